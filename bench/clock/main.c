@@ -0,0 +1,178 @@
+/**
+ * @file main.c
+ * @brief Host benchmark for the clock manager (lib/aes132/aes132_clock.h)
+ *
+ * Runs Info commands against the fake device (tools/aes132_fake_device) through
+ * the real communication layer. The bus in between spins for the transfer time
+ * of every transaction at the clock the manager sets (9 clocks per byte, plus
+ * address and word address bytes), so the rates differ in time as on a board.
+ *
+ * - fixed:  each rate alone on a clean bus: us per command, and the throughput
+ *           the manager measured at the transport
+ * - board:  the default policy (1 MHz, 400 kHz, 100 kHz) on a bus that flips a
+ *           bit of responses read above 400 kHz: what the manager does per rate
+ *
+ * Usage: pio run -e native_bench_clock -t exec
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "aes132_clock.h"
+#include "aes132_comm_marshaling.h"
+#include "aes132_device.h"
+#include "aes132_fake_device.h"
+
+#define BENCH_COMMANDS 500
+#define BENCH_BOARD_COMMANDS 2000
+
+//! clocks per byte: 8 data bits and an acknowledge
+#define BUS_CLOCKS_PER_BYTE 9
+
+//! bytes sent besides the data of a read: I2C address, two word address bytes, I2C read address
+#define BUS_READ_OVERHEAD_BYTES 4
+
+//! bytes sent besides the data of a write: I2C address, two word address bytes
+#define BUS_WRITE_OVERHEAD_BYTES 3
+
+//! fastest clock at which the simulated board reads responses intact
+#define BOARD_MAX_CLOCK_HZ 400000
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// bus that takes its transfer time, around the fake device; the default transport of this build
+// (-DAES132_TRANSPORT_DEFAULT=bench_transport)
+
+static struct {
+  struct aes132h_fake_device fake;
+  uint32_t clock_hz;
+} bus;
+
+static void bus_spin(uint16_t n_bytes) {
+  double end = now_ns() + (double)n_bytes * BUS_CLOCKS_PER_BYTE * 1e9 / bus.clock_hz;
+  while (now_ns() < end) {
+  }
+}
+
+static void bus_enable_interface(void *context) {
+  (void)context;
+  bus.fake.transport.enable_interface(&bus.fake);
+}
+
+static void bus_disable_interface(void *context) {
+  (void)context;
+  bus.fake.transport.disable_interface(&bus.fake);
+}
+
+static uint8_t bus_select_device(void *context, uint8_t device_id) {
+  (void)context;
+  return bus.fake.transport.select_device(&bus.fake, device_id);
+}
+
+static uint8_t bus_read_memory(void *context, uint8_t size, uint16_t word_address,
+                               uint8_t *data) {
+  (void)context;
+  uint8_t result = bus.fake.transport.read_memory(&bus.fake, size, word_address, data);
+  // A nacked address ends the transaction after its first byte.
+  bus_spin(result == AES132_FUNCTION_RETCODE_SUCCESS ? BUS_READ_OVERHEAD_BYTES + size : 1);
+  return result;
+}
+
+static uint8_t bus_write_memory_segments(void *context, uint16_t word_address,
+                                         const struct aes132_segment *segments,
+                                         uint8_t n_segments) {
+  (void)context;
+  uint16_t n_bytes = BUS_WRITE_OVERHEAD_BYTES;
+  uint8_t result = bus.fake.transport.write_memory_segments(&bus.fake, word_address, segments,
+                                                            n_segments);
+  for (uint8_t i = 0; i < n_segments; i++) {
+    n_bytes += segments[i].count;
+  }
+  bus_spin(result == AES132_FUNCTION_RETCODE_SUCCESS ? n_bytes : 1);
+  return result;
+}
+
+static uint8_t bus_resync(void *context) {
+  (void)context;
+  return bus.fake.transport.resync(&bus.fake);
+}
+
+static uint8_t bus_set_clock(void *context, uint32_t clock_hz) {
+  (void)context;
+  bus.clock_hz = clock_hz;
+  return bus.fake.transport.set_clock(&bus.fake, clock_hz);
+}
+
+const struct aes132_transport bench_transport = {
+    bus_enable_interface, bus_disable_interface, bus_select_device, bus_read_memory,
+    bus_write_memory_segments, bus_resync, bus_set_clock, NULL};
+
+//! runs Info commands; returns us per command, and counts the commands that failed
+static double run_commands(int n_commands, int *n_failed) {
+  uint8_t command[AES132_COMMAND_SIZE_MAX];
+  uint8_t response[AES132_RESPONSE_SIZE_MAX];
+  double start = now_ns();
+
+  *n_failed = 0;
+  for (int n = 0; n < n_commands; n++) {
+    if (aes132m_execute(AES132_INFO, 0, 0, 0, 0, NULL, 0, NULL, 0, NULL, 0, NULL, command,
+                        response) != AES132_FUNCTION_RETCODE_SUCCESS) {
+      (*n_failed)++;
+    }
+  }
+  return (now_ns() - start) / 1e3 / n_commands;
+}
+
+int main(void) {
+  static const uint32_t rates_hz[] = {AES132_CLOCK_RATES_HZ};
+  const uint8_t n_rates = sizeof(rates_hz) / sizeof(rates_hz[0]);
+  uint8_t device_index;
+  int n_failed;
+
+  aes132h_fake_device_init(&bus.fake);
+  bus.fake.execution_us = 1;
+  bus.clock_hz = rates_hz[n_rates - 1];
+  if (aes132c_select_device(0xA0) != AES132_FUNCTION_RETCODE_SUCCESS) {
+    printf("FAILED: cannot select the device\n");
+    return 1;
+  }
+  device_index = aes132c_get_device_index();
+
+  // Each rate alone on a clean bus.
+  printf("%-10s %12s %12s %12s\n", "fixed", "us/command", "kB/s", "failed");
+  for (uint8_t r = 0; r < n_rates; r++) {
+    const struct aes132_clock_policy fixed = {&rates_hz[r], 1, AES132_CLOCK_WINDOW,
+                                              AES132_CLOCK_MAX_ERRORS, 0};
+
+    aes132c_set_clock_policy(&fixed);
+    double us = run_commands(BENCH_COMMANDS, &n_failed);
+    printf("%-7u kHz %12.2f %12.1f %12d\n", (unsigned)(rates_hz[r] / 1000), us,
+           aes132c_get_clock_throughput(device_index, 0) / 1e3, n_failed);
+  }
+
+  // The default policy on a board that does not run above BOARD_MAX_CLOCK_HZ.
+  bus.fake.max_clock_hz = BOARD_MAX_CLOCK_HZ;
+  aes132c_set_clock_policy(NULL);
+  double us = run_commands(BENCH_BOARD_COMMANDS, &n_failed);
+  const struct aes132_clock_statistics *statistics = aes132c_get_clock_statistics(device_index);
+
+  printf("\n%-10s %12s %12s %12s %12s %12s\n", "board", "commands", "errors", "bytes", "bus ms",
+         "kB/s");
+  for (uint8_t r = 0; r < aes132c_get_clock_policy()->n_rates; r++) {
+    const struct aes132_clock_rate_statistics *rate = &statistics->rates[r];
+    printf("%-7u kHz %12u %12u %12u %12.1f %12.1f\n",
+           (unsigned)(aes132c_get_clock_policy()->rates_hz[r] / 1000), (unsigned)rate->n_commands,
+           (unsigned)rate->n_errors, (unsigned)rate->n_bytes, rate->bus_us / 1e3,
+           aes132c_get_clock_throughput(device_index, r) / 1e3);
+  }
+  printf("\n%.2f us/command, %u downshifts, %u upshifts, %d failed commands, ends at %u kHz\n", us,
+         (unsigned)statistics->n_downshifts, (unsigned)statistics->n_upshifts, n_failed,
+         (unsigned)(aes132c_get_clock_rate() / 1000));
+  return 0;
+}
@@ -0,0 +1,222 @@
+/**
+ * @file main.cpp
+ * @brief Host benchmark for overlapping device latency with other work using coroutines
+ *
+ * Runs the same flow (Nonce, Encrypt, 32 random bytes from two Random commands)
+ * against a simulated device, once with the blocking typed API
+ * (aes132_commands.h) and once as a coroutine (aes132_coro.h). While the
+ * coroutine is suspended, the main loop does units of other work between calls
+ * to Scheduler::poll(). The report shows the wall time per flow and how much
+ * other work fit into it.
+ *
+ * The simulated physical layer models a polled bus driver at 400 kHz like
+ * bench/wait. The device takes a fixed time per op-code.
+ *
+ * Usage: pio run -e native_bench_coro -t exec
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "aes132_commands.h"
+#include "aes132_coro.h"
+#include "aes132_opcode.h"
+#include "aes132_timer.h"
+
+#define BENCH_FLOWS 50
+
+//! transfer time of one byte in ns: 9 clocks at 400 kHz
+#define BUS_BYTE_NS 22500.0
+
+//! bytes sent besides the data: I2C address, two word address bytes, I2C read address
+#define BUS_OVERHEAD_BYTES 4
+
+//! simulated execution time in us by op-code
+static uint32_t execution_us(uint8_t op_code) {
+  switch (op_code) {
+    case AES132_NONCE:
+      return 1500;
+    case AES132_ENCRYPT:
+      return 2000;
+    case AES132_RANDOM:
+      return 1200;
+    default:
+      return 300;
+  }
+}
+
+// simulated device
+static uint32_t device_ready_us;
+static uint8_t device_response[AES132_RESPONSE_SIZE_MAX];
+static uint8_t device_response_index;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void bus_transfer(uint8_t count) {
+  double end = now_ns() + (count + BUS_OVERHEAD_BYTES) * BUS_BYTE_NS;
+  while (now_ns() < end) {
+  }
+}
+
+static void device_start(uint8_t op_code, uint8_t mode, uint16_t param2) {
+  uint8_t size = aes132c_get_response_size(op_code, mode, param2);
+
+  if (size == 0) {
+    size = AES132_RESPONSE_SIZE_MIN;
+  }
+  memset(device_response, 0, sizeof(device_response));
+  device_response[AES132_RESPONSE_INDEX_COUNT] = size;
+  for (uint8_t i = AES132_RESPONSE_INDEX_DATA; i < size - AES132_CRC_SIZE; i++) {
+    device_response[i] = i;
+  }
+  aes132c_calculate_crc(size - AES132_CRC_SIZE, device_response,
+                        &device_response[size - AES132_CRC_SIZE]);
+  device_response_index = 0;
+  device_ready_us = aes132c_now_us() + execution_us(op_code);
+}
+
+// transport of this build (-DAES132_TRANSPORT_DEFAULT=bench_transport)
+
+static void bench_set_interface(void *context) { (void)context; }
+
+static uint8_t bench_select_device(void *context, uint8_t device_id) {
+  (void)context;
+  (void)device_id;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t bench_resync(void *context) {
+  (void)context;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t bench_read_memory(void *context, uint8_t size, uint16_t word_address,
+                                 uint8_t *data) {
+  (void)context;
+  bus_transfer(size);
+  if (word_address == AES132_STATUS_ADDR) {
+    int32_t remaining_us = (int32_t)(device_ready_us - aes132c_now_us());
+    *data = (remaining_us <= 0) ? AES132_RESPONSE_READY_BIT : 0;
+  } else if (word_address == AES132_IO_ADDR) {
+    for (uint8_t i = 0; i < size; i++) {
+      data[i] = device_response[device_response_index++ % sizeof(device_response)];
+    }
+  } else {
+    memset(data, 0, size);
+  }
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t bench_write_memory_segments(void *context, uint16_t word_address,
+                                           const struct aes132_segment *segments,
+                                           uint8_t n_segments) {
+  uint8_t count = 0;
+
+  (void)context;
+  for (uint8_t i = 0; i < n_segments; i++) {
+    count += segments[i].count;
+  }
+  bus_transfer(count);
+  if (word_address == AES132_IO_ADDR) {
+    const uint8_t *header = segments[0].data;
+    device_start(header[AES132_COMMAND_INDEX_OPCODE], header[AES132_COMMAND_INDEX_MODE],
+                 (uint16_t)((header[AES132_COMMAND_INDEX_PARAM2_MSB] << 8) |
+                            header[AES132_COMMAND_INDEX_PARAM2_LSB]));
+  }
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+extern "C" const struct aes132_transport bench_transport = {
+    bench_set_interface, bench_set_interface, bench_select_device, bench_read_memory,
+    bench_write_memory_segments, bench_resync, NULL, NULL};
+
+static const uint8_t seed[12] = {0};
+static const uint8_t plaintext[16] = {0};
+
+//! one unit of other work for the main loop
+static volatile uint32_t work_sink;
+static uint32_t other_work(void) {
+  for (uint32_t i = 0; i < 100; i++) {
+    work_sink = work_sink * 1664525u + 1013904223u;
+  }
+  return 1;
+}
+
+static uint8_t flow_blocking(void) {
+  aes132::Nonce<0x01>::Response nonce;
+  aes132::Encrypt<16>::Response encrypted;
+  aes132::Random::Response random;
+
+  uint8_t ret = aes132::Nonce<0x01>::execute(seed, nonce);
+  if (ret == AES132_DEVICE_RETCODE_SUCCESS) {
+    ret = aes132::Encrypt<16>::execute(0, 0, plaintext, encrypted);
+  }
+  for (int i = 0; i < 2 && ret == AES132_DEVICE_RETCODE_SUCCESS; i++) {
+    ret = aes132::Random::execute(0, random);
+  }
+  return ret;
+}
+
+static uint8_t flow_result;
+
+static aes132::Task flow(aes132::Device &device) {
+  aes132::Nonce<0x01>::Response nonce;
+  aes132::Encrypt<16>::Response encrypted;
+  uint8_t random[32];
+
+  uint8_t ret = co_await device.nonce<0x01>(seed, nonce);
+  if (ret == AES132_DEVICE_RETCODE_SUCCESS) {
+    ret = co_await device.encrypt(0, 0, plaintext, encrypted);
+  }
+  if (ret == AES132_DEVICE_RETCODE_SUCCESS) {
+    ret = co_await device.random_bytes(random, sizeof(random));
+  }
+  flow_result = ret;
+  co_return ret;
+}
+
+int main(void) {
+  aes132::Scheduler scheduler;
+  aes132::Device device(scheduler, 0xA0);
+
+  printf("%-12s %12s %12s\n", "mode", "wall us", "work units");
+
+  double start = now_ns();
+  for (int n = 0; n < BENCH_FLOWS; n++) {
+    uint8_t result = flow_blocking();
+    if (result != AES132_FUNCTION_RETCODE_SUCCESS) {
+      printf("FAILED: blocking flow returned 0x%02X\n", result);
+      return 1;
+    }
+  }
+  printf("%-12s %12.0f %12u\n", "blocking", (now_ns() - start) / 1e3 / BENCH_FLOWS, 0u);
+
+  uint32_t work = 0;
+  start = now_ns();
+  for (int n = 0; n < BENCH_FLOWS; n++) {
+    flow_result = AES132_FUNCTION_RETCODE_COMM_FAIL;
+    if (!scheduler.spawn(flow(device))) {
+      printf("FAILED: no coroutine frame\n");
+      return 1;
+    }
+    while (scheduler.poll()) {
+      work += other_work();
+    }
+    if (flow_result != AES132_FUNCTION_RETCODE_SUCCESS) {
+      printf("FAILED: coroutine flow returned 0x%02X\n", flow_result);
+      return 1;
+    }
+  }
+  printf("%-12s %12.0f %12u\n", "coroutine", (now_ns() - start) / 1e3 / BENCH_FLOWS,
+         work / BENCH_FLOWS);
+
+  printf("\nframes: %u of %u free, %u bytes each\n", aes132::frame_pool.available(),
+         (unsigned)AES132_CORO_FRAME_COUNT, (unsigned)AES132_CORO_FRAME_SIZE);
+  return 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file main.c
+ * @brief Host benchmark for the CRC-16 kernels in tools/aes132_crc_host
+ *
+ * Every kernel is first checked bit for bit against the firmware implementation
+ * (aes132c_calculate_crc_bitwise, and aes132c_crc_update for buffers longer than
+ * one packet). Then it reports the throughput of each kernel in GB/s on a large
+ * buffer and the packet rate of aes132h_validate_packets() on a stream of
+ * back-to-back packets, like an I2C capture. Exits with 1 on any mismatch.
+ *
+ * Usage: pio run -e native_bench_crc_host -t exec
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aes132_comm.h"
+#include "aes132_crc.h"
+#include "aes132_crc_host.h"
+
+#define BUFFER_SIZE (16UL * 1024 * 1024)
+#define BUFFER_ROUNDS 8
+#define STREAM_PACKETS 200000UL
+#define STREAM_ROUNDS 10
+
+typedef uint16_t (*crc_kernel)(uint16_t crc, const uint8_t *data, size_t length);
+
+static const struct {
+  enum aes132h_crc_kernel kernel;
+  crc_kernel function;
+} kernels[] = {
+    {AES132H_CRC_KERNEL_TABLE, aes132h_crc16_table},
+    {AES132H_CRC_KERNEL_SLICE8, aes132h_crc16_slice8},
+    {AES132H_CRC_KERNEL_PCLMUL, aes132h_crc16_pclmul},
+};
+
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Reference CRC of any length, fed to the firmware in pieces of at most 255 bytes.
+static uint16_t reference_crc(uint16_t crc, const uint8_t *data, size_t length) {
+  struct aes132_crc_context context = {crc};
+  uint8_t bytes[AES132_CRC_SIZE];
+
+  while (length > 0) {
+    uint8_t chunk = length > 255 ? 255 : (uint8_t)length;
+    aes132c_crc_update(&context, chunk, data);
+    data += chunk;
+    length -= chunk;
+  }
+  aes132c_crc_final(&context, bytes);
+  return (uint16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+static int verify_kernels(const uint8_t *buffer) {
+  uint8_t crc[AES132_CRC_SIZE];
+
+  // Every packet length, compared with the firmware's original loop.
+  for (size_t length = 0; length <= AES132_COMMAND_SIZE_MAX; length++) {
+    aes132c_calculate_crc_bitwise((uint8_t)length, buffer, crc);
+    uint16_t expected = (uint16_t)((crc[0] << 8) | crc[1]);
+    for (size_t k = 0; k < KERNEL_COUNT; k++) {
+      if (kernels[k].function(0, buffer, length) != expected) {
+        printf("MISMATCH: %s, length %zu\n",
+               aes132h_crc_kernel_name(kernels[k].kernel), length);
+        return 1;
+      }
+    }
+  }
+
+  // Longer buffers, odd offsets and a running CRC exercise all folding paths.
+  for (size_t length = 0; length <= 1100; length += (length < 300 ? 1 : 37)) {
+    for (size_t offset = 0; offset < 3; offset++) {
+      uint16_t start = (uint16_t)(length * 0x9E37u);
+      uint16_t expected = reference_crc(start, buffer + offset, length);
+      for (size_t k = 0; k < KERNEL_COUNT; k++) {
+        if (kernels[k].function(start, buffer + offset, length) != expected) {
+          printf("MISMATCH: %s, length %zu, offset %zu, start 0x%04X\n",
+                 aes132h_crc_kernel_name(kernels[k].kernel), length, offset,
+                 start);
+          return 1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+// Fills buffer with back-to-back packets of varying size; every 16th CRC is corrupted.
+static size_t build_stream(uint8_t *stream, unsigned long packets,
+                           unsigned long *bad_packets) {
+  size_t offset = 0;
+  *bad_packets = 0;
+
+  for (unsigned long n = 0; n < packets; n++) {
+    uint8_t count = (uint8_t)(AES132_RESPONSE_SIZE_MIN +
+                              n % (AES132_COMMAND_SIZE_MAX - AES132_RESPONSE_SIZE_MIN + 1));
+    uint8_t *packet = &stream[offset];
+    packet[AES132_RESPONSE_INDEX_COUNT] = count;
+    for (uint8_t i = 1; i < count - AES132_CRC_SIZE; i++) {
+      packet[i] = (uint8_t)(n * 13 + i);
+    }
+    aes132c_calculate_crc(count - AES132_CRC_SIZE, packet, &packet[count - AES132_CRC_SIZE]);
+    if (n % 16 == 15) {
+      packet[count - 1] ^= 0x01;
+      (*bad_packets)++;
+    }
+    offset += count;
+  }
+  return offset;
+}
+
+int main(void) {
+  uint8_t *buffer = malloc(BUFFER_SIZE);
+  uint8_t *stream = malloc(STREAM_PACKETS * AES132_COMMAND_SIZE_MAX);
+  struct aes132h_packet_result *results =
+      malloc(STREAM_PACKETS * sizeof(*results));
+  volatile uint16_t sink = 0;
+
+  if (!buffer || !stream || !results) {
+    printf("out of memory\n");
+    return 1;
+  }
+
+  for (size_t i = 0; i < BUFFER_SIZE; i++) {
+    buffer[i] = (uint8_t)(i * 37 + (i >> 8) + 11);
+  }
+
+  if (verify_kernels(buffer) != 0) {
+    return 1;
+  }
+  printf("all kernels match the firmware CRC\n");
+  printf("auto-selected kernel: %s\n\n",
+         aes132h_crc_kernel_name(aes132h_crc_select_kernel(AES132H_CRC_KERNEL_AUTO)));
+
+  printf("%-8s %10s %10s\n", "kernel", "MiB", "GB/s");
+  for (size_t k = 0; k < KERNEL_COUNT; k++) {
+    if (!aes132h_crc_kernel_supported(kernels[k].kernel)) {
+      printf("%-8s %10s\n", aes132h_crc_kernel_name(kernels[k].kernel),
+             "unsupported");
+      continue;
+    }
+    double start = now_ns();
+    for (int round = 0; round < BUFFER_ROUNDS; round++) {
+      sink ^= kernels[k].function(sink, buffer, BUFFER_SIZE);
+    }
+    double elapsed = now_ns() - start;
+    printf("%-8s %10lu %10.2f\n", aes132h_crc_kernel_name(kernels[k].kernel),
+           BUFFER_SIZE >> 20,
+           (double)BUFFER_SIZE * BUFFER_ROUNDS / elapsed);
+  }
+
+  unsigned long bad_packets;
+  size_t stream_length = build_stream(stream, STREAM_PACKETS, &bad_packets);
+  size_t consumed = 0;
+  size_t n_results = 0;
+  double start = now_ns();
+  for (int round = 0; round < STREAM_ROUNDS; round++) {
+    n_results = aes132h_validate_packets(stream, stream_length, results,
+                                         STREAM_PACKETS, &consumed);
+  }
+  double elapsed = now_ns() - start;
+
+  unsigned long failed = 0;
+  for (size_t i = 0; i < n_results; i++) {
+    if (results[i].status != AES132_FUNCTION_RETCODE_SUCCESS) {
+      failed++;
+    }
+  }
+  if (n_results != STREAM_PACKETS || consumed != stream_length ||
+      failed != bad_packets) {
+    printf("MISMATCH: batch validation found %lu bad of %zu packets, expected "
+           "%lu of %lu\n",
+           failed, n_results, bad_packets, STREAM_PACKETS);
+    return 1;
+  }
+
+  printf("\nbatch validation: %lu packets (%zu bytes), %lu bad CRCs found\n",
+         STREAM_PACKETS, stream_length, failed);
+  printf("%.1f Mpackets/s, %.2f GB/s\n",
+         (double)STREAM_PACKETS * STREAM_ROUNDS / elapsed * 1e3,
+         (double)stream_length * STREAM_ROUNDS / elapsed);
+
+  (void)sink;
+  free(results);
+  free(stream);
+  free(buffer);
+  return 0;
+}
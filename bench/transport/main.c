@@ -0,0 +1,361 @@
+/**
+ * @file main.c
+ * @brief Host benchmark for the cost of calling the physical layer through a transport
+ *
+ * The aes132p_* functions call the transport of the selected device through a
+ * function pointer (aes132_transport.h). The library used to call the physical
+ * layer directly. This benchmark compares, per call of a read that does nothing:
+ *
+ * - direct:     a direct call of a function in another translation unit, as before
+ * - transport:  aes132p_read_memory_physical() through the transport
+ * - wrapped:    the same through a tracing wrapper that counts calls and calls the transport
+ *
+ * It then runs Info commands against the fake device (tools/aes132_fake_device)
+ * through the real communication layer, counts the bus calls per command with the
+ * wrapper, and reports what the dispatch adds per command.
+ *
+ * Built with AES132_I2C_MASTER=1, it also runs the Info commands through
+ * aes132_i2c_master_transport on the stand-in of the ESP-IDF driver
+ * (tools/aes132_i2c_master_host) and reports the I2C transactions per command.
+ *
+ * Built with AES132_SPI=1 as well, it runs commands with payloads through both
+ * backends, SPI on the fake SPI device (tools/aes132_spi_master_host), and
+ * compares the frames, bytes and bus time per command. The bus time is computed
+ * from the bytes: 9 clocks per I2C byte, counting two I2C address bytes per
+ * transaction, and 8 clocks per SPI byte.
+ *
+ * Usage: pio run -e native_bench_transport -t exec
+ *        pio run -e native_bench_transport_i2c_master -t exec
+ *        pio run -e native_bench_transport_spi -t exec
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "aes132_comm_marshaling.h"
+#include "aes132_device.h"
+#include "aes132_fake_device.h"
+#include "aes132_i2c_master.h"
+
+#if AES132_I2C_MASTER
+#include "aes132_i2c_master_host.h"
+#endif
+
+#if AES132_SPI
+#include "aes132_spi_master_host.h"
+#endif
+
+#define BENCH_CALLS 20000000UL
+#define BENCH_ROUNDS 5
+#define BENCH_COMMANDS 20000
+#define BENCH_PAYLOAD_COMMANDS 1000
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// transport that does nothing, the default of this build (-DAES132_TRANSPORT_DEFAULT=bench_transport)
+
+static void null_set_interface(void *context) { (void)context; }
+
+static uint8_t null_select_device(void *context, uint8_t device_id) {
+  (void)context;
+  (void)device_id;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+__attribute__((noinline)) static uint8_t null_read_memory(void *context, uint8_t size,
+                                                          uint16_t word_address, uint8_t *data) {
+  (void)context;
+  (void)size;
+  (void)word_address;
+  data[0] = 0;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t null_write_memory_segments(void *context, uint16_t word_address,
+                                          const struct aes132_segment *segments,
+                                          uint8_t n_segments) {
+  (void)context;
+  (void)word_address;
+  (void)segments;
+  (void)n_segments;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t null_resync(void *context) {
+  (void)context;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+const struct aes132_transport bench_transport = {
+    null_set_interface, null_set_interface, null_select_device, null_read_memory,
+    null_write_memory_segments, null_resync, NULL, NULL};
+
+//! the physical layer as it was called before: a plain function
+__attribute__((noinline)) static uint8_t direct_read_memory_physical(uint8_t size,
+                                                                     uint16_t word_address,
+                                                                     uint8_t *data) {
+  (void)size;
+  (void)word_address;
+  data[0] = 0;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+#if AES132_I2C_MASTER && AES132_SPI
+static const struct {
+  const char *name;
+  uint8_t op_code;
+  uint16_t param2;
+  uint8_t data_size; //!< bytes of data sent with the command
+} payload_commands[] = {
+    {"Info", AES132_INFO, 0, 0},
+    {"Random", AES132_RANDOM, 0, 0},
+    {"Encrypt 32", AES132_ENCRYPT, 32, 32},
+    {"EncRead 32", AES132_ENC_READ, 32, 0},
+};
+
+#define PAYLOAD_COMMAND_COUNT (sizeof(payload_commands) / sizeof(payload_commands[0]))
+
+//! runs a command with a payload BENCH_PAYLOAD_COMMANDS times on a transport
+static uint8_t run_payload_command(unsigned c, const struct aes132_transport *transport) {
+  uint8_t command[AES132_COMMAND_SIZE_MAX];
+  uint8_t response[AES132_RESPONSE_SIZE_MAX];
+  uint8_t data[32] = {0};
+
+  aes132c_use_transport(transport);
+  aes132p_enable_interface();
+  uint8_t result = aes132c_select_device_transport(0xA0, transport);
+  for (int n = 0; n < BENCH_PAYLOAD_COMMANDS && result == AES132_FUNCTION_RETCODE_SUCCESS; n++) {
+    result = aes132m_execute(payload_commands[c].op_code, 0, 0, payload_commands[c].param2,
+                             payload_commands[c].data_size, data, 0, NULL, 0, NULL, 0, NULL,
+                             command, response);
+  }
+  aes132p_disable_interface();
+  return result;
+}
+#endif
+
+// tracing wrapper around another transport
+
+struct trace {
+  struct aes132_transport transport;
+  const struct aes132_transport *inner;
+  uint32_t n_calls;
+};
+
+static void trace_enable_interface(void *context) {
+  struct trace *trace = (struct trace *)context;
+  trace->n_calls++;
+  trace->inner->enable_interface(trace->inner->context);
+}
+
+static void trace_disable_interface(void *context) {
+  struct trace *trace = (struct trace *)context;
+  trace->n_calls++;
+  trace->inner->disable_interface(trace->inner->context);
+}
+
+static uint8_t trace_select_device(void *context, uint8_t device_id) {
+  struct trace *trace = (struct trace *)context;
+  trace->n_calls++;
+  return trace->inner->select_device(trace->inner->context, device_id);
+}
+
+static uint8_t trace_read_memory(void *context, uint8_t size, uint16_t word_address,
+                                 uint8_t *data) {
+  struct trace *trace = (struct trace *)context;
+  trace->n_calls++;
+  return trace->inner->read_memory(trace->inner->context, size, word_address, data);
+}
+
+static uint8_t trace_write_memory_segments(void *context, uint16_t word_address,
+                                           const struct aes132_segment *segments,
+                                           uint8_t n_segments) {
+  struct trace *trace = (struct trace *)context;
+  trace->n_calls++;
+  return trace->inner->write_memory_segments(trace->inner->context, word_address, segments,
+                                             n_segments);
+}
+
+static uint8_t trace_resync(void *context) {
+  struct trace *trace = (struct trace *)context;
+  trace->n_calls++;
+  return trace->inner->resync(trace->inner->context);
+}
+
+static uint8_t trace_set_clock(void *context, uint32_t clock_hz) {
+  struct trace *trace = (struct trace *)context;
+  trace->n_calls++;
+  if (!trace->inner->set_clock) {
+    return AES132_FUNCTION_RETCODE_NOT_IMPLEMENTED;
+  }
+  return trace->inner->set_clock(trace->inner->context, clock_hz);
+}
+
+static void trace_init(struct trace *trace, const struct aes132_transport *inner) {
+  trace->transport.enable_interface = trace_enable_interface;
+  trace->transport.disable_interface = trace_disable_interface;
+  trace->transport.select_device = trace_select_device;
+  trace->transport.read_memory = trace_read_memory;
+  trace->transport.write_memory_segments = trace_write_memory_segments;
+  trace->transport.resync = trace_resync;
+  trace->transport.set_clock = trace_set_clock;
+  trace->transport.context = trace;
+  trace->inner = inner;
+  trace->n_calls = 0;
+}
+
+enum { MODE_DIRECT, MODE_TRANSPORT, MODE_WRAPPED, MODE_COUNT };
+
+static const char *mode_names[MODE_COUNT] = {"direct", "transport", "wrapped"};
+
+//! ns per call of a read, best of BENCH_ROUNDS
+static double time_calls(int mode) {
+  double best = 0;
+
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    uint8_t data;
+    uint32_t sum = 0;
+    double start = now_ns();
+
+    if (mode == MODE_DIRECT) {
+      for (unsigned long i = 0; i < BENCH_CALLS; i++) {
+        sum += direct_read_memory_physical(1, AES132_STATUS_ADDR, &data);
+      }
+    } else {
+      for (unsigned long i = 0; i < BENCH_CALLS; i++) {
+        sum += aes132p_read_memory_physical(1, AES132_STATUS_ADDR, &data);
+      }
+    }
+
+    double ns = (now_ns() - start) / BENCH_CALLS;
+    if (sum != 0) {
+      printf("FAILED: read returned an error\n");
+    }
+    if (round == 0 || ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+int main(void) {
+  static struct aes132h_fake_device fake;
+  static struct trace trace;
+  double ns[MODE_COUNT];
+
+  // Calls through the default transport, and through a wrapper around it.
+  trace_init(&trace, &bench_transport);
+  for (int mode = 0; mode < MODE_COUNT; mode++) {
+    aes132c_use_transport(mode == MODE_WRAPPED ? &trace.transport : &bench_transport);
+    ns[mode] = time_calls(mode);
+  }
+
+  printf("%-12s %12s %12s\n", "call", "ns/call", "vs direct");
+  for (int mode = 0; mode < MODE_COUNT; mode++) {
+    printf("%-12s %12.2f %+12.2f\n", mode_names[mode], ns[mode], ns[mode] - ns[MODE_DIRECT]);
+  }
+
+  // Info commands against the fake device, counting bus calls with the wrapper.
+  aes132h_fake_device_init(&fake);
+  fake.execution_us = 1;
+  trace_init(&trace, &fake.transport);
+
+  double us[MODE_COUNT];
+  double calls = 0;
+  for (int mode = MODE_TRANSPORT; mode < MODE_COUNT; mode++) {
+    uint8_t command[AES132_COMMAND_SIZE_MAX];
+    uint8_t response[AES132_RESPONSE_SIZE_MAX];
+    uint8_t result = aes132c_select_device_transport(
+        0xA0, mode == MODE_WRAPPED ? &trace.transport : &fake.transport);
+
+    trace.n_calls = 0;
+    double start = now_ns();
+    for (int n = 0; n < BENCH_COMMANDS && result == AES132_FUNCTION_RETCODE_SUCCESS; n++) {
+      result = aes132m_execute(AES132_INFO, 0, 0, 0, 0, NULL, 0, NULL, 0, NULL, 0, NULL, command,
+                               response);
+    }
+    us[mode] = (now_ns() - start) / 1e3 / BENCH_COMMANDS;
+    if (result != AES132_FUNCTION_RETCODE_SUCCESS) {
+      printf("FAILED: Info returned 0x%02X\n", result);
+      return 1;
+    }
+    if (mode == MODE_WRAPPED) {
+      calls = (double)trace.n_calls / BENCH_COMMANDS;
+    }
+  }
+
+  // Both runs make the same calls; the wrapper counted them.
+  printf("\n%-12s %12s %12s %12s\n", "command", "us/command", "calls", "dispatch ns");
+  for (int mode = MODE_TRANSPORT; mode < MODE_COUNT; mode++) {
+    printf("%-12s %12.2f %12.1f %12.1f\n", mode_names[mode], us[mode], calls,
+           calls * (ns[mode] - ns[MODE_DIRECT]));
+  }
+
+#if AES132_I2C_MASTER
+  // The same commands through the ESP-IDF backend on the stand-in of its driver.
+  uint8_t command[AES132_COMMAND_SIZE_MAX];
+  uint8_t response[AES132_RESPONSE_SIZE_MAX];
+  aes132h_i2c_master_attach(&fake);
+  aes132c_use_transport(&aes132_i2c_master_transport);
+  aes132p_enable_interface();
+  uint8_t result = aes132c_select_device_transport(0xA0, &aes132_i2c_master_transport);
+
+  double start = now_ns();
+  for (int n = 0; n < BENCH_COMMANDS && result == AES132_FUNCTION_RETCODE_SUCCESS; n++) {
+    result = aes132m_execute(AES132_INFO, 0, 0, 0, 0, NULL, 0, NULL, 0, NULL, 0, NULL, command,
+                             response);
+  }
+  double us_i2c_master = (now_ns() - start) / 1e3 / BENCH_COMMANDS;
+  aes132p_disable_interface();
+  if (result != AES132_FUNCTION_RETCODE_SUCCESS) {
+    printf("FAILED: Info through i2c_master returned 0x%02X\n", result);
+    return 1;
+  }
+
+  const struct aes132h_i2c_master_statistics *statistics = aes132h_i2c_master_get_statistics();
+  printf("\n%-12s %12s %12s %12s %12s\n", "backend", "us/command", "transactions", "bytes",
+         "nacks");
+  printf("%-12s %12.2f %12.1f %12.1f %12.1f\n", "i2c_master", us_i2c_master,
+         (double)statistics->n_transactions / BENCH_COMMANDS,
+         (double)statistics->n_bytes / BENCH_COMMANDS,
+         (double)statistics->n_nacks / BENCH_COMMANDS);
+#endif
+
+#if AES132_I2C_MASTER && AES132_SPI
+  // Commands with payloads through both backends; the bus time follows from the bytes.
+  printf("\n%-12s %8s %8s %10s %10s %8s %8s %10s\n", "payload", "I2C tx", "bytes", "us 400k",
+         "us 1M", "SPI tx", "bytes", "us 10M");
+  for (unsigned c = 0; c < PAYLOAD_COMMAND_COUNT; c++) {
+    fake.is_nack_busy = 1;
+    aes132h_i2c_master_attach(&fake);
+    result = run_payload_command(c, &aes132_i2c_master_transport);
+    struct aes132h_i2c_master_statistics i2c = *aes132h_i2c_master_get_statistics();
+
+    aes132h_spi_master_attach(&fake);
+    if (result == AES132_FUNCTION_RETCODE_SUCCESS) {
+      result = run_payload_command(c, &aes132_spi_transport);
+    }
+    const struct aes132h_spi_master_statistics *spi = aes132h_spi_master_get_statistics();
+    if (result != AES132_FUNCTION_RETCODE_SUCCESS || spi->n_ignored_writes != 0) {
+      printf("FAILED: %s returned 0x%02X, %u writes ignored\n", payload_commands[c].name, result,
+             (unsigned)spi->n_ignored_writes);
+      return 1;
+    }
+
+    double i2c_clocks = (i2c.n_bytes + 2.0 * i2c.n_transactions) * 9 / BENCH_PAYLOAD_COMMANDS;
+    double spi_clocks = spi->n_bytes * 8.0 / BENCH_PAYLOAD_COMMANDS;
+    printf("%-12s %8.1f %8.1f %10.1f %10.1f %8.1f %8.1f %10.1f\n", payload_commands[c].name,
+           (double)i2c.n_transactions / BENCH_PAYLOAD_COMMANDS,
+           (double)i2c.n_bytes / BENCH_PAYLOAD_COMMANDS, i2c_clocks / 0.4, i2c_clocks / 1.0,
+           (double)spi->n_transactions / BENCH_PAYLOAD_COMMANDS,
+           (double)spi->n_bytes / BENCH_PAYLOAD_COMMANDS, spi_clocks / 10.0);
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file main.c
+ * @brief Host benchmark for the CPU time spent waiting for command execution
+ *
+ * Runs commands against a simulated device through the real communication layer
+ * (aes132_comm.c, aes132_comm_marshaling.c) and reports, per command, the wall
+ * time and the CPU time of the calling thread. The difference is the CPU time
+ * other tasks could use while the device executes.
+ *
+ * The simulated physical layer models a polled bus driver: every transaction
+ * spins for its transfer time at 400 kHz (9 clocks per byte, plus address and
+ * word address bytes). The device takes a fixed time per op-code, between the
+ * typical and the maximum time in aes132_opcode.c.
+ *
+ * The wait mode is chosen at build time (AES132_YIELDING_WAIT); run both
+ * environments and compare:
+ *
+ * Usage: pio run -e native_bench_wait -t exec
+ *        pio run -e native_bench_wait_yield -t exec
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "aes132_comm_marshaling.h"
+#include "aes132_opcode.h"
+#include "aes132_timer.h"
+
+#define BENCH_COMMANDS 20
+
+//! transfer time of one byte in ns: 9 clocks at 400 kHz
+#define BUS_BYTE_NS 22500.0
+
+//! bytes sent besides the data: I2C address, two word address bytes, I2C read address
+#define BUS_OVERHEAD_BYTES 4
+
+static const struct {
+  const char *name;
+  uint8_t op_code;
+  uint8_t mode;
+  uint16_t param2;
+  uint32_t execution_us; //!< simulated execution time
+} commands[] = {
+    {"Info", AES132_INFO, 0, 0, 300},
+    {"Encrypt (16 bytes)", AES132_ENCRYPT, 0, 16, 2000},
+    {"KeyCreate", AES132_KEY_CREATE, 0, 0, 12000},
+    {"TempSense", AES132_TEMP_SENSE, 0, 0, 60000},
+};
+
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+// simulated device
+static uint32_t device_execution_us;
+static uint32_t device_ready_us;
+static uint8_t device_response[AES132_RESPONSE_SIZE_MAX];
+static uint8_t device_response_index;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void bus_transfer(uint8_t count) {
+  double end = now_ns() + (count + BUS_OVERHEAD_BYTES) * BUS_BYTE_NS;
+  while (now_ns() < end) {
+  }
+}
+
+static void device_start(uint8_t op_code, uint8_t mode, uint16_t param2) {
+  uint8_t size = aes132c_get_response_size(op_code, mode, param2);
+
+  if (size == 0) {
+    size = AES132_RESPONSE_SIZE_MIN;
+  }
+  memset(device_response, 0, sizeof(device_response));
+  device_response[AES132_RESPONSE_INDEX_COUNT] = size;
+  aes132c_calculate_crc(size - AES132_CRC_SIZE, device_response,
+                        &device_response[size - AES132_CRC_SIZE]);
+  device_response_index = 0;
+  device_ready_us = aes132c_now_us() + device_execution_us;
+}
+
+// transport of this build (-DAES132_TRANSPORT_DEFAULT=bench_transport)
+
+static void bench_set_interface(void *context) { (void)context; }
+
+static uint8_t bench_select_device(void *context, uint8_t device_id) {
+  (void)context;
+  (void)device_id;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t bench_resync(void *context) {
+  (void)context;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t bench_read_memory(void *context, uint8_t size, uint16_t word_address,
+                                 uint8_t *data) {
+  (void)context;
+  bus_transfer(size);
+  if (word_address == AES132_STATUS_ADDR) {
+    int32_t remaining_us = (int32_t)(device_ready_us - aes132c_now_us());
+    *data = (remaining_us <= 0) ? AES132_RESPONSE_READY_BIT : 0;
+  } else if (word_address == AES132_IO_ADDR) {
+    for (uint8_t i = 0; i < size; i++) {
+      data[i] = device_response[device_response_index++ % sizeof(device_response)];
+    }
+  } else {
+    memset(data, 0, size);
+  }
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t bench_write_memory_segments(void *context, uint16_t word_address,
+                                           const struct aes132_segment *segments,
+                                           uint8_t n_segments) {
+  uint8_t count = 0;
+
+  (void)context;
+  for (uint8_t i = 0; i < n_segments; i++) {
+    count += segments[i].count;
+  }
+  bus_transfer(count);
+  if (word_address == AES132_IO_ADDR) {
+    const uint8_t *header = segments[0].data;
+    device_start(header[AES132_COMMAND_INDEX_OPCODE], header[AES132_COMMAND_INDEX_MODE],
+                 (uint16_t)((header[AES132_COMMAND_INDEX_PARAM2_MSB] << 8) |
+                            header[AES132_COMMAND_INDEX_PARAM2_LSB]));
+  }
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+const struct aes132_transport bench_transport = {
+    bench_set_interface, bench_set_interface, bench_select_device, bench_read_memory,
+    bench_write_memory_segments, bench_resync, NULL, NULL};
+
+int main(void) {
+  uint8_t tx_buffer[AES132_COMMAND_SIZE_MAX];
+  uint8_t rx_buffer[AES132_RESPONSE_SIZE_MAX];
+  uint8_t data[16] = {0};
+
+  printf("wait mode: %s\n\n", AES132_YIELDING_WAIT ? "yielding" : "busy");
+  printf("%-20s %12s %12s %12s\n", "command", "wall us", "cpu us", "idle us");
+
+  for (size_t c = 0; c < COMMAND_COUNT; c++) {
+    device_execution_us = commands[c].execution_us;
+
+    double wall_start = now_ns();
+    double cpu_start = cpu_ns();
+    for (int n = 0; n < BENCH_COMMANDS; n++) {
+      uint8_t result = aes132m_execute(commands[c].op_code, commands[c].mode, 0,
+                                       commands[c].param2,
+                                       (uint8_t)commands[c].param2, data, 0, NULL,
+                                       0, NULL, 0, NULL, tx_buffer, rx_buffer);
+      if (result != AES132_FUNCTION_RETCODE_SUCCESS) {
+        printf("FAILED: %s returned 0x%02X\n", commands[c].name, result);
+        return 1;
+      }
+    }
+    double wall_us = (now_ns() - wall_start) / 1e3 / BENCH_COMMANDS;
+    double cpu_us = (cpu_ns() - cpu_start) / 1e3 / BENCH_COMMANDS;
+
+    printf("%-20s %12.0f %12.0f %12.0f\n", commands[c].name, wall_us, cpu_us,
+           wall_us - cpu_us);
+  }
+
+  return 0;
+}
@@ -6,6 +6,7 @@
  * BlockRead 명령어를 사용하여 다양한 메모리 영역을 읽어옵니다.
  */
 
+#include "aes132_commands.h"
 #include "aes132_comm_marshaling.h"
 #include "aes132_config.h"
 #include "aes132_utils.h"
@@ -15,61 +16,40 @@
 /**
  * @brief BlockRead 명령어를 사용하여 메모리 읽기
  *
+ * 읽을 길이는 data 배열의 크기에서 컴파일 시에 정해집니다.
+ * aes132::BlockRead<Length>가 응답 크기(4 + Length)를 상수로 가지고 있으므로
+ * 수신 버퍼를 정확한 크기로 잡고, 데이터는 고정 오프셋에서 읽습니다.
+ *
  * @param zone_id 읽을 영역 ID (0-15)
  * @param block_id 읽을 블록 ID (0-7, 각 영역은 8개 블록으로 구성)
- * @param length 읽을 바이트 수 (최대 16바이트)
- * @param data 읽은 데이터를 저장할 버퍼
- * @return AES132_DEVICE_RETCODE_SUCCESS 성공 시
+ * @param data 읽은 데이터를 저장할 버퍼 (최대 16바이트)
+ * @return 읽은 바이트 수 (실패 시 0)
  */
-uint8_t readMemoryBlock(uint8_t zone_id, uint8_t block_id, uint8_t length,
-                        uint8_t *data) {
-  uint8_t tx_buffer[AES132_COMMAND_SIZE_MAX];
-  uint8_t rx_buffer[AES132_RESPONSE_SIZE_MAX];
+template <uint8_t Length>
+uint8_t readMemoryBlock(uint8_t zone_id, uint8_t block_id,
+                        uint8_t (&data)[Length]) {
+  using BlockRead = aes132::BlockRead<Length>;
+  typename BlockRead::Response response; // 정확히 4 + Length 바이트
 
   // BlockRead 명령어 파라미터 구성
   // param1: Zone ID (상위 4비트) + Block ID (하위 4비트)
   uint16_t param1 = ((uint16_t)zone_id << 8) | block_id;
 
-  // param2: 읽을 바이트 수
-  uint16_t param2 = length;
-
   // BlockRead 명령어 실행
   // [AES132 Datasheet 8.4 BlockRead Command]
-  // OpCode: 0x02 (AES132_BLOCK_READ) -> 블록 읽기
+  // OpCode: 0x10 (AES132_BLOCK_READ) -> 블록 읽기
   // Mode: 0 -> 메모리 직접 읽기
   // Param1: Address (Zone/Block)
-  // Param2: Length
-  uint8_t ret = aes132m_execute(
-      AES132_BLOCK_READ, // [OpCode] BlockRead (0x02): 블록 읽기 명령
-      0,                 // [Mode] 0: 메모리 직접 읽기
-      param1,            // [Param1] Address: 읽을 Zone/Block 주소
-      param2,            // [Param2] Length: 읽을 데이터 길이
-      0,                 // [Data1 Length] 0: 입력 데이터 없음
-      NULL,              // [Data1 Pointer] NULL: 입력 데이터 없음
-      0,                 // [Data2 Length] 0: 입력 데이터 없음
-      NULL,              // [Data2 Pointer] NULL: 입력 데이터 없음
-      0,                 // [Data3 Length] 0: 입력 데이터 없음
-      NULL,              // [Data3 Pointer] NULL: 입력 데이터 없음
-      0,                 // [Data4 Length] 0: 입력 데이터 없음
-      NULL,              // [Data4 Pointer] NULL: 입력 데이터 없음
-      tx_buffer,         // [TX Buffer] 송신 버퍼 포인터
-      rx_buffer          // [RX Buffer] 수신 버퍼 포인터
-  );
+  // Param2: Length (템플릿 인자에서 자동 설정)
+  uint8_t ret = BlockRead::execute(param1, response);
 
   if (ret == AES132_DEVICE_RETCODE_SUCCESS) {
     // 응답에서 데이터 추출
-    // rx_buffer[0]: Count
-    // rx_buffer[1]: Status (Return Code)
-    // rx_buffer[2]부터: 읽은 데이터
-    uint8_t data_length = rx_buffer[AES132_RESPONSE_INDEX_COUNT] -
-                          3; // Count - Status - Checksum(2)
-    uint8_t copy_length = (data_length < length) ? data_length : length;
-
-    for (uint8_t i = 0; i < copy_length; i++) {
-      data[i] = rx_buffer[AES132_RESPONSE_INDEX_DATA + i];
-    }
-
-    return copy_length;
+    // response.bytes[0]: Count
+    // response.bytes[1]: Status (Return Code)
+    // response.bytes[2]부터: 읽은 데이터 (BlockRead::data_offset)
+    memcpy(data, &response.bytes[BlockRead::data_offset], Length);
+    return Length;
   }
 
   return 0;
@@ -99,7 +79,7 @@ void setup(void) {
   // 예제 1: Zone 0, Block 0에서 16바이트 읽기
   Serial.println("=== Example 1: Read Zone 0, Block 0 (16 bytes) ===");
   uint8_t data1[16] = {0};
-  uint8_t bytes_read = readMemoryBlock(0, 0, 16, data1);
+  uint8_t bytes_read = readMemoryBlock(0, 0, data1);
 
   if (bytes_read > 0) {
     Serial.print("Successfully read ");
@@ -115,7 +95,7 @@ void setup(void) {
   // 예제 2: Zone 0, Block 1에서 8바이트 읽기
   Serial.println("=== Example 2: Read Zone 0, Block 1 (8 bytes) ===");
   uint8_t data2[8] = {0};
-  bytes_read = readMemoryBlock(0, 1, 8, data2);
+  bytes_read = readMemoryBlock(0, 1, data2);
 
   if (bytes_read > 0) {
     Serial.print("Successfully read ");
@@ -132,7 +112,7 @@ void setup(void) {
       "=== Example 3: Read Multiple Blocks (Zone 0, Blocks 0-2) ===");
   for (uint8_t block = 0; block < 3; block++) {
     uint8_t block_data[16] = {0};
-    bytes_read = readMemoryBlock(0, block, 16, block_data);
+    bytes_read = readMemoryBlock(0, block, block_data);
 
     if (bytes_read > 0) {
       Serial.print("Block ");
@@ -6,6 +6,7 @@
  * 암호학적으로 안전한 랜덤 숫자를 생성하는 방법을 보여줍니다.
  */
 
+#include "aes132_command_packet.h"
 #include "aes132_comm_marshaling.h"
 #include "aes132_config.h"
 #include "aes132_utils.h"
@@ -28,39 +29,19 @@ uint8_t generateRandom(uint8_t *random_data, uint8_t length) {
     return 0; // Return 0 on error (same pattern as read_memory_block)
   }
 
-  uint8_t tx_buffer[AES132_COMMAND_SIZE_MAX];
   uint8_t rx_buffer[AES132_RESPONSE_SIZE_MAX];
   memset(rx_buffer, 0, AES132_RESPONSE_SIZE_MAX); // Initialize buffer
 
-  // Random 명령어 파라미터 구성
-  // Mode: 0 (일반 랜덤 생성)
-  // Param1: 0 (Mode 0에서는 무시됨, 0으로 설정)
-  // Param2: 0 (사용 안 함)
-  uint16_t param1 = 0;
-  uint16_t param2 = 0;
-
   // Random 명령어 실행
   // [AES132 Datasheet 8.12 Random Command]
-  // OpCode: 0x1B (AES132_RANDOM) -> 랜덤 생성
+  // OpCode: 0x02 (AES132_RANDOM) -> 랜덤 생성
   // Mode: 0 -> Seed Update 없이 난수 생성
-  // Param1: 0
-  // Param2: 0
-  uint8_t ret = aes132m_execute(
-      AES132_RANDOM, // [OpCode] Random (0x1B): 랜덤 데이터 생성 명령
-      0,             // [Mode] 0: Seed Update 없이 난수 생성
-      param1,        // [Param1] 0: Mode 0에서는 무시됨
-      param2,        // [Param2] 0: Mode 0에서는 무시됨
-      0,             // [Data1 Length] 0: 입력 데이터 없음
-      NULL,          // [Data1 Pointer] NULL: 입력 데이터 없음
-      0,             // [Data2 Length] 0: 입력 데이터 없음
-      NULL,          // [Data2 Pointer] NULL: 입력 데이터 없음
-      0,             // [Data3 Length] 0: 입력 데이터 없음
-      NULL,          // [Data3 Pointer] NULL: 입력 데이터 없음
-      0,             // [Data4 Length] 0: 입력 데이터 없음
-      NULL,          // [Data4 Pointer] NULL: 입력 데이터 없음
-      tx_buffer,     // [TX Buffer] 송신 버퍼 포인터
-      rx_buffer      // [RX Buffer] 수신 버퍼 포인터
-  );
+  // Param1: 0 (Mode 0에서는 무시됨)
+  // Param2: 0 (사용 안 함)
+  // 모든 필드가 상수이므로 CRC를 포함한 패킷 전체가 컴파일 시점에 생성되어
+  // 플래시에 저장됩니다 (aes132_command_packet.h). 런타임에 마샬링과 CRC 계산이
+  // 필요 없습니다.
+  uint8_t ret = aes132::execute_fixed<AES132_RANDOM, 0>(rx_buffer);
 
   if (ret == AES132_DEVICE_RETCODE_SUCCESS) {
     // 응답에서 랜덤 데이터 추출
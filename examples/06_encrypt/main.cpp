@@ -17,6 +17,7 @@
  * 3. Valid Key in Slot 0 -> Loaded by Ex 99.
  */
 
+#include "aes132_commands.h"
 #include "aes132_comm_marshaling.h"
 #include "aes132_utils.h"
 #include "i2c_phys.h"
@@ -28,13 +29,21 @@
 #define BLOCK_SIZE 16
 
 // --- Helper: Encrypt Function ---
-// Returns true on success
-// OUT: out_mac (16 bytes), out_ciphertext (16 bytes)
-bool encryptBlock(uint8_t key_id, const uint8_t *plaintext, uint8_t *out_mac,
-                  uint8_t *out_ciphertext) {
-  uint8_t tx_buf[AES132_COMMAND_SIZE_MAX];
-  uint8_t rx_buf[AES132_RESPONSE_SIZE_MAX];
-
+// Encrypt 명령은 KeyID와 길이가 매번 같고 평문만 바뀝니다.
+// 그래서 패킷을 한 번만 조립(aes132m_prepare)해 두고, 이후 호출에서는 평문 바이트만
+// 교체합니다 (aes132m_prepared_set_data). CRC는 바뀐 바이트만으로 보정되므로
+// 호출마다 마샬링과 전체 CRC 계산이 필요 없습니다.
+static struct aes132_prepared_command encrypt_command;
+static int16_t encrypt_command_key_id = -1; // -1: 아직 조립되지 않음
+
+// 응답은 호출자가 가진 rx_buf에 수신되고, 반환된 View가 그 버퍼를 가리킵니다.
+// Count/CRC는 수신 시 이미 검사되었고, View는 결과 코드와 응답 크기만 확인한 뒤
+// MAC과 암호문을 복사 없이 읽게 해 줍니다.
+// view.ok()가 true일 때만 필드를 읽으세요. View는 rx_buf보다 오래 쓰면 안 됩니다.
+using EncryptBlock = aes132::Encrypt<BLOCK_SIZE>;
+
+EncryptBlock::View encryptBlock(uint8_t key_id, const uint8_t *plaintext,
+                                uint8_t (&rx_buf)[AES132_RESPONSE_SIZE_MAX]) {
   // Encrypt OpCode: 0x06, Mode: 0 (Encrypt)
   // Param1: KeyID, Param2: Data Length (16)
   // Response: [Count][Status][MAC(16)][Ciphertext(16)][CRC]
@@ -45,45 +54,37 @@ bool encryptBlock(uint8_t key_id, const uint8_t *plaintext, uint8_t *out_mac,
   // Param2: Data Length -> 입력 데이터 길이 (16 bytes)
   // 결과: 칩은 입력된 평문을 암호화하고 MAC을 생성하여 반환합니다.
   // OutData: [Count][Status][MAC(16)][Ciphertext(16)][CRC]
-  uint8_t ret = aes132m_execute(
-      AES132_ENCRYPT,       // [OpCode] Encrypt (0x06): 암호화 명령
-      0,                    // [Mode] 0: Normal Encryption (일반 암호화 모드)
-      key_id,               // [Param1] KeyID: 암호화에 사용할 키 슬롯 번호
-      BLOCK_SIZE,           // [Param2] Data Length: 입력 데이터 길이 (16 bytes)
-      BLOCK_SIZE,           // [Data1 Length] 16: 입력 데이터(Plaintext) 길이
-      (uint8_t *)plaintext, // [Data1 Pointer] Plaintext: 평문 데이터 포인터
-      0,                    // [Data2 Length] 0: 입력 데이터 없음
-      NULL,                 // [Data2 Pointer] NULL: 입력 데이터 없음
-      0,                    // [Data3 Length] 0: 입력 데이터 없음
-      NULL,                 // [Data3 Pointer] NULL: 입력 데이터 없음
-      0,                    // [Data4 Length] 0: 입력 데이터 없음
-      NULL,                 // [Data4 Pointer] NULL: 입력 데이터 없음
-      tx_buf,               // [TX Buffer] 송신 버퍼 포인터
-      rx_buf                // [RX Buffer] 수신 버퍼 포인터
-  );
-
-  if (ret == AES132_DEVICE_RETCODE_SUCCESS) {
-    uint8_t count = rx_buf[AES132_RESPONSE_INDEX_COUNT];
-    // Expected Length: 1 (Count) + 1 (Status) + 16 (MAC) + 16 (Ciphertext) + 2
-    // (CRC) = 36 bytes
-    if (count >= 36) {
-      // Correct indexing:
-      // Index 0: Count
-      // Index 1: Status
-      // Index 2~17: MAC (16 bytes)
-      // Index 18~33: Ciphertext (16 bytes)
-      memcpy(out_mac, &rx_buf[AES132_RESPONSE_INDEX_DATA], 16);
-      memcpy(out_ciphertext, &rx_buf[AES132_RESPONSE_INDEX_DATA + 16], 16);
-      return true;
-    } else {
-      Serial.print("[Encrypt] Response too short: ");
-      Serial.println(count);
-    }
+  if (encrypt_command_key_id != key_id) {
+    aes132m_prepare(
+        &encrypt_command,     // [Prepared] 조립된 패킷을 저장할 구조체
+        AES132_ENCRYPT,       // [OpCode] Encrypt (0x06): 암호화 명령
+        0,                    // [Mode] 0: Normal Encryption (일반 암호화 모드)
+        key_id,               // [Param1] KeyID: 암호화에 사용할 키 슬롯 번호
+        BLOCK_SIZE,           // [Param2] Data Length: 입력 데이터 길이 (16 bytes)
+        BLOCK_SIZE,           // [Data1 Length] 16: 입력 데이터(Plaintext) 길이
+        (uint8_t *)plaintext, // [Data1 Pointer] Plaintext: 평문 데이터 포인터
+        0,                    // [Data2 Length] 0: 입력 데이터 없음
+        NULL,                 // [Data2 Pointer] NULL: 입력 데이터 없음
+        0,                    // [Data3 Length] 0: 입력 데이터 없음
+        NULL,                 // [Data3 Pointer] NULL: 입력 데이터 없음
+        0,                    // [Data4 Length] 0: 입력 데이터 없음
+        NULL                  // [Data4 Pointer] NULL: 입력 데이터 없음
+    );
+    encrypt_command_key_id = key_id;
+  } else {
+    // 평문(Data1, 오프셋 0)만 교체하고 CRC를 보정합니다.
+    aes132m_prepared_set_data(&encrypt_command, 0, BLOCK_SIZE, plaintext);
   }
 
-  Serial.print("[Encrypt] Failed. Code: 0x");
-  Serial.println(ret, HEX);
-  return false;
+  uint8_t ret = aes132m_prepared_execute(&encrypt_command, rx_buf);
+
+  // [Count][Status][MAC(16)][Ciphertext(16)][CRC(2)] = 36 bytes
+  EncryptBlock::View view(ret, rx_buf);
+  if (!view.ok()) {
+    Serial.print("[Encrypt] Failed. Code: 0x");
+    Serial.println(view.status(), HEX);
+  }
+  return view;
 }
 
 // --- Helper: Generate Nonce ---
@@ -184,18 +185,18 @@ void setup() {
   Serial.println("\n--- Test 1: Simple Data ---");
   uint8_t plaintext[16] = {0, 1, 2,  3,  4,  5,  6,  7,
                            8, 9, 10, 11, 12, 13, 14, 15};
-  uint8_t mac[16];
-  uint8_t ciphertext[16];
+  uint8_t rx_buf[AES132_RESPONSE_SIZE_MAX];
 
   Serial.print("Plaintext: ");
   print_hex("", plaintext, 16);
 
-  if (encryptBlock(KEY_SLOT_ID, plaintext, mac, ciphertext)) {
+  EncryptBlock::View view = encryptBlock(KEY_SLOT_ID, plaintext, rx_buf);
+  if (view.ok()) {
     Serial.println("-> Encryption SUCCESS!");
     Serial.print("MAC:        ");
-    print_hex("", mac, 16);
+    print_hex("", view.out_mac().data(), view.out_mac().size());
     Serial.print("Ciphertext: ");
-    print_hex("", ciphertext, 16);
+    print_hex("", view.ciphertext().data(), view.ciphertext().size());
 
     Serial.println(
         "\n[IMPORTANT] Store BOTH MAC and Ciphertext for Decryption (Ex 07).");
@@ -209,12 +210,13 @@ void setup() {
   Serial.print(text_msg);
   Serial.println("\"");
 
-  if (encryptBlock(KEY_SLOT_ID, plaintext, mac, ciphertext)) {
+  view = encryptBlock(KEY_SLOT_ID, plaintext, rx_buf);
+  if (view.ok()) {
     Serial.println("-> Encryption SUCCESS!");
     Serial.print("MAC:        ");
-    print_hex("", mac, 16);
+    print_hex("", view.out_mac().data(), view.out_mac().size());
     Serial.print("Ciphertext: ");
-    print_hex("", ciphertext, 16);
+    print_hex("", view.ciphertext().data(), view.ciphertext().size());
   }
 }
 
@@ -108,7 +108,6 @@ bool encryptBlock(uint8_t key_id, const uint8_t *plaintext, uint8_t *out_mac,
 // Returns: Plaintext(16)
 bool decryptBlock(uint8_t key_id, const uint8_t *mac, const uint8_t *ciphertext,
                   uint8_t *out_plaintext) {
-  uint8_t tx_buf[AES132_COMMAND_SIZE_MAX];
   uint8_t rx_buf[AES132_RESPONSE_SIZE_MAX];
 
   // Decrypt Command
@@ -123,22 +122,21 @@ bool decryptBlock(uint8_t key_id, const uint8_t *mac, const uint8_t *ciphertext,
   // Data1: Ciphertext (16 bytes)
   // Data2: MAC (16 bytes)
   // 참고: Loopback 테스트를 위해 암호화 결과(Cipher+MAC)를 입력으로 사용함
-  uint8_t ret = aes132m_execute(
+  // 참고: aes132m_execute_segments는 Ciphertext와 MAC을 송신 버퍼로 복사하지 않고
+  //       각 버퍼에서 바로 I2C로 전송합니다 (TX 버퍼 불필요).
+  const struct aes132_segment data[] = {
+      {ciphertext, BLOCK_SIZE}, // [Data1] Ciphertext: 암호문 (16 bytes)
+      {mac, BLOCK_SIZE},        // [Data2] MAC: 인증 태그 (16 bytes)
+  };
+  uint8_t ret = aes132m_execute_segments(
       AES132_DECRYPT, // [OpCode] Decrypt (0x07): 복호화 명령
       0,              // [Mode] 0: Normal Decryption (일반 복호화 모드)
       key_id,         // [Param1] KeyID: 복호화 키 슬롯 번호
       BLOCK_SIZE,     // [Param2] Result Length: 결과 데이터 길이 (16 bytes)
-      BLOCK_SIZE,     // [Data1 Length] 16: 입력 데이터 1 (Ciphertext) 길이
-      (uint8_t *)ciphertext, // [Data1 Pointer] Ciphertext: 암호문 포인터
-      BLOCK_SIZE,            // [Data2 Length] 16: 입력 데이터 2 (MAC) 길이
-      (uint8_t *)
-          mac, // [Data2 Pointer] MAC: 인증 태그 포인터 (Data order confirmed)
-      0,       // [Data3 Length] 0: 입력 데이터 없음
-      NULL,    // [Data3 Pointer] NULL: 입력 데이터 없음
-      0,       // [Data4 Length] 0: 입력 데이터 없음
-      NULL,    // [Data4 Pointer] NULL: 입력 데이터 없음
-      tx_buf,  // [TX Buffer] 송신 버퍼 포인터
-      rx_buf   // [RX Buffer] 수신 버퍼 포인터
+      data,           // [Data] 입력 데이터 세그먼트 목록
+      2,              // [Data Count] 세그먼트 개수
+      sizeof(rx_buf), // [RX Size] 수신 버퍼 크기
+      rx_buf          // [RX Buffer] 수신 버퍼 포인터
   );
 
   if (ret == AES132_DEVICE_RETCODE_SUCCESS) {
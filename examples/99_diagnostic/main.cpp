@@ -11,6 +11,7 @@
  */
 
 #include "aes132_comm_marshaling.h"
+#include "aes132_commands.h"
 #include "aes132_utils.h"
 #include "i2c_phys.h"
 #include <Arduino.h>
@@ -40,40 +41,25 @@ const uint8_t test_key[16] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
 
 // --- Helper Functions ---
 
+// BlockRead 응답은 호출자가 가진 Response 버퍼에 정확한 크기로 수신됩니다.
+// 반환된 View가 결과 코드와 응답 크기를 확인하고, 데이터는 view.data()로
+// 복사 없이 읽습니다. View는 Response 버퍼보다 오래 쓰면 안 됩니다.
+using Read4Bytes = aes132::BlockRead<4>;
+using Read16Bytes = aes132::BlockRead<16>;
+
 void printHeader(const char *title) {
   Serial.println("\n--------------------------------------------");
   Serial.println(title);
   Serial.println("--------------------------------------------");
 }
 
-uint8_t read4Bytes(uint16_t addr, uint8_t *data) {
-  uint8_t tx_buf[AES132_COMMAND_SIZE_MAX];
-  uint8_t rx_buf[AES132_RESPONSE_SIZE_MAX];
+Read4Bytes::View read4Bytes(uint16_t addr, Read4Bytes::Response &response) {
   // [AES132 Datasheet 8.4 BlockRead Command]
   // OpCode: 0x02 (AES132_BLOCK_READ) -> 블록 읽기
   // Mode: 0 -> 메모리 직접 읽기
   // Param1: Address -> 읽을 주소 (4바이트 단위)
   // Param2: Length (4) -> 읽을 길이
-  uint8_t ret = aes132m_execute(
-      AES132_BLOCK_READ, // [OpCode] BlockRead (0x02): 블록 읽기 명령
-      0,                 // [Mode] 0: 메모리 직접 읽기
-      addr,              // [Param1] Address: 읽을 주소 (4바이트)
-      4,                 // [Param2] Length: 읽을 데이터 길이
-      0,                 // [Data1 Length] 0: 입력 데이터 없음
-      NULL,              // [Data1 Pointer] NULL: 입력 데이터 없음
-      0,                 // [Data2 Length] 0: 입력 데이터 없음
-      NULL,              // [Data2 Pointer] NULL: 입력 데이터 없음
-      0,                 // [Data3 Length] 0: 입력 데이터 없음
-      NULL,              // [Data3 Pointer] NULL: 입력 데이터 없음
-      0,                 // [Data4 Length] 0: 입력 데이터 없음
-      NULL,              // [Data4 Pointer] NULL: 입력 데이터 없음
-      tx_buf,            // [TX Buffer] 송신 버퍼 포인터
-      rx_buf             // [RX Buffer] 수신 버퍼 포인터
-  );
-  if (ret == AES132_DEVICE_RETCODE_SUCCESS) {
-    memcpy(data, &rx_buf[AES132_RESPONSE_INDEX_DATA], 4);
-  }
-  return ret;
+  return Read4Bytes::View(Read4Bytes::execute(addr, response), response);
 }
 
 uint8_t writeConfig4Bytes(uint16_t addr, const uint8_t *data) {
@@ -82,16 +68,17 @@ uint8_t writeConfig4Bytes(uint16_t addr, const uint8_t *data) {
 
 // Check Lock State and return safe-to-write status
 bool checkAndPrintLockState() {
-  uint8_t buf[4];
-  if (read4Bytes(ADDR_LOCK_CONFIG, buf) != 0) {
+  Read4Bytes::Response response;
+  Read4Bytes::View lock_config = read4Bytes(ADDR_LOCK_CONFIG, response);
+  if (!lock_config.ok()) {
     Serial.println("Error: Failed to read LockConfig.");
     return false;
   }
 
   Serial.print("LockConfig (0xF020): ");
-  print_hex("", buf, 4);
+  print_hex("", lock_config.data().data(), 4);
 
-  uint8_t config_lock = buf[2];
+  uint8_t config_lock = lock_config.data()[2];
   bool unlocked = (config_lock == 0x55);
 
   Serial.print("Status: ");
@@ -104,14 +91,16 @@ bool checkAndPrintLockState() {
 }
 
 void configureChip() {
-  uint8_t buf[4];
-  if (read4Bytes(ADDR_CHIP_CONFIG, buf) == 0) {
+  Read4Bytes::Response response;
+  if (read4Bytes(ADDR_CHIP_CONFIG, response).ok()) {
+    // 읽은 값을 응답 버퍼 안에서 바로 수정해 다시 씁니다.
+    uint8_t *chip_config = &response.bytes[Read4Bytes::data_offset];
     Serial.print("Current ChipConfig: ");
-    print_hex("", buf, 4);
-    if (buf[0] != CHIP_CONFIG_DEFAULT) {
+    print_hex("", chip_config, 4);
+    if (chip_config[0] != CHIP_CONFIG_DEFAULT) {
       Serial.println("-> Updating ChipConfig to 0xC3 (Enable Encryption)...");
-      buf[0] = CHIP_CONFIG_DEFAULT;
-      if (writeConfig4Bytes(ADDR_CHIP_CONFIG, buf) == 0) {
+      chip_config[0] = CHIP_CONFIG_DEFAULT;
+      if (writeConfig4Bytes(ADDR_CHIP_CONFIG, chip_config) == 0) {
         Serial.println("-> Success: ChipConfig Updated.");
       } else {
         Serial.println("-> Error: Failed to update ChipConfig.");
@@ -158,67 +147,46 @@ void loadKeysDirect() {
   }
 }
 
-uint8_t read16Bytes(uint16_t addr, uint8_t *data) {
-  uint8_t tx_buf[AES132_COMMAND_SIZE_MAX];
-  uint8_t rx_buf[AES132_RESPONSE_SIZE_MAX];
+Read16Bytes::View read16Bytes(uint16_t addr, Read16Bytes::Response &response) {
   // [AES132 Datasheet 8.4 BlockRead Command]
   // OpCode: 0x02 (AES132_BLOCK_READ) -> 블록 읽기
   // Mode: 0 -> 메모리 직접 읽기
   // Param1: Address -> 읽을 주소 (16바이트 단위)
   // Param2: Length (16) -> 읽을 길이
-  uint8_t ret = aes132m_execute(
-      AES132_BLOCK_READ, // [OpCode] BlockRead (0x02): 블록 읽기 명령
-      0,                 // [Mode] 0: 메모리 직접 읽기
-      addr,              // [Param1] Address: 읽을 주소 (16바이트)
-      16,                // [Param2] Length: 읽을 데이터 길이
-      0,                 // [Data1 Length] 0: 입력 데이터 없음
-      NULL,              // [Data1 Pointer] NULL: 입력 데이터 없음
-      0,                 // [Data2 Length] 0: 입력 데이터 없음
-      NULL,              // [Data2 Pointer] NULL: 입력 데이터 없음
-      0,                 // [Data3 Length] 0: 입력 데이터 없음
-      NULL,              // [Data3 Pointer] NULL: 입력 데이터 없음
-      0,                 // [Data4 Length] 0: 입력 데이터 없음
-      NULL,              // [Data4 Pointer] NULL: 입력 데이터 없음
-      tx_buf,            // [TX Buffer] 송신 버퍼 포인터
-      rx_buf             // [RX Buffer] 수신 버퍼 포인터
-  );
-  if (ret == AES132_DEVICE_RETCODE_SUCCESS) {
-    memcpy(data, &rx_buf[AES132_RESPONSE_INDEX_DATA], 16);
-  }
-  return ret;
+  return Read16Bytes::View(Read16Bytes::execute(addr, response), response);
 }
 
 void verifyKeys() {
-  uint8_t buf[16];
+  Read16Bytes::Response response;
 
   // Verify Key 0
   Serial.println("Verifying Key 0 (0xF200)...");
-  uint8_t ret = read16Bytes(ADDR_KEY_0_DIRECT, buf);
-  if (ret == 0) {
-    if (memcmp(buf, test_key, 16) == 0) {
+  Read16Bytes::View key = read16Bytes(ADDR_KEY_0_DIRECT, response);
+  if (key.ok()) {
+    if (memcmp(key.data().data(), test_key, 16) == 0) {
       Serial.println("-> Match! Key 0 verified.");
     } else {
       Serial.println("-> Mismatch! Read data:");
-      print_hex("", buf, 16);
+      print_hex("", key.data().data(), 16);
     }
   } else {
     Serial.print("-> Error: Failed to read Key 0. RetCode: 0x");
-    Serial.println(ret, HEX);
+    Serial.println(key.status(), HEX);
   }
 
   // Verify Key 1
   Serial.println("Verifying Key 1 (0xF210)...");
-  ret = read16Bytes(ADDR_KEY_1_DIRECT, buf);
-  if (ret == 0) {
-    if (memcmp(buf, test_key, 16) == 0) {
+  key = read16Bytes(ADDR_KEY_1_DIRECT, response);
+  if (key.ok()) {
+    if (memcmp(key.data().data(), test_key, 16) == 0) {
       Serial.println("-> Match! Key 1 verified.");
     } else {
       Serial.println("-> Mismatch! Read data:");
-      print_hex("", buf, 16);
+      print_hex("", key.data().data(), 16);
     }
   } else {
     Serial.print("-> Error: Failed to read Key 1. RetCode: 0x");
-    Serial.println(ret, HEX);
+    Serial.println(key.status(), HEX);
   }
 }
 
@@ -226,16 +194,36 @@ void dumpKeyConfigTable() {
   printHeader("Final Verification: KeyConfig Table");
   Serial.println("Slot | KeyConfig");
   Serial.println("-----|-----------");
-  uint8_t buf[4];
+
+  // 16개의 BlockRead를 하나의 배치로 실행합니다. 칩은 한 번만 깨우고,
+  // 각 명령은 이전 응답을 읽은 직후 Ready 확인 없이 바로 전송됩니다.
+  // CONTINUE_ON_ERROR: 한 슬롯 읽기가 실패해도 나머지 슬롯은 계속 읽습니다.
+  Read4Bytes::Response responses[16];
+  struct aes132_batch_command commands[16];
   for (int i = 0; i < 16; i++) {
-    if (read4Bytes(ADDR_KEY_CONFIG + (i * 4), buf) == 0) {
+    commands[i] = {
+        Read4Bytes::op_code,                   // [OpCode] BlockRead (0x10)
+        0,                                     // [Mode] 0: 메모리 직접 읽기
+        (uint16_t)(ADDR_KEY_CONFIG + (i * 4)), // [Param1] KeyConfig 주소
+        4,                                     // [Param2] Length: 4 bytes
+        NULL,                                  // [Data] 입력 데이터 없음
+        0,                                     // [Data Count] 0
+        Read4Bytes::response_size,             // [RX Size] 정확한 응답 크기 (8 bytes)
+        responses[i].bytes,                    // [RX Buffer] 슬롯별 응답 버퍼
+        0                                      // [Result] 실행 후 결과 코드가 저장됨
+    };
+  }
+  aes132m_execute_batch(commands, 16, AES132_BATCH_CONTINUE_ON_ERROR);
+
+  for (int i = 0; i < 16; i++) {
+    Read4Bytes::View key_config(commands[i].result, responses[i]);
+    if (key_config.ok()) {
       if (i < 10)
         Serial.print(" ");
       Serial.print(i);
       Serial.print("  | ");
-      print_hex("", buf, 4);
+      print_hex("", key_config.data().data(), 4);
     }
-    delay(10);
   }
 }
 
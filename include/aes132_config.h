@@ -24,6 +24,22 @@ extern "C" {
 /** SCL 핀 번호 (기본값: GPIO 22) */
 #define AES132_SCL_PIN 22
 
+// ============================================================================
+// SPI 핀 설정 (-DAES132_SPI=1 로 빌드할 때, 기본값: VSPI)
+// ============================================================================
+
+/** MOSI 핀 번호 (기본값: GPIO 23) */
+#define AES132_SPI_MOSI_PIN 23
+
+/** MISO 핀 번호 (기본값: GPIO 19) */
+#define AES132_SPI_MISO_PIN 19
+
+/** SCLK 핀 번호 (기본값: GPIO 18) */
+#define AES132_SPI_SCLK_PIN 18
+
+/** CS 핀 번호 (기본값: GPIO 5) */
+#define AES132_SPI_CS_PIN 5
+
 // ============================================================================
 // AES132 I2C 주소 설정
 // ============================================================================
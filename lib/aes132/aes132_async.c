@@ -0,0 +1,537 @@
+/** \file
+ *  \brief  Non-blocking command interface of the AES132 library.
+ *
+ * See aes132_async.h for the states and how to drive them.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "aes132_async.h"
+#include "aes132_clock.h"
+#include "aes132_comm.h"
+#include "aes132_opcode.h"
+#include "aes132_poller.h"
+#include "aes132_power.h"
+#include "aes132_timer.h"
+
+
+/** \brief This function finishes a command and calls its callback.
+ * \param[in,out] command command in progress
+ * \param[in] result status of the operation or response return code
+ */
+static void aes132c_async_complete(struct aes132_async_command *command, uint8_t result)
+{
+	command->result = result;
+	command->state = AES132_ASYNC_STATE_DONE;
+
+	if (command->callback)
+		command->callback(command, command->context);
+}
+
+
+/** \brief This function schedules a re-synchronization.
+ * \param[in,out] command command in progress
+ * \param[in] result error that caused it; it becomes the result if resume_state is #AES132_ASYNC_STATE_DONE
+ * \param[in] resume_state state to continue with
+ */
+static void aes132c_async_resync(struct aes132_async_command *command, uint8_t result, uint8_t resume_state)
+{
+	command->result = result;
+	command->resume_state = resume_state;
+	command->backoff_us = 0;
+	command->state = AES132_ASYNC_STATE_RESYNC;
+}
+
+
+/** \brief This function starts waiting for the device being ready before writing the command.
+ * \param[in,out] command command in progress
+ */
+static void aes132c_async_wait_for_device_ready(struct aes132_async_command *command)
+{
+	command->wait_start_us = aes132c_now_us();
+	command->state = AES132_ASYNC_STATE_WAIT_DEVICE_READY;
+}
+
+
+/** \brief This function starts writing the command, with its own retries (see aes132c_write_memory_segments()).
+ * \param[in,out] command command in progress
+ */
+static void aes132c_async_begin_access(struct aes132_async_command *command)
+{
+	command->n_retries_access = AES132_RETRY_COUNT_ERROR;
+	aes132c_async_wait_for_device_ready(command);
+}
+
+
+/** \brief This function starts an attempt to send the command (see aes132c_send_command_segments()).
+ * \param[in,out] command command in progress
+ */
+static void aes132c_async_begin_send(struct aes132_async_command *command)
+{
+	if (((command->options & AES132_OPTION_DEVICE_READY) != 0) && (command->retry.n_retries == 0)
+				&& (aes132c_get_power_mode() == AES132_POWER_MODE_ACTIVE)) {
+		// The device is idle. Write the command without polling the device status register first.
+		// No access retries: a failure counts as a failed send attempt.
+		command->n_retries_access = 0;
+		command->state = AES132_ASYNC_STATE_SEND;
+		return;
+	}
+
+	command->n_retries_resync = AES132_RETRY_COUNT_RESYNC;
+	aes132c_async_begin_access(command);
+}
+
+
+/** \brief This function starts waiting for the Response-Ready bit.
+ * \param[in,out] command command in progress
+ * \param[in] is_first_wait non-zero for the first wait, which counts from sending the command
+ */
+static void aes132c_async_wait_for_response_ready(struct aes132_async_command *command, uint8_t is_first_wait)
+{
+	uint8_t op_code = command->command[AES132_COMMAND_INDEX_OPCODE];
+	uint8_t mode = command->command[AES132_COMMAND_INDEX_MODE];
+
+	command->is_first_wait = is_first_wait;
+	command->n_polls = 0;
+	command->wait_start_us = is_first_wait ? command->execute_start_us : aes132c_now_us();
+	command->next_poll_us = aes132c_now_us();
+	command->interval_us = (AES132_ADAPTIVE_POLLING && is_first_wait) ? aes132c_get_poll_interval(op_code, mode) : 0;
+	command->state = AES132_ASYNC_STATE_WAIT_RESPONSE_READY;
+}
+
+
+/** \brief This function continues with the resume state, after the backoff if there is one.
+ * \param[in,out] command command in progress
+ */
+static void aes132c_async_resume(struct aes132_async_command *command)
+{
+	uint8_t op_code = command->command[AES132_COMMAND_INDEX_OPCODE];
+	uint8_t mode = command->command[AES132_COMMAND_INDEX_MODE];
+
+	if (command->backoff_us > 0) {
+		command->backoff_start_us = aes132c_now_us();
+		command->state = AES132_ASYNC_STATE_BACKOFF;
+		return;
+	}
+
+	switch (command->resume_state) {
+	case AES132_ASYNC_STATE_WAIT_DEVICE_READY:
+		aes132c_async_begin_access(command);
+		break;
+
+	case AES132_ASYNC_STATE_SEND:
+		aes132c_async_begin_send(command);
+		break;
+
+	case AES132_ASYNC_STATE_WAIT_RESPONSE_READY:
+		aes132c_async_wait_for_response_ready(command, 0);
+		break;
+
+	case AES132_ASYNC_STATE_RECOVER:
+		command->n_retries_status = AES132_RETRY_COUNT_ERROR;
+		command->state = AES132_ASYNC_STATE_RECOVER;
+		break;
+
+	default:
+		// The exchange has failed. Repeat it as aes132c_send_and_receive_segments() does.
+		if ((--command->n_exchanges > 0) && aes132c_is_exchange_repeated(op_code, mode, command->result)) {
+			// The device might still be busy with the failed attempt.
+			command->options &= ~AES132_OPTION_DEVICE_READY;
+			command->retry.n_retries = 0;
+			aes132c_async_begin_send(command);
+		}
+		else
+			aes132c_async_complete(command, command->result);
+		break;
+	}
+}
+
+
+/** \brief This function handles a failed attempt as the retry policy says.
+ * \param[in,out] command command in progress
+ * \param[in,out] retry retries that the attempt counts against
+ * \param[in] result error of the attempt
+ * \param[in] is_resynced non-zero if communication has already been re-synchronized after the error
+ * \param[in] retry_state state that starts the retry
+ */
+static void aes132c_async_retry(struct aes132_async_command *command, struct aes132_retry_state *retry,
+			uint8_t result, uint8_t is_resynced, uint8_t retry_state)
+{
+	struct aes132_retry_action action;
+
+	command->result = result;
+	command->resume_state = aes132c_plan_retry(retry, result, is_resynced, &action)
+				? retry_state : AES132_ASYNC_STATE_DONE;
+	command->backoff_us = action.backoff_us;
+	if (action.is_resync)
+		command->state = AES132_ASYNC_STATE_RESYNC;
+	else
+		aes132c_async_resume(command);
+}
+
+
+/** \brief This function handles a failed attempt to send the command.
+ * \param[in,out] command command in progress
+ * \param[in] result error of the attempt
+ * \param[in] is_resynced non-zero if communication has already been re-synchronized after the error
+ */
+static void aes132c_async_send_failed(struct aes132_async_command *command, uint8_t result, uint8_t is_resynced)
+{
+	aes132c_async_retry(command, &command->retry, result, is_resynced, AES132_ASYNC_STATE_SEND);
+}
+
+
+/** \brief This function handles running out of attempts to write the command.
+ * \param[in,out] command command in progress
+ * \param[in] result error of the last attempt
+ */
+static void aes132c_async_access_failed(struct aes132_async_command *command, uint8_t result)
+{
+	if (--command->n_retries_resync == 0)
+		// We failed to communicate with the device even after re-synchronizing.
+		aes132c_async_send_failed(command, result, 1);
+	else
+		aes132c_async_resync(command, result, AES132_ASYNC_STATE_WAIT_DEVICE_READY);
+}
+
+
+/** \brief This function starts waiting for the command to execute.
+ * \param[in,out] command command in progress
+ */
+static void aes132c_async_begin_execute(struct aes132_async_command *command)
+{
+	uint8_t op_code = command->command[AES132_COMMAND_INDEX_OPCODE];
+	uint8_t mode = command->command[AES132_COMMAND_INDEX_MODE];
+	uint16_t param2 = (command->command[AES132_COMMAND_INDEX_PARAM2_MSB] << 8)
+				| command->command[AES132_COMMAND_INDEX_PARAM2_LSB];
+	struct aes132_execution_time execution_time = aes132c_get_execution_time(op_code, mode);
+
+	command->execute_start_us = aes132c_now_us();
+	command->timeout_us = execution_time.max_ms * 1000UL;
+	command->delay_us = AES132_ADAPTIVE_POLLING ? aes132c_predict_execution_time(op_code, mode)
+				: execution_time.typical_us;
+	if (command->delay_us > command->timeout_us)
+		command->delay_us = command->timeout_us;
+
+	// Read the expected response at once, or only the count byte if its size is not known.
+	command->expected_size = aes132c_get_response_size(op_code, mode, param2);
+	command->first_read_size = 1;
+	if ((command->expected_size >= AES132_RESPONSE_SIZE_MIN) && (command->expected_size <= command->size))
+		command->first_read_size = command->expected_size;
+
+	// Receiving the response is a new exchange under the same policy.
+	command->retry.n_retries = 0;
+	command->state = AES132_ASYNC_STATE_EXECUTE;
+}
+
+
+/** \brief This function handles a failed attempt to receive the response.
+ * \param[in,out] command command in progress
+ * \param[in] result error of the attempt
+ */
+static void aes132c_async_receive_failed(struct aes132_async_command *command, uint8_t result)
+{
+	command->is_first_wait = 0;
+	if (AES132_NACK_POLLING && (result != AES132_FUNCTION_RETCODE_TIMEOUT)) {
+		// Find out whether the device has rejected the command first (see aes132c_find_tx_crc_error()).
+		command->result = result;
+		command->n_retries_status = AES132_RETRY_COUNT_ERROR;
+		command->state = AES132_ASYNC_STATE_CHECK_STATUS;
+		return;
+	}
+
+	aes132c_async_retry(command, &command->retry, result, 0, AES132_ASYNC_STATE_WAIT_RESPONSE_READY);
+}
+
+
+/** \brief This function continues after the count byte, or the expected response, has been read.
+ * \param[in,out] command command in progress
+ * \param[in] aes132_lib_return status of the read
+ */
+static void aes132c_async_count_read(struct aes132_async_command *command, uint8_t aes132_lib_return)
+{
+	if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+		aes132_lib_return = aes132c_check_response_count(command->response[AES132_RESPONSE_INDEX_COUNT],
+					command->size);
+	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
+		aes132c_async_receive_failed(command, aes132_lib_return);
+	else if (command->response[AES132_RESPONSE_INDEX_COUNT] > command->first_read_size)
+		command->state = AES132_ASYNC_STATE_READ_BODY;
+	else
+		command->state = AES132_ASYNC_STATE_CHECK_CRC;
+}
+
+
+/** \brief This function starts a command without waiting for its response.
+ *
+ * The CRC is appended to the command unless options contain #AES132_OPTION_NO_APPEND_CRC
+ * (see aes132c_send_command()). Drive the command with aes132c_async_step().
+ * \param[out] command command to start; must not be in progress
+ * \param[in] command_buffer command buffer
+ * \param[in] size size of the response buffer
+ * \param[out] response response buffer
+ * \param[in] options flags for communication behavior
+ * \param[in] callback function to call once the command has completed, or NULL
+ * \param[in] context passed to the callback
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS, or #AES132_FUNCTION_RETCODE_BAD_PARAM if the
+ *         command is in progress or a buffer is missing
+ */
+uint8_t aes132c_send_and_receive_async(struct aes132_async_command *command, uint8_t *command_buffer,
+			uint8_t size, uint8_t *response, uint8_t options,
+			void (*callback)(struct aes132_async_command *command, void *context), void *context)
+{
+	uint8_t count;
+
+	if (!command || !command_buffer || !response)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	if ((command->state != AES132_ASYNC_STATE_IDLE) && (command->state != AES132_ASYNC_STATE_DONE))
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	count = command_buffer[AES132_COMMAND_INDEX_COUNT];
+	if ((options & AES132_OPTION_NO_APPEND_CRC) == 0)
+		// Append two-byte CRC to command.
+		aes132c_calculate_crc(count - AES132_CRC_SIZE, command_buffer, &command_buffer[count - AES132_CRC_SIZE]);
+
+	command->command = command_buffer;
+	command->size = size;
+	command->response = response;
+	command->options = options;
+	command->callback = callback;
+	command->context = context;
+	command->result = AES132_FUNCTION_RETCODE_SUCCESS;
+	command->n_exchanges = AES132_RETRY_COUNT_EXCHANGE;
+	if (AES132_CLOCK_MANAGER)
+		// Count the command, and run it at the rate of the device (see aes132_clock.h).
+		aes132c_record_clock_command();
+	aes132c_begin_retries(&command->retry);
+	aes132c_begin_retries(&command->tx_retry);
+	aes132c_async_begin_send(command);
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function advances a command by at most one bus transaction.
+ *
+ * It never waits. States that wait for time or for the device return at once if
+ * it is not yet time.
+ * \param[in,out] command command started by aes132c_send_and_receive_async()
+ * \return non-zero while the command is in progress, 0 once it has completed
+ */
+uint8_t aes132c_async_step(struct aes132_async_command *command)
+{
+	uint8_t aes132_lib_return;
+	uint8_t device_status_register = 0;
+	uint8_t count_byte;
+	uint8_t is_ready;
+	uint32_t now_us;
+	uint32_t waited_us;
+	struct aes132_segment segment;
+
+	switch (command->state) {
+	case AES132_ASYNC_STATE_WAIT_DEVICE_READY:
+		aes132_lib_return = aes132p_read_memory_physical(1, AES132_STATUS_ADDR, &device_status_register);
+		waited_us = aes132c_now_us() - command->wait_start_us;
+		if ((aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS) && ((device_status_register & AES132_WIP_BIT) == 0)) {
+			aes132c_record_device_ready_time(waited_us, AES132_FUNCTION_RETCODE_SUCCESS);
+			command->state = AES132_ASYNC_STATE_SEND;
+		}
+		else if (waited_us >= AES132_DEVICE_READY_TIMEOUT * 1000UL) {
+			// We lost communication. Re-synchronize.
+			aes132c_record_device_ready_time(waited_us, AES132_FUNCTION_RETCODE_TIMEOUT);
+			aes132c_async_access_failed(command, AES132_FUNCTION_RETCODE_TIMEOUT);
+		}
+		break;
+
+	case AES132_ASYNC_STATE_SEND:
+		segment.data = command->command;
+		segment.count = command->command[AES132_COMMAND_INDEX_COUNT];
+		aes132_lib_return = aes132p_write_memory_physical_segments(AES132_IO_ADDR, &segment, 1);
+		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
+			if (command->n_retries_access == 0)
+				// Written without polling the device first. Retry through the regular path.
+				aes132c_async_send_failed(command, aes132_lib_return, 1);
+			else if (--command->n_retries_access > 0)
+				aes132c_async_wait_for_device_ready(command);
+			else
+				aes132c_async_access_failed(command, aes132_lib_return);
+		}
+		else if (((command->options & AES132_OPTION_NO_STATUS_READ) != 0) || AES132_NACK_POLLING)
+			// With #AES132_NACK_POLLING, a Tx CRC error shows when the response is read.
+			aes132c_async_begin_execute(command);
+		else {
+			command->n_retries_status = AES132_RETRY_COUNT_ERROR;
+			command->state = AES132_ASYNC_STATE_CHECK_SEND;
+		}
+		break;
+
+	case AES132_ASYNC_STATE_CHECK_SEND:
+		aes132_lib_return = aes132p_read_memory_physical(1, AES132_STATUS_ADDR, &device_status_register);
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS) {
+			if ((device_status_register & AES132_CRC_ERROR_BIT) != 0)
+				// The device has calculated a not-matching CRC. Retry sending the command.
+				aes132c_async_send_failed(command, AES132_FUNCTION_RETCODE_BAD_CRC_TX, 0);
+			else
+				aes132c_async_begin_execute(command);
+		}
+		else if (--command->n_retries_status > 0)
+			// Read the device status register again at the next step.
+			break;
+		else if (aes132_lib_return == AES132_FUNCTION_RETCODE_COMM_FAIL)
+			// A nack to the I2C address indicates that the device is busy executing the command.
+			aes132c_async_begin_execute(command);
+		else
+			// Re-synchronize. Send the command again only if it is idempotent or has not reached
+			// the device, e.g. not a Counter command that has run.
+			aes132c_async_resync(command, aes132_lib_return, AES132_ASYNC_STATE_RECOVER);
+		break;
+
+	case AES132_ASYNC_STATE_RECOVER:
+		if (aes132c_get_command_class(command->command[AES132_COMMAND_INDEX_OPCODE],
+					command->command[AES132_COMMAND_INDEX_MODE]) == AES132_COMMAND_CLASS_IDEMPOTENT) {
+			// Running the command twice does no harm. Send it again.
+			aes132c_async_send_failed(command, command->result, 1);
+			break;
+		}
+
+		// Find out whether the device has received the command.
+		aes132_lib_return = aes132p_read_memory_physical(1, AES132_STATUS_ADDR, &device_status_register);
+		if ((aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) && (--command->n_retries_status > 0))
+			// Read the device status register again at the next step.
+			break;
+
+		aes132_lib_return = aes132c_check_command_received(aes132_lib_return, device_status_register);
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+			// The command has run or is running. Receive its response.
+			aes132c_async_begin_execute(command);
+		else if ((aes132_lib_return == AES132_FUNCTION_RETCODE_NOT_EXECUTED)
+					|| (aes132_lib_return == AES132_FUNCTION_RETCODE_BAD_CRC_TX))
+			aes132c_async_send_failed(command, command->result, 1);
+		else
+			// We still cannot tell. Give up rather than risk running the command twice.
+			aes132c_async_complete(command, command->result);
+		break;
+
+	case AES132_ASYNC_STATE_CHECK_STATUS:
+		aes132_lib_return = aes132p_read_memory_physical(1, AES132_STATUS_ADDR, &device_status_register);
+		if ((aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) && (--command->n_retries_status > 0))
+			// Read the device status register again at the next step.
+			break;
+
+		if ((aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+					&& ((device_status_register & AES132_CRC_ERROR_BIT) != 0)) {
+			// The device has rejected the command without running it. Send it again as
+			// aes132c_send_and_receive_segments() does.
+			command->options &= ~AES132_OPTION_DEVICE_READY;
+			command->retry.n_retries = 0;
+			aes132c_async_retry(command, &command->tx_retry, AES132_FUNCTION_RETCODE_BAD_CRC_TX, 0,
+						AES132_ASYNC_STATE_SEND);
+		}
+		else
+			aes132c_async_retry(command, &command->retry, command->result, 0,
+						AES132_ASYNC_STATE_WAIT_RESPONSE_READY);
+		break;
+
+	case AES132_ASYNC_STATE_EXECUTE:
+		// Leave the bus alone while the command executes.
+		if (aes132c_now_us() - command->execute_start_us >= command->delay_us)
+			aes132c_async_wait_for_response_ready(command, 1);
+		break;
+
+	case AES132_ASYNC_STATE_WAIT_RESPONSE_READY:
+		now_us = aes132c_now_us();
+		if ((command->interval_us > 0) && ((int32_t) (now_us - command->next_poll_us) < 0))
+			break;
+
+		if (AES132_NACK_POLLING) {
+			// Read count byte, or the entire expected response, as soon as the device acks.
+			memset(command->response, 0, command->size);
+			aes132_lib_return = aes132p_read_memory_physical(command->first_read_size, AES132_IO_ADDR,
+						&command->response[AES132_RESPONSE_INDEX_COUNT]);
+			is_ready = (aes132_lib_return != AES132_FUNCTION_RETCODE_COMM_FAIL);
+		}
+		else {
+			aes132_lib_return = aes132p_read_memory_physical(1, AES132_STATUS_ADDR, &device_status_register);
+			is_ready = (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+						&& ((device_status_register & AES132_RESPONSE_READY_BIT) == AES132_RESPONSE_READY_BIT);
+		}
+		now_us = aes132c_now_us();
+		waited_us = now_us - command->wait_start_us;
+		if (command->n_polls < UINT16_MAX)
+			command->n_polls++;
+
+		if (is_ready) {
+			if (command->is_first_wait)
+				aes132c_record_execution_time(command->command[AES132_COMMAND_INDEX_OPCODE],
+							command->command[AES132_COMMAND_INDEX_MODE], waited_us,
+							AES132_FUNCTION_RETCODE_SUCCESS, command->n_polls == 1);
+			if (AES132_NACK_POLLING)
+				aes132c_async_count_read(command, aes132_lib_return);
+			else
+				command->state = AES132_ASYNC_STATE_READ_COUNT;
+		}
+		else if (waited_us >= command->timeout_us) {
+			if (command->is_first_wait)
+				aes132c_record_execution_time(command->command[AES132_COMMAND_INDEX_OPCODE],
+							command->command[AES132_COMMAND_INDEX_MODE], waited_us,
+							AES132_FUNCTION_RETCODE_TIMEOUT, 0);
+			aes132c_async_receive_failed(command, AES132_FUNCTION_RETCODE_TIMEOUT);
+		}
+		else if (command->interval_us > 0) {
+			command->next_poll_us = now_us + command->interval_us;
+			command->interval_us = aes132c_next_poll_interval(command->interval_us);
+		}
+		break;
+
+	case AES132_ASYNC_STATE_READ_COUNT:
+		// Initialize response buffer to prevent reading stale data
+		memset(command->response, 0, command->size);
+
+		// Read count byte, or the entire expected response, from response buffer.
+		aes132_lib_return = aes132p_read_memory_physical(command->first_read_size, AES132_IO_ADDR,
+					&command->response[AES132_RESPONSE_INDEX_COUNT]);
+		aes132c_async_count_read(command, aes132_lib_return);
+		break;
+
+	case AES132_ASYNC_STATE_READ_BODY:
+		// Read remainder of response.
+		count_byte = command->response[AES132_RESPONSE_INDEX_COUNT];
+		aes132_lib_return = aes132p_read_memory_physical(count_byte - command->first_read_size, AES132_IO_ADDR,
+					&command->response[command->first_read_size]);
+		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
+			aes132c_async_receive_failed(command, aes132_lib_return);
+		else
+			command->state = AES132_ASYNC_STATE_CHECK_CRC;
+		break;
+
+	case AES132_ASYNC_STATE_CHECK_CRC:
+		aes132_lib_return = aes132c_check_response_crc(command->response);
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+			// We received a consistent response packet. The result is the response return code.
+			aes132c_async_complete(command, command->response[AES132_RESPONSE_INDEX_RETURN_CODE]);
+		else
+			aes132c_async_receive_failed(command, aes132_lib_return);
+		break;
+
+	case AES132_ASYNC_STATE_RESYNC:
+		// Do not override the error that caused the re-synchronization.
+		(void) aes132c_resync();
+		aes132c_async_resume(command);
+		break;
+
+	case AES132_ASYNC_STATE_BACKOFF:
+		if (aes132c_now_us() - command->backoff_start_us >= command->backoff_us) {
+			command->backoff_us = 0;
+			aes132c_async_resume(command);
+		}
+		break;
+
+	default:
+		// AES132_ASYNC_STATE_IDLE or AES132_ASYNC_STATE_DONE
+		return 0;
+	}
+
+	return (command->state != AES132_ASYNC_STATE_DONE);
+}
@@ -0,0 +1,107 @@
+/** \file
+ *  \brief  Definitions and prototypes for the non-blocking command interface of the AES132 library.
+ *
+ * aes132c_send_and_receive() blocks until the response has arrived, up to the maximum
+ * execution time of the command. aes132c_send_and_receive_async() only starts a command.
+ * The caller then calls aes132c_async_step() from its main loop until it returns 0. Every
+ * step does at most one bus transaction, or a resync, and returns without waiting:
+ *
+ * - #AES132_ASYNC_STATE_WAIT_DEVICE_READY polls until the device is not busy writing.
+ * - #AES132_ASYNC_STATE_SEND writes the command to the I/O buffer.
+ * - #AES132_ASYNC_STATE_CHECK_SEND reads the device status register to catch a CRC error.
+ * - #AES132_ASYNC_STATE_EXECUTE leaves the bus alone for the typical (or, with
+ *   #AES132_ADAPTIVE_POLLING, learned) execution time.
+ * - #AES132_ASYNC_STATE_WAIT_RESPONSE_READY polls the Response-Ready bit, or with
+ *   #AES132_NACK_POLLING, reads the response as soon as the device acks.
+ * - #AES132_ASYNC_STATE_READ_COUNT and #AES132_ASYNC_STATE_READ_BODY read the response.
+ * - #AES132_ASYNC_STATE_CHECK_CRC checks it.
+ * - #AES132_ASYNC_STATE_CHECK_STATUS reads the device status register after a response that is
+ *   not consistent, with #AES132_NACK_POLLING, to find a Tx CRC error.
+ * - #AES132_ASYNC_STATE_RESYNC re-synchronizes after an error and continues with a retry.
+ * - #AES132_ASYNC_STATE_RECOVER checks whether the device has received a command whose
+ *   status read failed, before a command that is not idempotent is sent again.
+ * - #AES132_ASYNC_STATE_BACKOFF waits out the backoff of the retry policy before a retry.
+ *
+ * Retries and re-synchronizations follow aes132c_send_command() and aes132c_receive_command_response():
+ * the same retry policy (see aes132_retry.h), the same errors that are retried, and the same
+ * time-outs. Failed exchanges of idempotent commands are repeated as by
+ * aes132c_send_and_receive(). The policy in effect when the command is started applies until
+ * it completes. When the command has completed, the callback is called once and the result is in
+ * aes132_async_command::result.
+ *
+ * The caller owns the aes132_async_command and the command and response buffers, and has to
+ * keep them until the command has completed. Only one command can be in progress at a time,
+ * and nothing else may access the bus while it is.
+ */
+
+#ifndef AES132_ASYNC_H
+#   define AES132_ASYNC_H
+
+#include <stdint.h>
+
+#include "aes132_retry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! states of a command started by aes132c_send_and_receive_async()
+enum aes132_async_state {
+	AES132_ASYNC_STATE_IDLE                 = 0, //!< not started, or completed and handled
+	AES132_ASYNC_STATE_WAIT_DEVICE_READY    = 1, //!< polling the WIP bit before writing
+	AES132_ASYNC_STATE_SEND                 = 2, //!< writing the command
+	AES132_ASYNC_STATE_CHECK_SEND           = 3, //!< reading the CRC bit after writing
+	AES132_ASYNC_STATE_EXECUTE              = 4, //!< waiting out the execution time
+	AES132_ASYNC_STATE_WAIT_RESPONSE_READY  = 5, //!< polling the RRDY bit
+	AES132_ASYNC_STATE_READ_COUNT           = 6, //!< reading the count byte or the expected response
+	AES132_ASYNC_STATE_READ_BODY            = 7, //!< reading the remainder of the response
+	AES132_ASYNC_STATE_CHECK_CRC            = 8, //!< checking the response CRC
+	AES132_ASYNC_STATE_RESYNC               = 9, //!< re-synchronizing before the next state
+	AES132_ASYNC_STATE_BACKOFF              = 10, //!< waiting before a retry
+	AES132_ASYNC_STATE_RECOVER              = 11, //!< reading the device status register after a failed status read
+	AES132_ASYNC_STATE_CHECK_STATUS         = 12, //!< reading the CRC bit after a failed response read
+	AES132_ASYNC_STATE_DONE                 = 13 //!< completed; result is valid
+};
+
+//! a command in progress
+struct aes132_async_command {
+	uint8_t *command;                   //!< command buffer
+	uint8_t size;                       //!< size of the response buffer
+	uint8_t *response;                  //!< response buffer
+	uint8_t options;                    //!< AES132_OPTION_* flags
+	void (*callback)(struct aes132_async_command *command, void *context); //!< called on completion, or NULL
+	void *context;                      //!< passed to the callback
+
+	uint8_t state;                      //!< current state (#aes132_async_state)
+	uint8_t result;                     //!< status of the operation or response return code, once done
+	uint8_t resume_state;               //!< state after #AES132_ASYNC_STATE_RESYNC and #AES132_ASYNC_STATE_BACKOFF
+	struct aes132_retry_state retry;    //!< retries of sending the command, then of receiving the response
+	struct aes132_retry_state tx_retry; //!< retries after a Tx CRC error found while receiving (#AES132_NACK_POLLING)
+	uint8_t n_retries_access;           //!< attempts left to write the command before re-synchronizing
+	uint8_t n_retries_resync;           //!< re-synchronizations left for writing the command
+	uint8_t n_retries_status;           //!< attempts left to read the device status register
+	uint8_t n_exchanges;                //!< attempts left for the whole exchange of an idempotent command
+	uint8_t expected_size;              //!< size of a successful response, or 0 if not known
+	uint8_t first_read_size;            //!< bytes read in #AES132_ASYNC_STATE_READ_COUNT
+	uint8_t is_first_wait;              //!< non-zero during the first wait for Response-Ready
+	uint16_t n_polls;                   //!< polls in the current wait
+	uint32_t execute_start_us;          //!< time the command was sent
+	uint32_t delay_us;                  //!< time to leave the bus alone after sending
+	uint32_t wait_start_us;             //!< start of the current wait
+	uint32_t timeout_us;                //!< time-out of the current wait
+	uint32_t interval_us;               //!< time between polls, 0 to poll at every step
+	uint32_t next_poll_us;              //!< time of the next poll if interval_us is not 0
+	uint32_t backoff_start_us;          //!< start of the backoff
+	uint32_t backoff_us;                //!< backoff before resuming, 0 for none
+};
+
+uint8_t aes132c_send_and_receive_async(struct aes132_async_command *command, uint8_t *command_buffer,
+			uint8_t size, uint8_t *response, uint8_t options,
+			void (*callback)(struct aes132_async_command *command, void *context), void *context);
+uint8_t aes132c_async_step(struct aes132_async_command *command);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,291 @@
+/** \file
+ *  \brief  Clock manager of the AES132 library.
+ *
+ * See aes132_clock.h for when the clock is stepped down and up.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "aes132_clock.h"
+#include "aes132_comm.h"
+#include "aes132_device.h"
+#include "aes132_retry.h"
+#include "aes132_timer.h"
+#include "aes132_transport.h"
+
+//! clock state of a device
+struct aes132_clock_state {
+	uint8_t rate_index;             //!< index of the current rate in the policy
+	uint8_t is_probing;             //!< non-zero during the first window at a probed rate
+	uint8_t probe_backoff;          //!< failed probes in a row, at most #AES132_CLOCK_PROBE_BACKOFF_MAX
+	uint8_t n_errors;               //!< errors in the current window
+	uint16_t n_commands;            //!< commands in the current window
+	uint16_t n_clean_windows;       //!< windows without an error at the current rate
+};
+
+//! rates from the build options
+static const uint32_t aes132c_default_clock_rates_hz[] = {AES132_CLOCK_RATES_HZ};
+
+// The default policy has to fit into the statistics.
+typedef char aes132c_default_clock_rates_check[(sizeof(aes132c_default_clock_rates_hz)
+			<= AES132_CLOCK_RATE_COUNT_MAX * sizeof(aes132c_default_clock_rates_hz[0])) ? 1 : -1];
+
+//! rates and thresholds from the build options
+const struct aes132_clock_policy aes132c_default_clock_policy = {
+	aes132c_default_clock_rates_hz,
+	sizeof(aes132c_default_clock_rates_hz) / sizeof(aes132c_default_clock_rates_hz[0]),
+	AES132_CLOCK_WINDOW,
+	AES132_CLOCK_MAX_ERRORS,
+	AES132_CLOCK_PROBE_AFTER
+};
+
+//! policies set with aes132c_set_clock_policy(), indexed by device index; NULL for the default
+static const struct aes132_clock_policy *aes132c_clock_policies[AES132_DEVICE_COUNT_MAX];
+
+//! clock states, indexed by device index
+static struct aes132_clock_state aes132c_clock_states[AES132_DEVICE_COUNT_MAX];
+
+//! errors and throughput by rate, indexed by device index
+static struct aes132_clock_statistics aes132c_clock_statistics[AES132_DEVICE_COUNT_MAX];
+
+//! transport whose clock has been set last, or NULL
+static const struct aes132_transport *aes132c_clock_transport;
+
+//! clock that transport has been set to
+static uint32_t aes132c_clock_hz;
+
+
+/** \brief This function adds to a counter that stops at 0xFFFFFFFF.
+ * \param[in, out] counter counter
+ * \param[in] value value to add
+ */
+static void aes132c_clock_add(uint32_t *counter, uint32_t value)
+{
+	*counter = (value > UINT32_MAX - *counter) ? UINT32_MAX : *counter + value;
+}
+
+
+/** \brief This function sets the transport of the selected device to the rate of the device,
+ *         unless it is set to it already.
+ *
+ * If the transport fails to change its clock, the next command tries again.
+ */
+static void aes132c_apply_clock(void)
+{
+	uint32_t clock_hz = aes132c_get_clock_rate();
+	const struct aes132_transport *transport = aes132c_get_transport();
+
+	if ((transport == aes132c_clock_transport) && (clock_hz == aes132c_clock_hz))
+		return;
+
+	if (aes132p_set_clock(clock_hz) == AES132_FUNCTION_RETCODE_SUCCESS) {
+		aes132c_clock_transport = transport;
+		aes132c_clock_hz = clock_hz;
+	}
+}
+
+
+/** \brief This function moves the selected device to another rate and starts a new window.
+ * \param[in, out] state clock state of the device
+ * \param[in] rate_index index of the rate in the policy
+ */
+static void aes132c_shift_clock(struct aes132_clock_state *state, uint8_t rate_index)
+{
+	state->rate_index = rate_index;
+	state->n_commands = 0;
+	state->n_errors = 0;
+	state->n_clean_windows = 0;
+	aes132c_apply_clock();
+}
+
+
+/** \brief This function sets the clock policy of the selected device.
+ *
+ * The device starts again at the fastest rate of the policy, and its statistics are cleared,
+ * because they are kept by the index of the rate in the policy.
+ * \param[in] policy policy to use, or NULL for the default policy; has to stay valid while in use
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS, or #AES132_FUNCTION_RETCODE_BAD_PARAM if the policy
+ *         has no rates, more than #AES132_CLOCK_RATE_COUNT_MAX, or an empty window
+ */
+uint8_t aes132c_set_clock_policy(const struct aes132_clock_policy *policy)
+{
+	uint8_t device_index = aes132c_get_device_index();
+
+	if (policy && (!policy->rates_hz || (policy->n_rates == 0) || (policy->n_rates > AES132_CLOCK_RATE_COUNT_MAX)
+				|| (policy->window == 0)))
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	aes132c_clock_policies[device_index] = policy;
+	memset(&aes132c_clock_states[device_index], 0, sizeof(aes132c_clock_states[device_index]));
+	memset(&aes132c_clock_statistics[device_index], 0, sizeof(aes132c_clock_statistics[device_index]));
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function returns the clock policy in effect for the selected device.
+ * \return policy set with aes132c_set_clock_policy(), else the default
+ */
+const struct aes132_clock_policy *aes132c_get_clock_policy(void)
+{
+	const struct aes132_clock_policy *policy = aes132c_clock_policies[aes132c_get_device_index()];
+
+	return policy ? policy : &aes132c_default_clock_policy;
+}
+
+
+/** \brief This function returns the rate the clock manager runs the selected device at.
+ * \return clock rate in Hz
+ */
+uint32_t aes132c_get_clock_rate(void)
+{
+	return aes132c_get_clock_policy()->rates_hz[aes132c_clock_states[aes132c_get_device_index()].rate_index];
+}
+
+
+/** \brief This function records that a command to the selected device starts, and sets its clock.
+ *
+ * aes132c_send_command_segments() and aes132c_send_and_receive_async() call it. At the end of a
+ * window it probes the next faster rate if enough windows have been clean.
+ */
+void aes132c_record_clock_command(void)
+{
+	uint8_t device_index = aes132c_get_device_index();
+	struct aes132_clock_state *state = &aes132c_clock_states[device_index];
+	struct aes132_clock_rate_statistics *statistics;
+	const struct aes132_clock_policy *policy = aes132c_get_clock_policy();
+
+	if (state->n_commands >= policy->window) {
+		// The window has ended without too many errors. A probed rate has held.
+		state->n_clean_windows = (state->n_errors == 0) ? state->n_clean_windows + 1 : 0;
+		if (state->is_probing) {
+			state->is_probing = 0;
+			state->probe_backoff = 0;
+		}
+		state->n_commands = 0;
+		state->n_errors = 0;
+
+		if ((policy->probe_after > 0) && (state->rate_index > 0)
+					&& (state->n_clean_windows >= ((uint32_t) policy->probe_after << state->probe_backoff))) {
+			if (aes132c_clock_statistics[device_index].n_upshifts < UINT16_MAX)
+				aes132c_clock_statistics[device_index].n_upshifts++;
+			state->is_probing = 1;
+			aes132c_shift_clock(state, state->rate_index - 1);
+		}
+	}
+
+	state->n_commands++;
+	statistics = &aes132c_clock_statistics[device_index].rates[state->rate_index];
+	statistics->clock_hz = policy->rates_hz[state->rate_index];
+	aes132c_clock_add(&statistics->n_commands, 1);
+
+	aes132c_apply_clock();
+}
+
+
+/** \brief This function counts a failed attempt of the selected device against its rate.
+ *
+ * aes132c_plan_retry() calls it for every failed attempt to send a command or receive a response.
+ * Timeouts are not counted: a slower clock does not make the device answer sooner. When the errors
+ * of the window exceed aes132_clock_policy::max_errors, the device is stepped down to the next
+ * slower rate at once. A probed rate that fails doubles the wait for the next probe.
+ * \param[in] aes132_lib_return status of the failed attempt
+ */
+void aes132c_record_clock_error(uint8_t aes132_lib_return)
+{
+	uint8_t device_index = aes132c_get_device_index();
+	struct aes132_clock_state *state = &aes132c_clock_states[device_index];
+	const struct aes132_clock_policy *policy = aes132c_get_clock_policy();
+
+	if ((aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+				|| (aes132c_classify_error(aes132_lib_return) == AES132_ERROR_CLASS_TIMEOUT))
+		return;
+
+	aes132c_clock_add(&aes132c_clock_statistics[device_index].rates[state->rate_index].n_errors, 1);
+	if (state->n_errors < UINT8_MAX)
+		state->n_errors++;
+	if (state->n_errors <= policy->max_errors)
+		return;
+
+	if (state->is_probing) {
+		state->is_probing = 0;
+		if (state->probe_backoff < AES132_CLOCK_PROBE_BACKOFF_MAX)
+			state->probe_backoff++;
+	}
+
+	if (state->rate_index + 1 >= policy->n_rates) {
+		// There is no slower rate. Start a new window.
+		aes132c_shift_clock(state, state->rate_index);
+		return;
+	}
+
+	if (aes132c_clock_statistics[device_index].n_downshifts < UINT16_MAX)
+		aes132c_clock_statistics[device_index].n_downshifts++;
+	aes132c_shift_clock(state, state->rate_index + 1);
+}
+
+
+/** \brief This function adds a transaction with the selected device to the throughput of its rate.
+ *
+ * The read and write functions of the physical layer call it. Only successful transactions count.
+ * \param[in] n_bytes data bytes read or written, without I2C address and word address
+ * \param[in] start_us time the transaction started (aes132c_now_us())
+ * \param[in] aes132_lib_return status of the transaction
+ */
+void aes132c_record_clock_transfer(uint8_t n_bytes, uint32_t start_us, uint8_t aes132_lib_return)
+{
+	uint8_t device_index = aes132c_get_device_index();
+	struct aes132_clock_rate_statistics *statistics =
+				&aes132c_clock_statistics[device_index].rates[aes132c_clock_states[device_index].rate_index];
+
+	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
+		return;
+
+	aes132c_clock_add(&statistics->n_bytes, n_bytes);
+	aes132c_clock_add(&statistics->bus_us, aes132c_now_us() - start_us);
+}
+
+
+/** \brief This function returns the errors and throughput of a device by rate.
+ * \param[in] device_index device index (see aes132c_get_device_index())
+ * \return pointer to statistics, or NULL if the device index is out of range
+ */
+const struct aes132_clock_statistics *aes132c_get_clock_statistics(uint8_t device_index)
+{
+	if (device_index >= AES132_DEVICE_COUNT_MAX)
+		return (const struct aes132_clock_statistics *) 0;
+
+	return &aes132c_clock_statistics[device_index];
+}
+
+
+/** \brief This function returns the measured throughput of a device at one rate.
+ * \param[in] device_index device index (see aes132c_get_device_index())
+ * \param[in] rate_index index of the rate in the policy of the device
+ * \return data bytes per second of successful transactions, 0 if nothing has been measured
+ *         or an index is out of range
+ */
+uint32_t aes132c_get_clock_throughput(uint8_t device_index, uint8_t rate_index)
+{
+	const struct aes132_clock_rate_statistics *statistics;
+
+	if ((device_index >= AES132_DEVICE_COUNT_MAX) || (rate_index >= AES132_CLOCK_RATE_COUNT_MAX))
+		return 0;
+
+	statistics = &aes132c_clock_statistics[device_index].rates[rate_index];
+	if (statistics->bus_us == 0)
+		return 0;
+
+	return (uint32_t) (((uint64_t) statistics->n_bytes * 1000000UL) / statistics->bus_us);
+}
+
+
+/** \brief This function clears the errors and throughput of all devices.
+ *
+ * The rates the devices run at are kept.
+ */
+void aes132c_reset_clock_statistics(void)
+{
+	memset(aes132c_clock_statistics, 0, sizeof(aes132c_clock_statistics));
+}
@@ -0,0 +1,128 @@
+/** \file
+ *  \brief  Definitions and prototypes for the clock manager of the AES132 library.
+ *
+ * The device runs its I2C interface at up to 1 MHz (Fast-mode Plus), but whether the bus of a
+ * board does depends on its wiring and pull-ups. The clock manager starts every device at the
+ * fastest rate of its policy (aes132_clock_policy::rates_hz) and counts the errors of its
+ * commands: nacks, bad counts and CRC errors in either direction, i.e. every failed attempt of
+ * aes132c_send_command() and aes132c_receive_response() that the retry policy sees
+ * (see aes132c_plan_retry()), except timeouts. When more than aes132_clock_policy::max_errors
+ * occur within aes132_clock_policy::window commands, it steps the device down to the next
+ * slower rate at once, so that the retry already runs at that rate. After
+ * aes132_clock_policy::probe_after windows without an error, it probes the next faster rate
+ * again. Every probe that fails doubles the number of clean windows before the next one,
+ * up to #AES132_CLOCK_PROBE_BACKOFF_MAX doublings.
+ * \code
+ * static const uint32_t board_rates_hz[] = {400000, 100000};    // no Fast-mode Plus on this board
+ * static const struct aes132_clock_policy board = {board_rates_hz, 2, 32, 1, 16};
+ * ret = aes132c_set_clock_policy(&board);
+ * \endcode
+ * The rate is set through aes132p_set_clock() before a command, and only if the transport of
+ * the device has been set to another rate since. Transports without aes132_transport::set_clock
+ * keep their clock; errors and throughput are counted all the same.
+ *
+ * The bytes and bus time of every successful transaction are counted by rate (see
+ * aes132c_get_clock_statistics() and aes132c_get_clock_throughput()), so that the fastest rate
+ * a board sustains can be picked from what has been measured on it.
+ *
+ * All of this is built in with #AES132_CLOCK_MANAGER only.
+ */
+
+#ifndef AES132_CLOCK_H
+#   define AES132_CLOCK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief non-zero to manage the I2C clock of every device
+ *
+ * Override with a build flag, e.g. -DAES132_CLOCK_MANAGER=1.
+ */
+#ifndef AES132_CLOCK_MANAGER
+#   define AES132_CLOCK_MANAGER         (0)
+#endif
+
+/** \brief clock rates of the default policy in Hz, fastest first
+ *
+ * Override with a build flag, e.g. -DAES132_CLOCK_RATES_HZ=400000,100000.
+ */
+#ifndef AES132_CLOCK_RATES_HZ
+#   define AES132_CLOCK_RATES_HZ        1000000, 400000, 100000
+#endif
+
+/** \brief commands per window of the default policy
+ *
+ * Override with a build flag, e.g. -DAES132_CLOCK_WINDOW=64.
+ */
+#ifndef AES132_CLOCK_WINDOW
+#   define AES132_CLOCK_WINDOW          (32)
+#endif
+
+/** \brief errors per window the default policy tolerates; one more steps the clock down
+ *
+ * Override with a build flag, e.g. -DAES132_CLOCK_MAX_ERRORS=0.
+ */
+#ifndef AES132_CLOCK_MAX_ERRORS
+#   define AES132_CLOCK_MAX_ERRORS      (1)
+#endif
+
+/** \brief clean windows after which the default policy probes the next faster rate; 0 for never
+ *
+ * Override with a build flag, e.g. -DAES132_CLOCK_PROBE_AFTER=0.
+ */
+#ifndef AES132_CLOCK_PROBE_AFTER
+#   define AES132_CLOCK_PROBE_AFTER     (16)
+#endif
+
+//! maximum number of rates of a policy
+#define AES132_CLOCK_RATE_COUNT_MAX     (4)
+
+//! maximum number of times the interval between probes doubles after failed probes
+#define AES132_CLOCK_PROBE_BACKOFF_MAX  (3)
+
+//! rates of the clock and when to change between them
+struct aes132_clock_policy {
+	const uint32_t *rates_hz;   //!< clock rates in Hz, fastest first
+	uint8_t n_rates;            //!< number of rates, 1 to #AES132_CLOCK_RATE_COUNT_MAX
+	uint16_t window;            //!< commands per window, at least 1
+	uint8_t max_errors;         //!< errors per window that are tolerated; one more steps the clock down
+	uint16_t probe_after;       //!< clean windows after which the next faster rate is probed, 0 for never
+};
+
+//! what happened at one rate, each counter stops at 0xFFFFFFFF
+struct aes132_clock_rate_statistics {
+	uint32_t clock_hz;          //!< rate in Hz, 0 if it has not been used
+	uint32_t n_commands;        //!< commands started at this rate
+	uint32_t n_errors;          //!< errors counted against this rate
+	uint32_t n_bytes;           //!< data bytes of successful transactions
+	uint32_t bus_us;            //!< time of those transactions in us
+};
+
+//! what happened at the rates of a device
+struct aes132_clock_statistics {
+	struct aes132_clock_rate_statistics rates[AES132_CLOCK_RATE_COUNT_MAX];    //!< by index of the rate in the policy
+	uint16_t n_downshifts;      //!< times the clock was stepped down, stops at 0xFFFF
+	uint16_t n_upshifts;        //!< times a faster rate was probed, stops at 0xFFFF
+};
+
+//! the policy in effect when no other has been set
+extern const struct aes132_clock_policy aes132c_default_clock_policy;
+
+uint8_t aes132c_set_clock_policy(const struct aes132_clock_policy *policy);
+const struct aes132_clock_policy *aes132c_get_clock_policy(void);
+uint32_t aes132c_get_clock_rate(void);
+void    aes132c_record_clock_command(void);
+void    aes132c_record_clock_error(uint8_t aes132_lib_return);
+void    aes132c_record_clock_transfer(uint8_t n_bytes, uint32_t start_us, uint8_t aes132_lib_return);
+const struct aes132_clock_statistics *aes132c_get_clock_statistics(uint8_t device_index);
+uint32_t aes132c_get_clock_throughput(uint8_t device_index, uint8_t rate_index);
+void    aes132c_reset_clock_statistics(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,43 +23,29 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "aes132_clock.h"
 #include "aes132_comm.h"
+#include "aes132_opcode.h"
+#include "aes132_poller.h"
+#include "aes132_power.h"
+#include "aes132_retry.h"
+#include "aes132_timer.h"
+#include "aes132_trace.h"
 #include "aes132_utils.h"  // For debug logging functions
 
-/** \brief This function calculates a 16-bit CRC.
- * \param[in] length number of bytes in data buffer
- * \param[in] data pointer to data
- * \param[out] crc pointer to calculated CRC (high byte at crc[0])
- */
-void aes132c_calculate_crc(uint8_t length, uint8_t *data, uint8_t *crc)
-{
-	uint8_t counter;
-	uint8_t crc_low = 0, crc_high = 0, crc_carry;
-	uint8_t poly_low = 0x05, poly_high = 0x80;
-	uint8_t shift_register;
-	uint8_t data_bit, crc_bit;
-
-	for (counter = 0; counter < length; counter++) {
-		for (shift_register = 0x80; shift_register > 0x00; shift_register >>= 1) {
-			data_bit = (data[counter] & shift_register) ? 1 : 0;
-			crc_bit = crc_high >> 7;
-
-			// Shift CRC to the left by 1.
-			crc_carry = crc_low >> 7;
-			crc_low <<= 1;
-			crc_high <<= 1;
-			crc_high |= crc_carry;
-
-			if ((data_bit ^ crc_bit) != 0) {
-				crc_low ^= poly_low;
-				crc_high ^= poly_high;
-			}
-		}
-	}
-	crc[0] = crc_high;
-	crc[1] = crc_low;
-}
+static uint8_t aes132c_receive_response_polled(uint8_t size, uint8_t *response, uint8_t expected_size,
+			uint32_t start_us, uint32_t timeout_us, uint8_t op_code, uint8_t mode);
+static uint8_t aes132c_poll_status_register_bit(uint8_t mask, uint8_t is_set, uint32_t timeout_us, uint32_t interval_us,
+			uint32_t *elapsed_us, uint16_t *n_polls);
+static uint8_t aes132c_poll_response_buffer(uint8_t size, uint8_t *data, uint32_t timeout_us, uint32_t interval_us,
+			uint32_t *elapsed_us, uint16_t *n_polls);
+static void aes132c_wait_for_next_poll(uint32_t *interval_us, uint32_t remaining_us);
 
+//! measured waits for the device being ready
+static struct aes132_wait_statistics aes132c_device_ready_statistics;
+
+//! measured execution times, from sending a command until its response is ready, indexed by op-code
+static struct aes132_wait_statistics aes132c_execution_statistics[AES132_OPCODE_COUNT];
 
 /** \brief This function resets the command and response buffer address.
  * \return status of the operation
@@ -75,11 +61,18 @@ uint8_t aes132c_reset_io_address(void)
  */
 uint8_t aes132c_resync()
 {
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_COMM, AES132_TRACE_LEVEL_ERROR)
+	uint32_t start_us = aes132c_now_us();
+#endif
 	uint8_t aes132_lib_return = aes132p_resync_physical();
-	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
+	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
+		AES132_TRACE(AES132_TRACE_COMM, AES132_TRACE_LEVEL_ERROR, AES132_TRACE_COMM_RESYNC, aes132_lib_return, 0, 0, start_us);
 		return aes132_lib_return;
+	}
 
-	return aes132c_reset_io_address();
+	aes132_lib_return = aes132c_reset_io_address();
+	AES132_TRACE(AES132_TRACE_COMM, AES132_TRACE_LEVEL_ERROR, AES132_TRACE_COMM_RESYNC, aes132_lib_return, 0, 0, start_us);
+	return aes132_lib_return;
 }
 
 
@@ -102,46 +95,202 @@ uint8_t aes132c_read_device_status_register(uint8_t *device_status_register)
 
 /** \brief This function waits until a bit in the device status register is set or reset.
  *         Reading this register will wake up the device.
+ *
+ * The register is read at least once, even if the time-out is 0.
  * \param[in] mask contains bit pattern to wait for
  * \param[in] is_set specifies whether to wait until bit is set (#AES132_BIT_SET) or reset (#AES132_BIT_CLEARED)
- * \param[in] n_retries 16-bit number that indicates the number of retries before stopping to poll.
+ * \param[in] timeout_us time in us after which to stop polling
+ * \param[out] elapsed_us time in us spent waiting, or NULL if not needed
  * \return status of the operation
  */
-uint8_t aes132c_wait_for_status_register_bit(uint8_t mask, uint8_t is_set, uint16_t n_retries)
+uint8_t aes132c_wait_for_status_register_bit(uint8_t mask, uint8_t is_set, uint32_t timeout_us, uint32_t *elapsed_us)
+{
+	return aes132c_poll_status_register_bit(mask, is_set, timeout_us, 0, elapsed_us, (uint16_t *) 0);
+}
+
+
+/** \brief This function waits until a bit in the device status register is set or reset,
+ *         sleeping between polls.
+ * \param[in] mask contains bit pattern to wait for
+ * \param[in] is_set specifies whether to wait until bit is set (#AES132_BIT_SET) or reset (#AES132_BIT_CLEARED)
+ * \param[in] timeout_us time in us after which to stop polling
+ * \param[in] interval_us time in us to sleep after the first poll, doubled after every
+ *            further poll (see aes132c_next_poll_interval()); 0 to poll back to back,
+ *            or every #AES132_YIELD_POLL_INTERVAL_US with #AES132_YIELDING_WAIT
+ * \param[out] elapsed_us time in us spent waiting, or NULL if not needed
+ * \param[out] n_polls number of times the register was read, or NULL if not needed
+ * \return status of the operation
+ */
+static uint8_t aes132c_poll_status_register_bit(uint8_t mask, uint8_t is_set, uint32_t timeout_us, uint32_t interval_us,
+			uint32_t *elapsed_us, uint16_t *n_polls)
 {
 	uint8_t aes132_lib_return;
 	uint8_t device_status_register;
+	uint32_t start_us = aes132c_now_us();
+	uint32_t waited_us;
+	uint16_t polls = 0;
 
-	do {
+	while (1) {
 		// Initialize status register to prevent reading stale data
 		device_status_register = 0;
 		
 		aes132_lib_return = aes132p_read_memory_physical(1, AES132_STATUS_ADDR, &device_status_register);
+		waited_us = aes132c_now_us() - start_us;
+		if (polls < UINT16_MAX)
+			polls++;
 
-		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
-			continue;
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS) {
+			if (is_set == AES132_BIT_SET) {
+				// Wait for the mask bit(s) being set.
+				if ((device_status_register & mask) == mask)
+					// Mask pattern has been found in device status register. Return success.
+					break;
+
+			} else {
+				// Wait for the mask bit(s) being cleared.
+				if ((device_status_register & mask) == 0)
+					// Mask pattern has been found in device status register. Return success.
+					break;
+			}
 		}
 
-		if (is_set == AES132_BIT_SET) {
-			// Wait for the mask bit(s) being set.
-			if ((device_status_register & mask) == mask)
-				// Mask pattern has been found in device status register. Return success.
-				return aes132_lib_return;
+		// Device is busy, or "mask" pattern does not yet match the device status register value.
+		// Continue polling until the time-out has passed.
+		if (waited_us >= timeout_us) {
+			// The mask pattern was not found in the device status register. Return timeout error.
+			aes132_lib_return = AES132_FUNCTION_RETCODE_TIMEOUT;
+			break;
+		}
 
-		} else {
-			// Wait for the mask bit(s) being cleared.
-			if ((device_status_register & mask) == 0)
-				// Mask pattern has been found in device status register. Return success.
-				return aes132_lib_return;
+		aes132c_wait_for_next_poll(&interval_us, timeout_us - waited_us);
+	}
+
+	if (elapsed_us)
+		*elapsed_us = waited_us;
+	if (n_polls)
+		*n_polls = polls;
+
+	return aes132_lib_return;
+}
+
+
+/** \brief This function reads the response buffer as soon as the device acks its I2C address
+ *         (see #AES132_NACK_POLLING).
+ *
+ * The buffer is read at least once, even if the time-out is 0.
+ * \param[in] size number of bytes to read
+ * \param[out] data pointer to rx buffer
+ * \param[in] timeout_us time in us after which to stop polling
+ * \param[in] interval_us as in aes132c_poll_status_register_bit()
+ * \param[out] elapsed_us time in us spent waiting, or NULL if not needed
+ * \param[out] n_polls number of read attempts, or NULL if not needed
+ * \return status of the operation
+ */
+static uint8_t aes132c_poll_response_buffer(uint8_t size, uint8_t *data, uint32_t timeout_us, uint32_t interval_us,
+			uint32_t *elapsed_us, uint16_t *n_polls)
+{
+	uint8_t aes132_lib_return;
+	uint32_t start_us = aes132c_now_us();
+	uint32_t waited_us;
+	uint16_t polls = 0;
+
+	while (1) {
+		aes132_lib_return = aes132p_read_memory_physical(size, AES132_IO_ADDR, data);
+		waited_us = aes132c_now_us() - start_us;
+		if (polls < UINT16_MAX)
+			polls++;
+
+		if (aes132_lib_return != AES132_FUNCTION_RETCODE_COMM_FAIL)
+			// The device has acked: the response is ready, or reading it failed otherwise.
+			break;
+
+		// A nack to the I2C address indicates that the device is still busy executing the command.
+		if (waited_us >= timeout_us) {
+			aes132_lib_return = AES132_FUNCTION_RETCODE_TIMEOUT;
+			break;
 		}
 
-		// Device is busy, or "mask" pattern does not yet match the device status register value.
-		// Continue polling.
-	} while (n_retries-- > 0);
+		aes132c_wait_for_next_poll(&interval_us, timeout_us - waited_us);
+	}
+
+	if (elapsed_us)
+		*elapsed_us = waited_us;
+	if (n_polls)
+		*n_polls = polls;
+
+	return aes132_lib_return;
+}
+
+
+/** \brief This function leaves the bus alone until the next poll.
+ * \param[in, out] interval_us time in us to sleep, doubled for the next poll (see aes132c_next_poll_interval());
+ *            if 0, the next poll follows back to back, or after #AES132_YIELD_POLL_INTERVAL_US
+ *            with #AES132_YIELDING_WAIT
+ * \param[in] remaining_us time in us left until the time-out, which the sleep does not go beyond
+ */
+static void aes132c_wait_for_next_poll(uint32_t *interval_us, uint32_t remaining_us)
+{
+	if (*interval_us > 0) {
+		aes132c_delay_us((*interval_us < remaining_us) ? *interval_us : remaining_us);
+		*interval_us = aes132c_next_poll_interval(*interval_us);
+	}
+	else if (AES132_YIELDING_WAIT)
+		// Let other tasks run until the next poll.
+		aes132c_delay_us((AES132_YIELD_POLL_INTERVAL_US < remaining_us) ? AES132_YIELD_POLL_INTERVAL_US : remaining_us);
+}
+
+
+/** \brief This function adds a measured wait to statistics.
+ * \param[in,out] statistics statistics to update
+ * \param[in] duration_us duration of the wait in us
+ * \param[in] aes132_lib_return status of the wait
+ */
+void aes132c_record_wait(struct aes132_wait_statistics *statistics, uint32_t duration_us, uint8_t aes132_lib_return)
+{
+	statistics->last_us = duration_us;
+	if (duration_us > statistics->max_us)
+		statistics->max_us = duration_us;
+	if (statistics->n_waits < UINT16_MAX)
+		statistics->n_waits++;
+	if ((aes132_lib_return == AES132_FUNCTION_RETCODE_TIMEOUT) && (statistics->n_timeouts < UINT16_MAX))
+		statistics->n_timeouts++;
+}
+
 
-	// The mask pattern was not found in the device status register after "n_retries" polling
-	// iterations. Return timeout error.
-	return AES132_FUNCTION_RETCODE_TIMEOUT;
+/** \brief This function adds a measured wait for the device being ready to its statistics.
+ *
+ * The wait also counts as the wake cost of the power mode the device was in (see aes132c_record_wakeup()).
+ * \param[in] duration_us duration of the wait in us
+ * \param[in] aes132_lib_return status of the wait
+ */
+void aes132c_record_device_ready_time(uint32_t duration_us, uint8_t aes132_lib_return)
+{
+	aes132c_record_wait(&aes132c_device_ready_statistics, duration_us, aes132_lib_return);
+	aes132c_record_wakeup(duration_us, aes132_lib_return);
+}
+
+
+/** \brief This function adds a measured execution time to the statistics of a command.
+ *
+ * With #AES132_ADAPTIVE_POLLING, a successful wait also updates the learned execution time.
+ * The device counts as active until then (see aes132c_record_activity()).
+ * \param[in] op_code command op-code, or #AES132_OPCODE_UNKNOWN to ignore the measurement
+ * \param[in] mode command mode
+ * \param[in] duration_us time from sending the command until the response was found ready,
+ *            or until waiting for it timed out
+ * \param[in] aes132_lib_return status of the wait
+ * \param[in] is_upper_bound non-zero if the response was ready at the first poll
+ */
+void aes132c_record_execution_time(uint8_t op_code, uint8_t mode, uint32_t duration_us, uint8_t aes132_lib_return,
+			uint8_t is_upper_bound)
+{
+	aes132c_record_activity();
+	if (op_code >= AES132_OPCODE_COUNT)
+		return;
+
+	aes132c_record_wait(&aes132c_execution_statistics[op_code], duration_us, aes132_lib_return);
+	if (AES132_ADAPTIVE_POLLING && (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS))
+		aes132c_update_latency_estimate(op_code, mode, duration_us, is_upper_bound);
 }
 
 
@@ -150,7 +299,13 @@ uint8_t aes132c_wait_for_status_register_bit(uint8_t mask, uint8_t is_set, uint1
  */
 uint8_t aes132c_wait_for_device_ready(void)
 {
-	return aes132c_wait_for_status_register_bit(AES132_WIP_BIT, AES132_BIT_CLEARED, AES132_RETRY_COUNT_DEVICE_READY);
+	uint32_t elapsed_us;
+	uint8_t aes132_lib_return = aes132c_wait_for_status_register_bit(AES132_WIP_BIT, AES132_BIT_CLEARED,
+				AES132_DEVICE_READY_TIMEOUT * 1000UL, &elapsed_us);
+
+	aes132c_record_device_ready_time(elapsed_us, aes132_lib_return);
+
+	return aes132_lib_return;
 }
 
 
@@ -159,11 +314,49 @@ uint8_t aes132c_wait_for_device_ready(void)
  */
 uint8_t aes132c_wait_for_response_ready(void)
 {
-	return aes132c_wait_for_status_register_bit(AES132_RESPONSE_READY_BIT, AES132_BIT_SET, AES132_RETRY_COUNT_RESPONSE_READY);
+	return aes132c_wait_for_status_register_bit(AES132_RESPONSE_READY_BIT, AES132_BIT_SET,
+				AES132_RESPONSE_READY_TIMEOUT * 1000UL, (uint32_t *) 0);
+}
+
+
+/** \brief This function returns the measured waits for the device being ready.
+ * \return pointer to statistics
+ */
+const struct aes132_wait_statistics *aes132c_get_device_ready_statistics(void)
+{
+	return &aes132c_device_ready_statistics;
+}
+
+
+/** \brief This function returns the measured execution times of a command.
+ *
+ * The execution time is measured from sending the command until the Response-Ready bit is
+ * found set, and includes the delay before the first poll. Only commands whose response is
+ * received by aes132c_receive_command_response() are measured.
+ * \param[in] op_code command op-code
+ * \return pointer to statistics, or NULL if the op-code is out of range
+ */
+const struct aes132_wait_statistics *aes132c_get_execution_statistics(uint8_t op_code)
+{
+	if (op_code >= AES132_OPCODE_COUNT)
+		return (const struct aes132_wait_statistics *) 0;
+
+	return &aes132c_execution_statistics[op_code];
+}
+
+
+/** \brief This function clears all measured waits.
+ */
+void aes132c_reset_wait_statistics(void)
+{
+	memset(&aes132c_device_ready_statistics, 0, sizeof(aes132c_device_ready_statistics));
+	memset(aes132c_execution_statistics, 0, sizeof(aes132c_execution_statistics));
 }
 
 
 /** \brief This function sends a Sleep command to the device.
+ *
+ * After the command has been sent, the device counts as being in the power mode (see aes132c_record_power_mode()).
  * \param[in] standby mode (0: sleep, non-zero: standby)
  * \return status of the operation
  */
@@ -171,11 +364,14 @@ uint8_t aes132c_send_sleep_command(uint8_t standby)
 {
 	// command buffer fields:
 	// <count = 0x09><op code = 0x11><mode = 0x00 (sleep)><param1 = 0x0000><param2 = 0x0000><CRC = 0x7181>
-	const uint8_t command_sleep[] = {AES132_COMMAND_SIZE_MIN, 0x11, AES132_COMMAND_MODE_SLEEP, 0, 0, 0, 0, 0x71, 0x81};
-	const uint8_t command_standby[] = {AES132_COMMAND_SIZE_MIN, 0x11, AES132_COMMAND_MODE_STANDBY, 0, 0, 0, 0, 0xEF, 0x82};
+	// Static so that the packets are sent from flash instead of being copied to the stack.
+	static const uint8_t command_sleep[] = AES132_COMMAND_PACKET_SLEEP;
+	static const uint8_t command_standby[] = AES132_COMMAND_PACKET_STANDBY;
+	const struct aes132_segment segment_sleep = {command_sleep, sizeof(command_sleep)};
+	const struct aes132_segment segment_standby = {command_standby, sizeof(command_standby)};
 
-	// Disable reading the device status register after sending the command and disable appending the CRC.
-	const uint8_t options = (AES132_OPTION_NO_APPEND_CRC | AES132_OPTION_NO_STATUS_READ);
+	// Disable reading the device status register after sending the command. The packets carry their CRC.
+	const uint8_t options = AES132_OPTION_NO_STATUS_READ;
 
 	// We reset the IO buffer address as a precaution.
 	// Since we cannot read the device status register after sending the Sleep command
@@ -184,17 +380,24 @@ uint8_t aes132c_send_sleep_command(uint8_t standby)
 	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
 		return aes132_lib_return;
 
-	if (standby == AES132_COMMAND_MODE_SLEEP)
-		return aes132c_send_command((uint8_t *) command_sleep, options);
+	if (standby == AES132_COMMAND_MODE_SLEEP) {
+		aes132_lib_return = aes132c_send_command_segments(&segment_sleep, 1, options);
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+			aes132c_record_power_mode(AES132_POWER_MODE_SLEEP);
+		return aes132_lib_return;
+	}
 
-	return aes132c_send_command((uint8_t *) command_standby, options);
+	aes132_lib_return = aes132c_send_command_segments(&segment_standby, 1, options);
+	if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+		aes132c_record_power_mode(AES132_POWER_MODE_STANDBY);
+	return aes132_lib_return;
 }
 
 
 /** \brief This function wakes up a device.
  *
  * It takes about 1.5 ms for the device to wake up when in Sleep mode, and
- * about 0.3 ms when in Standby mode.
+ * about 0.3 ms when in Standby mode. The time it took is measured (see aes132c_get_power_statistics()).
  * \return status of the operation
  */
 uint8_t aes132c_wakeup(void)
@@ -222,13 +425,15 @@ uint8_t aes132c_standby(void)
 
 
 /** \brief This function writes to or reads from memory with retries.
- * \param[in] count number of bytes to send
  * \param[in] word_address word address
- * \param[in, out] data pointer to tx or rx data
- * \param[in] read flag indicating whether to read (#AES132_READ) or write (#AES132_WRITE)
+ * \param[in] segments buffers to write, in order (NULL to read)
+ * \param[in] n_segments number of segments to write
+ * \param[in] size number of bytes to read
+ * \param[out] data pointer to rx data
  * \return status of the operation or response return code
  * */
-uint8_t aes132c_access_memory(uint8_t count, uint16_t word_address, uint8_t *data, uint8_t read)
+static uint8_t aes132c_access_memory_segments(uint16_t word_address, const struct aes132_segment *segments,
+			uint8_t n_segments, uint8_t size, uint8_t *data)
 {
 	uint8_t aes132_lib_return;
 
@@ -250,9 +455,9 @@ uint8_t aes132c_access_memory(uint8_t count, uint16_t word_address, uint8_t *dat
 				// We lost communication. Re-synchronize.
 				break;
 
-			if (read == 0) {
+			if (segments) {
 				// Write to the device.
-				aes132_lib_return = aes132p_write_memory_physical(count, word_address, data);
+				aes132_lib_return = aes132p_write_memory_physical_segments(word_address, segments, n_segments);
 				if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
 					// Communication failed. Retry.
 					continue;
@@ -277,7 +482,7 @@ uint8_t aes132c_access_memory(uint8_t count, uint16_t word_address, uint8_t *dat
 			}
 			else {
 				// Read from the device.
-				aes132_lib_return = aes132p_read_memory_physical(count, word_address, data);
+				aes132_lib_return = aes132p_read_memory_physical(size, word_address, data);
 				if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
 					return aes132_lib_return;
 			}
@@ -300,6 +505,36 @@ uint8_t aes132c_access_memory(uint8_t count, uint16_t word_address, uint8_t *dat
 }
 
 
+/** \brief This function writes to or reads from memory with retries.
+ * \param[in] count number of bytes to send
+ * \param[in] word_address word address
+ * \param[in, out] data pointer to tx or rx data
+ * \param[in] read flag indicating whether to read (#AES132_READ) or write (#AES132_WRITE)
+ * \return status of the operation or response return code
+ * */
+uint8_t aes132c_access_memory(uint8_t count, uint16_t word_address, uint8_t *data, uint8_t read)
+{
+	struct aes132_segment segment = {data, count};
+
+	if (read != 0)
+		return aes132c_access_memory_segments(word_address, (struct aes132_segment *) 0, 0, count, data);
+
+	return aes132c_access_memory_segments(word_address, &segment, 1, 0, (uint8_t *) 0);
+}
+
+
+/** \brief This function writes several buffers to memory in one transfer, with retries.
+ * \param[in] word_address word address
+ * \param[in] segments buffers to write, in order
+ * \param[in] n_segments number of segments (at most #AES132_SEGMENT_COUNT_MAX)
+ * \return status of the operation or response return code
+ * */
+uint8_t aes132c_write_memory_segments(uint16_t word_address, const struct aes132_segment *segments, uint8_t n_segments)
+{
+	return aes132c_access_memory_segments(word_address, segments, n_segments, 0, (uint8_t *) 0);
+}
+
+
 /** \brief This function writes a command into the I/O buffer of the device.
  *
  * The fields of the command buffer are described below:\n
@@ -315,27 +550,78 @@ uint8_t aes132c_access_memory(uint8_t count, uint16_t word_address, uint8_t *dat
  */
 uint8_t aes132c_send_command(uint8_t *command, uint8_t options)
 {
-	uint8_t aes132_lib_return;
-	uint8_t n_retries = AES132_RETRY_COUNT_ERROR;
-	uint8_t device_status_register;
 	uint8_t count = command[AES132_COMMAND_INDEX_COUNT];
+	struct aes132_segment segment = {command, count};
 
 	if ((options & AES132_OPTION_NO_APPEND_CRC) == 0)
 		// Append two-byte CRC to command.
 		aes132c_calculate_crc(count - AES132_CRC_SIZE, command, &command[count - AES132_CRC_SIZE]);
 
+	return aes132c_send_command_segments(&segment, 1, options);
+}
+
+
+/** \brief This function writes a command that is split into several buffers into the I/O buffer of the device.
+ *
+ * The segments are sent in one I2C transfer straight from where they are, e.g. the command header
+ * on the stack, the data blocks in the caller's buffers, and the CRC. Together they have to form a
+ * complete command including count byte and CRC. #AES132_OPTION_NO_APPEND_CRC is implied.\n
+ * The function retries sending the command if the device indicates a CRC error. If the device
+ * status register cannot be read after writing, it sends an idempotent command again (see
+ * aes132c_get_command_class()). Any other command it sends again only if the device turns out
+ * not to have received it (see aes132c_check_command_received()).
+ * \param[in] segments buffers that form the command, in order; the first one holds at least
+ *            count, op-code and mode
+ * \param[in] n_segments number of segments (at most #AES132_SEGMENT_COUNT_MAX)
+ * \param[in] options flags for communication behavior
+ * \return status of the operation
+ */
+uint8_t aes132c_send_command_segments(const struct aes132_segment *segments, uint8_t n_segments, uint8_t options)
+{
+	uint8_t aes132_lib_return;
+	uint8_t is_resynced;
+	uint8_t device_status_register;
+	uint8_t recovery_return;
+	struct aes132_retry_state retry;
+	// The command header, up to the mode, is in the first segment.
+	uint8_t op_code = (segments[0].count > AES132_COMMAND_INDEX_MODE)
+				? segments[0].data[AES132_COMMAND_INDEX_OPCODE] : AES132_OPCODE_UNKNOWN;
+	uint8_t mode = (segments[0].count > AES132_COMMAND_INDEX_MODE) ? segments[0].data[AES132_COMMAND_INDEX_MODE] : 0;
+
+	if (aes132c_get_power_mode() != AES132_POWER_MODE_ACTIVE)
+		// The device is not ready before it has woken up (see aes132_power.h).
+		options &= ~AES132_OPTION_DEVICE_READY;
+
+	if (AES132_CLOCK_MANAGER)
+		// Count the command, and run it at the rate of the device (see aes132_clock.h).
+		aes132c_record_clock_command();
+
+	aes132c_begin_retries(&retry);
 	do {
-		aes132_lib_return = aes132c_access_memory(count, AES132_IO_ADDR, command,  AES132_WRITE);
-		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
-			// Writing to the I/O buffer failed. Retry.
+		if (((options & AES132_OPTION_DEVICE_READY) != 0) && (retry.n_retries == 0))
+			// The device is idle. Write the command without polling the device status register first.
+			// Retries go through the regular path.
+			aes132_lib_return = aes132p_write_memory_physical_segments(AES132_IO_ADDR, segments, n_segments);
+		else
+			aes132_lib_return = aes132c_write_memory_segments(AES132_IO_ADDR, segments, n_segments);
+		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
+			// Writing to the I/O buffer failed. Retry. Writing re-synchronizes by itself
+			// (see aes132c_write_memory_segments()), so the retry policy does not again.
+			is_resynced = 1;
 			continue;
+		}
 
 		if ((options & AES132_OPTION_NO_STATUS_READ) != 0)
 			// We don't read device status register when sending a Sleep command.
 			return aes132_lib_return;
 
+		if (AES132_NACK_POLLING)
+			// A Tx CRC error shows when the response is read (see aes132c_receive_response_polled()).
+			return aes132_lib_return;
+
 		// Try to read the device status register. If it fails with an I2C nack of the I2C write address,
 		// we know that the device is busy.
+		is_resynced = 0;
 		aes132_lib_return = aes132c_read_device_status_register(&device_status_register);
 		//aes132_lib_return = aes132p_read_memory_physical(1, AES132_STATUS_ADDR, &device_status_register);
 		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS) {
@@ -350,17 +636,33 @@ uint8_t aes132c_send_command(uint8_t *command, uint8_t options)
 			// indicates that the device is busy executing the command. We therefore return success.
 			return AES132_FUNCTION_RETCODE_SUCCESS;
 
-		// In case of read-device-status-register failure, we do not send the command again but only
-		// re-synchronize, because we do not want certain commands being repeated, e.g. the Counter command.
+		// In case of read-device-status-register failure, we re-synchronize. We send the command again
+		// only if it is idempotent or has not reached the device, because we do not want certain commands
+		// being repeated, e.g. the Counter command.
 		}else {
 			// Do not override the return value from the call to aes132p_read_memory_physical.
 			(void) aes132c_resync();
-			return aes132_lib_return;
+			is_resynced = 1;
+			if (aes132c_get_command_class(op_code, mode) == AES132_COMMAND_CLASS_IDEMPOTENT)
+				// Running the command twice does no harm. Send it again.
+				continue;
+
+			// Find out whether the device has received the command, and send it again only if it has not.
+			device_status_register = 0;
+			recovery_return = aes132c_read_device_status_register(&device_status_register);
+			recovery_return = aes132c_check_command_received(recovery_return, device_status_register);
+			if (recovery_return == AES132_FUNCTION_RETCODE_SUCCESS)
+				// The command has run or is running. Its response is read next.
+				return AES132_FUNCTION_RETCODE_SUCCESS;
+			if ((recovery_return != AES132_FUNCTION_RETCODE_NOT_EXECUTED)
+						&& (recovery_return != AES132_FUNCTION_RETCODE_BAD_CRC_TX))
+				// We still cannot tell. Give up rather than risk running the command twice.
+				return aes132_lib_return;
 		}
 
 		// Retry sending the command if an error occurred sending the command, or the device status register
-		// indicates a CRC error after having sent the command.
-	} while ((aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) && (--n_retries > 0));
+		// indicates a CRC error after having sent the command, as far as the retry policy allows.
+	} while (aes132c_retry(&retry, aes132_lib_return, is_resynced));
 
 	// We did not succeed sending a command. Return the error from aes132p_read_memory_physical or
 	// AES132_FUNCTION_RETCODE_BAD_CRC_TX.
@@ -368,101 +670,238 @@ uint8_t aes132c_send_command(uint8_t *command, uint8_t options)
 }
 
 
+/** \brief This function checks the count byte of a response.
+ * \param[in] count_byte count byte received
+ * \param[in] size size of the response buffer
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS if a response of this size is valid and fits, otherwise
+ *         #AES132_FUNCTION_RETCODE_COMM_FAIL, #AES132_FUNCTION_RETCODE_SIZE_TOO_SMALL,
+ *         or #AES132_FUNCTION_RETCODE_COUNT_INVALID
+ */
+uint8_t aes132c_check_response_count(uint8_t count_byte, uint8_t size)
+{
+	// Check if count byte is zero or invalid - this indicates I2C read failure
+	// Zero count means no data was received, which is a communication failure
+	if (count_byte == 0)
+		// Count byte is zero, which means I2C read failed or returned stale data
+		return AES132_FUNCTION_RETCODE_COMM_FAIL;
+
+	if (count_byte > size)
+		// The buffer provided by the caller is not big enough to store the entire response,
+		// or the count value got corrupted due to a bad communication channel.
+		return AES132_FUNCTION_RETCODE_SIZE_TOO_SMALL;
+
+	if ((count_byte < AES132_RESPONSE_SIZE_MIN) || (count_byte > AES132_RESPONSE_SIZE_MAX))
+		// A response has to be between #AES132_RESPONSE_SIZE_MIN and #AES132_RESPONSE_SIZE_MAX bytes long to be valid.
+		return AES132_FUNCTION_RETCODE_COUNT_INVALID;
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function checks the CRC of a response whose count byte has been checked.
+ * \param[in] response pointer to response
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS or #AES132_FUNCTION_RETCODE_BAD_CRC_RX
+ */
+uint8_t aes132c_check_response_crc(uint8_t *response)
+{
+	uint8_t crc[AES132_CRC_SIZE];
+	uint8_t crc_index = response[AES132_RESPONSE_INDEX_COUNT] - AES132_CRC_SIZE;
+
+	aes132c_calculate_crc(crc_index, response, crc);
+	if ((crc[0] == response[crc_index]) && (crc[1] == response[crc_index + 1]))
+		return AES132_FUNCTION_RETCODE_SUCCESS;
+
+	return AES132_FUNCTION_RETCODE_BAD_CRC_RX;
+}
+
+
 /** \brief This function reads a response from the I/O buffer of the device.
+ *
+ * The count byte is read first, and then the remainder of the response.
  * \param[in] size number of bytes to retrieve (<= response buffer size allocated by caller)
  * \param[out] response pointer to retrieved response
  * \return status of the operation
  */
 uint8_t aes132c_receive_response(uint8_t size, uint8_t *response)
+{
+	return aes132c_receive_response_expected(size, response, 0);
+}
+
+
+/** \brief This function reads a response of known size from the I/O buffer of the device.
+ *
+ * If the size of a successful response is known (see aes132c_get_response_size()), the whole
+ * response is read in one bus transaction instead of two. A shorter response, e.g. an error
+ * response, is still received correctly, because only "count" bytes of what was read are used.
+ * Should the count byte announce a longer response, its remainder is read in a second transaction.
+ * \param[in] size number of bytes to retrieve (<= response buffer size allocated by caller)
+ * \param[out] response pointer to retrieved response
+ * \param[in] expected_size size of a successful response, or 0 if it is not known
+ * \return status of the operation
+ */
+uint8_t aes132c_receive_response_expected(uint8_t size, uint8_t *response, uint8_t expected_size)
+{
+	return aes132c_receive_response_polled(size, response, expected_size, aes132c_now_us(),
+				AES132_RESPONSE_READY_TIMEOUT * 1000UL, AES132_OPCODE_UNKNOWN, 0);
+}
+
+
+/** \brief This function waits for a command to execute and reads its response.
+ *
+ * Call it right after sending the command. It sleeps for the typical execution time of the
+ * command before polling the device status register, and polls no longer than the maximum
+ * execution time (see aes132c_get_execution_time()), counted from the call. With
+ * #AES132_ADAPTIVE_POLLING, it sleeps for the learned execution time instead and backs off
+ * between polls (see aes132_poller.h). The response is
+ * read in one bus transaction if its size is known (see aes132c_receive_response_expected()).
+ * The measured execution time is added to aes132c_get_execution_statistics().
+ * \param[in] size number of bytes to retrieve (<= response buffer size allocated by caller)
+ * \param[out] response pointer to retrieved response
+ * \param[in] op_code op-code of the command that was sent
+ * \param[in] mode mode of the command that was sent
+ * \param[in] param2 second parameter of the command that was sent
+ * \return status of the operation
+ */
+uint8_t aes132c_receive_command_response(uint8_t size, uint8_t *response, uint8_t op_code, uint8_t mode, uint16_t param2)
+{
+	uint32_t start_us = aes132c_now_us();
+	struct aes132_execution_time execution_time = aes132c_get_execution_time(op_code, mode);
+	uint32_t timeout_us = execution_time.max_ms * 1000UL;
+	uint32_t delay_us = AES132_ADAPTIVE_POLLING ? aes132c_predict_execution_time(op_code, mode)
+				: execution_time.typical_us;
+
+	// Leave the bus alone while the command executes.
+	if (delay_us > 0)
+		aes132c_delay_us((delay_us < timeout_us) ? delay_us : timeout_us);
+
+	return aes132c_receive_response_polled(size, response, aes132c_get_response_size(op_code, mode, param2),
+				start_us, timeout_us, op_code, mode);
+}
+
+
+/** \brief This function tells whether the device has rejected the command, with #AES132_NACK_POLLING.
+ *
+ * Without reading the device status register after writing a command, a Tx CRC error shows only
+ * as a response that is not consistent: the device has not run the command, and the response
+ * buffer still holds what has been written. The device status register tells it from a Rx error.
+ * \param[in, out] aes132_lib_return status of a failed attempt to receive a response; set to
+ *            #AES132_FUNCTION_RETCODE_BAD_CRC_TX if the device flags a CRC error
+ * \return non-zero if the device has rejected the command
+ */
+uint8_t aes132c_find_tx_crc_error(uint8_t *aes132_lib_return)
+{
+	uint8_t device_status_register = 0;
+
+	if (!AES132_NACK_POLLING || (*aes132_lib_return == AES132_FUNCTION_RETCODE_TIMEOUT))
+		return 0;
+
+	if ((aes132c_read_device_status_register(&device_status_register) != AES132_FUNCTION_RETCODE_SUCCESS)
+				|| ((device_status_register & AES132_CRC_ERROR_BIT) == 0))
+		return 0;
+
+	*aes132_lib_return = AES132_FUNCTION_RETCODE_BAD_CRC_TX;
+	return 1;
+}
+
+
+/** \brief This function reads a response from the I/O buffer of the device.
+ * \param[in] size number of bytes to retrieve (<= response buffer size allocated by caller)
+ * \param[out] response pointer to retrieved response
+ * \param[in] expected_size size of a successful response, or 0 if it is not known
+ * \param[in] start_us time from which the first wait for the Response-Ready bit is measured
+ * \param[in] timeout_us time in us after which to stop waiting for the Response-Ready bit;
+ *            the first wait ends timeout_us after start_us, later waits after a resync get all of it
+ * \param[in] op_code op-code of the command whose execution time the first wait measures,
+ *            or #AES132_OPCODE_UNKNOWN
+ * \param[in] mode mode of that command
+ * \return status of the operation
+ */
+static uint8_t aes132c_receive_response_polled(uint8_t size, uint8_t *response, uint8_t expected_size,
+			uint32_t start_us, uint32_t timeout_us, uint8_t op_code, uint8_t mode)
 {
 	uint8_t aes132_lib_return;
-	uint8_t n_retries = AES132_RETRY_COUNT_ERROR;
-	uint8_t crc[AES132_CRC_SIZE];
-	uint8_t crc_index;
 	uint8_t count_byte;
+	uint32_t waited_us;
+	uint32_t elapsed_us;
+	uint32_t interval_us = 0;
+	uint16_t n_polls;
+	struct aes132_retry_state retry;
+
+	// Read the expected response at once, or only the count byte if its size is not known.
+	uint8_t first_read_size = 1;
+	if ((expected_size >= AES132_RESPONSE_SIZE_MIN) && (expected_size <= size))
+		first_read_size = expected_size;
 
 	// Initialize response buffer to prevent reading stale data
 	memset(response, 0, size);
 
+	aes132c_begin_retries(&retry);
 	do {
 		// Initialize response buffer on each retry to prevent reading stale data
 		memset(response, 0, size);
 		
-		aes132_lib_return = aes132c_wait_for_response_ready();
-		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
-			// Waiting for the Response-Ready bit timed out. We might have lost communication.
-			// Re-synchronize and retry.
-			// Do not override the return value from the call to aes132c_wait_for_response_ready.
-			(void) aes132c_resync();
-			continue;
+		if (retry.n_retries == 0) {
+			// First attempt: the deadline counts from start_us.
+			waited_us = aes132c_now_us() - start_us;
+			if (AES132_ADAPTIVE_POLLING && (op_code != AES132_OPCODE_UNKNOWN))
+				interval_us = aes132c_get_poll_interval(op_code, mode);
 		}
-
-		// Read count byte from response buffer.
-		aes132_lib_return = aes132p_read_memory_physical(1, AES132_IO_ADDR, &response[AES132_COMMAND_INDEX_COUNT]);
-		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
-			// Reading the count byte failed. We might have lost communication.
-			// Re-synchronize and retry.
-			// Do not override the return value from the call to aes132p_read_memory_physical.
-			(void) aes132c_resync();
-			continue;
+		else {
+			waited_us = 0;
+			interval_us = 0;
 		}
 
-		count_byte = response[AES132_RESPONSE_INDEX_COUNT];
-		
-		// Check if count byte is zero or invalid - this indicates I2C read failure
-		// Zero count means no data was received, which is a communication failure
-		if (count_byte == 0) {
-			// Count byte is zero, which means I2C read failed or returned stale data
-			aes132_lib_return = AES132_FUNCTION_RETCODE_COMM_FAIL;
-			(void) aes132c_resync();
-			continue;
+		if (AES132_NACK_POLLING)
+			// Read count byte, or the entire expected response, as soon as the device acks.
+			aes132_lib_return = aes132c_poll_response_buffer(first_read_size, &response[AES132_RESPONSE_INDEX_COUNT],
+						(waited_us < timeout_us) ? timeout_us - waited_us : 0, interval_us, &elapsed_us, &n_polls);
+		else
+			aes132_lib_return = aes132c_poll_status_register_bit(AES132_RESPONSE_READY_BIT, AES132_BIT_SET,
+						(waited_us < timeout_us) ? timeout_us - waited_us : 0, interval_us, &elapsed_us, &n_polls);
+		if (retry.n_retries == 0) {
+			aes132c_record_execution_time(op_code, mode, waited_us + elapsed_us,
+						(aes132_lib_return == AES132_FUNCTION_RETCODE_TIMEOUT)
+						? AES132_FUNCTION_RETCODE_TIMEOUT : AES132_FUNCTION_RETCODE_SUCCESS, n_polls == 1);
+			AES132_TRACE(AES132_TRACE_COMM, AES132_TRACE_LEVEL_INFO, AES132_TRACE_COMM_WAIT, aes132_lib_return,
+						(op_code << 8) | mode, n_polls, start_us);
 		}
-		
-		if (count_byte > size) {
-			// The buffer provided by the caller is not big enough to store the entire response,
-			// or the count value got corrupted due to a bad communication channel.
-			// Re-synchronize and retry.
-			aes132_lib_return = AES132_FUNCTION_RETCODE_SIZE_TOO_SMALL;
-			// Do not override aes132_lib_return.
-			(void) aes132c_resync();
+		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
+			// Waiting for the response timed out, or reading it failed. We might have lost communication.
 			continue;
-		}
 
-		if ((count_byte < AES132_RESPONSE_SIZE_MIN) || (count_byte > AES132_RESPONSE_SIZE_MAX)) {
-			// A response has to be between #AES132_RESPONSE_SIZE_MIN and #AES132_RESPONSE_SIZE_MAX bytes long to be valid.
-			// Re-synchronize and retry.
-			aes132_lib_return = AES132_FUNCTION_RETCODE_COUNT_INVALID;
-			// Do not override aes132_lib_return.
-			(void) aes132c_resync();
-			continue;
+		if (!AES132_NACK_POLLING) {
+			// Read count byte, or the entire expected response, from response buffer.
+			aes132_lib_return = aes132p_read_memory_physical(first_read_size, AES132_IO_ADDR, &response[AES132_COMMAND_INDEX_COUNT]);
+			if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
+				// Reading the count byte failed. We might have lost communication.
+				continue;
 		}
 
-		// Read remainder of response.
-		aes132_lib_return = aes132p_read_memory_physical(count_byte - 1, AES132_IO_ADDR, &response[AES132_RESPONSE_INDEX_RETURN_CODE]);
-		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
-			// Reading the remainder of the response failed. We might have lost communication.
-			// Re-synchronize and retry.
-			// Do not override the return value from the call to aes132p_read_memory_physical.
-			(void) aes132c_resync();
+		count_byte = response[AES132_RESPONSE_INDEX_COUNT];
+		aes132_lib_return = aes132c_check_response_count(count_byte, size);
+		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
 			continue;
+
+		if (count_byte > first_read_size) {
+			// Read remainder of response.
+			aes132_lib_return = aes132p_read_memory_physical(count_byte - first_read_size, AES132_IO_ADDR, &response[first_read_size]);
+			if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
+				// Reading the remainder of the response failed. We might have lost communication.
+				continue;
 		}
 		
 		// Check CRC.
-		crc_index = count_byte - AES132_CRC_SIZE;
-		aes132c_calculate_crc(crc_index, response, crc);
-		if ((crc[0] == response[crc_index]) && (crc[1] == response[crc_index + 1])) {
+		aes132_lib_return = aes132c_check_response_crc(response);
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS) {
 			// We received a consistent response packet. Return the response return code.
 			return response[AES132_RESPONSE_INDEX_RETURN_CODE];
 		}
 		
 		// Received and calculated CRC do not match. Retry reading the response buffer.
-		aes132_lib_return = AES132_FUNCTION_RETCODE_BAD_CRC_RX;
-
-		// Do not override aes132_lib_return.
-		(void) aes132c_resync();
 
-		// Retry if communication failed, or CRC did not match.
-	} while ((aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) && (--n_retries > 0));
+		// Retry if communication failed, or CRC did not match, as far as the retry policy allows.
+		// It also decides whether to re-synchronize first. A rejected command is not retried here.
+	} while (!aes132c_find_tx_crc_error(&aes132_lib_return) && aes132c_retry(&retry, aes132_lib_return, 0));
 
 	// Even after re-synchronizing and retrying, we could not receive a consistent response packet.
 	return aes132_lib_return;
@@ -478,10 +917,125 @@ uint8_t aes132c_receive_response(uint8_t size, uint8_t *response)
  */
 uint8_t aes132c_send_and_receive(uint8_t *command, uint8_t size, uint8_t *response, uint8_t options)
 {
-	uint8_t aes132_lib_return = aes132c_send_command(command, options);
+	uint8_t count = command[AES132_COMMAND_INDEX_COUNT];
+	struct aes132_segment segment = {command, count};
+
+	if ((options & AES132_OPTION_NO_APPEND_CRC) == 0)
+		// Append two-byte CRC to command.
+		aes132c_calculate_crc(count - AES132_CRC_SIZE, command, &command[count - AES132_CRC_SIZE]);
+
+	return aes132c_send_and_receive_segments(&segment, 1, size, response, options);
+}
+
+
+/** \brief This function sends a command that is split into several buffers and reads its response.
+ *
+ * If the exchange fails for an idempotent command, e.g. Info, BlockRead or TempSense, the whole
+ * exchange is repeated, up to #AES132_RETRY_COUNT_EXCHANGE attempts (see aes132c_is_exchange_repeated()).
+ * With #AES132_NACK_POLLING, a Tx CRC error is found while receiving the response, and the command
+ * is sent again as the retry policy allows.
+ * \param[in] segments buffers that form the command (see aes132c_send_command_segments()); the first
+ *            one holds the whole command header
+ * \param[in] n_segments number of segments (at most #AES132_SEGMENT_COUNT_MAX)
+ * \param[in] size size of response buffer
+ * \param[out] response pointer to response buffer
+ * \param[in] options flags for communication behavior
+ * \return status of the operation
+ */
+uint8_t aes132c_send_and_receive_segments(const struct aes132_segment *segments, uint8_t n_segments, uint8_t size,
+			uint8_t *response, uint8_t options)
+{
+	const uint8_t *header = segments[0].data;
+	uint8_t op_code = header[AES132_COMMAND_INDEX_OPCODE];
+	uint8_t mode = header[AES132_COMMAND_INDEX_MODE];
+	uint16_t param2 = (header[AES132_COMMAND_INDEX_PARAM2_MSB] << 8) | header[AES132_COMMAND_INDEX_PARAM2_LSB];
+	uint8_t n_exchanges = AES132_RETRY_COUNT_EXCHANGE;
+	uint8_t aes132_lib_return;
+	struct aes132_retry_state tx_retry;
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_COMM, AES132_TRACE_LEVEL_INFO)
+	uint32_t start_us = aes132c_now_us();
+#endif
+
+	aes132c_begin_retries(&tx_retry);
+	while (1) {
+		aes132_lib_return = aes132c_send_command_segments(segments, n_segments, options);
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+			aes132_lib_return = aes132c_receive_command_response(size, response, op_code, mode, param2);
+
+		// The device might still be busy with the failed attempt.
+		options &= ~AES132_OPTION_DEVICE_READY;
+
+		if (AES132_NACK_POLLING && (aes132_lib_return == AES132_FUNCTION_RETCODE_BAD_CRC_TX)
+					&& aes132c_retry(&tx_retry, aes132_lib_return, 0))
+			// The device has rejected the command without running it. Send it again.
+			continue;
+
+		if ((--n_exchanges == 0) || !aes132c_is_exchange_repeated(op_code, mode, aes132_lib_return))
+			break;
+	}
+
+	AES132_TRACE(AES132_TRACE_COMM, AES132_TRACE_LEVEL_INFO, AES132_TRACE_COMM_EXCHANGE, aes132_lib_return,
+				(op_code << 8) | mode, param2, start_us);
+	return aes132_lib_return;
+}
+
+
+/** \brief This function checks whether the device has received a command whose status read failed.
+ *
+ * Call it with the result of reading the device status register after re-synchronizing.
+ * A device that is busy or has a response ready has received the command; one that flags a
+ * CRC error has rejected it; one that is idle without a response has not received it.
+ * \param[in] aes132_lib_return status of reading the device status register
+ * \param[in] device_status_register value read
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS if the command has run or is running,
+ *         #AES132_FUNCTION_RETCODE_BAD_CRC_TX or #AES132_FUNCTION_RETCODE_NOT_EXECUTED if it has not,
+ *         else the error reading the register
+ */
+uint8_t aes132c_check_command_received(uint8_t aes132_lib_return, uint8_t device_status_register)
+{
+	if (aes132_lib_return == AES132_FUNCTION_RETCODE_COMM_FAIL)
+		// A nack to the I2C address indicates that the device is busy executing the command.
+		return AES132_FUNCTION_RETCODE_SUCCESS;
+
 	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
 		return aes132_lib_return;
 
-	return aes132c_receive_response(size, response);
+	if ((device_status_register & (AES132_WIP_BIT | AES132_RESPONSE_READY_BIT)) != 0)
+		return AES132_FUNCTION_RETCODE_SUCCESS;
+
+	if ((device_status_register & AES132_CRC_ERROR_BIT) != 0)
+		return AES132_FUNCTION_RETCODE_BAD_CRC_TX;
+
+	return AES132_FUNCTION_RETCODE_NOT_EXECUTED;
+}
+
+
+/** \brief This function decides whether to repeat a failed exchange, i.e. to send the command again.
+ *
+ * Only idempotent commands are sent again, and only after communication errors. An error response
+ * of the device, or a response that does not fit into the buffer, would not change.
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \param[in] aes132_lib_return status of the exchange or response return code
+ * \return non-zero to repeat the exchange
+ */
+uint8_t aes132c_is_exchange_repeated(uint8_t op_code, uint8_t mode, uint8_t aes132_lib_return)
+{
+	if (aes132c_get_command_class(op_code, mode) != AES132_COMMAND_CLASS_IDEMPOTENT)
+		return 0;
+
+	switch (aes132_lib_return) {
+	case AES132_FUNCTION_RETCODE_ADDRESS_WRITE_NACK:
+	case AES132_FUNCTION_RETCODE_ADDRESS_READ_NACK:
+	case AES132_FUNCTION_RETCODE_BAD_CRC_TX:
+	case AES132_FUNCTION_RETCODE_COUNT_INVALID:
+	case AES132_FUNCTION_RETCODE_BAD_CRC_RX:
+	case AES132_FUNCTION_RETCODE_TIMEOUT:
+	case AES132_FUNCTION_RETCODE_COMM_FAIL:
+		return 1;
+
+	default:
+		return 0;
+	}
 }
 
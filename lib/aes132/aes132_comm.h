@@ -57,30 +57,63 @@ enum aes132_bit_set_flag {
 	AES132_BIT_SET     = (uint8_t) 1    //!< bit set flag
 };
 
+
+/** \brief measured durations of one kind of wait
+ *
+ * Use these numbers to tune the time-outs and the execution time table in aes132_opcode.c
+ * to the hardware. All durations are in us.
+ */
+struct aes132_wait_statistics {
+	uint32_t last_us;                   //!< duration of the last wait
+	uint32_t max_us;                    //!< longest wait
+	uint16_t n_waits;                   //!< number of waits, stops counting at 0xFFFF
+	uint16_t n_timeouts;                //!< number of waits that timed out, stops counting at 0xFFFF
+};
+
 // ------------------------ timing definitions -----------------------------------
 
-//! Poll this many ms for the device being ready for access.
+/** \brief Poll this many ms for the device being ready for access.
+ *
+ * Time-outs are measured with aes132c_now_us(), so they hold regardless of how long
+ * one poll takes on a given CPU and bus clock.
+ */
 #define AES132_DEVICE_READY_TIMEOUT      (100)
 
 /** \brief Poll this many ms for the response buffer being ready for reading.
  *
- * When adjusting this number, consider the command execution delays used.
- * As these delays lie closer to or farther from the minimum command execution
- * delays, this number has to be made bigger or smaller accordingly. With other
- * words: The earlier we start polling after sending a command,
- * the longer we have to make the wait-for-response-ready time-out.
+ * This time-out applies when the command is not known, e.g. in aes132c_receive_response().
+ * aes132c_receive_command_response() uses the maximum execution time of the command instead
+ * (see aes132c_get_execution_time()).
  */
 #define AES132_RESPONSE_READY_TIMEOUT     (145) // Biggest response timeout is the one for the TempSense command (in ms).
 
+/** \brief Set to 1 to detect the completion of a command from I2C address nacks.
+ *
+ * Override with a build flag, e.g. -DAES132_NACK_POLLING=1. The device nacks its I2C address
+ * while it executes a command. When 1, the device status register is not read after writing a
+ * command, and the response buffer is read directly instead of polling the Response-Ready bit:
+ * a nack means busy, an ack delivers the response. This saves one to three bus transactions
+ * per command. The device status register is read only when a response is not consistent,
+ * to tell a Tx CRC error (#AES132_FUNCTION_RETCODE_BAD_CRC_TX), after which the device has not
+ * run the command, from a Rx error. Keep it 0 for SPI, where the device does not nack.
+ */
+#ifndef AES132_NACK_POLLING
+#   define AES132_NACK_POLLING            (0)
+#endif
+
 
 // ----------------------- definitions for retry counts -----------------------------
 
-//! number of retries for sending a command, receiving a response, and accessing memory
+//! number of attempts for accessing memory, and for sending a command and receiving a response
+//! under the default retry policy (see aes132_retry.h)
 #define AES132_RETRY_COUNT_ERROR           ((uint8_t) 2)
 
 //! number of re-synchronization retries
 #define AES132_RETRY_COUNT_RESYNC          ((uint8_t) 2)
 
+//! number of attempts for the whole exchange of an idempotent command, e.g. Info or BlockRead
+#define AES132_RETRY_COUNT_EXCHANGE        ((uint8_t) 3)
+
 
 // ------------- definitions for packet sizes --------------------
 
@@ -201,6 +234,12 @@ enum aes132_bit_set_flag {
  */
 #define AES132_OPTION_NO_STATUS_READ            ((uint8_t) 0x02)
 
+/** \brief flag for option parameter that indicates that the device is known to be ready,
+ *         e.g. because the response to the previous command has just been read,
+ *         so that the Write-In-Progress bit is not polled before sending the command.
+ */
+#define AES132_OPTION_DEVICE_READY              ((uint8_t) 0x04)
+
 
 // ----- definitions for byte indexes of command buffer --------
 
@@ -234,6 +273,17 @@ enum aes132_bit_set_flag {
 //! value of mode byte for the Sleep command to put device into Standby mode
 #define AES132_COMMAND_MODE_STANDBY             ((uint8_t) 0x40)
 
+/** \brief Sleep command packet with precomputed CRC
+ *
+ * <count = 0x09><op code = 0x11><mode = 0x00 (sleep)><param1 = 0x0000><param2 = 0x0000><CRC = 0x7181>\n
+ * The CRC is checked against the generator in aes132_command_packet.h at compile time
+ * (aes132_command_packet.cpp).
+ */
+#define AES132_COMMAND_PACKET_SLEEP             {AES132_COMMAND_SIZE_MIN, 0x11, AES132_COMMAND_MODE_SLEEP, 0, 0, 0, 0, 0x71, 0x81}
+
+//! Standby command packet with precomputed CRC (see #AES132_COMMAND_PACKET_SLEEP)
+#define AES132_COMMAND_PACKET_STANDBY           {AES132_COMMAND_SIZE_MIN, 0x11, AES132_COMMAND_MODE_STANDBY, 0, 0, 0, 0, 0xEF, 0x82}
+
 
 // ----- definitions for byte indexes of response buffer --------
 
@@ -251,16 +301,34 @@ enum aes132_bit_set_flag {
 
 uint8_t aes132c_access_memory(uint8_t count, uint16_t word_address, uint8_t *data, uint8_t read);
 uint8_t aes132c_read_device_status_register(uint8_t *deviceStatus);
+uint8_t aes132c_write_memory_segments(uint16_t word_address, const struct aes132_segment *segments, uint8_t n_segments);
 uint8_t aes132c_send_command(uint8_t *command, uint8_t options);
+uint8_t aes132c_send_command_segments(const struct aes132_segment *segments, uint8_t n_segments, uint8_t options);
 uint8_t aes132c_receive_response(uint8_t count, uint8_t *response);
+uint8_t aes132c_receive_response_expected(uint8_t size, uint8_t *response, uint8_t expected_size);
+uint8_t aes132c_receive_command_response(uint8_t size, uint8_t *response, uint8_t op_code, uint8_t mode, uint16_t param2);
+uint8_t aes132c_check_response_count(uint8_t count_byte, uint8_t size);
+uint8_t aes132c_check_response_crc(uint8_t *response);
+uint8_t aes132c_find_tx_crc_error(uint8_t *aes132_lib_return);
+uint8_t aes132c_check_command_received(uint8_t aes132_lib_return, uint8_t device_status_register);
+uint8_t aes132c_is_exchange_repeated(uint8_t op_code, uint8_t mode, uint8_t aes132_lib_return);
 uint8_t aes132c_send_and_receive(uint8_t *command, uint8_t size, uint8_t *response, uint8_t options);
+uint8_t aes132c_send_and_receive_segments(const struct aes132_segment *segments, uint8_t n_segments, uint8_t size,
+			uint8_t *response, uint8_t options);
 uint8_t aes132c_wakeup(void);
 uint8_t aes132c_sleep(void);
 uint8_t aes132c_standby(void);
 uint8_t aes132c_resync(void);
-uint8_t aes132c_wait_for_status_register_bit(uint8_t mask, uint8_t is_set, uint16_t n_retries);
+uint8_t aes132c_wait_for_status_register_bit(uint8_t mask, uint8_t is_set, uint32_t timeout_us, uint32_t *elapsed_us);
 uint8_t aes132c_wait_for_response_ready(void);
 uint8_t aes132c_wait_for_device_ready(void);
+void    aes132c_record_wait(struct aes132_wait_statistics *statistics, uint32_t duration_us, uint8_t aes132_lib_return);
+void    aes132c_record_device_ready_time(uint32_t duration_us, uint8_t aes132_lib_return);
+void    aes132c_record_execution_time(uint8_t op_code, uint8_t mode, uint32_t duration_us, uint8_t aes132_lib_return,
+			uint8_t is_upper_bound);
+const struct aes132_wait_statistics *aes132c_get_device_ready_statistics(void);
+const struct aes132_wait_statistics *aes132c_get_execution_statistics(uint8_t op_code);
+void    aes132c_reset_wait_statistics(void);
 uint8_t aes132c_send_sleep_command(uint8_t standby);
 uint8_t aes132c_reset_io_address(void);
 void    aes132c_calculate_crc(uint8_t count, uint8_t *data, uint8_t *crc);
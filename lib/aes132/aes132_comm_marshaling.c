@@ -20,8 +20,12 @@
  */
 
 
-#include <string.h>                    // needed for memcpy()
+#include <stddef.h>                    // size_t
+
 #include "aes132_comm_marshaling.h"    // definitions and declarations for the Command Marshaling module
+#include "aes132_crc.h"                // incremental CRC used while assembling a command
+#include "aes132_timer.h"              // start time of trace events
+#include "aes132_trace.h"              // trace events of the marshaling layer
 
 
 /** \brief This function sends data to the device.
@@ -48,11 +52,9 @@ uint8_t aes132m_read_memory(uint8_t size, uint16_t word_address, uint8_t *data)
 }
 
 
-/** \brief This function creates a command packet, sends it, and receives its response.
- *         The caller has to allocate enough space for txBuffer and rxBuffer so that
- *         the generated command and the expected response respectively do not overflow
- *         these buffers.
+/** \brief This function assembles a command packet including its CRC.
  *
+ * The CRC is calculated while the command is assembled so that every byte is touched once.
  * \param[in] op_code command op-code
  * \param[in] mode command mode
  * \param[in] param1 first parameter
@@ -65,19 +67,17 @@ uint8_t aes132m_read_memory(uint8_t size, uint16_t word_address, uint8_t *data)
  * \param[in] data3 pointer to third data block
  * \param[in] datalen4 number of bytes in fourth data block
  * \param[in] data4 pointer to fourth data block
- * \param[in] tx_buffer pointer to command buffer
- * \param[out] rx_buffer pointer to response buffer
- * \return status of the operation
+ * \param[out] tx_buffer pointer to command buffer
  */
-uint8_t aes132m_execute(uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
+static void aes132m_assemble(uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
 			uint8_t datalen1, uint8_t *data1, uint8_t datalen2, uint8_t *data2,
 			uint8_t datalen3, uint8_t *data3, uint8_t datalen4, uint8_t *data4,
-			uint8_t *tx_buffer, uint8_t *rx_buffer)
+			uint8_t *tx_buffer)
 {
 	uint8_t *p_buffer;
 	uint8_t len;
+	struct aes132_crc_context crc_context;
 
-	// Assemble command.
 	len = datalen1 + datalen2 + datalen3 + datalen4 + AES132_COMMAND_SIZE_MIN;
 	p_buffer = tx_buffer;
 	*p_buffer++ = len;
@@ -88,24 +88,374 @@ uint8_t aes132m_execute(uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t
 	*p_buffer++ = param2 >> 8;
 	*p_buffer++ = param2 & 0xFF;
 
-	if (datalen1 > 0) {
-		memcpy(p_buffer, data1, datalen1);
-		p_buffer += datalen1;
+	aes132c_crc_init(&crc_context);
+	aes132c_crc_update(&crc_context, (uint8_t) (p_buffer - tx_buffer), tx_buffer);
+
+	if (datalen1 > 0)
+		p_buffer = aes132c_crc_copy(&crc_context, p_buffer, datalen1, data1);
+	if (datalen2 > 0)
+		p_buffer = aes132c_crc_copy(&crc_context, p_buffer, datalen2, data2);
+	if (datalen3 > 0)
+		p_buffer = aes132c_crc_copy(&crc_context, p_buffer, datalen3, data3);
+	if (datalen4 > 0)
+		p_buffer = aes132c_crc_copy(&crc_context, p_buffer, datalen4, data4);
+
+	aes132c_crc_final(&crc_context, p_buffer);
+}
+
+
+/** \brief This function creates a command packet, sends it, and receives its response.
+ *         The caller has to allocate enough space for txBuffer and rxBuffer so that
+ *         the generated command and the expected response respectively do not overflow
+ *         these buffers.
+ *
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \param[in] param1 first parameter
+ * \param[in] param2 second parameter
+ * \param[in] datalen1 number of bytes in first data block
+ * \param[in] data1 pointer to first data block
+ * \param[in] datalen2 number of bytes in second data block
+ * \param[in] data2 pointer to second data block
+ * \param[in] datalen3 number of bytes in third data block
+ * \param[in] data3 pointer to third data block
+ * \param[in] datalen4 number of bytes in fourth data block
+ * \param[in] data4 pointer to fourth data block
+ * \param[in] tx_buffer pointer to command buffer
+ * \param[out] rx_buffer pointer to response buffer
+ * \return status of the operation
+ */
+uint8_t aes132m_execute(uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
+			uint8_t datalen1, uint8_t *data1, uint8_t datalen2, uint8_t *data2,
+			uint8_t datalen3, uint8_t *data3, uint8_t datalen4, uint8_t *data4,
+			uint8_t *tx_buffer, uint8_t *rx_buffer)
+{
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO)
+	uint32_t start_us = aes132c_now_us();
+#endif
+	uint8_t aes132_lib_return;
+
+	aes132m_assemble(op_code, mode, param1, param2, datalen1, data1, datalen2, data2,
+				datalen3, data3, datalen4, data4, tx_buffer);
+
+	// Send command and receive response. The CRC has already been appended.
+	aes132_lib_return = aes132c_send_and_receive(&tx_buffer[0], AES132_RESPONSE_SIZE_MAX,
+				&rx_buffer[0], AES132_OPTION_NO_APPEND_CRC);
+
+	AES132_TRACE(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO, AES132_TRACE_MARSHAL_EXECUTE, aes132_lib_return,
+				(op_code << 8) | mode, param1, start_us);
+	return aes132_lib_return;
+}
+
+
+/** \brief command header and CRC built on the stack, and the segments that send them together with the data */
+struct aes132_marshaled_command {
+	uint8_t header[AES132_COMMAND_INDEX_PARAM2_LSB + 1];        //!< count, op-code, mode and parameters
+	uint8_t crc[AES132_CRC_SIZE];                               //!< CRC over header and data
+	struct aes132_segment segments[AES132_SEGMENT_COUNT_MAX];  //!< header, data blocks and CRC
+	uint8_t n_segments;                                         //!< number of segments in use
+};
+
+
+/** \brief This function builds command header and CRC for data that stays in the caller's buffers.
+ * \param[out] marshaled pointer to marshaled command
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \param[in] param1 first parameter
+ * \param[in] param2 second parameter
+ * \param[in] data data blocks, in order (may be NULL if n_data is 0)
+ * \param[in] n_data number of data blocks (at most #AES132_SEGMENT_COUNT_MAX - 2)
+ * \return status of the operation
+ */
+static uint8_t aes132m_marshal(struct aes132_marshaled_command *marshaled,
+			uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
+			const struct aes132_segment *data, uint8_t n_data)
+{
+	uint8_t *header = marshaled->header;
+	struct aes132_crc_context crc_context;
+	uint16_t count = AES132_COMMAND_SIZE_MIN;
+	uint8_t i;
+
+	// One segment each is needed for the header and the CRC.
+	if (n_data > AES132_SEGMENT_COUNT_MAX - 2)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	for (i = 0; i < n_data; i++)
+		count += data[i].count;
+	if (count > AES132_COMMAND_SIZE_MAX)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	header[AES132_COMMAND_INDEX_COUNT] = (uint8_t) count;
+	header[AES132_COMMAND_INDEX_OPCODE] = op_code;
+	header[AES132_COMMAND_INDEX_MODE] = mode;
+	header[AES132_COMMAND_INDEX_PARAM1_MSB] = param1 >> 8;
+	header[AES132_COMMAND_INDEX_PARAM1_LSB] = param1 & 0xFF;
+	header[AES132_COMMAND_INDEX_PARAM2_MSB] = param2 >> 8;
+	header[AES132_COMMAND_INDEX_PARAM2_LSB] = param2 & 0xFF;
+
+	aes132c_crc_init(&crc_context);
+	aes132c_crc_update(&crc_context, sizeof(marshaled->header), header);
+	marshaled->segments[0].data = header;
+	marshaled->segments[0].count = sizeof(marshaled->header);
+	for (i = 0; i < n_data; i++) {
+		aes132c_crc_update(&crc_context, data[i].count, data[i].data);
+		marshaled->segments[1 + i] = data[i];
 	}
-	if (datalen2 > 0) {
-		memcpy(p_buffer, data2, datalen2);
-		p_buffer += datalen2;
+	aes132c_crc_final(&crc_context, marshaled->crc);
+	marshaled->segments[1 + n_data].data = marshaled->crc;
+	marshaled->segments[1 + n_data].count = sizeof(marshaled->crc);
+	marshaled->n_segments = n_data + 2;
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function sends a command whose data stays in the caller's buffers, and receives its response.
+ *
+ * Unlike aes132m_execute(), the data is not copied into a command buffer. The command header
+ * and the CRC are built on the stack, the CRC is calculated over the header and the data where
+ * they are, and header, data and CRC are written to the device as segments of one transfer.
+ * This saves the copy of up to 54 bytes per command, e.g. for Encrypt, EncWrite and KeyImport.
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \param[in] param1 first parameter
+ * \param[in] param2 second parameter
+ * \param[in] data data blocks, in order (may be NULL if n_data is 0)
+ * \param[in] n_data number of data blocks (at most #AES132_SEGMENT_COUNT_MAX - 2)
+ * \param[in] size size of response buffer
+ * \param[out] rx_buffer pointer to response buffer
+ * \return status of the operation
+ */
+uint8_t aes132m_execute_segments(uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
+			const struct aes132_segment *data, uint8_t n_data, uint8_t size, uint8_t *rx_buffer)
+{
+	struct aes132_marshaled_command marshaled;
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO)
+	uint32_t start_us = aes132c_now_us();
+#endif
+
+	uint8_t aes132_lib_return = aes132m_marshal(&marshaled, op_code, mode, param1, param2, data, n_data);
+	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
+		AES132_TRACE(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO, AES132_TRACE_MARSHAL_EXECUTE, aes132_lib_return,
+					(op_code << 8) | mode, param1, start_us);
+		return aes132_lib_return;
 	}
-	if (datalen3 > 0) {
-		memcpy(p_buffer, data3, datalen3);
-		p_buffer += datalen3;
+
+	aes132_lib_return = aes132c_send_and_receive_segments(marshaled.segments, marshaled.n_segments, size, rx_buffer,
+				AES132_OPTION_DEFAULT);
+	AES132_TRACE(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO, AES132_TRACE_MARSHAL_EXECUTE, aes132_lib_return,
+				(op_code << 8) | mode, param1, start_us);
+	return aes132_lib_return;
+}
+
+
+/** \brief This function marshals a command of a batch.
+ * \param[out] marshaled pointer to marshaled command
+ * \param[in] command pointer to batch command
+ * \return status of the operation
+ */
+static uint8_t aes132m_marshal_batch_command(struct aes132_marshaled_command *marshaled,
+			const struct aes132_batch_command *command)
+{
+	return aes132m_marshal(marshaled, command->op_code, command->mode, command->param1, command->param2,
+				command->data, command->n_data);
+}
+
+
+/** \brief This function executes several commands back to back.
+ *
+ * The device is woken up once for the whole batch. While a command executes on the device,
+ * the next one is marshaled, and it is sent without polling the device status register for
+ * the device being ready, because the device is idle after its previous response has been read.
+ * The status of every command is stored in its "result" member. With
+ * #AES132_BATCH_ABORT_ON_ERROR, the commands after a failed one are not sent and their result is
+ * #AES132_FUNCTION_RETCODE_NOT_EXECUTED.
+ * \param[in, out] commands commands to execute, in order
+ * \param[in] n_commands number of commands
+ * \param[in] policy #AES132_BATCH_ABORT_ON_ERROR or #AES132_BATCH_CONTINUE_ON_ERROR
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS if every command succeeded, else the result of the first failed command
+ */
+uint8_t aes132m_execute_batch(struct aes132_batch_command *commands, uint8_t n_commands, uint8_t policy)
+{
+	// Two marshaled commands: the one being executed and the next one.
+	struct aes132_marshaled_command marshaled[2];
+	uint8_t options;
+	uint8_t batch_return = AES132_FUNCTION_RETCODE_SUCCESS;
+	uint8_t marshal_return;
+	uint8_t aes132_lib_return;
+	uint8_t i;
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO)
+	uint32_t start_us = aes132c_now_us();
+	uint32_t command_start_us;
+#endif
+
+	if (n_commands == 0)
+		return AES132_FUNCTION_RETCODE_SUCCESS;
+
+	aes132_lib_return = aes132c_wakeup();
+	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
+		for (i = 0; i < n_commands; i++)
+			commands[i].result = AES132_FUNCTION_RETCODE_NOT_EXECUTED;
+		return aes132_lib_return;
 	}
-	if (datalen4 > 0) {
-		memcpy(p_buffer, data4, datalen4);
-		p_buffer += datalen4;
+
+	// The device is awake and ready for the first command.
+	options = AES132_OPTION_DEVICE_READY;
+	marshal_return = aes132m_marshal_batch_command(&marshaled[0], &commands[0]);
+
+	for (i = 0; i < n_commands; i++) {
+		struct aes132_batch_command *command = &commands[i];
+		struct aes132_marshaled_command *current = &marshaled[i & 1];
+
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO)
+		command_start_us = aes132c_now_us();
+#endif
+		aes132_lib_return = marshal_return;
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+			aes132_lib_return = aes132c_send_command_segments(current->segments, current->n_segments, options);
+
+		// Marshal the next command while the device executes this one.
+		if (i + 1 < n_commands)
+			marshal_return = aes132m_marshal_batch_command(&marshaled[(i + 1) & 1], &commands[i + 1]);
+
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+			aes132_lib_return = aes132c_receive_command_response(command->size, command->rx_buffer,
+						command->op_code, command->mode, command->param2);
+
+		command->result = aes132_lib_return;
+		AES132_TRACE(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO, AES132_TRACE_MARSHAL_EXECUTE, aes132_lib_return,
+					(command->op_code << 8) | command->mode, command->param1, command_start_us);
+
+		// After a complete response, including one with a device error code, the device is idle.
+		// After a library error (0xA0 and up), poll for it being ready again.
+		options = (aes132_lib_return < AES132_FUNCTION_RETCODE_ADDRESS_WRITE_NACK)
+				? AES132_OPTION_DEVICE_READY : AES132_OPTION_DEFAULT;
+
+		if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+			continue;
+
+		if (batch_return == AES132_FUNCTION_RETCODE_SUCCESS)
+			batch_return = aes132_lib_return;
+
+		if (policy == AES132_BATCH_ABORT_ON_ERROR) {
+			for (i++; i < n_commands; i++)
+				commands[i].result = AES132_FUNCTION_RETCODE_NOT_EXECUTED;
+			break;
+		}
 	}
 
-	// Send command and receive response.
-	return aes132c_send_and_receive(&tx_buffer[0], AES132_RESPONSE_SIZE_MAX,
-				&rx_buffer[0], AES132_OPTION_DEFAULT);
-}
\ No newline at end of file
+	AES132_TRACE(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO, AES132_TRACE_MARSHAL_BATCH, batch_return,
+				n_commands, policy, start_us);
+	return batch_return;
+}
+
+
+/** \brief This function assembles a command packet once so that it can be executed repeatedly.
+ *
+ * Parameters and data of a prepared command can be changed with
+ * aes132m_prepared_set_param1(), aes132m_prepared_set_param2() and aes132m_prepared_set_data().
+ * These functions fix up the CRC from the changed bytes alone instead of re-assembling the packet.
+ * The data blocks may be NULL to reserve space that is filled in later with aes132m_prepared_set_data().
+ * \param[out] prepared pointer to prepared command
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \param[in] param1 first parameter
+ * \param[in] param2 second parameter
+ * \param[in] datalen1 number of bytes in first data block
+ * \param[in] data1 pointer to first data block
+ * \param[in] datalen2 number of bytes in second data block
+ * \param[in] data2 pointer to second data block
+ * \param[in] datalen3 number of bytes in third data block
+ * \param[in] data3 pointer to third data block
+ * \param[in] datalen4 number of bytes in fourth data block
+ * \param[in] data4 pointer to fourth data block
+ * \return status of the operation
+ */
+uint8_t aes132m_prepare(struct aes132_prepared_command *prepared,
+			uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
+			uint8_t datalen1, uint8_t *data1, uint8_t datalen2, uint8_t *data2,
+			uint8_t datalen3, uint8_t *data3, uint8_t datalen4, uint8_t *data4)
+{
+	uint8_t zeros[AES132_COMMAND_SIZE_MAX - AES132_COMMAND_SIZE_MIN] = {0};
+
+	if ((size_t) datalen1 + datalen2 + datalen3 + datalen4 > sizeof(zeros))
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	aes132m_assemble(op_code, mode, param1, param2,
+				datalen1, data1 ? data1 : zeros, datalen2, data2 ? data2 : zeros,
+				datalen3, data3 ? data3 : zeros, datalen4, data4 ? data4 : zeros,
+				prepared->command);
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function changes the first parameter of a prepared command.
+ * \param[in, out] prepared pointer to prepared command
+ * \param[in] param1 first parameter
+ */
+void aes132m_prepared_set_param1(struct aes132_prepared_command *prepared, uint16_t param1)
+{
+	uint8_t param[2] = {(uint8_t) (param1 >> 8), (uint8_t) (param1 & 0xFF)};
+
+	aes132c_crc_patch(prepared->command, AES132_COMMAND_INDEX_PARAM1_MSB, sizeof(param), param);
+}
+
+
+/** \brief This function changes the second parameter of a prepared command.
+ * \param[in, out] prepared pointer to prepared command
+ * \param[in] param2 second parameter
+ */
+void aes132m_prepared_set_param2(struct aes132_prepared_command *prepared, uint16_t param2)
+{
+	uint8_t param[2] = {(uint8_t) (param2 >> 8), (uint8_t) (param2 & 0xFF)};
+
+	aes132c_crc_patch(prepared->command, AES132_COMMAND_INDEX_PARAM2_MSB, sizeof(param), param);
+}
+
+
+/** \brief This function overwrites data bytes of a prepared command.
+ *
+ * The data blocks passed to aes132m_prepare() are stored back to back,
+ * so offset 0 is the first byte of the first data block.
+ * \param[in, out] prepared pointer to prepared command
+ * \param[in] offset index of first byte to overwrite, relative to the start of the data
+ * \param[in] length number of bytes to overwrite
+ * \param[in] data pointer to new data
+ * \return status of the operation
+ */
+uint8_t aes132m_prepared_set_data(struct aes132_prepared_command *prepared, uint8_t offset,
+			uint8_t length, const uint8_t *data)
+{
+	uint8_t data_size = prepared->command[AES132_COMMAND_INDEX_COUNT] - AES132_COMMAND_SIZE_MIN;
+
+	if ((uint16_t) offset + length > data_size)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	aes132c_crc_patch(prepared->command, AES132_COMMAND_INDEX_PARAM2_LSB + 1 + offset, length, data);
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function sends a prepared command and receives its response.
+ *
+ * The prepared command is sent as is, without marshaling or CRC calculation.
+ * \param[in] prepared pointer to prepared command
+ * \param[out] rx_buffer pointer to response buffer
+ * \return status of the operation
+ */
+uint8_t aes132m_prepared_execute(struct aes132_prepared_command *prepared, uint8_t *rx_buffer)
+{
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO)
+	uint32_t start_us = aes132c_now_us();
+#endif
+	uint8_t aes132_lib_return = aes132c_send_and_receive(prepared->command, AES132_RESPONSE_SIZE_MAX,
+				rx_buffer, AES132_OPTION_NO_APPEND_CRC);
+
+	AES132_TRACE(AES132_TRACE_MARSHAL, AES132_TRACE_LEVEL_INFO, AES132_TRACE_MARSHAL_EXECUTE, aes132_lib_return,
+				(prepared->command[AES132_COMMAND_INDEX_OPCODE] << 8) | prepared->command[AES132_COMMAND_INDEX_MODE],
+				(prepared->command[AES132_COMMAND_INDEX_PARAM1_MSB] << 8) | prepared->command[AES132_COMMAND_INDEX_PARAM1_LSB],
+				start_us);
+	return aes132_lib_return;
+}
@@ -151,12 +151,55 @@ extern "C" {
 #define AES132_TEMP_SENSE        ((uint8_t) 0x0E)       //!< TempSense command op-code
 /** @} */
 
+/** \brief command packet that is assembled once and executed repeatedly
+ *
+ * See aes132m_prepare(). Do not modify the command buffer directly, because that
+ * invalidates its CRC.
+ */
+struct aes132_prepared_command {
+	uint8_t command[AES132_COMMAND_SIZE_MAX];   //!< assembled command including CRC
+};
+
+/** \name Policies for aes132m_execute_batch()
+@{ */
+#define AES132_BATCH_ABORT_ON_ERROR     ((uint8_t) 0x00)   //!< Skip the remaining commands after a failed one.
+#define AES132_BATCH_CONTINUE_ON_ERROR  ((uint8_t) 0x01)   //!< Execute all commands regardless of failures.
+/** @} */
+
+/** \brief one command of a batch executed by aes132m_execute_batch()
+ *
+ * The data is sent from the caller's buffers as with aes132m_execute_segments().
+ */
+struct aes132_batch_command {
+	uint8_t op_code;                        //!< command op-code
+	uint8_t mode;                           //!< command mode
+	uint16_t param1;                        //!< first parameter
+	uint16_t param2;                        //!< second parameter
+	const struct aes132_segment *data;      //!< data blocks, in order (may be NULL if n_data is 0)
+	uint8_t n_data;                         //!< number of data blocks (at most #AES132_SEGMENT_COUNT_MAX - 2)
+	uint8_t size;                           //!< size of response buffer
+	uint8_t *rx_buffer;                     //!< response buffer
+	uint8_t result;                         //!< [out] status of the operation, as aes132m_execute_segments() returns it
+};
+
 uint8_t aes132m_read_memory(uint8_t count, uint16_t word_address, uint8_t *data);
 uint8_t aes132m_write_memory(uint8_t count, uint16_t word_address, uint8_t *data);
 uint8_t aes132m_execute(uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
 			uint8_t datalen1, uint8_t *data1, uint8_t datalen2, uint8_t *data2,
 			uint8_t datalen3, uint8_t *data3, uint8_t datalen4, uint8_t *data4,
 			uint8_t *tx_buffer, uint8_t *rx_buffer);
+uint8_t aes132m_execute_segments(uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
+			const struct aes132_segment *data, uint8_t n_data, uint8_t size, uint8_t *rx_buffer);
+uint8_t aes132m_execute_batch(struct aes132_batch_command *commands, uint8_t n_commands, uint8_t policy);
+uint8_t aes132m_prepare(struct aes132_prepared_command *prepared,
+			uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
+			uint8_t datalen1, uint8_t *data1, uint8_t datalen2, uint8_t *data2,
+			uint8_t datalen3, uint8_t *data3, uint8_t datalen4, uint8_t *data4);
+void    aes132m_prepared_set_param1(struct aes132_prepared_command *prepared, uint16_t param1);
+void    aes132m_prepared_set_param2(struct aes132_prepared_command *prepared, uint16_t param2);
+uint8_t aes132m_prepared_set_data(struct aes132_prepared_command *prepared, uint8_t offset,
+			uint8_t length, const uint8_t *data);
+uint8_t aes132m_prepared_execute(struct aes132_prepared_command *prepared, uint8_t *rx_buffer);
 
 /** @} */
 
@@ -0,0 +1,42 @@
+/** \file
+ *  \brief  Compile-time checks of the hand-written command packets of the AES132 library.
+ *
+ * This translation unit is part of every build of the library, so a hand-written
+ * constant CRC that disagrees with the generator in aes132_command_packet.h fails the build.
+ * It does not generate any code.
+ */
+
+#include "aes132_command_packet.h"
+
+namespace {
+
+constexpr uint8_t command_sleep[] = AES132_COMMAND_PACKET_SLEEP;
+constexpr uint8_t command_standby[] = AES132_COMMAND_PACKET_STANDBY;
+
+static_assert(aes132::packet_crc_matches(command_sleep),
+		"CRC of AES132_COMMAND_PACKET_SLEEP is wrong");
+static_assert(aes132::packet_crc_matches(command_standby),
+		"CRC of AES132_COMMAND_PACKET_STANDBY is wrong");
+
+/** \brief This function compares a hand-written packet with a generated one at compile time.
+ * \param[in] packet hand-written packet
+ * \param[in] generated packet built by aes132::make_fixed_command()
+ * \return true if both packets have the same bytes
+ */
+template <size_t Size>
+constexpr bool packet_equals(const uint8_t (&packet)[Size], const aes132::CommandPacket<Size> &generated)
+{
+	for (size_t i = 0; i < Size; i++) {
+		if (packet[i] != generated.bytes[i])
+			return false;
+	}
+	return true;
+}
+
+// The generator has to reproduce the hand-written packets byte for byte.
+static_assert(packet_equals(command_sleep, aes132::make_fixed_command<AES132_SLEEP, AES132_COMMAND_MODE_SLEEP>()),
+		"aes132::make_fixed_command does not match AES132_COMMAND_PACKET_SLEEP");
+static_assert(packet_equals(command_standby, aes132::make_fixed_command<AES132_SLEEP, AES132_COMMAND_MODE_STANDBY>()),
+		"aes132::make_fixed_command does not match AES132_COMMAND_PACKET_STANDBY");
+
+} // namespace
@@ -0,0 +1,140 @@
+/** \file
+ *  \brief  Compile-time generated command packets for the AES132 library (C++17).
+ *
+ * Commands whose op-code, mode, parameters and data are all constants do not need
+ * to be marshaled and CRC'd at runtime. aes132::fixed_command builds the complete
+ * packet, CRC included, during compilation and stores it as a constant, i.e. in flash:
+ * \code
+ * uint8_t rx_buffer[AES132_RESPONSE_SIZE_MAX];
+ * // Info command, mode 0 (DevRev)
+ * uint8_t ret = aes132::execute_fixed<AES132_INFO, 0>(rx_buffer);
+ * \endcode
+ *
+ * Packets written by hand can be checked against the generator with
+ * aes132::packet_crc_matches() in a static_assert, so that a wrong constant CRC breaks
+ * the build instead of producing an #AES132_FUNCTION_RETCODE_BAD_CRC_TX at runtime.
+ */
+
+#ifndef AES132_COMMAND_PACKET_H
+#   define AES132_COMMAND_PACKET_H
+
+#ifndef __cplusplus
+#   error aes132_command_packet.h requires C++17.
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes132_comm.h"
+#include "aes132_comm_marshaling.h"
+
+namespace aes132 {
+
+/** \brief This function calculates the CRC-16 of a packet at compile time.
+ *
+ * Same algorithm as aes132c_calculate_crc(), written as a constexpr function.
+ * \param[in] data pointer to data
+ * \param[in] length number of bytes in data buffer
+ * \return CRC (high byte is sent first)
+ */
+constexpr uint16_t crc16(const uint8_t *data, size_t length)
+{
+	uint16_t crc = 0;
+	for (size_t i = 0; i < length; i++) {
+		crc ^= (uint16_t) (data[i] << 8);
+		for (uint8_t bit = 0; bit < 8; bit++)
+			crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ 0x8005) : (uint16_t) (crc << 1);
+	}
+	return crc;
+}
+
+
+//! complete command packet of a fixed size, including count byte and CRC
+template <size_t Size>
+struct CommandPacket {
+	static_assert(Size >= AES132_COMMAND_SIZE_MIN && Size <= AES132_COMMAND_SIZE_MAX,
+			"command size out of range");
+
+	uint8_t bytes[Size];
+
+	//! number of bytes in the packet
+	static constexpr uint8_t size = (uint8_t) Size;
+};
+
+
+/** \brief This function assembles a command packet and appends its CRC at compile time.
+ * \tparam OpCode command op-code
+ * \tparam Mode command mode
+ * \tparam Param1 first parameter
+ * \tparam Param2 second parameter
+ * \tparam Data optional data bytes
+ * \return assembled packet
+ */
+template <uint8_t OpCode, uint8_t Mode, uint16_t Param1 = 0, uint16_t Param2 = 0, uint8_t... Data>
+constexpr CommandPacket<AES132_COMMAND_SIZE_MIN + sizeof...(Data)> make_fixed_command()
+{
+	constexpr size_t size = AES132_COMMAND_SIZE_MIN + sizeof...(Data);
+	const uint8_t data[] = {Data..., 0};
+
+	CommandPacket<size> packet = {};
+	packet.bytes[AES132_COMMAND_INDEX_COUNT] = (uint8_t) size;
+	packet.bytes[AES132_COMMAND_INDEX_OPCODE] = OpCode;
+	packet.bytes[AES132_COMMAND_INDEX_MODE] = Mode;
+	packet.bytes[AES132_COMMAND_INDEX_PARAM1_MSB] = (uint8_t) (Param1 >> 8);
+	packet.bytes[AES132_COMMAND_INDEX_PARAM1_LSB] = (uint8_t) (Param1 & 0xFF);
+	packet.bytes[AES132_COMMAND_INDEX_PARAM2_MSB] = (uint8_t) (Param2 >> 8);
+	packet.bytes[AES132_COMMAND_INDEX_PARAM2_LSB] = (uint8_t) (Param2 & 0xFF);
+	for (size_t i = 0; i < sizeof...(Data); i++)
+		packet.bytes[AES132_COMMAND_INDEX_PARAM2_LSB + 1 + i] = data[i];
+
+	const uint16_t crc = crc16(packet.bytes, size - AES132_CRC_SIZE);
+	packet.bytes[size - AES132_CRC_SIZE] = (uint8_t) (crc >> 8);
+	packet.bytes[size - 1] = (uint8_t) (crc & 0xFF);
+	return packet;
+}
+
+
+/** \brief Command packet generated at compile time and stored in flash.
+ *
+ * One instance exists per distinct set of template arguments.
+ */
+template <uint8_t OpCode, uint8_t Mode, uint16_t Param1 = 0, uint16_t Param2 = 0, uint8_t... Data>
+inline constexpr auto fixed_command = make_fixed_command<OpCode, Mode, Param1, Param2, Data...>();
+
+
+/** \brief This function checks a complete packet (count byte, body, CRC) at compile time.
+ * \param[in] packet packet including count byte and CRC
+ * \return true if the count byte equals the packet size and the CRC is correct
+ */
+template <size_t Size>
+constexpr bool packet_crc_matches(const uint8_t (&packet)[Size])
+{
+	if (Size < AES132_CRC_SIZE + 1 || packet[AES132_COMMAND_INDEX_COUNT] != Size)
+		return false;
+
+	const uint16_t crc = crc16(packet, Size - AES132_CRC_SIZE);
+	return (packet[Size - AES132_CRC_SIZE] == (uint8_t) (crc >> 8))
+			&& (packet[Size - 1] == (uint8_t) (crc & 0xFF));
+}
+
+
+/** \brief This function sends a compile-time generated command and receives its response.
+ *
+ * Neither marshaling nor CRC calculation happens at runtime. The packet is sent from flash
+ * as a single segment, so it is never written to.
+ * \param[out] rx_buffer pointer to response buffer (#AES132_RESPONSE_SIZE_MAX bytes)
+ * \return status of the operation
+ */
+template <uint8_t OpCode, uint8_t Mode, uint16_t Param1 = 0, uint16_t Param2 = 0, uint8_t... Data>
+inline uint8_t execute_fixed(uint8_t *rx_buffer)
+{
+	const auto &packet = fixed_command<OpCode, Mode, Param1, Param2, Data...>;
+	const struct aes132_segment segment = {packet.bytes, packet.size};
+
+	return aes132c_send_and_receive_segments(&segment, 1, AES132_RESPONSE_SIZE_MAX, rx_buffer,
+				AES132_OPTION_DEFAULT);
+}
+
+} // namespace aes132
+
+#endif
@@ -0,0 +1,572 @@
+/** \file
+ *  \brief  Type-safe command API for the AES132 library (C++17, header only).
+ *
+ * There is one struct per op-code in aes132_comm_marshaling.h. Each one carries the exact
+ * command and response sizes as constants, so that buffers can be sized exactly and
+ * response fields are read at fixed offsets:
+ * \code
+ * aes132::Random::Response response;   // 20 bytes instead of AES132_RESPONSE_SIZE_MAX
+ * if (aes132::Random::execute(0, response) == AES132_DEVICE_RETCODE_SUCCESS)
+ *     use(&response.bytes[aes132::Random::random_offset]);
+ * \endcode
+ * The execute() functions are inline and call aes132m_execute_segments() directly.
+ * Input data is passed as fixed-size arrays, so wrong lengths fail to compile, and it is
+ * sent from those arrays without being copied.
+ *
+ * Commands whose sizes depend on the mode or on a length parameter are templates over
+ * that parameter. Sizes follow the command descriptions in the ATAES132A datasheet.
+ * A response that is shorter than expected (e.g. a four-byte error response)
+ * still fits into the buffer; check the return value before reading any fields.
+ *
+ * Every command also has a View (see aes132_response_view.h) that checks the result of
+ * execute() once and then exposes the response fields by name without copying them.
+ */
+
+#ifndef AES132_COMMANDS_H
+#   define AES132_COMMANDS_H
+
+#ifndef __cplusplus
+#   error aes132_commands.h requires C++17.
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "aes132_comm.h"
+#include "aes132_comm_marshaling.h"
+#include "aes132_response_view.h"
+
+namespace aes132 {
+
+//! size of a MAC in commands and responses
+constexpr uint8_t mac_size = 16;
+
+//! size of an AES block
+constexpr uint8_t block_size = 16;
+
+
+/** \brief sizes and offsets shared by all commands
+ * \tparam OpCode command op-code
+ * \tparam DataSize number of data bytes in the command
+ * \tparam ResponseDataSize number of data bytes in a successful response
+ */
+template <uint8_t OpCode, uint8_t DataSize, uint8_t ResponseDataSize>
+struct Command {
+	static_assert(AES132_COMMAND_SIZE_MIN + DataSize <= AES132_COMMAND_SIZE_MAX, "command too long");
+	static_assert(AES132_RESPONSE_SIZE_MIN + ResponseDataSize <= AES132_RESPONSE_SIZE_MAX, "response too long");
+
+	//! command op-code
+	static constexpr uint8_t op_code = OpCode;
+
+	//! number of data bytes in the command
+	static constexpr uint8_t data_size = DataSize;
+
+	//! command size including count byte and CRC
+	static constexpr uint8_t command_size = AES132_COMMAND_SIZE_MIN + DataSize;
+
+	//! number of data bytes in a successful response
+	static constexpr uint8_t response_data_size = ResponseDataSize;
+
+	//! size of a successful response including count byte, return code and CRC
+	static constexpr uint8_t response_size = AES132_RESPONSE_SIZE_MIN + ResponseDataSize;
+
+	//! offset of the first data byte in the response
+	static constexpr uint8_t data_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! response buffer of the exact size
+	using Response = ResponseBuffer<response_size>;
+
+	//! validated view of the response; commands with named fields provide their own
+	using View = ResponseView<response_size>;
+
+protected:
+	/** \brief This function sends the command and receives its response.
+	 * \param[in] mode command mode
+	 * \param[in] param1 first parameter
+	 * \param[in] param2 second parameter
+	 * \param[in] data data blocks, in order; together they have to be DataSize bytes
+	 * \param[in] n_data number of data blocks
+	 * \param[out] response response buffer
+	 * \return status of the operation
+	 */
+	static uint8_t send(uint8_t mode, uint16_t param1, uint16_t param2,
+				const aes132_segment *data, uint8_t n_data, Response &response)
+	{
+		return aes132m_execute_segments(OpCode, mode, param1, param2, data, n_data,
+					response_size, response.bytes);
+	}
+
+	//! Sends a command without data.
+	static uint8_t send(uint8_t mode, uint16_t param1, uint16_t param2, Response &response)
+	{
+		return send(mode, param1, param2, nullptr, 0, response);
+	}
+};
+
+
+/** \brief Auth command: authenticates the host, the device, or both.
+ * \tparam Mode bit 0: inbound (InMAC is sent), bit 1: outbound (OutMAC is returned)
+ */
+template <uint8_t Mode>
+struct Auth : Command<AES132_AUTH, (Mode & 0x01) ? mac_size : 0, (Mode & 0x02) ? mac_size : 0> {
+	using Base = Command<AES132_AUTH, (Mode & 0x01) ? mac_size : 0, (Mode & 0x02) ? mac_size : 0>;
+	using typename Base::Response;
+
+	//! offset of OutMAC in the response (outbound modes only)
+	static constexpr uint8_t out_mac_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! validated view of the response
+	struct View : ResponseView<Base::response_size> {
+		using ResponseView<Base::response_size>::ResponseView;
+
+		ByteSpan<mac_size> out_mac() const { return this->template field<out_mac_offset, mac_size>(); }
+	};
+
+	//! Outbound-only authentication.
+	template <uint8_t M = Mode, std::enable_if_t<(M & 0x01) == 0, int> = 0>
+	static uint8_t execute(uint16_t key_id, uint16_t usage, Response &response)
+	{
+		return Base::send(Mode, key_id, usage, response);
+	}
+
+	//! Inbound or mutual authentication.
+	template <uint8_t M = Mode, std::enable_if_t<(M & 0x01) != 0, int> = 0>
+	static uint8_t execute(uint16_t key_id, uint16_t usage, const uint8_t (&in_mac)[mac_size], Response &response)
+	{
+		const aes132_segment data[] = {{in_mac, mac_size}};
+		return Base::send(Mode, key_id, usage, data, 1, response);
+	}
+};
+
+
+//! AuthCheck command: checks a MAC computed by another device.
+struct AuthCheck : Command<AES132_AUTH_CHECK, 11 + 13 + mac_size, 0> {
+	static uint8_t execute(uint8_t mode, uint16_t key_id, const uint8_t (&first_block)[11],
+				const uint8_t (&second_block)[13], const uint8_t (&comp_mac)[mac_size], Response &response)
+	{
+		const aes132_segment data[] = {{first_block, 11}, {second_block, 13}, {comp_mac, mac_size}};
+		return send(mode, key_id, 0, data, 3, response);
+	}
+};
+
+
+//! AuthCompute command: computes a MAC for another device to check.
+struct AuthCompute : Command<AES132_AUTH_COMPUTE, 11 + 13, mac_size> {
+	//! offset of OutMAC in the response
+	static constexpr uint8_t out_mac_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! validated view of the response
+	struct View : ResponseView<response_size> {
+		using ResponseView<response_size>::ResponseView;
+
+		ByteSpan<mac_size> out_mac() const { return this->template field<out_mac_offset, mac_size>(); }
+	};
+
+	static uint8_t execute(uint8_t mode, uint16_t key_id, const uint8_t (&first_block)[11],
+				const uint8_t (&second_block)[13], Response &response)
+	{
+		const aes132_segment data[] = {{first_block, 11}, {second_block, 13}};
+		return send(mode, key_id, 0, data, 2, response);
+	}
+};
+
+
+/** \brief BlockRead command: reads user memory in clear text.
+ * \tparam Length number of bytes to read (1 to #AES132_MEM_ACCESS_MAX)
+ */
+template <uint8_t Length>
+struct BlockRead : Command<AES132_BLOCK_READ, 0, Length> {
+	static_assert(Length >= 1 && Length <= AES132_MEM_ACCESS_MAX, "BlockRead length out of range");
+	using Base = Command<AES132_BLOCK_READ, 0, Length>;
+	using typename Base::Response;
+
+	static uint8_t execute(uint16_t address, Response &response)
+	{
+		return Base::send(0, address, Length, response);
+	}
+};
+
+
+/** \brief Counter command: reads or increments a monotonic counter.
+ * \tparam Mode bit 0: read (CountValue and OutMAC are returned), else increment;
+ *         bit 1: increment with InMAC
+ */
+template <uint8_t Mode>
+struct Counter : Command<AES132_COUNTER, ((Mode & 0x03) == 0x02) ? mac_size : 0, (Mode & 0x01) ? 4 + mac_size : 0> {
+	using Base = Command<AES132_COUNTER, ((Mode & 0x03) == 0x02) ? mac_size : 0, (Mode & 0x01) ? 4 + mac_size : 0>;
+	using typename Base::Response;
+
+	//! offset of CountValue in the response (read mode only)
+	static constexpr uint8_t count_value_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! offset of OutMAC in the response (read mode only)
+	static constexpr uint8_t out_mac_offset = AES132_RESPONSE_INDEX_DATA + 4;
+
+	//! validated view of the response
+	struct View : ResponseView<Base::response_size> {
+		using ResponseView<Base::response_size>::ResponseView;
+
+		ByteSpan<4> count_value() const { return this->template field<count_value_offset, 4>(); }
+
+		ByteSpan<mac_size> out_mac() const { return this->template field<out_mac_offset, mac_size>(); }
+	};
+
+	template <uint8_t M = Mode, std::enable_if_t<(M & 0x03) != 0x02, int> = 0>
+	static uint8_t execute(uint16_t counter_id, Response &response)
+	{
+		return Base::send(Mode, counter_id, 0, response);
+	}
+
+	template <uint8_t M = Mode, std::enable_if_t<(M & 0x03) == 0x02, int> = 0>
+	static uint8_t execute(uint16_t counter_id, uint16_t counter_value, const uint8_t (&in_mac)[mac_size],
+				Response &response)
+	{
+		const aes132_segment data[] = {{in_mac, mac_size}};
+		return Base::send(Mode, counter_id, counter_value, data, 1, response);
+	}
+};
+
+
+//! Crunch command: iterates a seed through the AES engine.
+struct Crunch : Command<AES132_CRUNCH, block_size, block_size> {
+	//! offset of the result in the response
+	static constexpr uint8_t result_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! validated view of the response
+	struct View : ResponseView<response_size> {
+		using ResponseView<response_size>::ResponseView;
+
+		ByteSpan<block_size> result() const { return this->template field<result_offset, block_size>(); }
+	};
+
+	static uint8_t execute(uint16_t count, const uint8_t (&seed)[block_size], Response &response)
+	{
+		const aes132_segment data[] = {{seed, block_size}};
+		return send(0, count, 0, data, 1, response);
+	}
+};
+
+
+/** \brief Decrypt command: decrypts and authenticates a packet.
+ * \tparam Length plaintext length (16 or 32)
+ */
+template <uint8_t Length>
+struct Decrypt : Command<AES132_DECRYPT, Length + mac_size, Length> {
+	static_assert(Length == 16 || Length == 32, "Decrypt length has to be 16 or 32");
+	using Base = Command<AES132_DECRYPT, Length + mac_size, Length>;
+	using typename Base::Response;
+
+	//! offset of the plaintext in the response
+	static constexpr uint8_t plaintext_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! validated view of the response
+	struct View : ResponseView<Base::response_size> {
+		using ResponseView<Base::response_size>::ResponseView;
+
+		ByteSpan<Length> plaintext() const { return this->template field<plaintext_offset, Length>(); }
+	};
+
+	static uint8_t execute(uint8_t mode, uint16_t key_id, const uint8_t (&ciphertext)[Length],
+				const uint8_t (&in_mac)[mac_size], Response &response)
+	{
+		const aes132_segment data[] = {{ciphertext, Length}, {in_mac, mac_size}};
+		return Base::send(mode, key_id, Length, data, 2, response);
+	}
+};
+
+
+/** \brief EncRead command: reads user memory encrypted.
+ * \tparam Length number of bytes to read (16 or 32)
+ */
+template <uint8_t Length>
+struct EncRead : Command<AES132_ENC_READ, 0, mac_size + Length> {
+	static_assert(Length == 16 || Length == 32, "EncRead length has to be 16 or 32");
+	using Base = Command<AES132_ENC_READ, 0, mac_size + Length>;
+	using typename Base::Response;
+
+	//! offset of OutMAC in the response
+	static constexpr uint8_t out_mac_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! offset of the ciphertext in the response
+	static constexpr uint8_t ciphertext_offset = AES132_RESPONSE_INDEX_DATA + mac_size;
+
+	//! validated view of the response
+	struct View : ResponseView<Base::response_size> {
+		using ResponseView<Base::response_size>::ResponseView;
+
+		ByteSpan<mac_size> out_mac() const { return this->template field<out_mac_offset, mac_size>(); }
+
+		ByteSpan<Length> ciphertext() const { return this->template field<ciphertext_offset, Length>(); }
+	};
+
+	static uint8_t execute(uint8_t mode, uint16_t address, Response &response)
+	{
+		return Base::send(mode, address, Length, response);
+	}
+};
+
+
+/** \brief Encrypt command: encrypts and authenticates a packet.
+ * \tparam Length plaintext length (16 or 32)
+ */
+template <uint8_t Length>
+struct Encrypt : Command<AES132_ENCRYPT, Length, mac_size + Length> {
+	static_assert(Length == 16 || Length == 32, "Encrypt length has to be 16 or 32");
+	using Base = Command<AES132_ENCRYPT, Length, mac_size + Length>;
+	using typename Base::Response;
+
+	//! offset of OutMAC in the response
+	static constexpr uint8_t out_mac_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! offset of the ciphertext in the response
+	static constexpr uint8_t ciphertext_offset = AES132_RESPONSE_INDEX_DATA + mac_size;
+
+	//! validated view of the response
+	struct View : ResponseView<Base::response_size> {
+		using ResponseView<Base::response_size>::ResponseView;
+
+		ByteSpan<mac_size> out_mac() const { return this->template field<out_mac_offset, mac_size>(); }
+
+		ByteSpan<Length> ciphertext() const { return this->template field<ciphertext_offset, Length>(); }
+	};
+
+	static uint8_t execute(uint8_t mode, uint16_t key_id, const uint8_t (&plaintext)[Length], Response &response)
+	{
+		const aes132_segment data[] = {{plaintext, Length}};
+		return Base::send(mode, key_id, Length, data, 1, response);
+	}
+};
+
+
+/** \brief EncWrite command: writes user memory encrypted.
+ * \tparam Length number of bytes to write (16 or 32)
+ */
+template <uint8_t Length>
+struct EncWrite : Command<AES132_ENC_WRITE, Length + mac_size, 0> {
+	static_assert(Length == 16 || Length == 32, "EncWrite length has to be 16 or 32");
+	using Base = Command<AES132_ENC_WRITE, Length + mac_size, 0>;
+	using typename Base::Response;
+
+	static uint8_t execute(uint8_t mode, uint16_t address, const uint8_t (&ciphertext)[Length],
+				const uint8_t (&in_mac)[mac_size], Response &response)
+	{
+		const aes132_segment data[] = {{ciphertext, Length}, {in_mac, mac_size}};
+		return Base::send(mode, address, Length, data, 2, response);
+	}
+};
+
+
+//! Info command: reads a device information field.
+struct Info : Command<AES132_INFO, 0, 2> {
+	//! offset of the result in the response
+	static constexpr uint8_t result_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! validated view of the response
+	struct View : ResponseView<response_size> {
+		using ResponseView<response_size>::ResponseView;
+
+		ByteSpan<2> result() const { return this->template field<result_offset, 2>(); }
+	};
+
+	static uint8_t execute(uint16_t selector, Response &response)
+	{
+		return send(0, selector, 0, response);
+	}
+};
+
+
+/** \brief KeyCreate command: creates a random key.
+ * \tparam Mode bit 0: the device returns the key encrypted together with OutMAC
+ */
+template <uint8_t Mode>
+struct KeyCreate : Command<AES132_KEY_CREATE, 0, (Mode & 0x01) ? mac_size + block_size : 0> {
+	using Base = Command<AES132_KEY_CREATE, 0, (Mode & 0x01) ? mac_size + block_size : 0>;
+	using typename Base::Response;
+
+	//! offset of OutMAC in the response (mode bit 0 only)
+	static constexpr uint8_t out_mac_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! offset of the encrypted key in the response (mode bit 0 only)
+	static constexpr uint8_t ciphertext_offset = AES132_RESPONSE_INDEX_DATA + mac_size;
+
+	//! validated view of the response
+	struct View : ResponseView<Base::response_size> {
+		using ResponseView<Base::response_size>::ResponseView;
+
+		ByteSpan<mac_size> out_mac() const { return this->template field<out_mac_offset, mac_size>(); }
+
+		ByteSpan<block_size> ciphertext() const { return this->template field<ciphertext_offset, block_size>(); }
+	};
+
+	static uint8_t execute(uint16_t key_id, uint16_t usage, Response &response)
+	{
+		return Base::send(Mode, key_id, usage, response);
+	}
+};
+
+
+//! KeyImport command: imports an encrypted key into a key slot.
+struct KeyImport : Command<AES132_KEY_IMPORT, mac_size + block_size, 0> {
+	static uint8_t execute(uint8_t mode, uint16_t key_id, const uint8_t (&in_mac)[mac_size],
+				const uint8_t (&ciphertext)[block_size], Response &response)
+	{
+		const aes132_segment data[] = {{in_mac, mac_size}, {ciphertext, block_size}};
+		return send(mode, key_id, 0, data, 2, response);
+	}
+};
+
+
+//! KeyLoad command: loads an encrypted key into a key slot.
+struct KeyLoad : Command<AES132_KEY_LOAD, mac_size + block_size, 0> {
+	static uint8_t execute(uint8_t mode, uint16_t key_id, const uint8_t (&in_mac)[mac_size],
+				const uint8_t (&ciphertext)[block_size], Response &response)
+	{
+		const aes132_segment data[] = {{in_mac, mac_size}, {ciphertext, block_size}};
+		return send(mode, key_id, 0, data, 2, response);
+	}
+};
+
+
+//! KeyTransfer command: copies a key from user memory into a key slot.
+struct KeyTransfer : Command<AES132_KEY_TRANSFER, 0, 0> {
+	static uint8_t execute(uint16_t address, uint16_t key_id, Response &response)
+	{
+		return send(0, address, key_id, response);
+	}
+};
+
+
+//! Legacy command: single AES-ECB operation.
+struct Legacy : Command<AES132_LEGACY, block_size, block_size> {
+	//! offset of the result in the response
+	static constexpr uint8_t result_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! validated view of the response
+	struct View : ResponseView<response_size> {
+		using ResponseView<response_size>::ResponseView;
+
+		ByteSpan<block_size> result() const { return this->template field<result_offset, block_size>(); }
+	};
+
+	static uint8_t execute(uint16_t key_id, const uint8_t (&block)[block_size], Response &response)
+	{
+		const aes132_segment data[] = {{block, block_size}};
+		return send(0, key_id, 0, data, 1, response);
+	}
+};
+
+
+//! Lock command: locks the configuration, key, or user memory.
+struct Lock : Command<AES132_LOCK, 0, 0> {
+	static uint8_t execute(uint8_t mode, uint16_t param1, uint16_t param2, Response &response)
+	{
+		return send(mode, param1, param2, response);
+	}
+};
+
+
+/** \brief Nonce command: loads or generates the nonce.
+ * \tparam Mode bit 0: random nonce (RandOut is returned), else fixed nonce
+ */
+template <uint8_t Mode>
+struct Nonce : Command<AES132_NONCE, 12, (Mode & 0x01) ? 12 : 0> {
+	using Base = Command<AES132_NONCE, 12, (Mode & 0x01) ? 12 : 0>;
+	using typename Base::Response;
+
+	//! offset of RandOut in the response (random mode only)
+	static constexpr uint8_t rand_out_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! validated view of the response
+	struct View : ResponseView<Base::response_size> {
+		using ResponseView<Base::response_size>::ResponseView;
+
+		ByteSpan<12> rand_out() const { return this->template field<rand_out_offset, 12>(); }
+	};
+
+	static uint8_t execute(const uint8_t (&in_seed)[12], Response &response)
+	{
+		const aes132_segment data[] = {{in_seed, 12}};
+		return Base::send(Mode, 0, 0, data, 1, response);
+	}
+};
+
+
+//! NonceCompute command: computes a nonce from a host seed and the current nonce.
+struct NonceCompute : Command<AES132_NONCE_COMPUTE, 12, 0> {
+	static uint8_t execute(uint8_t mode, const uint8_t (&in_seed)[12], Response &response)
+	{
+		const aes132_segment data[] = {{in_seed, 12}};
+		return send(mode, 0, 0, data, 1, response);
+	}
+};
+
+
+//! Random command: returns 16 random bytes.
+struct Random : Command<AES132_RANDOM, 0, 16> {
+	//! offset of the random bytes in the response
+	static constexpr uint8_t random_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! validated view of the response
+	struct View : ResponseView<response_size> {
+		using ResponseView<response_size>::ResponseView;
+
+		ByteSpan<16> random() const { return this->template field<random_offset, 16>(); }
+	};
+
+	static uint8_t execute(uint8_t mode, Response &response)
+	{
+		return send(mode, 0, 0, response);
+	}
+};
+
+
+/** \brief Reset command: resets the device.
+ *
+ * The device does not answer; the command is sent without reading a response.
+ */
+struct Reset : Command<AES132_RESET, 0, 0> {
+	static uint8_t execute()
+	{
+		uint8_t header[] = {command_size, op_code, 0, 0, 0, 0, 0};
+		uint8_t crc[AES132_CRC_SIZE];
+		aes132c_calculate_crc(sizeof(header), header, crc);
+		const aes132_segment segments[] = {{header, sizeof(header)}, {crc, sizeof(crc)}};
+		return aes132c_send_command_segments(segments, 2, AES132_OPTION_NO_STATUS_READ);
+	}
+};
+
+
+/** \brief Sleep command: puts the device into Sleep or Standby mode.
+ *
+ * The device does not answer. Same as aes132c_sleep() and aes132c_standby().
+ */
+struct Sleep : Command<AES132_SLEEP, 0, 0> {
+	static uint8_t execute(uint8_t mode)
+	{
+		return aes132c_send_sleep_command(mode);
+	}
+};
+
+
+//! TempSense command: measures the die temperature.
+struct TempSense : Command<AES132_TEMP_SENSE, 0, 2> {
+	//! offset of the temperature reading in the response
+	static constexpr uint8_t temperature_offset = AES132_RESPONSE_INDEX_DATA;
+
+	//! validated view of the response
+	struct View : ResponseView<response_size> {
+		using ResponseView<response_size>::ResponseView;
+
+		ByteSpan<2> temperature() const { return this->template field<temperature_offset, 2>(); }
+	};
+
+	static uint8_t execute(Response &response)
+	{
+		return send(0, 0, 0, response);
+	}
+};
+
+} // namespace aes132
+
+#endif
@@ -0,0 +1,493 @@
+/** \file
+ *  \brief  Coroutine interface for the AES132 library (C++20, header only).
+ *
+ * Commands can be awaited in coroutines, so that a sequence of commands reads as
+ * straight-line code while the caller stays free during every execution time:
+ * \code
+ * aes132::Task encrypt_with_nonce(aes132::Device &device, aes132::Encrypt<16>::Response &encrypted)
+ * {
+ *     aes132::Nonce<0x01>::Response nonce;
+ *     uint8_t ret = co_await device.nonce<0x01>(seed, nonce);
+ *     if (ret == AES132_DEVICE_RETCODE_SUCCESS)
+ *         ret = co_await device.encrypt(0, key_id, plaintext, encrypted);
+ *     co_return ret;
+ * }
+ *
+ * aes132::Scheduler scheduler;
+ * aes132::Device device(scheduler, AES132_I2C_ADDRESS);
+ * scheduler.spawn(encrypt_with_nonce(device, encrypted));
+ * while (scheduler.poll())
+ *     do_other_work();
+ * \endcode
+ * Awaiting a command queues it on the scheduler and suspends the coroutine.
+ * Scheduler::poll() drives the command in progress with aes132c_async_step() (see
+ * aes132_async.h) and resumes the coroutine when the response has arrived. Commands run
+ * one at a time in the order they were awaited, so coroutines for several devices can
+ * share the bus. Scheduler::run() polls until nothing is left and, with
+ * #AES132_YIELDING_WAIT, sleeps while the device executes, so that it can be the body of
+ * a FreeRTOS task or of a host thread. Spawn, poll and run from the same task.
+ *
+ * A Task can also be awaited by another coroutine, e.g. Device::random_bytes(), and
+ * returns the status of its last command. Coroutine frames come from a pool of
+ * #AES132_CORO_FRAME_COUNT frames of #AES132_CORO_FRAME_SIZE bytes, never from the heap.
+ * If no frame is free, or the frame would be too large, the coroutine is not created:
+ * Scheduler::spawn() returns false, and awaiting it returns
+ * #AES132_FUNCTION_RETCODE_NO_FRAME.
+ */
+
+#ifndef AES132_CORO_H
+#   define AES132_CORO_H
+
+#if !defined(__cplusplus) || !defined(__cpp_impl_coroutine)
+#   error aes132_coro.h requires C++20 coroutines.
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "aes132_async.h"
+#include "aes132_comm.h"
+#include "aes132_commands.h"
+#include "aes132_device.h"
+#include "aes132_timer.h"
+
+/** \brief size in bytes of a coroutine frame
+ *
+ * Override with a build flag, e.g. -DAES132_CORO_FRAME_SIZE=1024. A frame holds the
+ * locals of the coroutine, including its response buffers, and every co_await of a command
+ * gets its own Operation of about 150 bytes (190 on 64-bit hosts). A coroutine that
+ * awaits three commands needs about 550 bytes on a 64-bit host.
+ */
+#ifndef AES132_CORO_FRAME_SIZE
+#   define AES132_CORO_FRAME_SIZE       (768)
+#endif
+
+/** \brief number of coroutine frames
+ *
+ * Override with a build flag, e.g. -DAES132_CORO_FRAME_COUNT=8. An awaited Task
+ * needs a frame in addition to the one of its caller.
+ */
+#ifndef AES132_CORO_FRAME_COUNT
+#   define AES132_CORO_FRAME_COUNT      (4)
+#endif
+
+namespace aes132 {
+
+class Scheduler;
+
+
+//! fixed pool of coroutine frames
+class FramePool {
+public:
+	/** \brief Takes a free frame.
+	 * \param[in] size frame size the compiler needs
+	 * \return frame, or nullptr if none is free or size is larger than #AES132_CORO_FRAME_SIZE
+	 */
+	void *allocate(size_t size) noexcept
+	{
+		if (size > AES132_CORO_FRAME_SIZE)
+			return nullptr;
+
+		for (uint8_t i = 0; i < AES132_CORO_FRAME_COUNT; i++) {
+			if (!is_used_[i]) {
+				is_used_[i] = true;
+				return frames_[i].bytes;
+			}
+		}
+		return nullptr;
+	}
+
+	//! Returns a frame taken by allocate().
+	void deallocate(void *frame) noexcept
+	{
+		is_used_[static_cast<Frame *>(frame) - frames_] = false;
+	}
+
+	//! number of free frames
+	uint8_t available() const noexcept
+	{
+		uint8_t n_free = 0;
+
+		for (uint8_t i = 0; i < AES132_CORO_FRAME_COUNT; i++)
+			n_free += is_used_[i] ? 0 : 1;
+		return n_free;
+	}
+
+private:
+	struct alignas(alignof(max_align_t)) Frame {
+		unsigned char bytes[AES132_CORO_FRAME_SIZE];
+	};
+
+	Frame frames_[AES132_CORO_FRAME_COUNT];
+	bool is_used_[AES132_CORO_FRAME_COUNT] = {};
+};
+
+//! the pool all coroutine frames come from
+inline FramePool frame_pool;
+
+
+/** \brief coroutine that sends commands and returns a status
+ *
+ * The coroutine starts when it is spawned or awaited. co_return the status of the
+ * operation or the response return code.
+ */
+class Task {
+public:
+	struct promise_type;
+	using Handle = std::coroutine_handle<promise_type>;
+
+	//! Resumes the awaiting coroutine, or frees a spawned one, when the task has returned.
+	struct FinalAwaiter {
+		bool await_ready() const noexcept { return false; }
+
+		std::coroutine_handle<> await_suspend(Handle handle) noexcept
+		{
+			promise_type &promise = handle.promise();
+
+			if (promise.continuation)
+				return promise.continuation;
+			if (promise.is_detached)
+				handle.destroy();
+			return std::noop_coroutine();
+		}
+
+		void await_resume() const noexcept {}
+	};
+
+	struct promise_type {
+		uint8_t result = AES132_FUNCTION_RETCODE_SUCCESS;
+		std::coroutine_handle<> continuation;
+		bool is_detached = false;
+
+		static void *operator new(size_t size) noexcept { return frame_pool.allocate(size); }
+		static void operator delete(void *frame) noexcept { frame_pool.deallocate(frame); }
+		static Task get_return_object_on_allocation_failure() noexcept { return Task(); }
+
+		Task get_return_object() noexcept { return Task(Handle::from_promise(*this)); }
+		std::suspend_always initial_suspend() const noexcept { return {}; }
+		FinalAwaiter final_suspend() const noexcept { return {}; }
+		void return_value(uint8_t value) noexcept { result = value; }
+		void unhandled_exception() const noexcept { std::terminate(); }
+	};
+
+	Task() noexcept = default;
+	Task(Task &&other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+	Task(const Task &) = delete;
+	Task &operator=(const Task &) = delete;
+	Task &operator=(Task &&other) noexcept
+	{
+		if (this != &other) {
+			if (handle_)
+				handle_.destroy();
+			handle_ = other.handle_;
+			other.handle_ = nullptr;
+		}
+		return *this;
+	}
+	~Task()
+	{
+		if (handle_)
+			handle_.destroy();
+	}
+
+	//! false if no frame was available
+	bool valid() const noexcept { return static_cast<bool>(handle_); }
+
+	bool await_ready() const noexcept { return !handle_; }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+	{
+		handle_.promise().continuation = continuation;
+		return handle_;
+	}
+
+	uint8_t await_resume() const noexcept
+	{
+		return handle_ ? handle_.promise().result : AES132_FUNCTION_RETCODE_NO_FRAME;
+	}
+
+private:
+	friend class Scheduler;
+
+	explicit Task(Handle handle) noexcept : handle_(handle) {}
+
+	Handle handle_;
+};
+
+
+/** \brief one command awaited by a coroutine
+ *
+ * Returned by the Device functions. The command is assembled into the operation, so the
+ * data need not outlive the call; the response buffer has to outlive the co_await.
+ */
+class Operation {
+public:
+	/** \brief Assembles a command.
+	 * \param[in] scheduler scheduler that sends it
+	 * \param[in] device_id device to send it to (see aes132c_select_device())
+	 * \param[in] op_code command op-code
+	 * \param[in] mode command mode
+	 * \param[in] param1 first parameter
+	 * \param[in] param2 second parameter
+	 * \param[in] data data blocks, in order (may be nullptr if n_data is 0)
+	 * \param[in] n_data number of data blocks
+	 * \param[in] size size of the response buffer
+	 * \param[out] response response buffer
+	 */
+	Operation(Scheduler &scheduler, uint8_t device_id, uint8_t op_code, uint8_t mode,
+				uint16_t param1, uint16_t param2, const aes132_segment *data, uint8_t n_data,
+				uint8_t size, uint8_t *response) noexcept
+		: scheduler_(scheduler), response_(response), size_(size), device_id_(device_id)
+	{
+		uint8_t count = AES132_COMMAND_SIZE_MIN;
+
+		for (uint8_t i = 0; i < n_data; i++) {
+			if (count + data[i].count > AES132_COMMAND_SIZE_MAX) {
+				result_ = AES132_FUNCTION_RETCODE_BAD_PARAM;
+				is_ready_ = true;
+				return;
+			}
+			memcpy(&command_[AES132_COMMAND_INDEX_PARAM2_LSB + 1 + count - AES132_COMMAND_SIZE_MIN],
+						data[i].data, data[i].count);
+			count += data[i].count;
+		}
+
+		// The CRC is appended when the command is started.
+		command_[AES132_COMMAND_INDEX_COUNT] = count;
+		command_[AES132_COMMAND_INDEX_OPCODE] = op_code;
+		command_[AES132_COMMAND_INDEX_MODE] = mode;
+		command_[AES132_COMMAND_INDEX_PARAM1_MSB] = param1 >> 8;
+		command_[AES132_COMMAND_INDEX_PARAM1_LSB] = param1 & 0xFF;
+		command_[AES132_COMMAND_INDEX_PARAM2_MSB] = param2 >> 8;
+		command_[AES132_COMMAND_INDEX_PARAM2_LSB] = param2 & 0xFF;
+	}
+
+	// The scheduler keeps a pointer to a suspended operation.
+	Operation(const Operation &) = delete;
+	Operation &operator=(const Operation &) = delete;
+
+	bool await_ready() const noexcept { return is_ready_; }
+	inline void await_suspend(std::coroutine_handle<> continuation) noexcept;
+	uint8_t await_resume() const noexcept { return result_; }
+
+private:
+	friend class Scheduler;
+
+	Scheduler &scheduler_;
+	Operation *next_ = nullptr;
+	std::coroutine_handle<> continuation_;
+	aes132_async_command async_ = {};
+	uint8_t *response_;
+	uint8_t size_;
+	uint8_t device_id_;
+	uint8_t result_ = AES132_FUNCTION_RETCODE_SUCCESS;
+	bool is_ready_ = false;
+	uint8_t command_[AES132_COMMAND_SIZE_MAX] = {};
+};
+
+
+//! runs awaited commands one at a time and resumes their coroutines
+class Scheduler {
+public:
+	Scheduler() noexcept = default;
+	Scheduler(const Scheduler &) = delete;
+	Scheduler &operator=(const Scheduler &) = delete;
+
+	/** \brief Starts a coroutine. It runs until it awaits its first command.
+	 *
+	 * The scheduler frees the frame when the coroutine returns; its result is dropped.
+	 * \param[in] task coroutine to start
+	 * \return false if the task has no frame
+	 */
+	bool spawn(Task task) noexcept
+	{
+		Task::Handle handle = task.handle_;
+
+		if (!handle)
+			return false;
+
+		task.handle_ = nullptr;
+		handle.promise().is_detached = true;
+		handle.resume();
+		return true;
+	}
+
+	/** \brief Advances the command in progress by one step, or starts the next one.
+	 *
+	 * Returns at once. A coroutine whose command has completed is resumed from here.
+	 * \return true while commands are in progress or queued
+	 */
+	bool poll() noexcept
+	{
+		uint8_t ret;
+
+		if (!active_) {
+			if (!head_)
+				return false;
+
+			active_ = head_;
+			head_ = head_->next_;
+			if (!head_)
+				tail_ = nullptr;
+
+			ret = aes132c_select_device(active_->device_id_);
+			if (ret == AES132_FUNCTION_RETCODE_SUCCESS)
+				ret = aes132c_send_and_receive_async(&active_->async_, active_->command_, active_->size_,
+							active_->response_, AES132_OPTION_DEFAULT, nullptr, nullptr);
+			if (ret != AES132_FUNCTION_RETCODE_SUCCESS) {
+				complete(ret);
+				return !is_idle();
+			}
+		}
+
+		if (aes132c_async_step(&active_->async_))
+			return true;
+
+		complete(active_->async_.result);
+		return !is_idle();
+	}
+
+	//! Polls until no command is left. With #AES132_YIELDING_WAIT, the task sleeps while the device is busy.
+	void run() noexcept
+	{
+		while (poll()) {
+			if (AES132_YIELDING_WAIT && is_waiting())
+				aes132c_delay_us(AES132_YIELD_POLL_INTERVAL_US);
+		}
+	}
+
+	//! true if no command is in progress or queued
+	bool is_idle() const noexcept { return !active_ && !head_; }
+
+private:
+	friend class Operation;
+
+	void enqueue(Operation &operation) noexcept
+	{
+		operation.next_ = nullptr;
+		if (tail_)
+			tail_->next_ = &operation;
+		else
+			head_ = &operation;
+		tail_ = &operation;
+	}
+
+	void complete(uint8_t result) noexcept
+	{
+		Operation *operation = active_;
+
+		// The operation lives in the frame of the coroutine and ends with the co_await.
+		active_ = nullptr;
+		operation->result_ = result;
+		operation->continuation_.resume();
+	}
+
+	//! true if the command in progress waits for the device, so that polling it again soon is useless
+	bool is_waiting() const noexcept
+	{
+		if (!active_)
+			return false;
+
+		return (active_->async_.state == AES132_ASYNC_STATE_WAIT_DEVICE_READY)
+					|| (active_->async_.state == AES132_ASYNC_STATE_EXECUTE)
+					|| (active_->async_.state == AES132_ASYNC_STATE_WAIT_RESPONSE_READY);
+	}
+
+	Operation *active_ = nullptr;
+	Operation *head_ = nullptr;
+	Operation *tail_ = nullptr;
+};
+
+
+inline void Operation::await_suspend(std::coroutine_handle<> continuation) noexcept
+{
+	continuation_ = continuation;
+	scheduler_.enqueue(*this);
+}
+
+
+/** \brief one device whose commands are awaited
+ *
+ * Sizes and data layouts follow the typed commands in aes132_commands.h, so their
+ * views decode the responses.
+ */
+class Device {
+public:
+	/** \brief binds a device to a scheduler
+	 * \param[in] scheduler scheduler that sends the commands
+	 * \param[in] device_id device to send them to (see aes132c_select_device())
+	 */
+	Device(Scheduler &scheduler, uint8_t device_id) noexcept
+		: scheduler_(scheduler), device_id_(device_id) {}
+
+	//! Sends any command; see aes132m_execute_segments().
+	Operation execute(uint8_t op_code, uint8_t mode, uint16_t param1, uint16_t param2,
+				const aes132_segment *data, uint8_t n_data, uint8_t size, uint8_t *response) noexcept
+	{
+		return Operation(scheduler_, device_id_, op_code, mode, param1, param2, data, n_data, size, response);
+	}
+
+	//! Random command: 16 random bytes.
+	Operation random(uint8_t mode, Random::Response &response) noexcept
+	{
+		return execute(AES132_RANDOM, mode, 0, 0, nullptr, 0, Random::response_size, response.bytes);
+	}
+
+	/** \brief Fills a buffer of any length with Random commands.
+	 * \param[out] out buffer for the random bytes
+	 * \param[in] length number of random bytes
+	 * \return status of the first failed command, or #AES132_DEVICE_RETCODE_SUCCESS
+	 */
+	Task random_bytes(uint8_t *out, uint8_t length) noexcept
+	{
+		Random::Response response;
+
+		while (length > 0) {
+			Random::View view(co_await random(0, response), response);
+			if (!view.ok())
+				co_return view.status();
+
+			uint8_t n = (length < view.random().size()) ? length : view.random().size();
+			memcpy(out, view.random().data(), n);
+			out += n;
+			length -= n;
+		}
+		co_return AES132_DEVICE_RETCODE_SUCCESS;
+	}
+
+	//! Nonce command; see Nonce::execute().
+	template <uint8_t Mode>
+	Operation nonce(const uint8_t (&in_seed)[12], typename Nonce<Mode>::Response &response) noexcept
+	{
+		const aes132_segment data[] = {{in_seed, 12}};
+		return execute(AES132_NONCE, Mode, 0, 0, data, 1, Nonce<Mode>::response_size, response.bytes);
+	}
+
+	//! Encrypt command; see Encrypt::execute().
+	template <uint8_t Length>
+	Operation encrypt(uint8_t mode, uint16_t key_id, const uint8_t (&plaintext)[Length],
+				typename Encrypt<Length>::Response &response) noexcept
+	{
+		const aes132_segment data[] = {{plaintext, Length}};
+		return execute(AES132_ENCRYPT, mode, key_id, Length, data, 1, Encrypt<Length>::response_size, response.bytes);
+	}
+
+	//! BlockRead command: Length bytes of user memory; see BlockRead::execute().
+	template <uint8_t Length>
+	Operation read_memory(uint16_t address, typename BlockRead<Length>::Response &response) noexcept
+	{
+		return execute(AES132_BLOCK_READ, 0, address, Length, nullptr, 0, BlockRead<Length>::response_size,
+					response.bytes);
+	}
+
+private:
+	Scheduler &scheduler_;
+	uint8_t device_id_;
+};
+
+} // namespace aes132
+
+#endif
@@ -0,0 +1,282 @@
+/** \file
+ *  \brief  CRC-16 module of the AES132 library.
+ *
+ * See aes132_crc.h for the algorithm and the trade-offs between the implementations.
+ */
+
+#include <stdint.h>
+
+#include "aes132_comm.h"
+#include "aes132_crc.h"
+
+#if defined(ESP_PLATFORM) && defined(AES132_CRC_IN_RAM)
+#   include "esp_attr.h"
+/** \brief Keep the byte table in internal RAM and the CRC function in IRAM
+ *         so that a CRC never waits for a flash cache miss.
+ *
+ * IRAM only supports 32-bit accesses, so the 16-bit table has to live in DRAM.
+ */
+#   define AES132_CRC_TABLE_ATTR       DRAM_ATTR
+#   define AES132_CRC_FUNCTION_ATTR    IRAM_ATTR
+#else
+//! Tables are const and stay in flash (.rodata).
+#   define AES132_CRC_TABLE_ATTR
+#   define AES132_CRC_FUNCTION_ATTR
+#endif
+
+
+//! CRC of every possible upper byte, indexed by (crc >> 8) ^ data byte
+static const uint16_t aes132c_crc_byte_table[256] AES132_CRC_TABLE_ATTR = {
+	0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011,
+	0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022,
+	0x8063, 0x0066, 0x006C, 0x8069, 0x0078, 0x807D, 0x8077, 0x0072,
+	0x0050, 0x8055, 0x805F, 0x005A, 0x804B, 0x004E, 0x0044, 0x8041,
+	0x80C3, 0x00C6, 0x00CC, 0x80C9, 0x00D8, 0x80DD, 0x80D7, 0x00D2,
+	0x00F0, 0x80F5, 0x80FF, 0x00FA, 0x80EB, 0x00EE, 0x00E4, 0x80E1,
+	0x00A0, 0x80A5, 0x80AF, 0x00AA, 0x80BB, 0x00BE, 0x00B4, 0x80B1,
+	0x8093, 0x0096, 0x009C, 0x8099, 0x0088, 0x808D, 0x8087, 0x0082,
+	0x8183, 0x0186, 0x018C, 0x8189, 0x0198, 0x819D, 0x8197, 0x0192,
+	0x01B0, 0x81B5, 0x81BF, 0x01BA, 0x81AB, 0x01AE, 0x01A4, 0x81A1,
+	0x01E0, 0x81E5, 0x81EF, 0x01EA, 0x81FB, 0x01FE, 0x01F4, 0x81F1,
+	0x81D3, 0x01D6, 0x01DC, 0x81D9, 0x01C8, 0x81CD, 0x81C7, 0x01C2,
+	0x0140, 0x8145, 0x814F, 0x014A, 0x815B, 0x015E, 0x0154, 0x8151,
+	0x8173, 0x0176, 0x017C, 0x8179, 0x0168, 0x816D, 0x8167, 0x0162,
+	0x8123, 0x0126, 0x012C, 0x8129, 0x0138, 0x813D, 0x8137, 0x0132,
+	0x0110, 0x8115, 0x811F, 0x011A, 0x810B, 0x010E, 0x0104, 0x8101,
+	0x8303, 0x0306, 0x030C, 0x8309, 0x0318, 0x831D, 0x8317, 0x0312,
+	0x0330, 0x8335, 0x833F, 0x033A, 0x832B, 0x032E, 0x0324, 0x8321,
+	0x0360, 0x8365, 0x836F, 0x036A, 0x837B, 0x037E, 0x0374, 0x8371,
+	0x8353, 0x0356, 0x035C, 0x8359, 0x0348, 0x834D, 0x8347, 0x0342,
+	0x03C0, 0x83C5, 0x83CF, 0x03CA, 0x83DB, 0x03DE, 0x03D4, 0x83D1,
+	0x83F3, 0x03F6, 0x03FC, 0x83F9, 0x03E8, 0x83ED, 0x83E7, 0x03E2,
+	0x83A3, 0x03A6, 0x03AC, 0x83A9, 0x03B8, 0x83BD, 0x83B7, 0x03B2,
+	0x0390, 0x8395, 0x839F, 0x039A, 0x838B, 0x038E, 0x0384, 0x8381,
+	0x0280, 0x8285, 0x828F, 0x028A, 0x829B, 0x029E, 0x0294, 0x8291,
+	0x82B3, 0x02B6, 0x02BC, 0x82B9, 0x02A8, 0x82AD, 0x82A7, 0x02A2,
+	0x82E3, 0x02E6, 0x02EC, 0x82E9, 0x02F8, 0x82FD, 0x82F7, 0x02F2,
+	0x02D0, 0x82D5, 0x82DF, 0x02DA, 0x82CB, 0x02CE, 0x02C4, 0x82C1,
+	0x8243, 0x0246, 0x024C, 0x8249, 0x0258, 0x825D, 0x8257, 0x0252,
+	0x0270, 0x8275, 0x827F, 0x027A, 0x826B, 0x026E, 0x0264, 0x8261,
+	0x0220, 0x8225, 0x822F, 0x022A, 0x823B, 0x023E, 0x0234, 0x8231,
+	0x8213, 0x0216, 0x021C, 0x8219, 0x0208, 0x820D, 0x8207, 0x0202
+};
+
+//! CRC of every possible upper nibble, indexed by (crc >> 12) ^ data nibble
+static const uint16_t aes132c_crc_nibble_table[16] AES132_CRC_TABLE_ATTR = {
+	0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011,
+	0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022
+};
+
+
+/** \brief This function feeds one byte into a CRC register
+ *         using the implementation selected by #AES132_CRC_TABLE_SIZE.
+ * \param[in] crc_register current CRC register
+ * \param[in] data byte to feed
+ * \return updated CRC register
+ */
+static inline uint16_t aes132c_crc_update_byte(uint16_t crc_register, uint8_t data)
+{
+#if (AES132_CRC_TABLE_SIZE == AES132_CRC_TABLE_BYTE)
+	return (uint16_t) (crc_register << 8) ^ aes132c_crc_byte_table[(crc_register >> 8) ^ data];
+#elif (AES132_CRC_TABLE_SIZE == AES132_CRC_TABLE_NIBBLE)
+	crc_register = (uint16_t) (crc_register << 4) ^ aes132c_crc_nibble_table[(crc_register >> 12) ^ (data >> 4)];
+	return (uint16_t) (crc_register << 4) ^ aes132c_crc_nibble_table[(crc_register >> 12) ^ (data & 0x0F)];
+#else
+	uint8_t bit;
+
+	crc_register ^= (uint16_t) data << 8;
+	for (bit = 0; bit < 8; bit++)
+		crc_register = (crc_register & 0x8000) ? (uint16_t) ((crc_register << 1) ^ AES132_CRC_POLYNOMIAL)
+				: (uint16_t) (crc_register << 1);
+	return crc_register;
+#endif
+}
+
+
+/** \brief This function starts an incremental CRC calculation.
+ * \param[out] context pointer to CRC context
+ */
+void aes132c_crc_init(struct aes132_crc_context *context)
+{
+	context->crc = 0;
+}
+
+
+/** \brief This function feeds bytes into an incremental CRC calculation.
+ * \param[in, out] context pointer to CRC context
+ * \param[in] length number of bytes in data buffer
+ * \param[in] data pointer to data
+ */
+AES132_CRC_FUNCTION_ATTR void aes132c_crc_update(struct aes132_crc_context *context, uint8_t length, const uint8_t *data)
+{
+	uint16_t crc_register = context->crc;
+
+	while (length-- > 0)
+		crc_register = aes132c_crc_update_byte(crc_register, *data++);
+
+	context->crc = crc_register;
+}
+
+
+/** \brief This function copies bytes and feeds them into an incremental CRC calculation
+ *         in the same pass.
+ *
+ * Source and destination must not overlap.
+ * \param[in, out] context pointer to CRC context
+ * \param[out] destination pointer to destination buffer
+ * \param[in] length number of bytes to copy
+ * \param[in] source pointer to source data
+ * \return pointer to the byte following the copied bytes in the destination buffer
+ */
+AES132_CRC_FUNCTION_ATTR uint8_t *aes132c_crc_copy(struct aes132_crc_context *context, uint8_t *destination,
+			uint8_t length, const uint8_t *source)
+{
+	uint16_t crc_register = context->crc;
+	uint8_t data;
+
+	while (length-- > 0) {
+		data = *source++;
+		*destination++ = data;
+		crc_register = aes132c_crc_update_byte(crc_register, data);
+	}
+
+	context->crc = crc_register;
+	return destination;
+}
+
+
+/** \brief This function stores the result of an incremental CRC calculation.
+ * \param[in] context pointer to CRC context
+ * \param[out] crc pointer to calculated CRC (high byte at crc[0])
+ */
+void aes132c_crc_final(const struct aes132_crc_context *context, uint8_t *crc)
+{
+	crc[0] = (uint8_t) (context->crc >> 8);
+	crc[1] = (uint8_t) (context->crc & 0xFF);
+}
+
+
+/** \brief This function overwrites bytes of a packet and fixes up its CRC
+ *         from the changed bytes alone.
+ *
+ * The CRC has no initial value and no final XOR, so it is linear:
+ * CRC(a ^ b) = CRC(a) ^ CRC(b) for packets of equal length. Replacing bytes
+ * therefore changes the CRC by the CRC of (old ^ new) followed by the bytes
+ * up to the CRC, which are zero in the difference. Leading zeros do not
+ * change the CRC, so the bytes in front of the patched range are not read.
+ *
+ * The caller has to make sure that offset + length does not reach into the CRC.
+ * \param[in, out] packet pointer to packet with count byte and valid CRC
+ * \param[in] offset index of the first byte to overwrite
+ * \param[in] length number of bytes to overwrite
+ * \param[in] data pointer to new bytes
+ */
+AES132_CRC_FUNCTION_ATTR void aes132c_crc_patch(uint8_t *packet, uint8_t offset, uint8_t length, const uint8_t *data)
+{
+	uint8_t crc_index = packet[AES132_COMMAND_INDEX_COUNT] - AES132_CRC_SIZE;
+	uint8_t tail_length = crc_index - offset - length;
+	uint8_t *p_packet = &packet[offset];
+	uint16_t crc_register = 0;
+
+	while (length-- > 0) {
+		crc_register = aes132c_crc_update_byte(crc_register, *p_packet ^ *data);
+		*p_packet++ = *data++;
+	}
+	while (tail_length-- > 0)
+		crc_register = aes132c_crc_update_byte(crc_register, 0);
+
+	packet[crc_index] ^= (uint8_t) (crc_register >> 8);
+	packet[crc_index + 1] ^= (uint8_t) (crc_register & 0xFF);
+}
+
+
+/** \brief This function calculates a 16-bit CRC one bit at a time.
+ *
+ * This is the reference implementation. It does not need a table.
+ * \param[in] length number of bytes in data buffer
+ * \param[in] data pointer to data
+ * \param[out] crc pointer to calculated CRC (high byte at crc[0])
+ */
+void aes132c_calculate_crc_bitwise(uint8_t length, const uint8_t *data, uint8_t *crc)
+{
+	uint8_t counter;
+	uint8_t crc_low = 0, crc_high = 0, crc_carry;
+	uint8_t poly_low = 0x05, poly_high = 0x80;
+	uint8_t shift_register;
+	uint8_t data_bit, crc_bit;
+
+	for (counter = 0; counter < length; counter++) {
+		for (shift_register = 0x80; shift_register > 0x00; shift_register >>= 1) {
+			data_bit = (data[counter] & shift_register) ? 1 : 0;
+			crc_bit = crc_high >> 7;
+
+			// Shift CRC to the left by 1.
+			crc_carry = crc_low >> 7;
+			crc_low <<= 1;
+			crc_high <<= 1;
+			crc_high |= crc_carry;
+
+			if ((data_bit ^ crc_bit) != 0) {
+				crc_low ^= poly_low;
+				crc_high ^= poly_high;
+			}
+		}
+	}
+	crc[0] = crc_high;
+	crc[1] = crc_low;
+}
+
+
+/** \brief This function calculates a 16-bit CRC using a 16-entry table.
+ * \param[in] length number of bytes in data buffer
+ * \param[in] data pointer to data
+ * \param[out] crc pointer to calculated CRC (high byte at crc[0])
+ */
+void aes132c_calculate_crc_nibble(uint8_t length, const uint8_t *data, uint8_t *crc)
+{
+	uint16_t crc_register = 0;
+
+	while (length-- > 0) {
+		crc_register = (uint16_t) (crc_register << 4) ^ aes132c_crc_nibble_table[(crc_register >> 12) ^ (*data >> 4)];
+		crc_register = (uint16_t) (crc_register << 4) ^ aes132c_crc_nibble_table[(crc_register >> 12) ^ (*data & 0x0F)];
+		data++;
+	}
+	crc[0] = (uint8_t) (crc_register >> 8);
+	crc[1] = (uint8_t) (crc_register & 0xFF);
+}
+
+
+/** \brief This function calculates a 16-bit CRC using a 256-entry table.
+ * \param[in] length number of bytes in data buffer
+ * \param[in] data pointer to data
+ * \param[out] crc pointer to calculated CRC (high byte at crc[0])
+ */
+AES132_CRC_FUNCTION_ATTR void aes132c_calculate_crc_table(uint8_t length, const uint8_t *data, uint8_t *crc)
+{
+	uint16_t crc_register = 0;
+
+	while (length-- > 0)
+		crc_register = (uint16_t) (crc_register << 8) ^ aes132c_crc_byte_table[(crc_register >> 8) ^ *data++];
+
+	crc[0] = (uint8_t) (crc_register >> 8);
+	crc[1] = (uint8_t) (crc_register & 0xFF);
+}
+
+
+/** \brief This function calculates a 16-bit CRC.
+ *
+ * The implementation is selected at compile time with #AES132_CRC_TABLE_SIZE.
+ * \param[in] length number of bytes in data buffer
+ * \param[in] data pointer to data
+ * \param[out] crc pointer to calculated CRC (high byte at crc[0])
+ */
+void aes132c_calculate_crc(uint8_t length, uint8_t *data, uint8_t *crc)
+{
+#if (AES132_CRC_TABLE_SIZE == AES132_CRC_TABLE_BYTE)
+	aes132c_calculate_crc_table(length, data, crc);
+#elif (AES132_CRC_TABLE_SIZE == AES132_CRC_TABLE_NIBBLE)
+	aes132c_calculate_crc_nibble(length, data, crc);
+#else
+	aes132c_calculate_crc_bitwise(length, data, crc);
+#endif
+}
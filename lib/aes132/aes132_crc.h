@@ -0,0 +1,79 @@
+/** \file
+ *  \brief  Definitions and prototypes for the CRC-16 module of the AES132 library.
+ *
+ * Every command and response packet ends with a CRC-16 over all preceding bytes
+ * (polynomial 0x8005, initial value 0x0000, MSB first, no final XOR, high byte sent first).
+ * The CRC is calculated twice per command: once when appending it to the command and once
+ * when checking the response. Three implementations of the same algorithm are provided:
+ *
+ * <table>
+ *   <tr><th>Variant</th>           <th>Table size</th> <th>Work per byte</th></tr>
+ *   <tr><td>bit-at-a-time</td>     <td>none</td>       <td>8 shift / xor steps</td></tr>
+ *   <tr><td>nibble table</td>      <td>32 bytes</td>   <td>2 table lookups</td></tr>
+ *   <tr><td>byte table</td>        <td>512 bytes</td>  <td>1 table lookup</td></tr>
+ * </table>
+ *
+ * #AES132_CRC_TABLE_SIZE selects the variant that backs aes132c_calculate_crc().
+ * All variants stay callable so they can be compared against each other.
+ */
+
+#ifndef AES132_CRC_H
+#   define AES132_CRC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! CRC polynomial x^16 + x^15 + x^2 + 1 (x^16 implied)
+#define AES132_CRC_POLYNOMIAL          ((uint16_t) 0x8005)
+
+//! value for #AES132_CRC_TABLE_SIZE that selects the bit-at-a-time implementation
+#define AES132_CRC_TABLE_NONE          (0)
+
+//! value for #AES132_CRC_TABLE_SIZE that selects the 16-entry nibble table (small footprint)
+#define AES132_CRC_TABLE_NIBBLE        (16)
+
+//! value for #AES132_CRC_TABLE_SIZE that selects the 256-entry byte table (fastest)
+#define AES132_CRC_TABLE_BYTE          (256)
+
+/** \brief Implementation used by aes132c_calculate_crc().
+ *
+ * Override with a build flag, e.g. -DAES132_CRC_TABLE_SIZE=16.
+ */
+#ifndef AES132_CRC_TABLE_SIZE
+#   define AES132_CRC_TABLE_SIZE       AES132_CRC_TABLE_BYTE
+#endif
+
+#if (AES132_CRC_TABLE_SIZE != AES132_CRC_TABLE_NONE) \
+	&& (AES132_CRC_TABLE_SIZE != AES132_CRC_TABLE_NIBBLE) \
+	&& (AES132_CRC_TABLE_SIZE != AES132_CRC_TABLE_BYTE)
+#   error AES132_CRC_TABLE_SIZE has to be 0, 16, or 256.
+#endif
+
+/** \brief running state of an incremental CRC calculation
+ *
+ * Use aes132c_crc_init(), then aes132c_crc_update() or aes132c_crc_copy() for every
+ * piece of the packet in order, and aes132c_crc_final() to store the CRC. The result
+ * equals aes132c_calculate_crc() over the concatenated pieces.
+ */
+struct aes132_crc_context {
+	uint16_t crc;   //!< CRC register
+};
+
+void     aes132c_crc_init(struct aes132_crc_context *context);
+void     aes132c_crc_update(struct aes132_crc_context *context, uint8_t length, const uint8_t *data);
+uint8_t *aes132c_crc_copy(struct aes132_crc_context *context, uint8_t *destination, uint8_t length, const uint8_t *source);
+void     aes132c_crc_final(const struct aes132_crc_context *context, uint8_t *crc);
+void     aes132c_crc_patch(uint8_t *packet, uint8_t offset, uint8_t length, const uint8_t *data);
+
+void aes132c_calculate_crc_bitwise(uint8_t length, const uint8_t *data, uint8_t *crc);
+void aes132c_calculate_crc_nibble(uint8_t length, const uint8_t *data, uint8_t *crc);
+void aes132c_calculate_crc_table(uint8_t length, const uint8_t *data, uint8_t *crc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+/** \file
+ *  \brief  Device context module of the AES132 library.
+ *
+ * See aes132_device.h for how device indexes are used.
+ */
+
+#include <stdint.h>
+
+#include "aes132_comm.h"
+#include "aes132_device.h"
+#include "aes132_transport.h"
+
+//! device id (I2C address) per device index, valid for the first aes132c_device_count entries
+static uint8_t aes132c_device_ids[AES132_DEVICE_COUNT_MAX];
+
+//! transport per device index, NULL for #AES132_TRANSPORT_DEFAULT
+static const struct aes132_transport *aes132c_device_transports[AES132_DEVICE_COUNT_MAX];
+
+//! number of device indexes handed out
+static uint8_t aes132c_device_count;
+
+//! index of the selected device
+static uint8_t aes132c_device_index;
+
+
+/** \brief This function selects a device on its transport.
+ *
+ * The first time a device id is selected, it gets the next free device index
+ * and #AES132_TRANSPORT_DEFAULT (see aes132c_select_device_transport()).
+ * The device index is kept when selecting the physical device fails.
+ * \param[in] device_id device id (I2C address)
+ * \return status of the operation; #AES132_FUNCTION_RETCODE_DEVICE_SELECT_FAIL
+ *         if #AES132_DEVICE_COUNT_MAX devices are already known
+ */
+uint8_t aes132c_select_device(uint8_t device_id)
+{
+	return aes132c_select_device_transport(device_id, (const struct aes132_transport *) 0);
+}
+
+
+/** \brief This function selects a device and sets the transport it is reached through.
+ *
+ * The device keeps the transport when other devices are selected in between.
+ * The device index and transport are kept when selecting the physical device fails.
+ * \param[in] device_id device id (I2C address)
+ * \param[in] transport transport to reach the device through; has to stay valid while in use.
+ *            NULL keeps the transport the device has.
+ * \return status of the operation; #AES132_FUNCTION_RETCODE_DEVICE_SELECT_FAIL
+ *         if #AES132_DEVICE_COUNT_MAX devices are already known
+ */
+uint8_t aes132c_select_device_transport(uint8_t device_id, const struct aes132_transport *transport)
+{
+	uint8_t aes132_lib_return;
+	uint8_t device_index;
+	const struct aes132_transport *previous_transport = aes132c_get_transport();
+
+	for (device_index = 0; device_index < aes132c_device_count; device_index++) {
+		if (aes132c_device_ids[device_index] == device_id)
+			break;
+	}
+
+	if (device_index == aes132c_device_count) {
+		if (aes132c_device_count == AES132_DEVICE_COUNT_MAX)
+			return AES132_FUNCTION_RETCODE_DEVICE_SELECT_FAIL;
+
+		aes132c_device_ids[aes132c_device_count++] = device_id;
+	}
+
+	if (!transport)
+		transport = aes132c_device_transports[device_index];
+
+	aes132c_use_transport(transport);
+	aes132_lib_return = aes132p_select_device(device_id);
+	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
+		// Keep talking to the selected device.
+		aes132c_use_transport(previous_transport);
+		return aes132_lib_return;
+	}
+
+	aes132c_device_transports[device_index] = transport;
+	aes132c_device_index = device_index;
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function returns the index of the selected device.
+ * \return device index, smaller than #AES132_DEVICE_COUNT_MAX
+ */
+uint8_t aes132c_get_device_index(void)
+{
+	return aes132c_device_index;
+}
@@ -0,0 +1,45 @@
+/** \file
+ *  \brief  Definitions and prototypes for the device context module of the AES132 library.
+ *
+ * Several devices can share one bus. The library keeps state that differs between
+ * devices, e.g. the learned execution times of the adaptive poller (see aes132_poller.h),
+ * in a table indexed by device. aes132c_select_device() selects the device for the
+ * physical layer and the row of that table. Until a device is selected, index 0 is used.
+ *
+ * Devices can be reached through different transports (see aes132_transport.h), e.g. one
+ * device on the I2C bus and one fake device. aes132c_select_device_transport() sets the
+ * transport of a device.
+ */
+
+#ifndef AES132_DEVICE_H
+#   define AES132_DEVICE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief maximum number of devices the library keeps state for
+ *
+ * Override with a build flag, e.g. -DAES132_DEVICE_COUNT_MAX=1.
+ */
+#ifndef AES132_DEVICE_COUNT_MAX
+#   define AES132_DEVICE_COUNT_MAX      (4)
+#endif
+
+#if (AES132_DEVICE_COUNT_MAX < 1) || (AES132_DEVICE_COUNT_MAX > 255)
+#   error AES132_DEVICE_COUNT_MAX has to be between 1 and 255.
+#endif
+
+struct aes132_transport;
+
+uint8_t aes132c_select_device(uint8_t device_id);
+uint8_t aes132c_select_device_transport(uint8_t device_id, const struct aes132_transport *transport);
+uint8_t aes132c_get_device_index(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,7 +22,6 @@
 #include "aes132_i2c.h" //!< I2C library definitions
 #include "i2c_phys.h"   //!< I2C physical layer (from i2c_phys library)
 #include <stdint.h>     //!< C type definitions
-#include <string.h>
 
 /** \brief These enumerations are flags for I2C read or write addressing. */
 enum aes132_i2c_read_write_flag {
@@ -30,45 +29,71 @@ enum aes132_i2c_read_write_flag {
   I2C_READ = (uint8_t)0x01   //!< read command id
 };
 
-/** \brief This function initializes and enables the I2C hardware peripheral. */
-void aes132p_enable_interface(void) { i2c_enable_phys(); }
+/** \brief This function initializes and enables the I2C hardware peripheral.
+ * \param[in] context not used
+ */
+static void aes132_i2c_enable_interface(void *context) {
+  (void)context;
+  i2c_enable_phys();
+}
 
-/** \brief This function disables the I2C hardware peripheral. */
-void aes132p_disable_interface(void) { i2c_disable_phys(); }
+/** \brief This function disables the I2C hardware peripheral.
+ * \param[in] context not used
+ */
+static void aes132_i2c_disable_interface(void *context) {
+  (void)context;
+  i2c_disable_phys();
+}
 
 /** \brief This function selects a I2C AES132 device.
  *
+ * @param[in] context not used
  * @param[in] device_id I2C address
  * @return always success
  */
-uint8_t aes132p_select_device(uint8_t device_id) {
+static uint8_t aes132_i2c_select_device(void *context, uint8_t device_id) {
+  (void)context;
   return i2c_select_device_phys(device_id);
 }
 
-/** \brief This function writes bytes to the device.
- * \param[in] count number of bytes to write
+/** \brief This function writes several buffers to the device in one transfer.
+ *
+ * The word address and the segments are handed to the I2C layer as they are,
+ * so no copy of the data is made on the way to the bus.
+ * \param[in] context not used
  * \param[in] word_address word address to write to
- * \param[in] data pointer to tx buffer
+ * \param[in] segments buffers to write, in order
+ * \param[in] n_segments number of segments (at most #AES132_SEGMENT_COUNT_MAX)
  * \return status of the operation
  */
-uint8_t aes132p_write_memory_physical(uint8_t count, uint16_t word_address,
-                                      uint8_t *data) {
+static uint8_t aes132_i2c_write_memory_segments(
+    void *context, uint16_t word_address,
+    const struct aes132_segment *segments, uint8_t n_segments) {
   // In both, big-endian and little-endian systems, we send MSB first.
   uint8_t word_address_buffer[2] = {(uint8_t)(word_address >> 8),
                                     (uint8_t)(word_address & 0xFF)};
-  uint8_t data_buffer[2 + count];
-  memcpy(&data_buffer[0], word_address_buffer, 2);
-  memcpy(&data_buffer[2], data, count);
+  struct i2c_segment i2c_segments[1 + AES132_SEGMENT_COUNT_MAX];
+
+  (void)context;
+  if (n_segments > AES132_SEGMENT_COUNT_MAX)
+    return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+  i2c_segments[0].data = word_address_buffer;
+  i2c_segments[0].count = sizeof(word_address_buffer);
+  for (uint8_t i = 0; i < n_segments; i++) {
+    i2c_segments[1 + i].data = segments[i].data;
+    i2c_segments[1 + i].count = segments[i].count;
+  }
+
   uint8_t aes132_lib_return = i2c_send_slave_address(I2C_WRITE);
   if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
     // There is no need to create a Stop condition, since function
     // aes132p_send_slave_address does that already in case of error.
     return aes132_lib_return;
 
-  aes132_lib_return =
-      i2c_send_bytes(sizeof(data_buffer), (uint8_t *)data_buffer);
+  aes132_lib_return = i2c_send_segments(1 + n_segments, i2c_segments);
   if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
-    // Don't override the return code from i2c_send_bytes in case of error.
+    // Don't override the return code from i2c_send_segments in case of error.
     (void)i2c_send_stop();
     return aes132_lib_return;
   }
@@ -78,16 +103,20 @@ uint8_t aes132p_write_memory_physical(uint8_t count, uint16_t word_address,
 }
 
 /** \brief This function reads bytes from the device.
+ * \param[in] context not used
  * \param[in] size number of bytes to read
  * \param[in] word_address word address to read from
  * \param[out] data pointer to rx buffer
  * \return status of the operation
  */
-uint8_t aes132p_read_memory_physical(uint8_t size, uint16_t word_address,
-                                     uint8_t *data) {
+static uint8_t aes132_i2c_read_memory(void *context, uint8_t size,
+                                      uint16_t word_address, uint8_t *data) {
   uint8_t word_address_buffer[2] = {(uint8_t)(word_address >> 8),
                                     (uint8_t)(word_address & 0xFF)};
-  uint8_t aes132_lib_return = i2c_send_slave_address(I2C_WRITE);
+  uint8_t aes132_lib_return;
+
+  (void)context;
+  aes132_lib_return = i2c_send_slave_address(I2C_WRITE);
   if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
     return aes132_lib_return;
 
@@ -104,14 +133,17 @@ uint8_t aes132p_read_memory_physical(uint8_t size, uint16_t word_address,
 
   return i2c_receive_bytes(size, data);
 }
+
 /** \brief This function resynchronizes communication.
+ * \param[in] context not used
  * \return status of the operation
  */
-uint8_t aes132p_resync_physical(void) {
+static uint8_t aes132_i2c_resync(void *context) {
   uint8_t nine_clocks = 0xFF;
   uint8_t n_retries = 2;
   uint8_t aes132_lib_return;
 
+  (void)context;
   do {
     aes132_lib_return = i2c_send_start();
     if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
@@ -132,3 +164,19 @@ uint8_t aes132p_resync_physical(void) {
 
   return i2c_send_stop();
 }
+
+/** \brief This function sets the I2C clock.
+ * \param[in] context not used
+ * \param[in] clock_hz I2C clock in Hz
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_set_clock(void *context, uint32_t clock_hz) {
+  (void)context;
+  return i2c_set_clock_phys(clock_hz);
+}
+
+const struct aes132_transport aes132_i2c_transport = {
+    aes132_i2c_enable_interface,      aes132_i2c_disable_interface,
+    aes132_i2c_select_device,         aes132_i2c_read_memory,
+    aes132_i2c_write_memory_segments, aes132_i2c_resync,
+    aes132_i2c_set_clock,             (void *)0};
@@ -22,7 +22,6 @@
 #include <stdint.h>                    //!< C type definitions
 #include <string.h>
 #include <Wire.h> // Required for Arduino Wire library functions
-#include <Arduino.h> // For Serial output
 
 #include "aes132_i2c.h"                //!< I2C library definitions
 #include "i2c_phys.h"                  //!< I2C physical layer (from i2c_phys library)
@@ -33,45 +32,62 @@ enum aes132_i2c_read_write_flag {
 	I2C_READ  = (uint8_t) 0x01   //!< read command id
 };
 
-/** \brief This function initializes and enables the I2C hardware peripheral. */
-void aes132p_enable_interface(void)
+/** \brief This function initializes and enables the I2C hardware peripheral.
+ * \param[in] context not used
+ */
+static void aes132_wire_enable_interface(void *context)
 {
+	(void) context;
 	i2c_enable_phys();
 }
 
 
-/** \brief This function disables the I2C hardware peripheral. */
-void aes132p_disable_interface(void)
+/** \brief This function disables the I2C hardware peripheral.
+ * \param[in] context not used
+ */
+static void aes132_wire_disable_interface(void *context)
 {
+	(void) context;
 	i2c_disable_phys();
 }
 
 
 /** \brief This function selects a I2C AES132 device.
  *
+ * @param[in] context not used
  * @param[in] device_id I2C address
  * @return always success
  */
-uint8_t aes132p_select_device(uint8_t device_id)
+static uint8_t aes132_wire_select_device(void *context, uint8_t device_id)
 {
+	(void) context;
 	return i2c_select_device_phys(device_id);
 }
 
 
-/** \brief This function writes bytes to the device.
- * \param[in] count number of bytes to write
+/** \brief This function writes several buffers to the device in one transfer.
+ *
+ * Each segment goes straight from the caller's buffer into the Wire transmit buffer.
+ * \param[in] context not used
  * \param[in] word_address word address to write to
- * \param[in] data pointer to tx buffer
+ * \param[in] segments buffers to write, in order
+ * \param[in] n_segments number of segments (at most #AES132_SEGMENT_COUNT_MAX)
  * \return status of the operation
  */
-uint8_t aes132p_write_memory_physical(uint8_t count, uint16_t word_address, uint8_t *data)
+static uint8_t aes132_wire_write_memory_segments(void *context, uint16_t word_address,
+			const struct aes132_segment *segments, uint8_t n_segments)
 {
+	(void) context;
+	if (n_segments > AES132_SEGMENT_COUNT_MAX)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
 	Wire.beginTransmission(i2c_address_current >> 1);
 	Wire.write((uint8_t) (word_address >> 8)); // MSB
 	Wire.write((uint8_t) (word_address & 0xFF)); // LSB
 
-	for (uint8_t i = 0; i < count; i++) {
-		Wire.write(data[i]);
+	for (uint8_t i = 0; i < n_segments; i++) {
+		if (segments[i].count > 0)
+			Wire.write(segments[i].data, segments[i].count);
 	}
 
 	uint8_t status = Wire.endTransmission();
@@ -85,23 +101,17 @@ uint8_t aes132p_write_memory_physical(uint8_t count, uint16_t word_address, uint
 
 
 /** \brief This function reads bytes from the device.
+ * \param[in] context not used
  * \param[in] size number of bytes to read
  * \param[in] word_address word address to read from
  * \param[out] data pointer to rx buffer
  * \return status of the operation
  */
-uint8_t aes132p_read_memory_physical(uint8_t size, uint16_t word_address, uint8_t *data)
+static uint8_t aes132_wire_read_memory(void *context, uint8_t size, uint16_t word_address, uint8_t *data)
 {
-	// #region agent log
-	Serial.print("[DEBUG] read_memory_physical: size=");
-	Serial.print(size);
-	Serial.print(", word_addr=0x");
-	Serial.print(word_address, HEX);
-	Serial.print(", i2c_addr=0x");
-	Serial.println(i2c_address_current, HEX);
-	Serial.flush(); // Ensure log is sent immediately
-	// #endregion
-	
+	(void) context;
+
+	// Reads are traced without blocking (AES132_TRACE_BUS in aes132_trace.h).
 	Wire.beginTransmission(i2c_address_current >> 1);
 	Wire.write((uint8_t) (word_address >> 8)); // MSB
 	Wire.write((uint8_t) (word_address & 0xFF)); // LSB
@@ -165,14 +175,17 @@ uint8_t aes132p_read_memory_physical(uint8_t size, uint16_t word_address, uint8_
 
 
 /** \brief This function resynchronizes communication.
+ * \param[in] context not used
  * \return status of the operation
  */
-uint8_t aes132p_resync_physical(void)
+static uint8_t aes132_wire_resync(void *context)
 {
 	uint8_t nine_clocks = 0xFF;
 	uint8_t n_retries = 2;
 	uint8_t aes132_lib_return;
 
+	(void) context;
+
 	do {
 		aes132_lib_return = i2c_send_start();
 		if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) {
@@ -193,3 +206,27 @@ uint8_t aes132p_resync_physical(void)
 
 	return i2c_send_stop();
 }
+
+
+/** \brief This function sets the I2C clock.
+ * \param[in] context not used
+ * \param[in] clock_hz I2C clock in Hz
+ * \return status of the operation
+ */
+static uint8_t aes132_wire_set_clock(void *context, uint32_t clock_hz)
+{
+	(void) context;
+	return i2c_set_clock_phys(clock_hz);
+}
+
+
+extern "C" const struct aes132_transport aes132_wire_transport = {
+	aes132_wire_enable_interface,
+	aes132_wire_disable_interface,
+	aes132_wire_select_device,
+	aes132_wire_read_memory,
+	aes132_wire_write_memory_segments,
+	aes132_wire_resync,
+	aes132_wire_set_clock,
+	(void *) 0
+};
@@ -0,0 +1,478 @@
+/** \file
+ *  \brief  I2C transport on the ESP-IDF I2C master driver.
+ *
+ * See aes132_i2c_master.h for how the transactions are made.
+ */
+
+#include <stdint.h>
+
+#include "aes132_device.h"
+#include "aes132_i2c.h"
+#include "aes132_i2c_master.h"
+
+#if AES132_I2C_MASTER
+
+#if defined(ESP_PLATFORM)
+#   include "esp_idf_version.h"
+#   include "esp_log.h"
+#   if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+#      define AES132_I2C_MASTER_LEGACY  (0)
+#   else
+#      define AES132_I2C_MASTER_LEGACY  (1)
+#   endif
+#else
+// Host builds compile the i2c_master code against tools/aes132_i2c_master_host.
+#   define AES132_I2C_MASTER_LEGACY     (0)
+#endif
+
+#if AES132_I2C_MASTER_LEGACY
+#   include "freertos/FreeRTOS.h"
+#   include "driver/i2c.h"
+#else
+#   include "driver/i2c_master.h"
+#endif
+
+//! SDA pin, set by aes132_i2c_master_set_pins()
+static int aes132_i2c_master_sda = 21;
+
+//! SCL pin, set by aes132_i2c_master_set_pins()
+static int aes132_i2c_master_scl = 22;
+
+//! device id (I2C address) of the selected device
+static uint8_t aes132_i2c_master_device_id;
+
+//! I2C clock in Hz, set by aes132_i2c_master_set_clock()
+static uint32_t aes132_i2c_master_clock_hz = AES132_I2C_MASTER_CLOCK_HZ;
+
+
+/** \brief This function sets the pins the driver is installed on.
+ *
+ * Call it before aes132p_enable_interface().
+ * \param[in] sda SDA pin number
+ * \param[in] scl SCL pin number
+ */
+void aes132_i2c_master_set_pins(int sda, int scl)
+{
+	aes132_i2c_master_sda = sda;
+	aes132_i2c_master_scl = scl;
+}
+
+
+/** \brief This function translates a return code of the driver.
+ *
+ * The driver reports a nack as an error. The library takes #AES132_FUNCTION_RETCODE_COMM_FAIL
+ * for a nack, e.g. while the device executes a command.
+ * \param[in] err return code of the driver
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_return(esp_err_t err)
+{
+	if (err == ESP_OK)
+		return AES132_FUNCTION_RETCODE_SUCCESS;
+	if (err == ESP_ERR_INVALID_ARG)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+	return AES132_FUNCTION_RETCODE_COMM_FAIL;
+}
+
+
+/** \brief This function selects a I2C AES132 device.
+ * \param[in] context not used
+ * \param[in] device_id I2C address
+ * \return always success
+ */
+static uint8_t aes132_i2c_master_select_device(void *context, uint8_t device_id)
+{
+	(void) context;
+	aes132_i2c_master_device_id = device_id & ~1;
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+#if !AES132_I2C_MASTER_LEGACY
+
+//! bus handle, NULL while the interface is disabled
+static i2c_master_bus_handle_t aes132_i2c_master_bus;
+
+//! device handles per device id, added when a device is first accessed
+static struct {
+	uint8_t device_id;
+	uint32_t clock_hz;          //!< clock the handle has been added with
+	i2c_master_dev_handle_t handle;
+} aes132_i2c_master_devices[AES132_DEVICE_COUNT_MAX];
+
+//! number of device handles added
+static uint8_t aes132_i2c_master_device_count;
+
+
+/** \brief This function installs the driver.
+ *
+ * Transactions are not queued: the calling task blocks while the interrupt handler
+ * of the driver runs a transaction.
+ * \param[in] context not used
+ */
+static void aes132_i2c_master_enable_interface(void *context)
+{
+	i2c_master_bus_config_t config = {
+		.i2c_port = AES132_I2C_MASTER_PORT,
+		.sda_io_num = aes132_i2c_master_sda,
+		.scl_io_num = aes132_i2c_master_scl,
+		.clk_source = I2C_CLK_SRC_DEFAULT,
+		.glitch_ignore_cnt = 7,
+		.trans_queue_depth = 0,
+		.flags.enable_internal_pullup = 1,
+	};
+
+	(void) context;
+	if (aes132_i2c_master_bus)
+		return;
+
+#if defined(ESP_PLATFORM)
+	// The device nacks while it executes a command. Do not log every nack.
+	esp_log_level_set("i2c.master", ESP_LOG_NONE);
+#endif
+	if (i2c_new_master_bus(&config, &aes132_i2c_master_bus) != ESP_OK)
+		aes132_i2c_master_bus = NULL;
+}
+
+
+/** \brief This function removes the devices and uninstalls the driver.
+ * \param[in] context not used
+ */
+static void aes132_i2c_master_disable_interface(void *context)
+{
+	(void) context;
+	if (!aes132_i2c_master_bus)
+		return;
+
+	while (aes132_i2c_master_device_count > 0)
+		(void) i2c_master_bus_rm_device(aes132_i2c_master_devices[--aes132_i2c_master_device_count].handle);
+	(void) i2c_del_master_bus(aes132_i2c_master_bus);
+	aes132_i2c_master_bus = NULL;
+}
+
+
+/** \brief This function returns the device handle of the selected device.
+ *
+ * The handle is added to the bus the first time the device is accessed, and again when
+ * the clock has changed since, because the driver takes the clock of a device when it is added.
+ * \return device handle, or NULL if the interface is disabled or no handle can be added
+ */
+static i2c_master_dev_handle_t aes132_i2c_master_get_device(void)
+{
+	i2c_device_config_t config = {
+		.dev_addr_length = I2C_ADDR_BIT_LEN_7,
+		.device_address = aes132_i2c_master_device_id >> 1,
+		.scl_speed_hz = aes132_i2c_master_clock_hz,
+	};
+	uint8_t i;
+
+	for (i = 0; i < aes132_i2c_master_device_count; i++) {
+		if (aes132_i2c_master_devices[i].device_id != aes132_i2c_master_device_id)
+			continue;
+		if (aes132_i2c_master_devices[i].clock_hz == aes132_i2c_master_clock_hz)
+			return aes132_i2c_master_devices[i].handle;
+
+		(void) i2c_master_bus_rm_device(aes132_i2c_master_devices[i].handle);
+		aes132_i2c_master_devices[i] = aes132_i2c_master_devices[--aes132_i2c_master_device_count];
+		break;
+	}
+
+	if (!aes132_i2c_master_bus || (aes132_i2c_master_device_count == AES132_DEVICE_COUNT_MAX))
+		return NULL;
+
+	i = aes132_i2c_master_device_count;
+	if (i2c_master_bus_add_device(aes132_i2c_master_bus, &config, &aes132_i2c_master_devices[i].handle) != ESP_OK)
+		return NULL;
+	aes132_i2c_master_devices[i].device_id = aes132_i2c_master_device_id;
+	aes132_i2c_master_devices[i].clock_hz = aes132_i2c_master_clock_hz;
+	aes132_i2c_master_device_count++;
+
+	return aes132_i2c_master_devices[i].handle;
+}
+
+
+/** \brief This function reads bytes from the device in one transaction.
+ * \param[in] context not used
+ * \param[in] size number of bytes to read
+ * \param[in] word_address word address to read from
+ * \param[out] data pointer to rx buffer
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_read_memory(void *context, uint8_t size, uint16_t word_address, uint8_t *data)
+{
+	uint8_t word_address_buffer[2] = {(uint8_t) (word_address >> 8), (uint8_t) (word_address & 0xFF)};
+	i2c_master_dev_handle_t device = aes132_i2c_master_get_device();
+
+	(void) context;
+	if (!device)
+		return AES132_FUNCTION_RETCODE_COMM_FAIL;
+
+	return aes132_i2c_master_return(i2c_master_transmit_receive(device, word_address_buffer,
+				sizeof(word_address_buffer), data, size, AES132_I2C_MASTER_TIMEOUT_MS));
+}
+
+
+/** \brief This function writes several buffers to the device in one transaction.
+ * \param[in] context not used
+ * \param[in] word_address word address to write to
+ * \param[in] segments buffers to write, in order
+ * \param[in] n_segments number of segments (at most #AES132_SEGMENT_COUNT_MAX)
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_write_memory_segments(void *context, uint16_t word_address,
+			const struct aes132_segment *segments, uint8_t n_segments)
+{
+	uint8_t word_address_buffer[2] = {(uint8_t) (word_address >> 8), (uint8_t) (word_address & 0xFF)};
+	i2c_master_transmit_multi_buffer_info_t buffers[1 + AES132_SEGMENT_COUNT_MAX];
+	i2c_master_dev_handle_t device = aes132_i2c_master_get_device();
+	uint8_t i;
+
+	(void) context;
+	if (n_segments > AES132_SEGMENT_COUNT_MAX)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+	if (!device)
+		return AES132_FUNCTION_RETCODE_COMM_FAIL;
+
+	buffers[0].write_buffer = word_address_buffer;
+	buffers[0].buffer_size = sizeof(word_address_buffer);
+	for (i = 0; i < n_segments; i++) {
+		// The driver does not write to the buffers.
+		buffers[1 + i].write_buffer = (uint8_t *) segments[i].data;
+		buffers[1 + i].buffer_size = segments[i].count;
+	}
+
+	return aes132_i2c_master_return(i2c_master_multi_buffer_transmit(device, buffers, 1 + n_segments,
+				AES132_I2C_MASTER_TIMEOUT_MS));
+}
+
+
+/** \brief This function resynchronizes communication.
+ *
+ * The driver clocks SCL until a device that holds SDA releases it.
+ * \param[in] context not used
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_resync(void *context)
+{
+	(void) context;
+	if (!aes132_i2c_master_bus)
+		return AES132_FUNCTION_RETCODE_COMM_FAIL;
+
+	return aes132_i2c_master_return(i2c_master_bus_reset(aes132_i2c_master_bus));
+}
+
+
+/** \brief This function sets the I2C clock.
+ *
+ * A device takes it with its next transaction (see aes132_i2c_master_get_device()).
+ * \param[in] context not used
+ * \param[in] clock_hz I2C clock in Hz
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_set_clock(void *context, uint32_t clock_hz)
+{
+	(void) context;
+	if (clock_hz == 0)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	aes132_i2c_master_clock_hz = clock_hz;
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+#else
+
+//! size of a command link with up to 12 commands; a write with six segments has 10
+#define AES132_I2C_MASTER_LINK_SIZE     I2C_LINK_RECOMMENDED_SIZE(2)
+
+//! non-zero while the driver is installed
+static uint8_t aes132_i2c_master_is_installed;
+
+
+/** \brief This function configures the port, with the current clock.
+ *
+ * It also clocks SCL until a device that holds SDA releases it.
+ * \return return code of the driver
+ */
+static esp_err_t aes132_i2c_master_configure(void)
+{
+	i2c_config_t config = {
+		.mode = I2C_MODE_MASTER,
+		.sda_io_num = aes132_i2c_master_sda,
+		.scl_io_num = aes132_i2c_master_scl,
+		.sda_pullup_en = GPIO_PULLUP_ENABLE,
+		.scl_pullup_en = GPIO_PULLUP_ENABLE,
+		.master.clk_speed = aes132_i2c_master_clock_hz,
+	};
+
+	return i2c_param_config(AES132_I2C_MASTER_PORT, &config);
+}
+
+
+/** \brief This function installs the driver.
+ * \param[in] context not used
+ */
+static void aes132_i2c_master_enable_interface(void *context)
+{
+	(void) context;
+	if (aes132_i2c_master_is_installed)
+		return;
+
+	if ((aes132_i2c_master_configure() == ESP_OK)
+				&& (i2c_driver_install(AES132_I2C_MASTER_PORT, I2C_MODE_MASTER, 0, 0, 0) == ESP_OK))
+		aes132_i2c_master_is_installed = 1;
+}
+
+
+/** \brief This function uninstalls the driver.
+ * \param[in] context not used
+ */
+static void aes132_i2c_master_disable_interface(void *context)
+{
+	(void) context;
+	if (!aes132_i2c_master_is_installed)
+		return;
+
+	(void) i2c_driver_delete(AES132_I2C_MASTER_PORT);
+	aes132_i2c_master_is_installed = 0;
+}
+
+
+/** \brief This function runs a command link and deletes it.
+ * \param[in] link command link
+ * \param[in] err first error while building the command link
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_run(i2c_cmd_handle_t link, esp_err_t err)
+{
+	if ((err == ESP_OK) && !aes132_i2c_master_is_installed)
+		err = ESP_FAIL;
+	if (err == ESP_OK)
+		err = i2c_master_cmd_begin(AES132_I2C_MASTER_PORT, link, pdMS_TO_TICKS(AES132_I2C_MASTER_TIMEOUT_MS));
+	i2c_cmd_link_delete_static(link);
+
+	return aes132_i2c_master_return(err);
+}
+
+
+/** \brief This function reads bytes from the device in one transaction.
+ * \param[in] context not used
+ * \param[in] size number of bytes to read
+ * \param[in] word_address word address to read from
+ * \param[out] data pointer to rx buffer
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_read_memory(void *context, uint8_t size, uint16_t word_address, uint8_t *data)
+{
+	uint8_t word_address_buffer[2] = {(uint8_t) (word_address >> 8), (uint8_t) (word_address & 0xFF)};
+	uint8_t link_buffer[AES132_I2C_MASTER_LINK_SIZE];
+	i2c_cmd_handle_t link;
+	esp_err_t err;
+
+	(void) context;
+	if (size == 0)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	link = i2c_cmd_link_create_static(link_buffer, sizeof(link_buffer));
+	err = i2c_master_start(link);
+	if (err == ESP_OK)
+		err = i2c_master_write_byte(link, aes132_i2c_master_device_id | I2C_MASTER_WRITE, true);
+	if (err == ESP_OK)
+		err = i2c_master_write(link, word_address_buffer, sizeof(word_address_buffer), true);
+	if (err == ESP_OK)
+		err = i2c_master_start(link);
+	if (err == ESP_OK)
+		err = i2c_master_write_byte(link, aes132_i2c_master_device_id | I2C_MASTER_READ, true);
+	if (err == ESP_OK)
+		err = i2c_master_read(link, data, size, I2C_MASTER_LAST_NACK);
+	if (err == ESP_OK)
+		err = i2c_master_stop(link);
+
+	return aes132_i2c_master_run(link, err);
+}
+
+
+/** \brief This function writes several buffers to the device in one transaction.
+ * \param[in] context not used
+ * \param[in] word_address word address to write to
+ * \param[in] segments buffers to write, in order
+ * \param[in] n_segments number of segments (at most #AES132_SEGMENT_COUNT_MAX)
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_write_memory_segments(void *context, uint16_t word_address,
+			const struct aes132_segment *segments, uint8_t n_segments)
+{
+	uint8_t word_address_buffer[2] = {(uint8_t) (word_address >> 8), (uint8_t) (word_address & 0xFF)};
+	uint8_t link_buffer[AES132_I2C_MASTER_LINK_SIZE];
+	i2c_cmd_handle_t link;
+	esp_err_t err;
+	uint8_t i;
+
+	(void) context;
+	if (n_segments > AES132_SEGMENT_COUNT_MAX)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	link = i2c_cmd_link_create_static(link_buffer, sizeof(link_buffer));
+	err = i2c_master_start(link);
+	if (err == ESP_OK)
+		err = i2c_master_write_byte(link, aes132_i2c_master_device_id | I2C_MASTER_WRITE, true);
+	if (err == ESP_OK)
+		err = i2c_master_write(link, word_address_buffer, sizeof(word_address_buffer), true);
+	for (i = 0; (i < n_segments) && (err == ESP_OK); i++) {
+		if (segments[i].count > 0)
+			err = i2c_master_write(link, segments[i].data, segments[i].count, true);
+	}
+	if (err == ESP_OK)
+		err = i2c_master_stop(link);
+
+	return aes132_i2c_master_run(link, err);
+}
+
+
+/** \brief This function resynchronizes communication.
+ *
+ * Installing the driver again clocks SCL until a device that holds SDA releases it.
+ * \param[in] context not used
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_resync(void *context)
+{
+	aes132_i2c_master_disable_interface(context);
+	aes132_i2c_master_enable_interface(context);
+
+	return aes132_i2c_master_is_installed ? AES132_FUNCTION_RETCODE_SUCCESS : AES132_FUNCTION_RETCODE_COMM_FAIL;
+}
+
+
+/** \brief This function sets the I2C clock, at once if the driver is installed.
+ * \param[in] context not used
+ * \param[in] clock_hz I2C clock in Hz
+ * \return status of the operation
+ */
+static uint8_t aes132_i2c_master_set_clock(void *context, uint32_t clock_hz)
+{
+	(void) context;
+	if (clock_hz == 0)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	aes132_i2c_master_clock_hz = clock_hz;
+	if (!aes132_i2c_master_is_installed)
+		return AES132_FUNCTION_RETCODE_SUCCESS;
+
+	return aes132_i2c_master_return(aes132_i2c_master_configure());
+}
+
+#endif
+
+
+const struct aes132_transport aes132_i2c_master_transport = {
+	aes132_i2c_master_enable_interface,
+	aes132_i2c_master_disable_interface,
+	aes132_i2c_master_select_device,
+	aes132_i2c_master_read_memory,
+	aes132_i2c_master_write_memory_segments,
+	aes132_i2c_master_resync,
+	aes132_i2c_master_set_clock,
+	(void *) 0
+};
+
+#endif
@@ -0,0 +1,75 @@
+/** \file
+ *  \brief  Definitions and prototypes for the I2C transport on the ESP-IDF I2C master driver.
+ *
+ * aes132_i2c_master_transport reaches the device through the I2C master driver of ESP-IDF
+ * instead of the Arduino Wire library. A read is one transaction that the driver runs from
+ * its interrupt handler: I2C address, word address, repeated Start, I2C address and the
+ * data, received straight into the buffer of the caller. A write hands the word address and
+ * the segments of the command to the driver as they are, also as one transaction. The
+ * calling task blocks on the driver while the transaction runs.
+ *
+ * ESP-IDF 5.3 and later use the i2c_master driver (driver/i2c_master.h). Older versions,
+ * e.g. the one of Arduino-ESP32 2.x, use a command link of the legacy driver (driver/i2c.h).
+ * Host builds compile the i2c_master code against a stand-in of the driver
+ * (tools/aes132_i2c_master_host), which reaches a fake device.
+ *
+ * The transport installs the driver on #AES132_I2C_MASTER_PORT in
+ * aes132p_enable_interface(). Do not use the Wire library on the same port.
+ */
+
+#ifndef AES132_I2C_MASTER_H
+#   define AES132_I2C_MASTER_H
+
+#include <stdint.h>
+
+#include "aes132_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief non-zero to build aes132_i2c_master_transport
+ *
+ * It also becomes #AES132_TRANSPORT_DEFAULT.
+ * Override with a build flag, e.g. -DAES132_I2C_MASTER=1.
+ */
+#ifndef AES132_I2C_MASTER
+#   define AES132_I2C_MASTER            (0)
+#endif
+
+/** \brief I2C port the driver is installed on
+ *
+ * Override with a build flag, e.g. -DAES132_I2C_MASTER_PORT=1.
+ */
+#ifndef AES132_I2C_MASTER_PORT
+#   define AES132_I2C_MASTER_PORT       (0)
+#endif
+
+/** \brief I2C clock in Hz until it is set through aes132p_set_clock(), e.g. by the clock manager (aes132_clock.h)
+ *
+ * Override with a build flag, e.g. -DAES132_I2C_MASTER_CLOCK_HZ=1000000.
+ */
+#ifndef AES132_I2C_MASTER_CLOCK_HZ
+#   define AES132_I2C_MASTER_CLOCK_HZ   (400000)
+#endif
+
+/** \brief time after which a transaction is abandoned, in ms
+ *
+ * Override with a build flag, e.g. -DAES132_I2C_MASTER_TIMEOUT_MS=50.
+ */
+#ifndef AES132_I2C_MASTER_TIMEOUT_MS
+#   define AES132_I2C_MASTER_TIMEOUT_MS (20)
+#endif
+
+#if AES132_I2C_MASTER
+//! transport over the ESP-IDF I2C master driver (aes132_i2c_master.c)
+extern const struct aes132_transport aes132_i2c_master_transport;
+
+void    aes132_i2c_master_set_pins(int sda, int scl);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+/** \file
+ *  \brief  Op-code descriptor table of the AES132 library.
+ *
+ * See aes132_opcode.h for how the table is used.
+ */
+
+#include <stdint.h>
+
+#include "aes132_comm_marshaling.h"
+#include "aes132_opcode.h"
+
+//! size of an AES block, the unit of Encrypt and EncRead ciphertext
+#define AES132_OPCODE_BLOCK_SIZE    ((uint8_t) 16)
+
+/** \brief response size and execution time rules, indexed by op-code
+ *
+ * Typical times are set at or below the typical execution times so that the first poll
+ * rarely comes late; maximum times leave slack above the worst case. Where unsure whether a
+ * command changes state, it is flagged as if it did.
+ * Columns: response data size, response mode mask, flags,
+ * {typical us, max ms}, time mode mask, {typical us, max ms} in those modes
+ */
+static const struct aes132_opcode_descriptor aes132c_opcode_table[AES132_OPCODE_COUNT] = {
+	[AES132_RESET]         = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_NO_RESPONSE, {    0,   0}},
+	[AES132_NONCE]         = {12, 0x01, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION, {  300,   5}, 0x01, {1000, 10}},  // RandOut and RNG in random mode
+	[AES132_RANDOM]        = {16, 0x00, AES132_OPCODE_FLAG_DEFINED, { 1000,  10}},
+	[AES132_AUTH]          = {16, 0x02, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION, { 1000,  10}},  // OutMAC for outbound authentication
+	[AES132_ENC_READ]      = {16, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_ADD_PARAM2_BLOCKS | AES132_OPCODE_FLAG_SESSION, { 1000,  10}},
+	[AES132_ENC_WRITE]     = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION | AES132_OPCODE_FLAG_WRITE, { 3000,  20}},  // EEPROM write
+	[AES132_ENCRYPT]       = {16, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_ADD_PARAM2_BLOCKS | AES132_OPCODE_FLAG_SESSION, { 1000,  10}},
+	[AES132_DECRYPT]       = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_ADD_PARAM2 | AES132_OPCODE_FLAG_SESSION, { 1000,  10}},
+	[AES132_KEY_CREATE]    = {32, 0x01, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION | AES132_OPCODE_FLAG_WRITE, { 3000,  20}},  // OutMAC and encrypted key; EEPROM write
+	[AES132_KEY_LOAD]      = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION | AES132_OPCODE_FLAG_WRITE, { 3000,  20}},  // EEPROM write
+	[AES132_COUNTER]       = {20, 0x01, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION | AES132_OPCODE_FLAG_WRITE | AES132_OPCODE_FLAG_WRITE_NOT_IN_MODE, { 3000,  20}, 0x01, {1000, 10}},  // read mode: CountValue and OutMAC, no EEPROM write
+	[AES132_CRUNCH]        = {16, 0x00, AES132_OPCODE_FLAG_DEFINED, {  500, 145}},  // grows with the iteration count in Param1
+	[AES132_INFO]          = { 2, 0x00, AES132_OPCODE_FLAG_DEFINED, {  100,   2}},
+	[AES132_LOCK]          = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION | AES132_OPCODE_FLAG_WRITE, { 3000,  20}},  // EEPROM write
+	[AES132_TEMP_SENSE]    = { 2, 0x00, AES132_OPCODE_FLAG_DEFINED, {20000, 145}},
+	[AES132_LEGACY]        = {16, 0x00, AES132_OPCODE_FLAG_DEFINED, {  500,   5}},
+	[AES132_BLOCK_READ]    = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_ADD_PARAM2, {  100,   2}},
+	[AES132_SLEEP]         = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_NO_RESPONSE, {    0,   0}},
+	[AES132_NONCE_COMPUTE] = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION, {  500,   5}},
+	[AES132_AUTH_COMPUTE]  = {16, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION, { 1000,  10}},
+	[AES132_AUTH_CHECK]    = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION, { 1000,  10}},
+	[AES132_KEY_IMPORT]    = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_SESSION | AES132_OPCODE_FLAG_WRITE, { 3000,  20}},  // EEPROM write
+	[AES132_KEY_TRANSFER]  = { 0, 0x00, AES132_OPCODE_FLAG_DEFINED | AES132_OPCODE_FLAG_WRITE, { 3000,  20}},  // EEPROM write
+};
+
+
+/** \brief This function returns the descriptor of an op-code.
+ * \param[in] op_code command op-code
+ * \return pointer to descriptor, or NULL if the op-code is unknown
+ */
+const struct aes132_opcode_descriptor *aes132c_get_opcode_descriptor(uint8_t op_code)
+{
+	if (op_code >= AES132_OPCODE_COUNT)
+		return (const struct aes132_opcode_descriptor *) 0;
+
+	if ((aes132c_opcode_table[op_code].flags & AES132_OPCODE_FLAG_DEFINED) == 0)
+		return (const struct aes132_opcode_descriptor *) 0;
+
+	return &aes132c_opcode_table[op_code];
+}
+
+
+/** \brief This function calculates the size of a successful response to a command.
+ *
+ * An error response is always #AES132_RESPONSE_SIZE_MIN bytes long, so it is never longer
+ * than the size returned here.
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \param[in] param2 second parameter
+ * \return response size including count byte, return code and CRC,
+ *         or 0 if it is not known (unknown op-code, no response, or size out of range)
+ */
+uint8_t aes132c_get_response_size(uint8_t op_code, uint8_t mode, uint16_t param2)
+{
+	const struct aes132_opcode_descriptor *descriptor = aes132c_get_opcode_descriptor(op_code);
+	uint32_t size = AES132_RESPONSE_SIZE_MIN;
+
+	if (!descriptor || (descriptor->flags & AES132_OPCODE_FLAG_NO_RESPONSE))
+		return 0;
+
+	if ((descriptor->mode_mask == 0) || (mode & descriptor->mode_mask))
+		size += descriptor->response_data_size;
+
+	if (descriptor->flags & AES132_OPCODE_FLAG_ADD_PARAM2)
+		size += param2;
+	else if (descriptor->flags & AES132_OPCODE_FLAG_ADD_PARAM2_BLOCKS)
+		size += (param2 + AES132_OPCODE_BLOCK_SIZE - 1) / AES132_OPCODE_BLOCK_SIZE * AES132_OPCODE_BLOCK_SIZE;
+
+	if (size > AES132_RESPONSE_SIZE_MAX)
+		return 0;
+
+	return (uint8_t) size;
+}
+
+
+/** \brief This function returns the execution time of a command.
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \return typical and maximum execution time; for unknown op-codes, no typical time
+ *         and #AES132_EXECUTION_TIME_MAX_DEFAULT
+ */
+struct aes132_execution_time aes132c_get_execution_time(uint8_t op_code, uint8_t mode)
+{
+	const struct aes132_opcode_descriptor *descriptor = aes132c_get_opcode_descriptor(op_code);
+	struct aes132_execution_time unknown = {0, AES132_EXECUTION_TIME_MAX_DEFAULT};
+
+	if (!descriptor)
+		return unknown;
+
+	if (mode & descriptor->time_mode_mask)
+		return descriptor->time_mode;
+
+	return descriptor->time;
+}
+
+
+/** \brief This function returns what running a command twice does.
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \return command class (#aes132_command_class); #AES132_COMMAND_CLASS_NOT_IDEMPOTENT for unknown op-codes
+ */
+uint8_t aes132c_get_command_class(uint8_t op_code, uint8_t mode)
+{
+	const struct aes132_opcode_descriptor *descriptor = aes132c_get_opcode_descriptor(op_code);
+
+	if (!descriptor)
+		return AES132_COMMAND_CLASS_NOT_IDEMPOTENT;
+
+	if ((descriptor->flags & AES132_OPCODE_FLAG_WRITE)
+				&& !((descriptor->flags & AES132_OPCODE_FLAG_WRITE_NOT_IN_MODE) && (mode & descriptor->mode_mask)))
+		return AES132_COMMAND_CLASS_NOT_IDEMPOTENT;
+
+	if (descriptor->flags & AES132_OPCODE_FLAG_SESSION)
+		return AES132_COMMAND_CLASS_STATE_MUTATING;
+
+	return AES132_COMMAND_CLASS_IDEMPOTENT;
+}
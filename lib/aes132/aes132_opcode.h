@@ -0,0 +1,101 @@
+/** \file
+ *  \brief  Definitions and prototypes for the op-code descriptor table of the AES132 library.
+ *
+ * For most commands the size of a successful response follows from op-code, mode and
+ * Param2 alone, e.g. 36 bytes for Encrypt of one block, 20 for Random and 6 for Info.
+ * The table in aes132_opcode.c describes these rules per op-code, so that
+ * aes132c_receive_command_response() can read the whole response in one bus transaction
+ * instead of reading the count byte first. Sizes follow the command descriptions in the
+ * ATAES132A datasheet and match the constants in aes132_commands.h.
+ *
+ * The table also holds the execution time of every command. After sending a command,
+ * the communication layer sleeps for the typical time before it polls the device status
+ * register for the first time, and stops polling after the maximum time. Commands that write
+ * EEPROM (EncWrite, KeyCreate, KeyLoad, Lock, Counter increment) take much longer than
+ * those that only read or use the AES engine (Info, BlockRead, Encrypt).
+ *
+ * Finally, the table tells what running a command twice does (see aes132c_get_command_class()).
+ * Reading commands like Info, BlockRead and TempSense can simply be sent again after a lost
+ * response. Commands that write EEPROM or a counter (Counter increment, EncWrite, KeyLoad)
+ * would repeat the write, and commands that use or replace the nonce and the MAC count (Nonce,
+ * Auth, Encrypt) would leave the session in a different state. For these, the communication
+ * layer first checks whether the device has received the command before it sends it again.
+ */
+
+#ifndef AES132_OPCODE_H
+#   define AES132_OPCODE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! number of entries in the descriptor table (highest op-code is KeyTransfer, 0x1A)
+#define AES132_OPCODE_COUNT                     ((uint8_t) 0x1B)
+
+//! op-code value for a response to a command that is not known
+#define AES132_OPCODE_UNKNOWN                   ((uint8_t) 0xFF)
+
+//! The entry describes an op-code. Entries without this flag are gaps in the op-code range.
+#define AES132_OPCODE_FLAG_DEFINED              ((uint8_t) 0x01)
+
+//! The response data grows by Param2 bytes (BlockRead, Decrypt).
+#define AES132_OPCODE_FLAG_ADD_PARAM2           ((uint8_t) 0x02)
+
+//! The response data grows by Param2 bytes rounded up to whole AES blocks (Encrypt, EncRead).
+#define AES132_OPCODE_FLAG_ADD_PARAM2_BLOCKS    ((uint8_t) 0x04)
+
+//! The command has no response (Reset, Sleep).
+#define AES132_OPCODE_FLAG_NO_RESPONSE          ((uint8_t) 0x08)
+
+//! The command uses or replaces the nonce and the MAC count (Nonce, Auth, and commands with a MAC).
+#define AES132_OPCODE_FLAG_SESSION              ((uint8_t) 0x10)
+
+//! The command writes EEPROM or a counter (EncWrite, KeyLoad, Lock, Counter increment).
+#define AES132_OPCODE_FLAG_WRITE                ((uint8_t) 0x20)
+
+//! With #AES132_OPCODE_FLAG_WRITE, the modes selected by the mode mask do not write (Counter read).
+#define AES132_OPCODE_FLAG_WRITE_NOT_IN_MODE    ((uint8_t) 0x40)
+
+//! what running a command twice does
+enum aes132_command_class {
+	AES132_COMMAND_CLASS_IDEMPOTENT         = 0, //!< nothing: the command only reads or computes
+	AES132_COMMAND_CLASS_NOT_IDEMPOTENT     = 1, //!< repeats a write to EEPROM or a counter
+	AES132_COMMAND_CLASS_STATE_MUTATING     = 2  //!< changes the nonce and the MAC count again
+};
+
+//! maximum execution time in ms used for op-codes that are not in the table
+#define AES132_EXECUTION_TIME_MAX_DEFAULT       ((uint8_t) 145)
+
+//! execution time of a command
+struct aes132_execution_time {
+	uint16_t typical_us;          //!< typical execution time in us; the first poll happens after it
+	uint8_t max_ms;               //!< maximum execution time in ms; polling stops after it
+};
+
+/** \brief response size and execution time rules of a command
+ *
+ * The response carries response_data_size data bytes if (mode & mode_mask) != 0, or always if
+ * mode_mask is 0, plus the bytes added by the AES132_OPCODE_FLAG_ADD_* flags.
+ * The command takes time_mode if (mode & time_mode_mask) != 0, else time.
+ */
+struct aes132_opcode_descriptor {
+	uint8_t response_data_size;                 //!< number of fixed response data bytes
+	uint8_t mode_mask;                          //!< mode bits that enable the fixed response data, 0 for always
+	uint8_t flags;                              //!< AES132_OPCODE_FLAG_* values
+	struct aes132_execution_time time;          //!< execution time
+	uint8_t time_mode_mask;                     //!< mode bits that select time_mode, 0 for none
+	struct aes132_execution_time time_mode;     //!< execution time in the modes selected by time_mode_mask
+};
+
+const struct aes132_opcode_descriptor *aes132c_get_opcode_descriptor(uint8_t op_code);
+uint8_t aes132c_get_response_size(uint8_t op_code, uint8_t mode, uint16_t param2);
+struct aes132_execution_time aes132c_get_execution_time(uint8_t op_code, uint8_t mode);
+uint8_t aes132c_get_command_class(uint8_t op_code, uint8_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
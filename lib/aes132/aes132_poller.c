@@ -0,0 +1,166 @@
+/** \file
+ *  \brief  Adaptive poller of the AES132 library.
+ *
+ * See aes132_poller.h for how execution times are learned and polls are scheduled.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "aes132_device.h"
+#include "aes132_opcode.h"
+#include "aes132_poller.h"
+
+//! The average moves by 1/2^3 of the difference to a measurement.
+#define AES132_LATENCY_MEAN_SHIFT         (3)
+
+//! The deviation moves by 1/2^2 of the difference to a measured deviation.
+#define AES132_LATENCY_DEVIATION_SHIFT    (2)
+
+//! number of estimates per op-code: one for the default and one for the time_mode execution time
+#define AES132_LATENCY_VARIANT_COUNT      (2)
+
+//! learned execution times, indexed by device index, op-code, and execution time variant
+static struct aes132_latency_estimate
+		aes132c_latency_table[AES132_DEVICE_COUNT_MAX][AES132_OPCODE_COUNT][AES132_LATENCY_VARIANT_COUNT];
+
+
+/** \brief This function finds the estimate of a command.
+ * \param[in] device_index device index
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \return pointer to estimate, or NULL if the op-code or device index is unknown
+ */
+static struct aes132_latency_estimate *aes132c_find_latency_estimate(uint8_t device_index, uint8_t op_code, uint8_t mode)
+{
+	const struct aes132_opcode_descriptor *descriptor = aes132c_get_opcode_descriptor(op_code);
+
+	if (!descriptor || (device_index >= AES132_DEVICE_COUNT_MAX))
+		return (struct aes132_latency_estimate *) 0;
+
+	return &aes132c_latency_table[device_index][op_code][(mode & descriptor->time_mode_mask) ? 1 : 0];
+}
+
+
+/** \brief This function returns the time after which to poll for a response the first time.
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \return learned execution time on the selected device in us, or the typical
+ *         execution time if the command has not been measured yet
+ */
+uint32_t aes132c_predict_execution_time(uint8_t op_code, uint8_t mode)
+{
+	const struct aes132_latency_estimate *estimate =
+				aes132c_find_latency_estimate(aes132c_get_device_index(), op_code, mode);
+
+	if (!estimate || (estimate->n_samples == 0))
+		return aes132c_get_execution_time(op_code, mode).typical_us;
+
+	return estimate->mean_us;
+}
+
+
+/** \brief This function returns the interval between the first and the second poll.
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \return interval in us, between #AES132_POLL_INTERVAL_MIN_US and #AES132_POLL_INTERVAL_MAX_US
+ */
+uint32_t aes132c_get_poll_interval(uint8_t op_code, uint8_t mode)
+{
+	const struct aes132_latency_estimate *estimate =
+				aes132c_find_latency_estimate(aes132c_get_device_index(), op_code, mode);
+	uint32_t interval_us;
+
+	if (!estimate || (estimate->n_samples == 0))
+		interval_us = aes132c_get_execution_time(op_code, mode).typical_us / 4;
+	else
+		interval_us = estimate->deviation_us / 2;
+
+	if (interval_us < AES132_POLL_INTERVAL_MIN_US)
+		return AES132_POLL_INTERVAL_MIN_US;
+	if (interval_us > AES132_POLL_INTERVAL_MAX_US)
+		return AES132_POLL_INTERVAL_MAX_US;
+
+	return interval_us;
+}
+
+
+/** \brief This function backs off the interval between polls.
+ * \param[in] interval_us current interval in us
+ * \return doubled interval, at most #AES132_POLL_INTERVAL_MAX_US
+ */
+uint32_t aes132c_next_poll_interval(uint32_t interval_us)
+{
+	if (interval_us >= AES132_POLL_INTERVAL_MAX_US / 2)
+		return AES132_POLL_INTERVAL_MAX_US;
+
+	return interval_us * 2;
+}
+
+
+/** \brief This function adds a measured execution time to the estimate of the selected device.
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \param[in] sample_us measured time from sending the command until the response was found ready
+ * \param[in] is_upper_bound non-zero if the response was ready at the first poll,
+ *            so that the command may have taken less than sample_us
+ */
+void aes132c_update_latency_estimate(uint8_t op_code, uint8_t mode, uint32_t sample_us, uint8_t is_upper_bound)
+{
+	struct aes132_latency_estimate *estimate =
+				aes132c_find_latency_estimate(aes132c_get_device_index(), op_code, mode);
+	int32_t error_us;
+	uint32_t deviation_sample_us;
+
+	if (!estimate)
+		return;
+
+	if (estimate->n_samples == 0) {
+		estimate->mean_us = sample_us;
+		estimate->deviation_us = sample_us / 2;
+		estimate->n_samples = 1;
+		return;
+	}
+
+	if (is_upper_bound) {
+		// The first poll came after the estimated time plus sleep overshoot. Assume the command
+		// finished a little before the estimate, by half the deviation or 1/8 of the estimate.
+		uint32_t shift_us = estimate->deviation_us / 2;
+		if (shift_us < (estimate->mean_us >> AES132_LATENCY_MEAN_SHIFT))
+			shift_us = estimate->mean_us >> AES132_LATENCY_MEAN_SHIFT;
+		if (sample_us > estimate->mean_us)
+			sample_us = estimate->mean_us;
+		sample_us = (sample_us > shift_us) ? sample_us - shift_us : 0;
+	}
+
+	error_us = (int32_t) (sample_us - estimate->mean_us);
+	deviation_sample_us = (error_us < 0) ? (uint32_t) -error_us : (uint32_t) error_us;
+
+	// Shift signed values by dividing, which rounds toward 0 on every compiler.
+	estimate->mean_us += error_us / (1 << AES132_LATENCY_MEAN_SHIFT);
+	estimate->deviation_us += ((int32_t) (deviation_sample_us - estimate->deviation_us))
+				/ (1 << AES132_LATENCY_DEVIATION_SHIFT);
+
+	if (estimate->n_samples < UINT16_MAX)
+		estimate->n_samples++;
+}
+
+
+/** \brief This function returns the learned execution time of a command on a device.
+ * \param[in] device_index device index (see aes132c_get_device_index())
+ * \param[in] op_code command op-code
+ * \param[in] mode command mode
+ * \return pointer to estimate, or NULL if the op-code or device index is unknown
+ */
+const struct aes132_latency_estimate *aes132c_get_latency_estimate(uint8_t device_index, uint8_t op_code, uint8_t mode)
+{
+	return aes132c_find_latency_estimate(device_index, op_code, mode);
+}
+
+
+/** \brief This function forgets all learned execution times.
+ */
+void aes132c_reset_latency_estimates(void)
+{
+	memset(aes132c_latency_table, 0, sizeof(aes132c_latency_table));
+}
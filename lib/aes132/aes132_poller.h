@@ -0,0 +1,65 @@
+/** \file
+ *  \brief  Definitions and prototypes for the adaptive poller of the AES132 library.
+ *
+ * The execution time of a command differs between devices and drifts with temperature,
+ * so the fixed table in aes132_opcode.c is either too early (wasted polls) or too late
+ * (wasted time). With #AES132_ADAPTIVE_POLLING, the library learns the execution time of
+ * every op-code on every device (see aes132_device.h) instead:
+ *
+ * - The estimate is a moving average of the measured times and of their deviation from
+ *   it, updated like the round-trip time estimate of TCP (gains 1/8 and 1/4).
+ * - The first poll happens at the estimated time. While the response is not ready, the
+ *   interval between polls starts at half the deviation and doubles up to
+ *   #AES132_POLL_INTERVAL_MAX_US.
+ * - A response that is ready at the first poll only tells that the command took at most
+ *   the estimated time. The estimate is then moved a little below itself, so that it follows
+ *   a device that became faster, and settles just below the real execution time.
+ *
+ * Commands whose op-code and mode select a different entry in the execution time table,
+ * e.g. Counter read and increment, get separate estimates. Until an op-code has been
+ * measured, the typical time from the table is used.
+ */
+
+#ifndef AES132_POLLER_H
+#   define AES132_POLLER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief Set to 1 to schedule polls from learned execution times.
+ *
+ * Override with a build flag, e.g. -DAES132_ADAPTIVE_POLLING=1. When 0, the first poll
+ * happens after the typical execution time from the table, followed by polls back to back.
+ */
+#ifndef AES132_ADAPTIVE_POLLING
+#   define AES132_ADAPTIVE_POLLING      (0)
+#endif
+
+//! shortest interval between two polls in us
+#define AES132_POLL_INTERVAL_MIN_US     ((uint32_t) 100)
+
+//! longest interval between two polls in us
+#define AES132_POLL_INTERVAL_MAX_US     ((uint32_t) 5000)
+
+//! learned execution time of a command on one device
+struct aes132_latency_estimate {
+	uint32_t mean_us;             //!< moving average of the execution time in us
+	uint32_t deviation_us;        //!< moving average of the deviation from mean_us in us
+	uint16_t n_samples;           //!< number of measurements, stops counting at 0xFFFF
+};
+
+uint32_t aes132c_predict_execution_time(uint8_t op_code, uint8_t mode);
+uint32_t aes132c_get_poll_interval(uint8_t op_code, uint8_t mode);
+uint32_t aes132c_next_poll_interval(uint32_t interval_us);
+void     aes132c_update_latency_estimate(uint8_t op_code, uint8_t mode, uint32_t sample_us, uint8_t is_upper_bound);
+const struct aes132_latency_estimate *aes132c_get_latency_estimate(uint8_t device_index, uint8_t op_code, uint8_t mode);
+void     aes132c_reset_latency_estimates(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+/** \file
+ *  \brief  Power manager of the AES132 library.
+ *
+ * See aes132_power.h for when devices are put into Standby and Sleep mode.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "aes132_comm.h"
+#include "aes132_device.h"
+#include "aes132_power.h"
+#include "aes132_timer.h"
+
+#if (AES132_POWER_STANDBY_AFTER_MS > AES132_POWER_IDLE_MAX_MS) || (AES132_POWER_SLEEP_AFTER_MS > AES132_POWER_IDLE_MAX_MS)
+#   error AES132_POWER_STANDBY_AFTER_MS and AES132_POWER_SLEEP_AFTER_MS have to be at most AES132_POWER_IDLE_MAX_MS.
+#endif
+
+//! power state of a device
+struct aes132_power_state {
+	uint8_t power_mode;             //!< current power mode (#aes132_power_mode)
+	uint32_t last_activity_us;      //!< time of the last access by a command, from aes132c_now_us()
+};
+
+//! thresholds from the build options
+const struct aes132_power_policy aes132c_default_power_policy = {
+	AES132_POWER_STANDBY_AFTER_MS,
+	AES132_POWER_SLEEP_AFTER_MS
+};
+
+//! policies set with aes132c_set_power_policy(), indexed by device index; NULL for the default
+static const struct aes132_power_policy *aes132c_power_policies[AES132_DEVICE_COUNT_MAX];
+
+//! power states, indexed by device index
+static struct aes132_power_state aes132c_power_states[AES132_DEVICE_COUNT_MAX];
+
+//! measured wake cost and mode changes, indexed by device index
+static struct aes132_power_statistics aes132c_power_statistics[AES132_DEVICE_COUNT_MAX];
+
+
+/** \brief This function sets the power policy of the selected device.
+ * \param[in] policy policy to use, or NULL for the default policy; has to stay valid while in use
+ */
+void aes132c_set_power_policy(const struct aes132_power_policy *policy)
+{
+	aes132c_power_policies[aes132c_get_device_index()] = policy;
+}
+
+
+/** \brief This function returns the power policy in effect for the selected device.
+ * \return policy set with aes132c_set_power_policy(), else the default
+ */
+const struct aes132_power_policy *aes132c_get_power_policy(void)
+{
+	const struct aes132_power_policy *policy = aes132c_power_policies[aes132c_get_device_index()];
+
+	return policy ? policy : &aes132c_default_power_policy;
+}
+
+
+/** \brief This function returns the power mode of the selected device, as far as the library knows it.
+ * \return power mode (#aes132_power_mode)
+ */
+uint8_t aes132c_get_power_mode(void)
+{
+	return aes132c_power_states[aes132c_get_device_index()].power_mode;
+}
+
+
+/** \brief This function puts the selected device into a lower power mode if it has been idle long enough.
+ *
+ * A device in Standby mode is woken up before it is put into Sleep mode. If both thresholds have
+ * passed, the device goes straight into Sleep mode.
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS if the mode was changed or did not have to be,
+ *         otherwise the status of waking up or of sending the Sleep command
+ */
+uint8_t aes132c_update_power_mode(void)
+{
+	struct aes132_power_state *state = &aes132c_power_states[aes132c_get_device_index()];
+	const struct aes132_power_policy *policy = aes132c_get_power_policy();
+	uint32_t last_activity_us = state->last_activity_us;
+	uint32_t idle_us = aes132c_now_us() - last_activity_us;
+	uint8_t aes132_lib_return = AES132_FUNCTION_RETCODE_SUCCESS;
+	uint8_t power_mode;
+
+	if ((policy->sleep_after_ms > 0) && (idle_us >= policy->sleep_after_ms * 1000UL))
+		power_mode = AES132_POWER_MODE_SLEEP;
+	else if ((policy->standby_after_ms > 0) && (idle_us >= policy->standby_after_ms * 1000UL))
+		power_mode = AES132_POWER_MODE_STANDBY;
+	else
+		return aes132_lib_return;
+
+	if (state->power_mode >= power_mode)
+		// The device is in this mode or a lower one already.
+		return aes132_lib_return;
+
+	if (state->power_mode == AES132_POWER_MODE_STANDBY)
+		// Wake the device before sending the Sleep command. The wait is measured as a wakeup from Standby.
+		aes132_lib_return = aes132c_wakeup();
+
+	if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+		aes132_lib_return = aes132c_send_sleep_command(power_mode == AES132_POWER_MODE_STANDBY
+					? AES132_COMMAND_MODE_STANDBY : AES132_COMMAND_MODE_SLEEP);
+
+	// Changing the mode is no activity of a command. Keep counting the idle time from the last one,
+	// so that the device goes from Standby into Sleep mode when the sleep threshold has passed.
+	state->last_activity_us = last_activity_us;
+
+	return aes132_lib_return;
+}
+
+
+/** \brief This function records that the selected device has been put into a power mode.
+ *
+ * aes132c_send_sleep_command() calls it after sending the Sleep command.
+ * \param[in] power_mode power mode (#aes132_power_mode)
+ */
+void aes132c_record_power_mode(uint8_t power_mode)
+{
+	uint8_t device_index = aes132c_get_device_index();
+	struct aes132_power_statistics *statistics = &aes132c_power_statistics[device_index];
+
+	if (power_mode >= AES132_POWER_MODE_COUNT)
+		return;
+
+	aes132c_power_states[device_index].power_mode = power_mode;
+	if ((power_mode == AES132_POWER_MODE_STANDBY) && (statistics->n_standbys < UINT16_MAX))
+		statistics->n_standbys++;
+	else if ((power_mode == AES132_POWER_MODE_SLEEP) && (statistics->n_sleeps < UINT16_MAX))
+		statistics->n_sleeps++;
+}
+
+
+/** \brief This function adds a wait for the selected device being ready to the wake cost of
+ *         its power mode, and records the activity.
+ *
+ * aes132c_record_device_ready_time() calls it. After a successful wait the device is active.
+ * \param[in] duration_us duration of the wait in us
+ * \param[in] aes132_lib_return status of the wait
+ */
+void aes132c_record_wakeup(uint32_t duration_us, uint8_t aes132_lib_return)
+{
+	uint8_t device_index = aes132c_get_device_index();
+	struct aes132_power_state *state = &aes132c_power_states[device_index];
+	struct aes132_power_statistics *statistics = &aes132c_power_statistics[device_index];
+
+	aes132c_record_wait(&statistics->wakeups[state->power_mode], duration_us, aes132_lib_return);
+	statistics->total_us[state->power_mode] = (duration_us > UINT32_MAX - statistics->total_us[state->power_mode])
+				? UINT32_MAX : statistics->total_us[state->power_mode] + duration_us;
+
+	if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS) {
+		state->power_mode = AES132_POWER_MODE_ACTIVE;
+		state->last_activity_us = aes132c_now_us();
+	}
+}
+
+
+/** \brief This function records an access of the selected device by a command.
+ *
+ * aes132c_record_execution_time() calls it when the response is ready.
+ */
+void aes132c_record_activity(void)
+{
+	aes132c_power_states[aes132c_get_device_index()].last_activity_us = aes132c_now_us();
+}
+
+
+/** \brief This function returns the measured wake cost and mode changes of a device.
+ *
+ * The mean wake cost of a mode is aes132_power_statistics::total_us divided by
+ * aes132_wait_statistics::n_waits of that mode.
+ * \param[in] device_index device index (see aes132c_get_device_index())
+ * \return pointer to statistics, or NULL if the device index is out of range
+ */
+const struct aes132_power_statistics *aes132c_get_power_statistics(uint8_t device_index)
+{
+	if (device_index >= AES132_DEVICE_COUNT_MAX)
+		return (const struct aes132_power_statistics *) 0;
+
+	return &aes132c_power_statistics[device_index];
+}
+
+
+/** \brief This function clears the measured wake cost and mode changes of all devices.
+ */
+void aes132c_reset_power_statistics(void)
+{
+	memset(aes132c_power_statistics, 0, sizeof(aes132c_power_statistics));
+}
@@ -0,0 +1,100 @@
+/** \file
+ *  \brief  Definitions and prototypes for the power manager of the AES132 library.
+ *
+ * The device draws least current in Sleep mode, less in Standby mode, and most while active.
+ * The power manager tracks the last activity of every device and puts it into Standby mode
+ * after it has been idle for aes132_power_policy::standby_after_ms, and into Sleep mode after
+ * aes132_power_policy::sleep_after_ms. Call aes132c_update_power_mode() for the selected device
+ * from the main loop, e.g.:
+ * \code
+ * static const struct aes132_power_policy battery = {20, 500};
+ * aes132c_set_power_policy(&battery);
+ * ...
+ * ret = aes132c_update_power_mode();
+ * \endcode
+ * It accesses the bus when it changes the mode, so do not call it while a command started with
+ * aes132c_send_and_receive_async() is in progress.
+ *
+ * The device wakes up on the next command by itself: the library waits for it being ready
+ * before writing (see aes132c_wait_for_device_ready()). That wait is the wake cost. It is
+ * measured per device and per mode the device was in (see aes132c_get_power_statistics()), so
+ * that the thresholds can be set from the cost measured on the hardware. The waits of an
+ * active device are measured, too, as the baseline.
+ *
+ * The device loses its volatile state in Sleep mode, e.g. the nonce and the authentication
+ * state. Keep aes132_power_policy::sleep_after_ms 0 if commands rely on them across idle times.
+ *
+ * Idle times are measured with aes132c_now_us() and have to be shorter than
+ * #AES132_POWER_IDLE_MAX_MS.
+ */
+
+#ifndef AES132_POWER_H
+#   define AES132_POWER_H
+
+#include <stdint.h>
+
+#include "aes132_comm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief idle time in ms after which the power manager puts a device into Standby mode by default; 0 for never
+ *
+ * Override with a build flag, e.g. -DAES132_POWER_STANDBY_AFTER_MS=20.
+ */
+#ifndef AES132_POWER_STANDBY_AFTER_MS
+#   define AES132_POWER_STANDBY_AFTER_MS    (0)
+#endif
+
+/** \brief idle time in ms after which the power manager puts a device into Sleep mode by default; 0 for never
+ *
+ * Override with a build flag, e.g. -DAES132_POWER_SLEEP_AFTER_MS=500.
+ */
+#ifndef AES132_POWER_SLEEP_AFTER_MS
+#   define AES132_POWER_SLEEP_AFTER_MS      (0)
+#endif
+
+//! longest idle time in ms the power manager can measure (half the range of aes132c_now_us())
+#define AES132_POWER_IDLE_MAX_MS            (2147483UL)
+
+//! power modes of a device
+enum aes132_power_mode {
+	AES132_POWER_MODE_ACTIVE    = 0,    //!< awake
+	AES132_POWER_MODE_STANDBY   = 1,    //!< Standby mode, volatile state is kept
+	AES132_POWER_MODE_SLEEP     = 2,    //!< Sleep mode, volatile state is lost
+	AES132_POWER_MODE_COUNT     = 3     //!< number of power modes
+};
+
+//! when to put an idle device into a lower power mode
+struct aes132_power_policy {
+	uint32_t standby_after_ms;  //!< idle time before Standby mode, 0 for never; at most #AES132_POWER_IDLE_MAX_MS
+	uint32_t sleep_after_ms;    //!< idle time before Sleep mode, 0 for never; at most #AES132_POWER_IDLE_MAX_MS
+};
+
+//! measured wake cost and mode changes of a device
+struct aes132_power_statistics {
+	struct aes132_wait_statistics wakeups[AES132_POWER_MODE_COUNT];    //!< waits for the device being ready, by power mode before the wait
+	uint32_t total_us[AES132_POWER_MODE_COUNT];                         //!< sum of those waits in us, stops at 0xFFFFFFFF
+	uint16_t n_standbys;                                                //!< times the device was put into Standby mode, stops at 0xFFFF
+	uint16_t n_sleeps;                                                  //!< times the device was put into Sleep mode, stops at 0xFFFF
+};
+
+//! the policy in effect when no other has been set
+extern const struct aes132_power_policy aes132c_default_power_policy;
+
+void    aes132c_set_power_policy(const struct aes132_power_policy *policy);
+const struct aes132_power_policy *aes132c_get_power_policy(void);
+uint8_t aes132c_get_power_mode(void);
+uint8_t aes132c_update_power_mode(void);
+void    aes132c_record_power_mode(uint8_t power_mode);
+void    aes132c_record_wakeup(uint32_t duration_us, uint8_t aes132_lib_return);
+void    aes132c_record_activity(void);
+const struct aes132_power_statistics *aes132c_get_power_statistics(uint8_t device_index);
+void    aes132c_reset_power_statistics(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,132 @@
+/** \file
+ *  \brief  Zero-copy views of AES132 responses (C++17, header only).
+ *
+ * aes132c_receive_response() already checks count byte and CRC of every response and
+ * returns its return code. A view takes that result together with the receive buffer,
+ * adds the one check left, that a successful response has exactly the size of the
+ * command's response, and then gives access to the response fields through fixed-size
+ * spans that point into the receive buffer. Parsing neither copies nor needs extra
+ * stack buffers:
+ * \code
+ * aes132::Encrypt<16>::Response response;
+ * aes132::Encrypt<16>::View view(aes132::Encrypt<16>::execute(0, key_id, plaintext, response), response);
+ * if (view.ok())
+ *     send(view.out_mac().data(), view.ciphertext().data());
+ * \endcode
+ * The receive buffer can be any caller-owned storage, e.g. a member of the structure
+ * that needs the result, so that the response is decoded where it is used.
+ * The view does not own the buffer and must not outlive it.
+ */
+
+#ifndef AES132_RESPONSE_VIEW_H
+#   define AES132_RESPONSE_VIEW_H
+
+#ifndef __cplusplus
+#   error aes132_response_view.h requires C++17.
+#endif
+
+#include <stdint.h>
+
+#include "aes132_comm.h"
+
+namespace aes132 {
+
+/** \brief response buffer of the exact size of a response
+ * \tparam Size response size including count byte, return code and CRC
+ */
+template <uint8_t Size>
+struct ResponseBuffer {
+	uint8_t bytes[Size];
+
+	//! count byte as received; smaller than Size for error responses
+	uint8_t count() const { return bytes[AES132_RESPONSE_INDEX_COUNT]; }
+
+	//! return code as received
+	uint8_t return_code() const { return bytes[AES132_RESPONSE_INDEX_RETURN_CODE]; }
+};
+
+
+/** \brief read-only view of a fixed number of bytes inside a response
+ * \tparam Size number of bytes
+ */
+template <uint8_t Size>
+class ByteSpan {
+public:
+	constexpr explicit ByteSpan(const uint8_t *data) : data_(data) {}
+
+	constexpr const uint8_t *data() const { return data_; }
+	static constexpr uint8_t size() { return Size; }
+	constexpr uint8_t operator[](uint8_t index) const { return data_[index]; }
+	constexpr const uint8_t *begin() const { return data_; }
+	constexpr const uint8_t *end() const { return data_ + Size; }
+
+private:
+	const uint8_t *data_;
+};
+
+
+/** \brief validated, zero-copy view of a response
+ *
+ * Commands derive their own views from this class with accessors named after the
+ * response fields. Read fields only if ok() returns true.
+ * \tparam ResponseSize size of a successful response including count byte, return code and CRC
+ */
+template <uint8_t ResponseSize>
+class ResponseView {
+public:
+	/** \brief Checks a response received into an exact-size buffer.
+	 * \param[in] result return value of the function that received the response
+	 * \param[in] response response buffer
+	 */
+	ResponseView(uint8_t result, const ResponseBuffer<ResponseSize> &response)
+		: ResponseView(result, response.bytes) {}
+
+	/** \brief Checks a response received into a larger buffer, e.g. of #AES132_RESPONSE_SIZE_MAX bytes.
+	 * \param[in] result return value of the function that received the response
+	 * \param[in] response response buffer
+	 */
+	ResponseView(uint8_t result, const uint8_t *response)
+		: bytes_(response), status_(check(result, response)) {}
+
+	//! #AES132_FUNCTION_RETCODE_SUCCESS, the result passed in if it was not, or
+	//! #AES132_FUNCTION_RETCODE_COUNT_INVALID if the response size does not match
+	uint8_t status() const { return status_; }
+
+	//! true if the response is consistent and reports success
+	bool ok() const { return status_ == AES132_FUNCTION_RETCODE_SUCCESS; }
+
+	//! all data bytes between return code and CRC
+	ByteSpan<ResponseSize - AES132_RESPONSE_SIZE_MIN> data() const
+	{
+		return field<AES132_RESPONSE_INDEX_DATA, ResponseSize - AES132_RESPONSE_SIZE_MIN>();
+	}
+
+protected:
+	//! Returns the field at a fixed offset.
+	template <uint8_t Offset, uint8_t Size>
+	ByteSpan<Size> field() const
+	{
+		static_assert(Offset >= AES132_RESPONSE_INDEX_DATA && Offset + Size <= ResponseSize - AES132_CRC_SIZE,
+				"field outside of response data");
+		return ByteSpan<Size>(bytes_ + Offset);
+	}
+
+private:
+	static uint8_t check(uint8_t result, const uint8_t *response)
+	{
+		if (result != AES132_FUNCTION_RETCODE_SUCCESS)
+			return result;
+
+		if (response[AES132_RESPONSE_INDEX_COUNT] != ResponseSize)
+			return AES132_FUNCTION_RETCODE_COUNT_INVALID;
+
+		return AES132_FUNCTION_RETCODE_SUCCESS;
+	}
+
+	const uint8_t *bytes_;
+	uint8_t status_;
+};
+
+} // namespace aes132
+
+#endif
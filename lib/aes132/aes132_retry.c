@@ -0,0 +1,217 @@
+/** \file
+ *  \brief  Retry policy of the AES132 library.
+ *
+ * See aes132_retry.h for how errors are classified and retried.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "aes132_clock.h"
+#include "aes132_comm.h"
+#include "aes132_device.h"
+#include "aes132_retry.h"
+#include "aes132_timer.h"
+
+//! one retry after every error, re-synchronizing after every error but a Tx CRC error
+const struct aes132_retry_policy aes132c_default_retry_policy = {
+	{
+		{AES132_RETRY_COUNT_ERROR - 1, 1, 0, 0},    // AES132_ERROR_CLASS_NACK
+		{AES132_RETRY_COUNT_ERROR - 1, 1, 0, 0},    // AES132_ERROR_CLASS_BAD_CRC_RX
+		{AES132_RETRY_COUNT_ERROR - 1, 0, 0, 0},    // AES132_ERROR_CLASS_BAD_CRC_TX
+		{AES132_RETRY_COUNT_ERROR - 1, 1, 0, 0},    // AES132_ERROR_CLASS_BAD_COUNT
+		{AES132_RETRY_COUNT_ERROR - 1, 1, 0, 0}     // AES132_ERROR_CLASS_TIMEOUT
+	}
+};
+
+//! policies set with aes132c_set_retry_policy(), indexed by device index; NULL for the default
+static const struct aes132_retry_policy *aes132c_device_retry_policies[AES132_DEVICE_COUNT_MAX];
+
+//! policy set with aes132c_use_retry_policy(), or NULL
+static const struct aes132_retry_policy *aes132c_call_retry_policy;
+
+//! counted decisions, indexed by device index
+static struct aes132_retry_statistics aes132c_retry_statistics[AES132_DEVICE_COUNT_MAX];
+
+
+/** \brief This function increments a counter that stops at 0xFFFF.
+ * \param[in, out] counter counter
+ */
+static void aes132c_count(uint16_t *counter)
+{
+	if (*counter < UINT16_MAX)
+		(*counter)++;
+}
+
+
+/** \brief This function returns the class of an error.
+ * \param[in] aes132_lib_return status of a failed operation
+ * \return error class (#aes132_error_class); errors of no other class are #AES132_ERROR_CLASS_NACK
+ */
+uint8_t aes132c_classify_error(uint8_t aes132_lib_return)
+{
+	switch (aes132_lib_return) {
+	case AES132_FUNCTION_RETCODE_BAD_CRC_RX:
+		return AES132_ERROR_CLASS_BAD_CRC_RX;
+
+	case AES132_FUNCTION_RETCODE_BAD_CRC_TX:
+		return AES132_ERROR_CLASS_BAD_CRC_TX;
+
+	case AES132_FUNCTION_RETCODE_COUNT_INVALID:
+	case AES132_FUNCTION_RETCODE_SIZE_TOO_SMALL:
+		return AES132_ERROR_CLASS_BAD_COUNT;
+
+	case AES132_FUNCTION_RETCODE_TIMEOUT:
+		return AES132_ERROR_CLASS_TIMEOUT;
+
+	default:
+		return AES132_ERROR_CLASS_NACK;
+	}
+}
+
+
+/** \brief This function sets the retry policy of the selected device.
+ * \param[in] policy policy to use, or NULL for the default policy; has to stay valid while in use
+ */
+void aes132c_set_retry_policy(const struct aes132_retry_policy *policy)
+{
+	aes132c_device_retry_policies[aes132c_get_device_index()] = policy;
+}
+
+
+/** \brief This function sets a retry policy for all devices until it is replaced.
+ *
+ * It takes precedence over the policies set with aes132c_set_retry_policy(). Set it around a
+ * call to apply a policy to that call only, and restore the previous one afterwards.
+ * \param[in] policy policy to use, or NULL to go back to the policy of each device
+ * \return policy in use before
+ */
+const struct aes132_retry_policy *aes132c_use_retry_policy(const struct aes132_retry_policy *policy)
+{
+	const struct aes132_retry_policy *previous = aes132c_call_retry_policy;
+
+	aes132c_call_retry_policy = policy;
+	return previous;
+}
+
+
+/** \brief This function returns the retry policy in effect for the selected device.
+ * \return policy set with aes132c_use_retry_policy(), else with aes132c_set_retry_policy(), else the default
+ */
+const struct aes132_retry_policy *aes132c_get_retry_policy(void)
+{
+	const struct aes132_retry_policy *policy = aes132c_call_retry_policy;
+
+	if (!policy)
+		policy = aes132c_device_retry_policies[aes132c_get_device_index()];
+
+	return policy ? policy : &aes132c_default_retry_policy;
+}
+
+
+/** \brief This function starts counting the retries of an exchange with the selected device.
+ * \param[out] retry retries of the exchange
+ */
+void aes132c_begin_retries(struct aes132_retry_state *retry)
+{
+	retry->policy = aes132c_get_retry_policy();
+	retry->device_index = aes132c_get_device_index();
+	retry->n_retries = 0;
+}
+
+
+/** \brief This function decides whether to retry after a failed attempt, and counts the decision.
+ * \param[in, out] retry retries of the exchange
+ * \param[in] aes132_lib_return status of the failed attempt
+ * \param[in] is_resynced non-zero if communication has already been re-synchronized after the
+ *            error, so that the rule does not ask for it again
+ * \param[out] action what to do before retrying, or before giving up (re-synchronizing only)
+ * \return non-zero to retry, 0 to give up
+ */
+uint8_t aes132c_plan_retry(struct aes132_retry_state *retry, uint8_t aes132_lib_return, uint8_t is_resynced,
+			struct aes132_retry_action *action)
+{
+	struct aes132_retry_statistics *statistics = &aes132c_retry_statistics[retry->device_index];
+	uint8_t error_class = aes132c_classify_error(aes132_lib_return);
+	const struct aes132_retry_rule *rule = &retry->policy->rules[error_class];
+	uint16_t n_doublings;
+
+	aes132c_count(&statistics->n_errors[error_class]);
+	if (AES132_CLOCK_MANAGER)
+		// Too many errors step the clock down (see aes132_clock.h).
+		aes132c_record_clock_error(aes132_lib_return);
+
+	// Re-synchronize also when giving up, so that the next exchange starts in sync.
+	action->is_resync = rule->is_resync && !is_resynced;
+	action->backoff_us = 0;
+	if (action->is_resync)
+		aes132c_count(&statistics->n_resyncs);
+
+	if (retry->n_retries >= rule->n_retries) {
+		aes132c_count(&statistics->n_exhausted);
+		return 0;
+	}
+
+	// Double the backoff per retry made, up to the longest backoff.
+	action->backoff_us = rule->backoff_us;
+	n_doublings = rule->backoff_shift * retry->n_retries;
+	while ((n_doublings-- > 0) && (action->backoff_us < AES132_RETRY_BACKOFF_MAX_US))
+		action->backoff_us <<= 1;
+	if (action->backoff_us > AES132_RETRY_BACKOFF_MAX_US)
+		action->backoff_us = AES132_RETRY_BACKOFF_MAX_US;
+
+	retry->n_retries++;
+	aes132c_count(&statistics->n_retries[error_class]);
+	return 1;
+}
+
+
+/** \brief This function decides whether to retry after a failed attempt, and prepares the retry.
+ *
+ * It re-synchronizes communication as the policy says, also when giving up, and waits out the
+ * backoff before a retry.
+ * \param[in, out] retry retries of the exchange
+ * \param[in] aes132_lib_return status of the failed attempt, or #AES132_FUNCTION_RETCODE_SUCCESS
+ * \param[in] is_resynced non-zero if communication has already been re-synchronized after the error
+ * \return non-zero to retry, 0 to give up or if the attempt succeeded
+ */
+uint8_t aes132c_retry(struct aes132_retry_state *retry, uint8_t aes132_lib_return, uint8_t is_resynced)
+{
+	struct aes132_retry_action action;
+	uint8_t is_retry;
+
+	if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+		return 0;
+
+	is_retry = aes132c_plan_retry(retry, aes132_lib_return, is_resynced, &action);
+
+	if (action.is_resync)
+		// Do not override the error that caused the retry.
+		(void) aes132c_resync();
+
+	if (is_retry && (action.backoff_us > 0))
+		aes132c_delay_us(action.backoff_us);
+
+	return is_retry;
+}
+
+
+/** \brief This function returns the counted retry decisions of a device.
+ * \param[in] device_index device index (see aes132c_get_device_index())
+ * \return pointer to statistics, or NULL if the device index is out of range
+ */
+const struct aes132_retry_statistics *aes132c_get_retry_statistics(uint8_t device_index)
+{
+	if (device_index >= AES132_DEVICE_COUNT_MAX)
+		return (const struct aes132_retry_statistics *) 0;
+
+	return &aes132c_retry_statistics[device_index];
+}
+
+
+/** \brief This function clears the counted retry decisions of all devices.
+ */
+void aes132c_reset_retry_statistics(void)
+{
+	memset(aes132c_retry_statistics, 0, sizeof(aes132c_retry_statistics));
+}
@@ -0,0 +1,102 @@
+/** \file
+ *  \brief  Definitions and prototypes for the retry policy of the AES132 library.
+ *
+ * When sending a command or receiving its response fails, the library looks up the class of
+ * the error in a retry policy. The rule for that class decides whether to retry the exchange,
+ * whether to re-synchronize communication (aes132c_resync()), and how long to back off.
+ * The default policy keeps the behavior of #AES132_RETRY_COUNT_ERROR: one retry for every
+ * class, re-synchronizing after every error but a Tx CRC error, without backoff.
+ *
+ * A noisy bus may want more retries with a growing backoff; a clean bus may skip
+ * re-synchronizing after a bad CRC. Policies can be set per device with
+ * aes132c_set_retry_policy() and for the calls in between with aes132c_use_retry_policy():
+ * \code
+ * const struct aes132_retry_policy *previous = aes132c_use_retry_policy(&no_retries);
+ * ret = aes132m_execute(...);
+ * (void) aes132c_use_retry_policy(previous);
+ * \endcode
+ * Policies are referenced, not copied, and have to stay valid while they are in use.
+ *
+ * Retry counts are per exchange: sending a command and receiving its response each start
+ * from zero. Waiting for the device to be ready before writing has its own retries and
+ * re-synchronizations (#AES132_RETRY_COUNT_ERROR, #AES132_RETRY_COUNT_RESYNC).
+ *
+ * Every decision is counted per device (see aes132c_get_retry_statistics()), so a policy
+ * can be tuned from what happens in the field.
+ */
+
+#ifndef AES132_RETRY_H
+#   define AES132_RETRY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! classes of errors that a retry policy has a rule for
+enum aes132_error_class {
+	AES132_ERROR_CLASS_NACK         = 0,    //!< nack or other bus error, e.g. #AES132_FUNCTION_RETCODE_COMM_FAIL
+	AES132_ERROR_CLASS_BAD_CRC_RX   = 1,    //!< #AES132_FUNCTION_RETCODE_BAD_CRC_RX
+	AES132_ERROR_CLASS_BAD_CRC_TX   = 2,    //!< #AES132_FUNCTION_RETCODE_BAD_CRC_TX
+	AES132_ERROR_CLASS_BAD_COUNT    = 3,    //!< #AES132_FUNCTION_RETCODE_COUNT_INVALID or #AES132_FUNCTION_RETCODE_SIZE_TOO_SMALL
+	AES132_ERROR_CLASS_TIMEOUT      = 4,    //!< #AES132_FUNCTION_RETCODE_TIMEOUT
+	AES132_ERROR_CLASS_COUNT        = 5     //!< number of error classes
+};
+
+//! longest backoff in us, however many retries have been made
+#define AES132_RETRY_BACKOFF_MAX_US     ((uint32_t) 100000)
+
+//! what to do after an error of one class
+struct aes132_retry_rule {
+	uint8_t n_retries;          //!< retry while fewer than this many retries have been made in the exchange
+	uint8_t is_resync;          //!< non-zero to re-synchronize after the error, before retrying or giving up
+	uint8_t backoff_shift;      //!< the backoff doubles this many times per retry; 0 keeps it constant
+	uint16_t backoff_us;        //!< time to wait before the first retry in us
+};
+
+//! rules by error class (#aes132_error_class)
+struct aes132_retry_policy {
+	struct aes132_retry_rule rules[AES132_ERROR_CLASS_COUNT];
+};
+
+//! retries of one exchange
+struct aes132_retry_state {
+	const struct aes132_retry_policy *policy;   //!< policy in effect when the exchange started
+	uint8_t device_index;                       //!< device whose statistics count the retries
+	uint8_t n_retries;                          //!< retries made so far
+};
+
+//! what to do before the next attempt
+struct aes132_retry_action {
+	uint8_t is_resync;          //!< non-zero to re-synchronize
+	uint32_t backoff_us;        //!< time to wait in us
+};
+
+//! counted decisions of a device, each one stops counting at 0xFFFF
+struct aes132_retry_statistics {
+	uint16_t n_errors[AES132_ERROR_CLASS_COUNT];    //!< failed attempts by error class
+	uint16_t n_retries[AES132_ERROR_CLASS_COUNT];   //!< retries by class of the error before them
+	uint16_t n_resyncs;                             //!< re-synchronizations after errors
+	uint16_t n_exhausted;                           //!< exchanges given up after an error
+};
+
+//! the policy in effect when no other has been set
+extern const struct aes132_retry_policy aes132c_default_retry_policy;
+
+uint8_t aes132c_classify_error(uint8_t aes132_lib_return);
+void    aes132c_set_retry_policy(const struct aes132_retry_policy *policy);
+const struct aes132_retry_policy *aes132c_use_retry_policy(const struct aes132_retry_policy *policy);
+const struct aes132_retry_policy *aes132c_get_retry_policy(void);
+void    aes132c_begin_retries(struct aes132_retry_state *retry);
+uint8_t aes132c_plan_retry(struct aes132_retry_state *retry, uint8_t aes132_lib_return, uint8_t is_resynced,
+			struct aes132_retry_action *action);
+uint8_t aes132c_retry(struct aes132_retry_state *retry, uint8_t aes132_lib_return, uint8_t is_resynced);
+const struct aes132_retry_statistics *aes132c_get_retry_statistics(uint8_t device_index);
+void    aes132c_reset_retry_statistics(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
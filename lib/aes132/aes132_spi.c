@@ -0,0 +1,318 @@
+/** \file
+ *  \brief  SPI transport on the ESP-IDF SPI master driver.
+ *
+ * See aes132_spi.h for how the frames are made.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "aes132_comm.h"
+#include "aes132_config.h"
+#include "aes132_spi.h"
+
+#if defined(AES132_SPI) && AES132_SPI
+
+#if AES132_NACK_POLLING
+#   error The device does not nack on SPI. Build without AES132_NACK_POLLING.
+#endif
+
+#include "driver/spi_master.h"
+
+#if defined(ESP_PLATFORM)
+#   include "esp_attr.h"
+#else
+// Host builds compile against tools/aes132_spi_master_host, where any buffer will do.
+#   define DMA_ATTR
+#endif
+
+//! size of the frame buffers: a header and 255 data bytes, rounded up to whole words for DMA
+#define AES132_SPI_BUFFER_SIZE          ((AES132_SPI_HEADER_SIZE + 0xFF + 3) & ~3)
+
+//! MOSI pin, #AES132_SPI_MOSI_PIN until aes132_spi_set_pins() sets it
+static int aes132_spi_mosi = AES132_SPI_MOSI_PIN;
+
+//! MISO pin, #AES132_SPI_MISO_PIN until aes132_spi_set_pins() sets it
+static int aes132_spi_miso = AES132_SPI_MISO_PIN;
+
+//! SCLK pin, #AES132_SPI_SCLK_PIN until aes132_spi_set_pins() sets it
+static int aes132_spi_sclk = AES132_SPI_SCLK_PIN;
+
+//! CS pin, #AES132_SPI_CS_PIN until aes132_spi_set_pins() sets it
+static int aes132_spi_cs = AES132_SPI_CS_PIN;
+
+//! SPI clock in Hz, set by aes132_spi_set_clock()
+static uint32_t aes132_spi_clock_hz = AES132_SPI_CLOCK_HZ;
+
+//! non-zero while the bus is initialized
+static uint8_t aes132_spi_is_installed;
+
+//! device handle, NULL until the next frame adds the device (see aes132_spi_transfer())
+static spi_device_handle_t aes132_spi_device;
+
+//! frame sent to the device
+DMA_ATTR static uint8_t aes132_spi_tx_buffer[AES132_SPI_BUFFER_SIZE];
+
+//! frame received from the device
+DMA_ATTR static uint8_t aes132_spi_rx_buffer[AES132_SPI_BUFFER_SIZE];
+
+
+/** \brief This function sets the pins the driver is installed on.
+ *
+ * Call it before aes132p_enable_interface().
+ * \param[in] mosi MOSI pin number
+ * \param[in] miso MISO pin number
+ * \param[in] sclk SCLK pin number
+ * \param[in] cs CS pin number of the device
+ */
+void aes132_spi_set_pins(int mosi, int miso, int sclk, int cs)
+{
+	aes132_spi_mosi = mosi;
+	aes132_spi_miso = miso;
+	aes132_spi_sclk = sclk;
+	aes132_spi_cs = cs;
+}
+
+
+/** \brief This function translates a return code of the driver.
+ * \param[in] err return code of the driver
+ * \return status of the operation
+ */
+static uint8_t aes132_spi_return(esp_err_t err)
+{
+	if (err == ESP_OK)
+		return AES132_FUNCTION_RETCODE_SUCCESS;
+	if (err == ESP_ERR_INVALID_ARG)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+	return AES132_FUNCTION_RETCODE_COMM_FAIL;
+}
+
+
+/** \brief This function adds the device to the bus with the current clock, unless it has been added.
+ *
+ * The driver takes the clock of a device when it is added.
+ * \return return code of the driver
+ */
+static esp_err_t aes132_spi_add_device(void)
+{
+	spi_device_interface_config_t config = {
+		.mode = 0,
+		.clock_speed_hz = (int) aes132_spi_clock_hz,
+		.spics_io_num = aes132_spi_cs,
+		.queue_size = 1,
+	};
+	esp_err_t err;
+
+	if (aes132_spi_device)
+		return ESP_OK;
+	if (!aes132_spi_is_installed)
+		return ESP_ERR_INVALID_STATE;
+
+	err = spi_bus_add_device(AES132_SPI_HOST, &config, &aes132_spi_device);
+	if (err != ESP_OK)
+		aes132_spi_device = NULL;
+	return err;
+}
+
+
+/** \brief This function initializes the bus with a DMA channel.
+ * \param[in] context not used
+ */
+static void aes132_spi_enable_interface(void *context)
+{
+	spi_bus_config_t config = {
+		.mosi_io_num = aes132_spi_mosi,
+		.miso_io_num = aes132_spi_miso,
+		.sclk_io_num = aes132_spi_sclk,
+		.quadwp_io_num = -1,
+		.quadhd_io_num = -1,
+		.max_transfer_sz = AES132_SPI_BUFFER_SIZE,
+	};
+
+	(void) context;
+	if (aes132_spi_is_installed)
+		return;
+
+	if (spi_bus_initialize(AES132_SPI_HOST, &config, SPI_DMA_CH_AUTO) == ESP_OK)
+		aes132_spi_is_installed = 1;
+}
+
+
+/** \brief This function removes the device and frees the bus.
+ * \param[in] context not used
+ */
+static void aes132_spi_disable_interface(void *context)
+{
+	(void) context;
+	if (!aes132_spi_is_installed)
+		return;
+
+	if (aes132_spi_device)
+		(void) spi_bus_remove_device(aes132_spi_device);
+	aes132_spi_device = NULL;
+	(void) spi_bus_free(AES132_SPI_HOST);
+	aes132_spi_is_installed = 0;
+}
+
+
+/** \brief This function selects the device. The device on the CS pin answers to every device id.
+ * \param[in] context not used
+ * \param[in] device_id device id
+ * \return always success
+ */
+static uint8_t aes132_spi_select_device(void *context, uint8_t device_id)
+{
+	(void) context;
+	(void) device_id;
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function runs a frame from the transmit buffer into the receive buffer.
+ *
+ * The device is added to the bus before its first frame, and again after the clock has changed.
+ * \param[in] size number of bytes of the frame
+ * \return status of the operation
+ */
+static uint8_t aes132_spi_transfer(uint16_t size)
+{
+	spi_transaction_t transaction;
+
+	if (aes132_spi_add_device() != ESP_OK)
+		return AES132_FUNCTION_RETCODE_COMM_FAIL;
+
+	memset(&transaction, 0, sizeof(transaction));
+	transaction.length = (size_t) size * 8;
+	transaction.tx_buffer = aes132_spi_tx_buffer;
+	transaction.rx_buffer = aes132_spi_rx_buffer;
+
+	return aes132_spi_return(spi_device_polling_transmit(aes132_spi_device, &transaction));
+}
+
+
+/** \brief This function reads bytes from the device in one frame.
+ *
+ * A read of the device status register alone uses RDSR.
+ * \param[in] context not used
+ * \param[in] size number of bytes to read
+ * \param[in] word_address word address to read from
+ * \param[out] data pointer to rx buffer
+ * \return status of the operation
+ */
+static uint8_t aes132_spi_read_memory(void *context, uint8_t size, uint16_t word_address, uint8_t *data)
+{
+	uint8_t header_size = AES132_SPI_HEADER_SIZE;
+	uint8_t aes132_lib_return;
+
+	(void) context;
+	if (size == 0)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	if ((word_address == AES132_STATUS_ADDR) && (size == 1)) {
+		aes132_spi_tx_buffer[0] = AES132_SPI_RDSR;
+		header_size = 1;
+	}
+	else {
+		aes132_spi_tx_buffer[0] = AES132_SPI_READ;
+		aes132_spi_tx_buffer[1] = (uint8_t) (word_address >> 8);
+		aes132_spi_tx_buffer[2] = (uint8_t) (word_address & 0xFF);
+	}
+
+	aes132_lib_return = aes132_spi_transfer(header_size + size);
+	if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+		memcpy(data, &aes132_spi_rx_buffer[header_size], size);
+
+	return aes132_lib_return;
+}
+
+
+/** \brief This function writes several buffers to the device in one frame, after setting the
+ *         write enable latch.
+ * \param[in] context not used
+ * \param[in] word_address word address to write to
+ * \param[in] segments buffers to write, in order
+ * \param[in] n_segments number of segments (at most #AES132_SEGMENT_COUNT_MAX)
+ * \return status of the operation
+ */
+static uint8_t aes132_spi_write_memory_segments(void *context, uint16_t word_address,
+			const struct aes132_segment *segments, uint8_t n_segments)
+{
+	uint16_t size = AES132_SPI_HEADER_SIZE;
+	uint8_t aes132_lib_return;
+	uint8_t i;
+
+	(void) context;
+	if (n_segments > AES132_SEGMENT_COUNT_MAX)
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	for (i = 0; i < n_segments; i++) {
+		if (size + segments[i].count > AES132_SPI_BUFFER_SIZE)
+			return AES132_FUNCTION_RETCODE_BAD_PARAM;
+		memcpy(&aes132_spi_tx_buffer[size], segments[i].data, segments[i].count);
+		size += segments[i].count;
+	}
+
+	// WREN takes the first byte of the buffer only.
+	aes132_spi_tx_buffer[0] = AES132_SPI_WREN;
+	aes132_lib_return = aes132_spi_transfer(1);
+	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
+		return aes132_lib_return;
+
+	aes132_spi_tx_buffer[0] = AES132_SPI_WRITE;
+	aes132_spi_tx_buffer[1] = (uint8_t) (word_address >> 8);
+	aes132_spi_tx_buffer[2] = (uint8_t) (word_address & 0xFF);
+
+	return aes132_spi_transfer(size);
+}
+
+
+/** \brief This function resynchronizes communication.
+ *
+ * Every frame starts with CS going low, which restarts the interface of the device. Reading the
+ * device status register leaves it between two frames.
+ * \param[in] context not used
+ * \return status of the operation
+ */
+static uint8_t aes132_spi_resync(void *context)
+{
+	(void) context;
+	aes132_spi_tx_buffer[0] = AES132_SPI_RDSR;
+
+	return aes132_spi_transfer(2);
+}
+
+
+/** \brief This function sets the SPI clock.
+ *
+ * The device takes it with its next frame (see aes132_spi_transfer()).
+ * \param[in] context not used
+ * \param[in] clock_hz SPI clock in Hz, at most #AES132_SPI_CLOCK_HZ_MAX
+ * \return status of the operation
+ */
+static uint8_t aes132_spi_set_clock(void *context, uint32_t clock_hz)
+{
+	(void) context;
+	if ((clock_hz == 0) || (clock_hz > AES132_SPI_CLOCK_HZ_MAX))
+		return AES132_FUNCTION_RETCODE_BAD_PARAM;
+
+	aes132_spi_clock_hz = clock_hz;
+	if (aes132_spi_device) {
+		(void) spi_bus_remove_device(aes132_spi_device);
+		aes132_spi_device = NULL;
+	}
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+const struct aes132_transport aes132_spi_transport = {
+	aes132_spi_enable_interface,
+	aes132_spi_disable_interface,
+	aes132_spi_select_device,
+	aes132_spi_read_memory,
+	aes132_spi_write_memory_segments,
+	aes132_spi_resync,
+	aes132_spi_set_clock,
+	(void *) 0
+};
+
+#endif
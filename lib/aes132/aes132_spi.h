@@ -0,0 +1,110 @@
+/** \file
+ *  \brief  Definitions of the SPI layer of the AES132 library.
+ *
+ * With AES132_SPI=1, aes132_comm.h includes this header instead of aes132_i2c.h, and
+ * aes132_spi_transport becomes #AES132_TRANSPORT_DEFAULT. The transport reaches the device
+ * through the SPI master driver of ESP-IDF, at up to 10 MHz. Every access is one frame
+ * while CS is low: an instruction, the word address and the data.
+ *
+ * - A read is READ, the word address, and the data. The device status register is read with
+ *   RDSR instead, which takes two bytes instead of four.
+ * - A write is WREN in a frame of its own, then WRITE, the word address and the segments of the
+ *   command. The device clears its write enable latch after every write.
+ * - There are no address nacks on SPI: a busy device ignores reads and writes, and the library
+ *   has to poll the device status register. #AES132_NACK_POLLING cannot be used.
+ * - The bus is initialized with a DMA channel, so that a frame may be longer than the 64 bytes
+ *   the SPI controller holds, e.g. a command with 32 bytes of data. Frames are assembled in
+ *   static, word-aligned buffers in DMA-capable memory instead of the buffers of the caller.
+ *   The driver runs them with spi_device_polling_transmit(): the longest frame of a command
+ *   takes 53 us at 10 MHz, less than waking the task after an interrupt would.
+ *
+ * The transport answers for the device on the CS pin set by aes132_spi_set_pins() (by default
+ * the pins in aes132_config.h), whatever its device id.
+ * Its clock can be set through aes132p_set_clock(), which rejects rates above
+ * #AES132_SPI_CLOCK_HZ_MAX with #AES132_FUNCTION_RETCODE_BAD_PARAM. With #AES132_CLOCK_MANAGER, give the clock
+ * manager SPI rates, e.g. -DAES132_CLOCK_RATES_HZ=10000000,5000000,1000000.
+ * Host builds compile it against a stand-in of the driver (tools/aes132_spi_master_host),
+ * which reaches a fake device through the same instructions.
+ */
+
+#ifndef AES132_SPI_H
+#   define AES132_SPI_H
+
+#include <stdint.h>
+
+#include "aes132_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// ------------ definitions for library return codes ----------------------------
+
+// The codes are the same as in aes132_i2c.h.
+
+#define AES132_FUNCTION_RETCODE_ADDRESS_WRITE_NACK   ((uint8_t) 0xA0) //!< I2C nack when sending a I2C address for writing
+#define AES132_FUNCTION_RETCODE_ADDRESS_READ_NACK    ((uint8_t) 0xA1) //!< I2C nack when sending a I2C address for reading
+#define AES132_FUNCTION_RETCODE_SIZE_TOO_SMALL       ((uint8_t) 0xA2) //!< Count value in response was bigger than buffer.
+
+// The codes below are the same as in the SHA204 library.
+#define AES132_FUNCTION_RETCODE_SUCCESS              ((uint8_t) 0x00) //!< Function succeeded.
+#define AES132_FUNCTION_RETCODE_BAD_CRC_TX           ((uint8_t) 0xD4) //!< Device status register bit 4 (CRC) is set.
+#define AES132_FUNCTION_RETCODE_NOT_IMPLEMENTED      ((uint8_t) 0xE0) //!< interface function not implemented
+#define AES132_FUNCTION_RETCODE_BAD_PARAM            ((uint8_t) 0xE2) //!< invalid function parameter
+#define AES132_FUNCTION_RETCODE_DEVICE_SELECT_FAIL   ((uint8_t) 0xE3) //!< device index out of bounds
+#define AES132_FUNCTION_RETCODE_COUNT_INVALID        ((uint8_t) 0xE4) //!< count byte in response is out of range
+#define AES132_FUNCTION_RETCODE_BAD_CRC_RX           ((uint8_t) 0xE5) //!< incorrect CRC received
+#define AES132_FUNCTION_RETCODE_TIMEOUT              ((uint8_t) 0xE7) //!< Function timed out while waiting for response.
+#define AES132_FUNCTION_RETCODE_NOT_EXECUTED         ((uint8_t) 0xE8) //!< Command was skipped in a batch after an earlier one failed, or did not reach the device.
+#define AES132_FUNCTION_RETCODE_NO_FRAME             ((uint8_t) 0xE9) //!< No coroutine frame was free in the pool.
+#define AES132_FUNCTION_RETCODE_COMM_FAIL            ((uint8_t) 0xF0) //!< Communication with device failed.
+
+
+// ------------ definitions for SPI instructions ----------------------------
+
+#define AES132_SPI_WRITE             ((uint8_t) 0x02) //!< write to a word address
+#define AES132_SPI_READ              ((uint8_t) 0x03) //!< read from a word address
+#define AES132_SPI_WRDI              ((uint8_t) 0x04) //!< reset the write enable latch
+#define AES132_SPI_RDSR              ((uint8_t) 0x05) //!< read the device status register
+#define AES132_SPI_WREN              ((uint8_t) 0x06) //!< set the write enable latch
+
+//! bytes of a frame before the data: instruction and word address
+#define AES132_SPI_HEADER_SIZE       ((uint8_t) 3)
+
+
+/** \brief SPI host the driver is installed on, e.g. 1 for SPI2_HOST (HSPI) or 2 for SPI3_HOST (VSPI)
+ *
+ * Override with a build flag, e.g. -DAES132_SPI_HOST=1.
+ */
+#ifndef AES132_SPI_HOST
+#   define AES132_SPI_HOST           (2)
+#endif
+
+//! fastest SPI clock of the device in Hz
+#define AES132_SPI_CLOCK_HZ_MAX      (10000000)
+
+/** \brief SPI clock in Hz until it is set through aes132p_set_clock(), at most #AES132_SPI_CLOCK_HZ_MAX
+ *
+ * Override with a build flag, e.g. -DAES132_SPI_CLOCK_HZ=5000000.
+ */
+#ifndef AES132_SPI_CLOCK_HZ
+#   define AES132_SPI_CLOCK_HZ       AES132_SPI_CLOCK_HZ_MAX
+#endif
+
+#if (AES132_SPI_CLOCK_HZ == 0) || (AES132_SPI_CLOCK_HZ > AES132_SPI_CLOCK_HZ_MAX)
+#   error AES132_SPI_CLOCK_HZ has to be between 1 and 10000000.
+#endif
+
+#if defined(AES132_SPI) && AES132_SPI
+//! transport over the ESP-IDF SPI master driver (aes132_spi.c)
+extern const struct aes132_transport aes132_spi_transport;
+
+void    aes132_spi_set_pins(int mosi, int miso, int sclk, int cs);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
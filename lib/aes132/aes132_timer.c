@@ -0,0 +1,159 @@
+/** \file
+ *  \brief  Timer module of the AES132 library.
+ */
+
+#if !defined(ESP_PLATFORM) && !defined(_POSIX_C_SOURCE)
+#   define _POSIX_C_SOURCE 200112L   // nanosleep(), clock_gettime(), pthread_condattr_setclock()
+#endif
+
+#include <stdint.h>
+
+#include "aes132_timer.h"
+
+#if defined(ESP_PLATFORM)
+#   include "freertos/FreeRTOS.h"
+#   include "freertos/task.h"
+#   include "freertos/semphr.h"
+#   include "esp_rom_sys.h"
+#   include "esp_timer.h"
+#else
+#   include <time.h>
+#   if AES132_YIELDING_WAIT
+#      include <pthread.h>
+#   endif
+#endif
+
+
+#if AES132_YIELDING_WAIT
+#   if defined(ESP_PLATFORM)
+//! semaphore a yielding wait blocks on; aes132c_wake() gives it
+static SemaphoreHandle_t aes132c_wake_semaphore;
+static StaticSemaphore_t aes132c_wake_semaphore_buffer;
+#   else
+static pthread_once_t aes132c_wake_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t aes132c_wake_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t aes132c_wake_condition;
+static int aes132c_wake_pending;   //!< aes132c_wake() was called and no wait has ended since
+
+
+/** \brief This function initializes the condition variable to time out on the monotonic clock.
+ */
+static void aes132c_init_wake_condition(void)
+{
+	pthread_condattr_t attributes;
+
+	(void) pthread_condattr_init(&attributes);
+	(void) pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	(void) pthread_cond_init(&aes132c_wake_condition, &attributes);
+	(void) pthread_condattr_destroy(&attributes);
+}
+#   endif
+
+
+/** \brief This function blocks the calling task until a time has passed or aes132c_wake() is called.
+ * \param[in] delay_us time to wait in us
+ */
+static void aes132c_block_us(uint32_t delay_us)
+{
+#   if defined(ESP_PLATFORM)
+	const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+
+	if (!aes132c_wake_semaphore)
+		aes132c_wake_semaphore = xSemaphoreCreateBinaryStatic(&aes132c_wake_semaphore_buffer);
+
+	// Round up: waking a tick late costs less than spinning through the remainder.
+	(void) xSemaphoreTake(aes132c_wake_semaphore, (delay_us + tick_us - 1) / tick_us);
+#   else
+	struct timespec deadline;
+
+	(void) pthread_once(&aes132c_wake_once, aes132c_init_wake_condition);
+	(void) clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += delay_us / 1000000;
+	deadline.tv_nsec += (long) (delay_us % 1000000) * 1000;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	(void) pthread_mutex_lock(&aes132c_wake_mutex);
+	while (!aes132c_wake_pending) {
+		if (pthread_cond_timedwait(&aes132c_wake_condition, &aes132c_wake_mutex, &deadline) != 0)
+			break;
+	}
+	aes132c_wake_pending = 0;
+	(void) pthread_mutex_unlock(&aes132c_wake_mutex);
+#   endif
+}
+#endif
+
+
+/** \brief This function waits for a number of microseconds.
+ *
+ * On the target, whole scheduler ticks are spent in vTaskDelay() so that other tasks can
+ * run while the device executes a command. Only the remainder is busy-waited.
+ * With #AES132_YIELDING_WAIT, the whole time is spent blocked (see aes132c_wake()).
+ * \param[in] delay_us time to wait in us
+ */
+void aes132c_delay_us(uint32_t delay_us)
+{
+#if AES132_YIELDING_WAIT
+	aes132c_block_us(delay_us);
+#elif defined(ESP_PLATFORM)
+	const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+	TickType_t ticks = delay_us / tick_us;
+
+	if (ticks > 0) {
+		vTaskDelay(ticks);
+		delay_us -= ticks * tick_us;
+	}
+	if (delay_us > 0)
+		esp_rom_delay_us(delay_us);
+#else
+	struct timespec delay;
+
+	delay.tv_sec = delay_us / 1000000;
+	delay.tv_nsec = (long) (delay_us % 1000000) * 1000;
+	(void) nanosleep(&delay, (struct timespec *) 0);
+#endif
+}
+
+
+/** \brief This function reads a monotonic clock.
+ *
+ * On the target this is esp_timer, on host builds CLOCK_MONOTONIC, the clock that
+ * std::chrono::steady_clock uses. Neither goes backwards when the wall time is set.
+ * \return time in us since an arbitrary start; wraps around at 2^32
+ */
+uint32_t aes132c_now_us(void)
+{
+#if defined(ESP_PLATFORM)
+	return (uint32_t) esp_timer_get_time();
+#else
+	struct timespec now;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t) ((uint64_t) now.tv_sec * 1000000 + (uint64_t) now.tv_nsec / 1000);
+#endif
+}
+
+
+/** \brief This function ends the current or next yielding wait early.
+ *
+ * Call it from another task when the device is known to be done, e.g. from a driver
+ * that saw the device acknowledge its address. Without #AES132_YIELDING_WAIT, it does nothing.
+ */
+void aes132c_wake(void)
+{
+#if AES132_YIELDING_WAIT
+#   if defined(ESP_PLATFORM)
+	if (aes132c_wake_semaphore)
+		(void) xSemaphoreGive(aes132c_wake_semaphore);
+#   else
+	(void) pthread_once(&aes132c_wake_once, aes132c_init_wake_condition);
+	(void) pthread_mutex_lock(&aes132c_wake_mutex);
+	aes132c_wake_pending = 1;
+	(void) pthread_cond_signal(&aes132c_wake_condition);
+	(void) pthread_mutex_unlock(&aes132c_wake_mutex);
+#   endif
+#endif
+}
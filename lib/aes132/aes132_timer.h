@@ -0,0 +1,49 @@
+/** \file
+ *  \brief  Definitions and prototypes for the timer module of the AES132 library.
+ *
+ * The communication layer waits out most of a command's execution time before polling
+ * the device status register (see aes132_opcode.h). This module provides the delay for
+ * the target (FreeRTOS on ESP32) and for host builds.
+ *
+ * Polling time-outs are deadlines on a monotonic microsecond clock, aes132c_now_us().
+ * The clock is 32 bits wide and wraps after about 71 minutes, so compute durations as
+ * unsigned differences, (uint32_t) (aes132c_now_us() - start_us), and never compare
+ * time stamps directly.
+ *
+ * By default, the library busy-waits for the part of a delay that is shorter than a
+ * scheduler tick, and polls the status register back to back. With #AES132_YIELDING_WAIT,
+ * the calling task blocks for every delay instead, rounded up to whole ticks, and sleeps
+ * #AES132_YIELD_POLL_INTERVAL_US between polls. Other tasks get the CPU while the device
+ * executes a command, at the cost of up to one tick of extra latency per wait.
+ * A blocked wait ends early when aes132c_wake() is called.
+ */
+
+#ifndef AES132_TIMER_H
+#   define AES132_TIMER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief Set to 1 to block the calling task instead of busy-waiting.
+ *
+ * Override with a build flag, e.g. -DAES132_YIELDING_WAIT=1. Host builds then need pthreads.
+ */
+#ifndef AES132_YIELDING_WAIT
+#   define AES132_YIELDING_WAIT         (0)
+#endif
+
+//! time in us between two polls of the status register when waiting yields the CPU
+#define AES132_YIELD_POLL_INTERVAL_US   ((uint32_t) 1000)
+
+void aes132c_delay_us(uint32_t delay_us);
+uint32_t aes132c_now_us(void);
+void     aes132c_wake(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
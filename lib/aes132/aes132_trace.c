@@ -0,0 +1,145 @@
+/** \file
+ *  \brief  Trace module of the AES132 library.
+ *
+ * See aes132_trace.h for what is recorded and how it is read out.
+ */
+
+#include <stdint.h>
+
+#include "aes132_timer.h"
+#include "aes132_trace.h"
+
+#if AES132_TRACE_LEVEL > AES132_TRACE_LEVEL_OFF
+
+// The decoder reads events of 12 bytes.
+typedef char aes132c_trace_event_size_check[(sizeof(struct aes132_trace_event) == 12) ? 1 : -1];
+
+//! ring buffer of events
+static struct aes132_trace_event aes132c_trace_events[AES132_TRACE_BUFFER_SIZE];
+
+//! number of events recorded; only the producer writes it
+static uint32_t aes132c_trace_head;
+
+//! number of events read; only the consumer writes it
+static uint32_t aes132c_trace_tail;
+
+//! number of events dropped because the ring buffer was full; only the producer writes it
+static uint32_t aes132c_trace_dropped;
+
+//! value of aes132c_trace_dropped when the last frame was written; only the consumer writes it
+static uint32_t aes132c_trace_dropped_reported;
+
+
+/** \brief This function records an event.
+ *
+ * Call it through AES132_TRACE(), which leaves out events of levels and categories
+ * that are not enabled. The event is dropped if the ring buffer is full.
+ * \param[in] event event, e.g. #AES132_TRACE_BUS_READ
+ * \param[in] result return code
+ * \param[in] arg0 first argument
+ * \param[in] arg1 second argument
+ * \param[in] start_us start of the event; the duration runs from there to now
+ */
+void aes132c_trace_record(uint8_t event, uint8_t result, uint16_t arg0, uint16_t arg1, uint32_t start_us)
+{
+	uint32_t head = aes132c_trace_head;
+	uint32_t duration_us = aes132c_now_us() - start_us;
+	struct aes132_trace_event *slot;
+
+	if (head - __atomic_load_n(&aes132c_trace_tail, __ATOMIC_ACQUIRE) >= AES132_TRACE_BUFFER_SIZE) {
+		__atomic_store_n(&aes132c_trace_dropped, aes132c_trace_dropped + 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	slot = &aes132c_trace_events[head & (AES132_TRACE_BUFFER_SIZE - 1)];
+	slot->time_us = start_us;
+	slot->duration_us = (duration_us > UINT16_MAX) ? UINT16_MAX : (uint16_t) duration_us;
+	slot->event = event;
+	slot->result = result;
+	slot->arg0 = arg0;
+	slot->arg1 = arg1;
+
+	// Publish the event after it has been written.
+	__atomic_store_n(&aes132c_trace_head, head + 1, __ATOMIC_RELEASE);
+}
+
+
+/** \brief This function reads the oldest events and removes them from the ring buffer.
+ * \param[out] events buffer for the events
+ * \param[in] max_events number of events the buffer holds
+ * \return number of events read
+ */
+uint16_t aes132c_trace_read(struct aes132_trace_event *events, uint16_t max_events)
+{
+	uint32_t tail = aes132c_trace_tail;
+	uint32_t available = __atomic_load_n(&aes132c_trace_head, __ATOMIC_ACQUIRE) - tail;
+	uint16_t n_events = (available < max_events) ? (uint16_t) available : max_events;
+	uint16_t i;
+
+	for (i = 0; i < n_events; i++)
+		events[i] = aes132c_trace_events[(tail + i) & (AES132_TRACE_BUFFER_SIZE - 1)];
+
+	// Hand the slots back to the producer after they have been copied.
+	__atomic_store_n(&aes132c_trace_tail, tail + n_events, __ATOMIC_RELEASE);
+
+	return n_events;
+}
+
+
+/** \brief This function writes all recorded events as frames and removes them from the ring buffer.
+ *
+ * A frame is #AES132_TRACE_FRAME_SYNC_0, #AES132_TRACE_FRAME_SYNC_1, the number of events, the
+ * number of events dropped since the previous frame (saturated at 255), and the events.
+ * \param[in] write function that writes the frames
+ * \param[in] context passed to write
+ * \return number of events written
+ */
+uint16_t aes132c_trace_drain(aes132_trace_write_t write, void *context)
+{
+	struct aes132_trace_event events[AES132_TRACE_FRAME_EVENTS_MAX];
+	uint8_t header[4] = {AES132_TRACE_FRAME_SYNC_0, AES132_TRACE_FRAME_SYNC_1, 0, 0};
+	uint16_t n_written = 0;
+	uint16_t n_events;
+	uint32_t dropped;
+
+	do {
+		n_events = aes132c_trace_read(events, AES132_TRACE_FRAME_EVENTS_MAX);
+		dropped = __atomic_load_n(&aes132c_trace_dropped, __ATOMIC_RELAXED) - aes132c_trace_dropped_reported;
+		if ((n_events == 0) && (dropped == 0))
+			break;
+
+		aes132c_trace_dropped_reported += dropped;
+		header[2] = (uint8_t) n_events;
+		header[3] = (dropped > UINT8_MAX) ? UINT8_MAX : (uint8_t) dropped;
+		write(header, sizeof(header), context);
+		if (n_events > 0)
+			write((const uint8_t *) events, (uint16_t) (n_events * sizeof(events[0])), context);
+		n_written += n_events;
+	} while (n_events == AES132_TRACE_FRAME_EVENTS_MAX);
+
+	return n_written;
+}
+
+
+/** \brief This function returns the number of events dropped because the ring buffer was full.
+ * \return number of events dropped since aes132c_trace_reset()
+ */
+uint32_t aes132c_trace_get_dropped(void)
+{
+	return __atomic_load_n(&aes132c_trace_dropped, __ATOMIC_RELAXED);
+}
+
+
+/** \brief This function discards all recorded events and the dropped count.
+ *
+ * Do not call it while the library is in use or events are being read.
+ */
+void aes132c_trace_reset(void)
+{
+	aes132c_trace_head = 0;
+	aes132c_trace_tail = 0;
+	aes132c_trace_dropped = 0;
+	aes132c_trace_dropped_reported = 0;
+}
+
+#endif
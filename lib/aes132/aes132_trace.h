@@ -0,0 +1,147 @@
+/** \file
+ *  \brief  Definitions and prototypes for the trace module of the AES132 library.
+ *
+ * The library records what it does as binary events into a ring buffer in RAM: every bus
+ * transaction (category bus), every command exchange and wait for a response (category comm),
+ * and every command marshaled (category marshal). Recording costs a few stores and never
+ * blocks; the events are read out later, e.g. by a low-priority task that writes them to a
+ * serial port, and scripts/aes132_trace_decode.py turns them back into a readable log:
+ * \code
+ * static void write_serial(const uint8_t *data, uint16_t size, void *context)
+ * {
+ *     Serial.write(data, size);
+ * }
+ * ...
+ * (void) aes132c_trace_drain(write_serial, NULL);   // e.g. in loop()
+ * \endcode
+ * \verbatim python3 scripts/aes132_trace_decode.py capture.bin \endverbatim
+ *
+ * What is traced is chosen at build time with #AES132_TRACE_LEVEL and #AES132_TRACE_CATEGORIES.
+ * Events of other levels and categories do not reach the compiler, and with
+ * #AES132_TRACE_LEVEL 0, the default, the library contains no trace code at all.
+ *
+ * The ring buffer has one producer, the task that uses the library, and one consumer, the task
+ * that calls aes132c_trace_read() or aes132c_trace_drain(). It needs no lock. When it is full,
+ * new events are dropped and counted (see aes132c_trace_get_dropped()).
+ */
+
+#ifndef AES132_TRACE_H
+#   define AES132_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Trace levels. An event is recorded if its level is at most #AES132_TRACE_LEVEL.
+#define AES132_TRACE_LEVEL_OFF          0   //!< no tracing
+#define AES132_TRACE_LEVEL_ERROR        1   //!< recovery from errors, e.g. re-synchronization
+#define AES132_TRACE_LEVEL_INFO         2   //!< commands and their waits
+#define AES132_TRACE_LEVEL_DEBUG        3   //!< every bus transaction
+
+// Trace categories, ORed together in #AES132_TRACE_CATEGORIES.
+#define AES132_TRACE_BUS                0x01   //!< transactions of the transport (aes132p_*)
+#define AES132_TRACE_COMM               0x02   //!< communication layer (aes132c_*)
+#define AES132_TRACE_MARSHAL            0x04   //!< marshaling layer (aes132m_*)
+
+/** \brief highest level of the events to record
+ *
+ * Override with a build flag, e.g. -DAES132_TRACE_LEVEL=2.
+ */
+#ifndef AES132_TRACE_LEVEL
+#   define AES132_TRACE_LEVEL           AES132_TRACE_LEVEL_OFF
+#endif
+
+/** \brief categories of the events to record
+ *
+ * Override with a build flag, e.g. -DAES132_TRACE_CATEGORIES=0x06 for comm and marshal.
+ */
+#ifndef AES132_TRACE_CATEGORIES
+#   define AES132_TRACE_CATEGORIES      (AES132_TRACE_BUS | AES132_TRACE_COMM | AES132_TRACE_MARSHAL)
+#endif
+
+/** \brief number of events the ring buffer holds, a power of two
+ *
+ * Override with a build flag, e.g. -DAES132_TRACE_BUFFER_SIZE=512.
+ */
+#ifndef AES132_TRACE_BUFFER_SIZE
+#   define AES132_TRACE_BUFFER_SIZE     128
+#endif
+
+#if (AES132_TRACE_BUFFER_SIZE < 2) || ((AES132_TRACE_BUFFER_SIZE & (AES132_TRACE_BUFFER_SIZE - 1)) != 0)
+#   error AES132_TRACE_BUFFER_SIZE has to be a power of two.
+#endif
+
+//! non-zero if events of a category and level are recorded; usable in #if
+#define AES132_TRACE_IS_ENABLED(category, level) \
+			((AES132_TRACE_LEVEL >= (level)) && ((AES132_TRACE_CATEGORIES & (category)) != 0))
+
+// Events, with what their arguments hold. Op-code and mode are passed as (op-code << 8) | mode.
+#define AES132_TRACE_BUS_SELECT         0x10   //!< device selected: arg0 device id
+#define AES132_TRACE_BUS_READ           0x11   //!< read: arg0 word address, arg1 size
+#define AES132_TRACE_BUS_WRITE          0x12   //!< write: arg0 word address, arg1 count
+#define AES132_TRACE_BUS_RESYNC         0x13   //!< bus re-synchronized
+#define AES132_TRACE_COMM_EXCHANGE      0x20   //!< command sent and response received: arg0 op-code and mode, arg1 param2
+#define AES132_TRACE_COMM_WAIT          0x21   //!< wait for a response since sending: arg0 op-code and mode, arg1 polls
+#define AES132_TRACE_COMM_RESYNC        0x22   //!< communication re-synchronized
+#define AES132_TRACE_MARSHAL_EXECUTE    0x30   //!< command marshaled and run: arg0 op-code and mode, arg1 param1
+#define AES132_TRACE_MARSHAL_BATCH      0x31   //!< batch run: arg0 number of commands, arg1 policy
+
+/** \brief one recorded event, 12 bytes
+ *
+ * aes132c_trace_drain() writes events as they are in memory, i.e. little-endian on the ESP32.
+ */
+struct aes132_trace_event {
+	uint32_t time_us;       //!< start of the event (aes132c_now_us())
+	uint16_t duration_us;   //!< duration of the event, saturated at 65535
+	uint8_t event;          //!< event, e.g. #AES132_TRACE_BUS_READ
+	uint8_t result;         //!< return code
+	uint16_t arg0;          //!< first argument of the event
+	uint16_t arg1;          //!< second argument of the event
+};
+
+//! first bytes of a frame written by aes132c_trace_drain()
+#define AES132_TRACE_FRAME_SYNC_0       ((uint8_t) 0xAE)
+#define AES132_TRACE_FRAME_SYNC_1       ((uint8_t) 0x13)
+
+//! maximum number of events per frame
+#define AES132_TRACE_FRAME_EVENTS_MAX   ((uint8_t) 16)
+
+/** \brief writes bytes of a frame, e.g. to a serial port
+ * \param[in] data bytes to write
+ * \param[in] size number of bytes
+ * \param[in] context context passed to aes132c_trace_drain()
+ */
+typedef void (*aes132_trace_write_t)(const uint8_t *data, uint16_t size, void *context);
+
+#if AES132_TRACE_LEVEL > AES132_TRACE_LEVEL_OFF
+void    aes132c_trace_record(uint8_t event, uint8_t result, uint16_t arg0, uint16_t arg1, uint32_t start_us);
+uint16_t aes132c_trace_read(struct aes132_trace_event *events, uint16_t max_events);
+uint16_t aes132c_trace_drain(aes132_trace_write_t write, void *context);
+uint32_t aes132c_trace_get_dropped(void);
+void    aes132c_trace_reset(void);
+
+/** \brief records an event if its category and level are enabled
+ * \param[in] category category of the event, e.g. #AES132_TRACE_COMM
+ * \param[in] level level of the event, e.g. #AES132_TRACE_LEVEL_INFO
+ * \param[in] event event, e.g. #AES132_TRACE_COMM_EXCHANGE
+ * \param[in] result return code
+ * \param[in] arg0 first argument
+ * \param[in] arg1 second argument
+ * \param[in] start_us start of the event; the duration runs from there to now
+ */
+#   define AES132_TRACE(category, level, event, result, arg0, arg1, start_us) \
+			do { \
+				if (AES132_TRACE_IS_ENABLED(category, level)) \
+					aes132c_trace_record((event), (result), (uint16_t) (arg0), (uint16_t) (arg1), (start_us)); \
+			} while (0)
+#else
+#   define AES132_TRACE(category, level, event, result, arg0, arg1, start_us)   ((void) 0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+/** \file
+ *  \brief  Transport interface of the AES132 library.
+ *
+ * See aes132_transport.h for how backends are plugged in.
+ */
+
+#include <stdint.h>
+
+#include "aes132_comm.h"
+#include "aes132_transport.h"
+
+extern const struct aes132_transport AES132_TRANSPORT_DEFAULT;
+
+const struct aes132_transport *aes132c_transport = &AES132_TRANSPORT_DEFAULT;
+
+
+/** \brief This function makes the aes132p_* functions call a transport.
+ *
+ * aes132c_select_device_transport() calls it. Call that instead, so that the transport
+ * stays with the device when another one is selected.
+ * \param[in] transport transport to use, or NULL for #AES132_TRANSPORT_DEFAULT
+ */
+void aes132c_use_transport(const struct aes132_transport *transport)
+{
+	aes132c_transport = transport ? transport : &AES132_TRANSPORT_DEFAULT;
+}
+
+
+/** \brief This function returns the transport of the selected device.
+ * \return transport
+ */
+const struct aes132_transport *aes132c_get_transport(void)
+{
+	return aes132c_transport;
+}
+
+
+/** \brief This function sets the clock of the transport of the selected device.
+ * \param[in] clock_hz clock in Hz
+ * \return status of the operation; #AES132_FUNCTION_RETCODE_NOT_IMPLEMENTED if the transport
+ *         cannot change its clock
+ */
+uint8_t aes132p_set_clock(uint32_t clock_hz)
+{
+	if (!aes132c_transport->set_clock)
+		return AES132_FUNCTION_RETCODE_NOT_IMPLEMENTED;
+
+	return aes132c_transport->set_clock(aes132c_transport->context, clock_hz);
+}
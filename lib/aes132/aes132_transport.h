@@ -0,0 +1,218 @@
+/** \file
+ *  \brief  Definitions and prototypes for the transport interface of the AES132 library.
+ *
+ * The communication layer reaches the device through the aes132p_* functions. They call
+ * the functions of a transport, a table of function pointers with a context pointer, so
+ * that a backend can be plugged in without relinking the library: a bus driver, a fake
+ * device on a host, or a wrapper that traces the calls of another transport.
+ *
+ * Every device has its own transport. aes132c_select_device_transport() sets it when
+ * selecting the device, and aes132c_select_device() switches to it. Devices that have
+ * not been given one use #AES132_TRANSPORT_DEFAULT.
+ *
+ * The aes132p_* functions are inline and load the transport of the selected device from one
+ * pointer, so calling through the transport costs an indirect call where the library used to
+ * make a direct one (bench/transport measures both). They also record the transactions of
+ * every transport as trace events of category #AES132_TRACE_BUS (see aes132_trace.h), and
+ * with #AES132_CLOCK_MANAGER, the bytes and time of every successful read and write for the
+ * throughput at each clock rate (see aes132_clock.h).
+ */
+
+#ifndef AES132_TRANSPORT_H
+#   define AES132_TRANSPORT_H
+
+#include <stdint.h>
+
+#include "aes132_clock.h"
+#include "aes132_timer.h"
+#include "aes132_trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief transport of devices that have not been given one
+ *
+ * aes132_i2c_master_transport if #AES132_I2C_MASTER is set, else aes132_spi_transport if AES132_SPI
+ * is set, else aes132_i2c_transport.
+ * Override with a build flag, e.g. -DAES132_TRANSPORT_DEFAULT=aes132_wire_transport.
+ * Host builds without a bus driver name their own, e.g. a fake device.
+ */
+#ifndef AES132_TRANSPORT_DEFAULT
+#   if defined(AES132_I2C_MASTER) && AES132_I2C_MASTER
+#      define AES132_TRANSPORT_DEFAULT  aes132_i2c_master_transport
+#   elif defined(AES132_SPI) && AES132_SPI
+#      define AES132_TRANSPORT_DEFAULT  aes132_spi_transport
+#   else
+#      define AES132_TRANSPORT_DEFAULT  aes132_i2c_transport
+#   endif
+#endif
+
+/** \brief one piece of the bytes written to the device by aes132p_write_memory_physical_segments()
+ *
+ * A command can be passed as header, data blocks and CRC where they are instead of
+ * being copied into one buffer first.
+ */
+struct aes132_segment {
+	const uint8_t *data;    //!< pointer to bytes to write
+	uint8_t count;          //!< number of bytes to write
+};
+
+//! maximum number of segments per write: command header, four data blocks, and CRC
+#define AES132_SEGMENT_COUNT_MAX          ((uint8_t) 6)
+
+/** \brief functions of a backend that reaches the device
+ *
+ * Every function gets aes132_transport::context as its first argument. The functions
+ * return the codes of the physical layer, e.g. #AES132_FUNCTION_RETCODE_COMM_FAIL for a nack.
+ */
+struct aes132_transport {
+	//! initializes and enables the interface
+	void    (*enable_interface)(void *context);
+	//! disables the interface
+	void    (*disable_interface)(void *context);
+	//! selects a device by its device id (I2C address)
+	uint8_t (*select_device)(void *context, uint8_t device_id);
+	//! reads size bytes from a word address
+	uint8_t (*read_memory)(void *context, uint8_t size, uint16_t word_address, uint8_t *data);
+	//! writes segments to a word address in one transfer
+	uint8_t (*write_memory_segments)(void *context, uint16_t word_address, const struct aes132_segment *segments,
+				uint8_t n_segments);
+	//! re-synchronizes communication
+	uint8_t (*resync)(void *context);
+	//! sets the clock of the transactions that follow in Hz, kept across disabling and enabling the
+	//! interface; NULL if the clock cannot be changed
+	uint8_t (*set_clock)(void *context, uint32_t clock_hz);
+	//! passed to every function, e.g. the state of a fake device or the transport a wrapper calls
+	void    *context;
+};
+
+//! transport of the selected device; set it with aes132c_select_device_transport()
+extern const struct aes132_transport *aes132c_transport;
+
+void    aes132c_use_transport(const struct aes132_transport *transport);
+const struct aes132_transport *aes132c_get_transport(void);
+uint8_t aes132p_set_clock(uint32_t clock_hz);
+
+
+/** \brief This function initializes and enables the interface of the selected device. */
+static inline void aes132p_enable_interface(void)
+{
+	aes132c_transport->enable_interface(aes132c_transport->context);
+}
+
+
+/** \brief This function disables the interface of the selected device. */
+static inline void aes132p_disable_interface(void)
+{
+	aes132c_transport->disable_interface(aes132c_transport->context);
+}
+
+
+/** \brief This function selects a device on the transport of the selected device.
+ * \param[in] device_id device id (I2C address)
+ * \return status of the operation
+ */
+static inline uint8_t aes132p_select_device(uint8_t device_id)
+{
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_BUS, AES132_TRACE_LEVEL_DEBUG)
+	uint32_t start_us = aes132c_now_us();
+	uint8_t aes132_lib_return = aes132c_transport->select_device(aes132c_transport->context, device_id);
+
+	aes132c_trace_record(AES132_TRACE_BUS_SELECT, aes132_lib_return, device_id, 0, start_us);
+	return aes132_lib_return;
+#else
+	return aes132c_transport->select_device(aes132c_transport->context, device_id);
+#endif
+}
+
+
+/** \brief This function reads bytes from the device.
+ * \param[in] size number of bytes to read
+ * \param[in] word_address word address to read from
+ * \param[out] data pointer to rx buffer
+ * \return status of the operation
+ */
+static inline uint8_t aes132p_read_memory_physical(uint8_t size, uint16_t word_address, uint8_t *data)
+{
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_BUS, AES132_TRACE_LEVEL_DEBUG) || AES132_CLOCK_MANAGER
+	uint32_t start_us = aes132c_now_us();
+	uint8_t aes132_lib_return = aes132c_transport->read_memory(aes132c_transport->context, size, word_address, data);
+
+	AES132_TRACE(AES132_TRACE_BUS, AES132_TRACE_LEVEL_DEBUG, AES132_TRACE_BUS_READ, aes132_lib_return, word_address,
+				size, start_us);
+	if (AES132_CLOCK_MANAGER)
+		aes132c_record_clock_transfer(size, start_us, aes132_lib_return);
+	return aes132_lib_return;
+#else
+	return aes132c_transport->read_memory(aes132c_transport->context, size, word_address, data);
+#endif
+}
+
+
+/** \brief This function writes several buffers to the device in one transfer.
+ * \param[in] word_address word address to write to
+ * \param[in] segments buffers to write, in order
+ * \param[in] n_segments number of segments (at most #AES132_SEGMENT_COUNT_MAX)
+ * \return status of the operation
+ */
+static inline uint8_t aes132p_write_memory_physical_segments(uint16_t word_address,
+			const struct aes132_segment *segments, uint8_t n_segments)
+{
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_BUS, AES132_TRACE_LEVEL_DEBUG) || AES132_CLOCK_MANAGER
+	uint32_t start_us = aes132c_now_us();
+	uint16_t count = 0;
+	uint8_t i;
+	uint8_t aes132_lib_return = aes132c_transport->write_memory_segments(aes132c_transport->context, word_address,
+				segments, n_segments);
+
+	for (i = 0; i < n_segments; i++)
+		count += segments[i].count;
+	AES132_TRACE(AES132_TRACE_BUS, AES132_TRACE_LEVEL_DEBUG, AES132_TRACE_BUS_WRITE, aes132_lib_return, word_address,
+				count, start_us);
+	if (AES132_CLOCK_MANAGER)
+		aes132c_record_clock_transfer((uint8_t) count, start_us, aes132_lib_return);
+	return aes132_lib_return;
+#else
+	return aes132c_transport->write_memory_segments(aes132c_transport->context, word_address, segments, n_segments);
+#endif
+}
+
+
+/** \brief This function writes bytes to the device.
+ * \param[in] count number of bytes to write
+ * \param[in] word_address word address to write to
+ * \param[in] data pointer to tx buffer
+ * \return status of the operation
+ */
+static inline uint8_t aes132p_write_memory_physical(uint8_t count, uint16_t word_address, uint8_t *data)
+{
+	struct aes132_segment segment = {data, count};
+
+	return aes132p_write_memory_physical_segments(word_address, &segment, 1);
+}
+
+
+/** \brief This function resynchronizes communication.
+ * \return status of the operation
+ */
+static inline uint8_t aes132p_resync_physical(void)
+{
+#if AES132_TRACE_IS_ENABLED(AES132_TRACE_BUS, AES132_TRACE_LEVEL_DEBUG)
+	uint32_t start_us = aes132c_now_us();
+	uint8_t aes132_lib_return = aes132c_transport->resync(aes132c_transport->context);
+
+	aes132c_trace_record(AES132_TRACE_BUS_RESYNC, aes132_lib_return, 0, 0, start_us);
+	return aes132_lib_return;
+#else
+	return aes132c_transport->resync(aes132c_transport->context);
+#endif
+}
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
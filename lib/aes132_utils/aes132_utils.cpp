@@ -5,6 +5,9 @@
 
 #include "aes132_utils.h"
 #include "aes132_comm_marshaling.h"
+#include "aes132_device.h"
+#include "aes132_i2c_master.h"
+#include "aes132_spi.h"
 #include "i2c_phys.h"
 #include <Arduino.h>
 #include <stdio.h>
@@ -18,12 +21,18 @@ uint8_t aes132_init(void) {
 
     // I2C 핀 설정
     i2c_set_pins(AES132_SDA_PIN, AES132_SCL_PIN);
+#if AES132_I2C_MASTER
+    aes132_i2c_master_set_pins(AES132_SDA_PIN, AES132_SCL_PIN);
+#endif
+#if AES132_SPI
+    aes132_spi_set_pins(AES132_SPI_MOSI_PIN, AES132_SPI_MISO_PIN, AES132_SPI_SCLK_PIN, AES132_SPI_CS_PIN);
+#endif
 
     // I2C 인터페이스 활성화
     aes132p_enable_interface();
 
     // AES132 디바이스 선택
-    ret = aes132p_select_device(AES132_I2C_ADDRESS);
+    ret = aes132c_select_device(AES132_I2C_ADDRESS);
     if (ret != AES132_FUNCTION_RETCODE_SUCCESS) {
         return ret;
     }
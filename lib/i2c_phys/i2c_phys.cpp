@@ -42,6 +42,9 @@ uint8_t i2c_address_current = I2C_DEFAULT_ADDRESS;
 static int sda_pin = 21;
 static int scl_pin = 22;
 
+// I2C clock, set by i2c_set_clock_phys()
+static uint32_t clock_hz = I2C_CLOCK_FREQ;
+
 /** \brief This function selects a I2C AES132 device.
  *
  * @param[in] device_id I2C address
@@ -56,7 +59,7 @@ uint8_t i2c_select_device_phys(uint8_t device_id) {
  */
 void i2c_enable_phys(void) {
   Wire.begin(sda_pin, scl_pin);
-  Wire.setClock(I2C_CLOCK_FREQ);
+  Wire.setClock(clock_hz);
 }
 
 /** \brief This function disables the I2C peripheral.
@@ -93,10 +96,27 @@ static bool need_repeated_start = false;
  * \return status of the operation
  */
 uint8_t i2c_send_bytes(uint8_t count, uint8_t *data) {
+  struct i2c_segment segment = {data, count};
+
+  return i2c_send_segments(1, &segment);
+}
+
+/** \brief This function sends several buffers to an I2C device in one transfer.
+ *
+ * The buffers are written back to back between one Start and one Stop
+ * condition, so the caller does not have to copy them into one buffer first.
+ * \param[in] n_segments number of segments
+ * \param[in] segments buffers to send, in order
+ * \return status of the operation
+ */
+uint8_t i2c_send_segments(uint8_t n_segments,
+                          const struct i2c_segment *segments) {
   Wire.beginTransmission(i2c_address_current >> 1);
 
-  for (uint8_t i = 0; i < count; i++) {
-    Wire.write(data[i]);
+  for (uint8_t i = 0; i < n_segments; i++) {
+    if (segments[i].count > 0) {
+      Wire.write(segments[i].data, segments[i].count);
+    }
   }
 
   // ESP32 Wire library: endTransmission(sendStop)
@@ -171,6 +191,18 @@ void i2c_set_pins(int sda, int scl) {
   scl_pin = scl;
 }
 
+/** \brief This function sets the I2C clock.
+ *
+ * It takes effect at once, and is kept when the peripheral is enabled again.
+ * \param[in] clock I2C clock in Hz, e.g. 1000000 for Fast-mode Plus
+ * \return status of the operation
+ */
+uint8_t i2c_set_clock_phys(uint32_t clock) {
+  clock_hz = clock;
+  Wire.setClock(clock_hz);
+  return I2C_FUNCTION_RETCODE_SUCCESS;
+}
+
 #ifdef __cplusplus
 }
 #endif
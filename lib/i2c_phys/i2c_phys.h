@@ -58,6 +58,12 @@ extern "C" {
 #define I2C_FUNCTION_RETCODE_TIMEOUT     ((uint8_t) 0xF1) //!< Communication timed out.
 #define I2C_FUNCTION_RETCODE_NACK        ((uint8_t) 0xF8) //!< I2C nack
 
+//! one piece of the bytes sent in a single transfer by #i2c_send_segments()
+struct i2c_segment {
+	const uint8_t *data;	//!< pointer to bytes to send
+	uint8_t count;			//!< number of bytes to send
+};
+
 
 // Function prototypes to be implemented in the target i2c_phys.c
 void    i2c_enable_phys(void);
@@ -66,10 +72,12 @@ uint8_t i2c_select_device_phys(uint8_t device_id);
 uint8_t i2c_send_start(void);
 uint8_t i2c_send_stop(void);
 uint8_t i2c_send_bytes(uint8_t count, uint8_t *data);
+uint8_t i2c_send_segments(uint8_t n_segments, const struct i2c_segment *segments);
 uint8_t i2c_receive_byte(uint8_t *data);
 uint8_t i2c_receive_bytes(uint8_t count, uint8_t *data);
 uint8_t i2c_send_slave_address(uint8_t read);
 void i2c_set_pins(int sda, int scl);
+uint8_t i2c_set_clock_phys(uint32_t clock);
 
 // External access to current I2C address
 extern uint8_t i2c_address_current;
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Decode trace frames written by aes132c_trace_drain() (lib/aes132/aes132_trace.h).
+
+Usage: python3 scripts/aes132_trace_decode.py <capture.bin | ->
+
+A frame is 0xAE 0x13, the number of events, the number of events dropped before
+it, and the events of 12 bytes each (little-endian). Bytes between frames, e.g.
+text printed to the same serial port, are skipped.
+"""
+
+import struct
+import sys
+
+FRAME_SYNC = b"\xAE\x13"
+FRAME_EVENTS_MAX = 16
+EVENT = struct.Struct("<IHBBHH")
+
+EVENTS = {
+    0x10: ("bus", "select"),
+    0x11: ("bus", "read"),
+    0x12: ("bus", "write"),
+    0x13: ("bus", "resync"),
+    0x20: ("comm", "exchange"),
+    0x21: ("comm", "wait"),
+    0x22: ("comm", "resync"),
+    0x30: ("marshal", "execute"),
+    0x31: ("marshal", "batch"),
+}
+
+OP_CODES = {
+    0x00: "Reset", 0x01: "Nonce", 0x02: "Random", 0x03: "Auth",
+    0x04: "EncRead", 0x05: "EncWrite", 0x06: "Encrypt", 0x07: "Decrypt",
+    0x08: "KeyCreate", 0x09: "KeyLoad", 0x0A: "Counter", 0x0B: "Crunch",
+    0x0C: "Info", 0x0D: "Lock", 0x0E: "TempSense", 0x0F: "Legacy",
+    0x10: "BlockRead", 0x11: "Sleep", 0x13: "NonceCompute", 0x14: "AuthCompute",
+    0x15: "AuthCheck", 0x19: "KeyImport", 0x1A: "KeyTransfer",
+}
+
+ADDRESSES = {0xFE00: "IO", 0xFFE0: "RESET", 0xFFF0: "STATUS"}
+
+RESULTS = {
+    0x00: "ok",
+    0xA0: "ADDRESS_WRITE_NACK", 0xA1: "ADDRESS_READ_NACK", 0xA2: "SIZE_TOO_SMALL",
+    0xD4: "BAD_CRC_TX", 0xE0: "NOT_IMPLEMENTED", 0xE2: "BAD_PARAM",
+    0xE3: "DEVICE_SELECT_FAIL", 0xE4: "COUNT_INVALID", 0xE5: "BAD_CRC_RX",
+    0xE7: "TIMEOUT", 0xE8: "NOT_EXECUTED", 0xE9: "NO_FRAME", 0xF0: "COMM_FAIL",
+}
+
+BATCH_POLICIES = {0x00: "abort-on-error", 0x01: "continue-on-error"}
+
+
+def command(arg0):
+    op_code, mode = arg0 >> 8, arg0 & 0xFF
+    return "%s mode=0x%02X" % (OP_CODES.get(op_code, "0x%02X" % op_code), mode)
+
+
+def address(arg0):
+    return ADDRESSES.get(arg0, "0x%04X" % arg0)
+
+
+def arguments(event, arg0, arg1):
+    if event == 0x10:
+        return "device=0x%02X" % arg0
+    if event == 0x11:
+        return "%s size=%d" % (address(arg0), arg1)
+    if event == 0x12:
+        return "%s count=%d" % (address(arg0), arg1)
+    if event == 0x20:
+        return "%s param2=0x%04X" % (command(arg0), arg1)
+    if event == 0x21:
+        return "%s polls=%d" % (command(arg0), arg1)
+    if event == 0x30:
+        return "%s param1=0x%04X" % (command(arg0), arg1)
+    if event == 0x31:
+        return "commands=%d %s" % (arg0, BATCH_POLICIES.get(arg1, "policy=0x%02X" % arg1))
+    return ""
+
+
+def format_event(data):
+    time_us, duration_us, event, result, arg0, arg1 = EVENT.unpack(data)
+    category, name = EVENTS.get(event, ("?", "event 0x%02X" % event))
+    duration = ">=65.535 ms" if duration_us == 0xFFFF else "%.3f ms" % (duration_us / 1000.0)
+    return "%12.3f ms  %-7s %-8s %-18s %s  %s" % (
+        time_us / 1000.0, category, name, RESULTS.get(result, "0x%02X" % result),
+        duration, arguments(event, arg0, arg1))
+
+
+def decode(data, out):
+    """Print the events of all frames in data; return the number of events and of dropped events."""
+    n_events = n_dropped = 0
+    position = 0
+    while True:
+        start = data.find(FRAME_SYNC, position)
+        if start < 0 or start + 4 > len(data):
+            break
+        count, dropped = data[start + 2], data[start + 3]
+        end = start + 4 + count * EVENT.size
+        if count > FRAME_EVENTS_MAX or end > len(data):
+            # Not a frame, or a frame cut off at the end of the capture.
+            position = start + 1
+            continue
+        if dropped:
+            out.write("%s  dropped %d%s event(s)\n" % (" " * 13, dropped, "+" if dropped == 0xFF else ""))
+            n_dropped += dropped
+        for offset in range(start + 4, end, EVENT.size):
+            out.write(format_event(data[offset:offset + EVENT.size]) + "\n")
+        n_events += count
+        position = end
+    return n_events, n_dropped
+
+
+def main(argv):
+    if len(argv) != 2:
+        sys.stderr.write(__doc__)
+        return 2
+    if argv[1] == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(argv[1], "rb") as capture:
+            data = capture.read()
+    n_events, n_dropped = decode(data, sys.stdout)
+    sys.stdout.write("%d event(s), %d dropped\n" % (n_events, n_dropped))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -1,5 +1,19 @@
+#include "aes132_async.h"
+#include "aes132_clock.h"
+#include "aes132_command_packet.h"
+#include "aes132_commands.h"
 #include "aes132_comm.h"
 #include "aes132_comm_marshaling.h"
+#include "aes132_crc.h"
+#include "aes132_device.h"
+#include "aes132_fake_device.h"
+#include "aes132_opcode.h"
+#include "aes132_poller.h"
+#include "aes132_power.h"
+#include "aes132_retry.h"
+#include "aes132_timer.h"
+#include "aes132_trace.h"
+#include "aes132_transport.h"
 #include <Arduino.h>
 #include <unity.h>
 
@@ -46,6 +60,1145 @@ void test_crc_calculation_standby_command(void) {
   TEST_ASSERT_EQUAL_HEX8(0x82, crc[1]);
 }
 
+/**
+ * @brief Test that the nibble and byte table CRCs match the bitwise reference
+ * Data: Sleep and Standby command vectors plus every length up to the maximum
+ * command size of a pseudo-random buffer
+ */
+void test_crc_table_variants_match_bitwise(void) {
+  const uint8_t sleep[] = {0x09, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00};
+  const uint8_t standby[] = {0x09, 0x11, 0x40, 0x00, 0x00, 0x00, 0x00};
+  uint8_t data[AES132_COMMAND_SIZE_MAX];
+  uint8_t expected[2];
+  uint8_t crc[2];
+
+  aes132c_calculate_crc_nibble(sizeof(sleep), sleep, crc);
+  TEST_ASSERT_EQUAL_HEX8(0x71, crc[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x81, crc[1]);
+  aes132c_calculate_crc_table(sizeof(sleep), sleep, crc);
+  TEST_ASSERT_EQUAL_HEX8(0x71, crc[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x81, crc[1]);
+
+  aes132c_calculate_crc_nibble(sizeof(standby), standby, crc);
+  TEST_ASSERT_EQUAL_HEX8(0xEF, crc[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x82, crc[1]);
+  aes132c_calculate_crc_table(sizeof(standby), standby, crc);
+  TEST_ASSERT_EQUAL_HEX8(0xEF, crc[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x82, crc[1]);
+
+  for (uint8_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i * 37 + 11);
+  }
+  for (uint8_t length = 0; length <= sizeof(data); length++) {
+    aes132c_calculate_crc_bitwise(length, data, expected);
+    aes132c_calculate_crc_nibble(length, data, crc);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, crc, 2);
+    aes132c_calculate_crc_table(length, data, crc);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, crc, 2);
+  }
+}
+
+/**
+ * @brief Test that compile-time generated packets match runtime marshaling
+ * Data: Info DevRev (0C 00 0000 0000) and Nonce with a 12-byte zero seed
+ */
+void test_fixed_command_matches_runtime_crc(void) {
+  const auto &info = aes132::fixed_command<AES132_INFO, 0>;
+  uint8_t packet[AES132_COMMAND_SIZE_MAX];
+  uint8_t crc[2];
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_SIZE_MIN, info.size);
+  TEST_ASSERT_EQUAL_HEX8(AES132_COMMAND_SIZE_MIN, info.bytes[0]);
+  TEST_ASSERT_EQUAL_HEX8(AES132_INFO, info.bytes[1]);
+  memcpy(packet, info.bytes, info.size);
+  aes132c_calculate_crc(info.size - 2, packet, crc);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(crc, &info.bytes[info.size - 2], 2);
+
+  const auto &nonce = aes132::fixed_command<AES132_NONCE, 1, 0, 0, 0, 0, 0, 0,
+                                            0, 0, 0, 0, 0, 0, 0, 0>;
+  TEST_ASSERT_EQUAL_UINT8(21, nonce.size);
+  memcpy(packet, nonce.bytes, nonce.size);
+  aes132c_calculate_crc(nonce.size - 2, packet, crc);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(crc, &nonce.bytes[nonce.size - 2], 2);
+
+  const uint8_t sleep[] = AES132_COMMAND_PACKET_SLEEP;
+  const auto &generated = aes132::fixed_command<AES132_SLEEP, AES132_COMMAND_MODE_SLEEP>;
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(sleep, generated.bytes, sizeof(sleep));
+}
+
+/**
+ * @brief Test that the incremental CRC over pieces equals the one-shot CRC
+ * Data: Encrypt command header followed by a 16-byte block, fed in two pieces
+ * with aes132c_crc_update() and aes132c_crc_copy()
+ */
+void test_crc_incremental_matches_one_shot(void) {
+  const uint8_t header[] = {0x19, AES132_ENCRYPT, 0x00, 0x00, 0x00, 0x00, 0x10};
+  uint8_t block[16];
+  uint8_t packet[sizeof(header) + sizeof(block)];
+  uint8_t expected[2];
+  uint8_t crc[2];
+  struct aes132_crc_context context;
+
+  for (uint8_t i = 0; i < sizeof(block); i++) {
+    block[i] = i;
+  }
+  memcpy(packet, header, sizeof(header));
+  memcpy(&packet[sizeof(header)], block, sizeof(block));
+  aes132c_calculate_crc(sizeof(packet), packet, expected);
+
+  uint8_t copy[sizeof(block)];
+  aes132c_crc_init(&context);
+  aes132c_crc_update(&context, sizeof(header), header);
+  uint8_t *end = aes132c_crc_copy(&context, copy, sizeof(block), block);
+  aes132c_crc_final(&context, crc);
+
+  TEST_ASSERT_EQUAL_PTR(&copy[sizeof(copy)], end);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(block, copy, sizeof(block));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, crc, 2);
+}
+
+/**
+ * @brief Test that patching a prepared command keeps its CRC valid
+ * Data: BlockRead walking addresses (param1) and Encrypt with changing data
+ */
+void test_prepared_command_patch_keeps_crc_valid(void) {
+  struct aes132_prepared_command block_read;
+  struct aes132_prepared_command encrypt;
+  uint8_t block[16];
+  uint8_t crc[2];
+
+  aes132m_prepare(&block_read, AES132_BLOCK_READ, 0, 0x0000, 4, 0, NULL, 0,
+                  NULL, 0, NULL, 0, NULL);
+  for (uint16_t address = 0xF080; address < 0xF0C0; address += 4) {
+    aes132m_prepared_set_param1(&block_read, address);
+    TEST_ASSERT_EQUAL_HEX8(address >> 8, block_read.command[3]);
+    TEST_ASSERT_EQUAL_HEX8(address & 0xFF, block_read.command[4]);
+    aes132c_calculate_crc(7, block_read.command, crc);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(crc, &block_read.command[7], 2);
+  }
+
+  TEST_ASSERT_EQUAL_HEX8(AES132_FUNCTION_RETCODE_SUCCESS,
+                         aes132m_prepare(&encrypt, AES132_ENCRYPT, 0, 0, 16, 16,
+                                         NULL, 0, NULL, 0, NULL, 0, NULL));
+  for (uint8_t round = 0; round < 4; round++) {
+    for (uint8_t i = 0; i < sizeof(block); i++) {
+      block[i] = (uint8_t)(round * 16 + i * 7);
+    }
+    TEST_ASSERT_EQUAL_HEX8(
+        AES132_FUNCTION_RETCODE_SUCCESS,
+        aes132m_prepared_set_data(&encrypt, 0, sizeof(block), block));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(block, &encrypt.command[7], sizeof(block));
+    aes132c_calculate_crc(23, encrypt.command, crc);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(crc, &encrypt.command[23], 2);
+  }
+  aes132m_prepared_set_param1(&encrypt, 1);
+  aes132c_calculate_crc(23, encrypt.command, crc);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(crc, &encrypt.command[23], 2);
+
+  // Data beyond the prepared data blocks must be rejected.
+  TEST_ASSERT_EQUAL_HEX8(AES132_FUNCTION_RETCODE_BAD_PARAM,
+                         aes132m_prepared_set_data(&encrypt, 8, 16, block));
+}
+
+/**
+ * @brief Test the command and response sizes of the typed command API
+ * Data: response sizes used by the examples (Info 6, Random 20, Encrypt 36)
+ * and the limits of the packet sizes
+ */
+void test_typed_command_sizes(void) {
+  static_assert(aes132::Info::response_size == 6, "Info response");
+  static_assert(aes132::Random::response_size == 20, "Random response");
+  static_assert(aes132::Encrypt<16>::response_size == 36, "Encrypt response");
+  static_assert(sizeof(aes132::Encrypt<16>::Response) == 36, "exact buffer");
+  static_assert(aes132::EncRead<32>::response_size == AES132_RESPONSE_SIZE_MAX,
+                "largest response");
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_SIZE_MIN + 16,
+                          aes132::Encrypt<16>::command_size);
+  TEST_ASSERT_EQUAL_UINT8(18, aes132::Encrypt<16>::ciphertext_offset);
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_SIZE_MIN + 32,
+                          aes132::Decrypt<16>::command_size);
+  TEST_ASSERT_EQUAL_UINT8(4 + 8, aes132::BlockRead<8>::response_size);
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_SIZE_MIN + 16,
+                          aes132::Auth<1>::command_size);
+  TEST_ASSERT_EQUAL_UINT8(AES132_RESPONSE_SIZE_MIN, aes132::Auth<1>::response_size);
+  TEST_ASSERT_EQUAL_UINT8(AES132_RESPONSE_SIZE_MIN + 16,
+                          aes132::Auth<3>::response_size);
+  TEST_ASSERT_EQUAL_UINT8(16, aes132::Nonce<1>::response_size);
+  TEST_ASSERT_EQUAL_UINT8(AES132_RESPONSE_SIZE_MIN, aes132::Nonce<0>::response_size);
+}
+
+/**
+ * @brief Test that a response view points into the receive buffer
+ * Data: Encrypt<16> response (MAC 0x10.., ciphertext 0x20..), a four-byte
+ * response with success code and a failed execute() result
+ */
+void test_response_view_fields(void) {
+  using Encrypt = aes132::Encrypt<16>;
+  Encrypt::Response response;
+
+  response.bytes[AES132_RESPONSE_INDEX_COUNT] = Encrypt::response_size;
+  response.bytes[AES132_RESPONSE_INDEX_RETURN_CODE] = AES132_DEVICE_RETCODE_SUCCESS;
+  for (uint8_t i = 0; i < 16; i++) {
+    response.bytes[Encrypt::out_mac_offset + i] = 0x10 + i;
+    response.bytes[Encrypt::ciphertext_offset + i] = 0x20 + i;
+  }
+  aes132c_calculate_crc(Encrypt::response_size - AES132_CRC_SIZE, response.bytes,
+                        &response.bytes[Encrypt::response_size - AES132_CRC_SIZE]);
+
+  Encrypt::View view(AES132_FUNCTION_RETCODE_SUCCESS, response);
+  TEST_ASSERT_TRUE(view.ok());
+  TEST_ASSERT_EQUAL_PTR(&response.bytes[Encrypt::out_mac_offset], view.out_mac().data());
+  TEST_ASSERT_EQUAL_PTR(&response.bytes[Encrypt::ciphertext_offset],
+                        view.ciphertext().data());
+  TEST_ASSERT_EQUAL_UINT8(16, view.ciphertext().size());
+  TEST_ASSERT_EQUAL_UINT8(0x2F, view.ciphertext()[15]);
+  TEST_ASSERT_EQUAL_UINT8(32, view.data().size());
+
+  // A view over a max-size buffer sees the same fields.
+  Encrypt::View raw_view(AES132_FUNCTION_RETCODE_SUCCESS, response.bytes);
+  TEST_ASSERT_TRUE(raw_view.ok());
+  TEST_ASSERT_EQUAL_UINT8(0x10, raw_view.out_mac()[0]);
+
+  // A consistent response of the wrong size is rejected.
+  response.bytes[AES132_RESPONSE_INDEX_COUNT] = AES132_RESPONSE_SIZE_MIN;
+  Encrypt::View short_view(AES132_FUNCTION_RETCODE_SUCCESS, response);
+  TEST_ASSERT_FALSE(short_view.ok());
+  TEST_ASSERT_EQUAL_HEX8(AES132_FUNCTION_RETCODE_COUNT_INVALID, short_view.status());
+
+  // The result of execute() is passed through.
+  Encrypt::View failed_view(AES132_FUNCTION_RETCODE_BAD_CRC_RX, response);
+  TEST_ASSERT_EQUAL_HEX8(AES132_FUNCTION_RETCODE_BAD_CRC_RX, failed_view.status());
+}
+
+/**
+ * @brief Test that the op-code descriptor table agrees with the typed command API
+ * Data: response sizes of aes132_commands.h for every op-code with a response,
+ * in the modes and lengths that change the size
+ */
+void test_opcode_response_sizes(void) {
+  TEST_ASSERT_EQUAL_UINT8(aes132::Info::response_size,
+                          aes132c_get_response_size(AES132_INFO, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Random::response_size,
+                          aes132c_get_response_size(AES132_RANDOM, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::TempSense::response_size,
+                          aes132c_get_response_size(AES132_TEMP_SENSE, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Encrypt<16>::response_size,
+                          aes132c_get_response_size(AES132_ENCRYPT, 0, 16));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Encrypt<32>::response_size,
+                          aes132c_get_response_size(AES132_ENCRYPT, 0, 32));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Encrypt<16>::response_size,
+                          aes132c_get_response_size(AES132_ENCRYPT, 0, 5));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Decrypt<32>::response_size,
+                          aes132c_get_response_size(AES132_DECRYPT, 0, 32));
+  TEST_ASSERT_EQUAL_UINT8(aes132::EncRead<32>::response_size,
+                          aes132c_get_response_size(AES132_ENC_READ, 0, 32));
+  TEST_ASSERT_EQUAL_UINT8(aes132::BlockRead<4>::response_size,
+                          aes132c_get_response_size(AES132_BLOCK_READ, 0, 4));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Auth<1>::response_size,
+                          aes132c_get_response_size(AES132_AUTH, 1, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Auth<3>::response_size,
+                          aes132c_get_response_size(AES132_AUTH, 3, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Nonce<0>::response_size,
+                          aes132c_get_response_size(AES132_NONCE, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Nonce<1>::response_size,
+                          aes132c_get_response_size(AES132_NONCE, 1, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Counter<0>::response_size,
+                          aes132c_get_response_size(AES132_COUNTER, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Counter<1>::response_size,
+                          aes132c_get_response_size(AES132_COUNTER, 1, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::KeyCreate<1>::response_size,
+                          aes132c_get_response_size(AES132_KEY_CREATE, 1, 0));
+  TEST_ASSERT_EQUAL_UINT8(aes132::Lock::response_size,
+                          aes132c_get_response_size(AES132_LOCK, 0, 0));
+
+  // Unknown sizes fall back to reading the count byte first.
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_get_response_size(AES132_SLEEP, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_get_response_size(0x12, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_get_response_size(0xFF, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_get_response_size(AES132_BLOCK_READ, 0, 0xFFFF));
+}
+
+/**
+ * @brief Test the execution times that delay the first Response-Ready poll
+ * Data: short commands (Info, BlockRead), long EEPROM commands (KeyCreate,
+ * Counter increment), TempSense and an unknown op-code
+ */
+void test_opcode_execution_times(void) {
+  struct aes132_execution_time info = aes132c_get_execution_time(AES132_INFO, 0);
+  struct aes132_execution_time encrypt = aes132c_get_execution_time(AES132_ENCRYPT, 0);
+  struct aes132_execution_time key_create = aes132c_get_execution_time(AES132_KEY_CREATE, 0);
+  struct aes132_execution_time temp_sense = aes132c_get_execution_time(AES132_TEMP_SENSE, 0);
+
+  TEST_ASSERT_TRUE(info.typical_us < encrypt.typical_us);
+  TEST_ASSERT_TRUE(encrypt.typical_us < key_create.typical_us);
+  TEST_ASSERT_EQUAL_UINT8(145, temp_sense.max_ms);
+
+  // Reading a counter does not write EEPROM; incrementing it does.
+  TEST_ASSERT_TRUE(aes132c_get_execution_time(AES132_COUNTER, 1).typical_us <
+                   aes132c_get_execution_time(AES132_COUNTER, 0).typical_us);
+
+  // Every typical time lies within its maximum time.
+  for (uint8_t op_code = 0; op_code < AES132_OPCODE_COUNT; op_code++) {
+    for (uint8_t mode = 0; mode < 4; mode++) {
+      struct aes132_execution_time time = aes132c_get_execution_time(op_code, mode);
+      TEST_ASSERT_TRUE(time.typical_us <= (uint32_t) time.max_ms * 1000);
+    }
+  }
+
+  struct aes132_execution_time unknown = aes132c_get_execution_time(0xFF, 0);
+  TEST_ASSERT_EQUAL_UINT16(0, unknown.typical_us);
+  TEST_ASSERT_EQUAL_UINT8(AES132_EXECUTION_TIME_MAX_DEFAULT, unknown.max_ms);
+}
+
+/**
+ * @brief Test which commands are sent again after a failed exchange
+ * Data: reading commands (Info, BlockRead, TempSense), Nonce and Auth, Counter
+ * increment and read, an unknown op-code, and device status register values
+ */
+void test_command_classes(void) {
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_CLASS_IDEMPOTENT, aes132c_get_command_class(AES132_INFO, 0));
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_CLASS_IDEMPOTENT, aes132c_get_command_class(AES132_BLOCK_READ, 0));
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_CLASS_IDEMPOTENT, aes132c_get_command_class(AES132_TEMP_SENSE, 0));
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_CLASS_STATE_MUTATING, aes132c_get_command_class(AES132_NONCE, 0x01));
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_CLASS_STATE_MUTATING, aes132c_get_command_class(AES132_AUTH, 0x03));
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_CLASS_NOT_IDEMPOTENT, aes132c_get_command_class(AES132_COUNTER, 0));
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_CLASS_STATE_MUTATING, aes132c_get_command_class(AES132_COUNTER, 1));
+  TEST_ASSERT_EQUAL_UINT8(AES132_COMMAND_CLASS_NOT_IDEMPOTENT, aes132c_get_command_class(0x12, 0));
+
+  // Only communication errors of idempotent commands repeat the exchange.
+  TEST_ASSERT_TRUE(aes132c_is_exchange_repeated(AES132_INFO, 0, AES132_FUNCTION_RETCODE_BAD_CRC_RX));
+  TEST_ASSERT_TRUE(aes132c_is_exchange_repeated(AES132_BLOCK_READ, 0, AES132_FUNCTION_RETCODE_TIMEOUT));
+  TEST_ASSERT_FALSE(aes132c_is_exchange_repeated(AES132_INFO, 0, AES132_FUNCTION_RETCODE_SUCCESS));
+  TEST_ASSERT_FALSE(aes132c_is_exchange_repeated(AES132_INFO, 0, AES132_DEVICE_RETCODE_BAD_ADDR));
+  TEST_ASSERT_FALSE(aes132c_is_exchange_repeated(AES132_BLOCK_READ, 0, AES132_FUNCTION_RETCODE_SIZE_TOO_SMALL));
+  TEST_ASSERT_FALSE(aes132c_is_exchange_repeated(AES132_NONCE, 0, AES132_FUNCTION_RETCODE_BAD_CRC_RX));
+  TEST_ASSERT_FALSE(aes132c_is_exchange_repeated(AES132_COUNTER, 0, AES132_FUNCTION_RETCODE_TIMEOUT));
+
+  // After a failed status read: busy or response ready means the command has reached the device.
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS,
+                          aes132c_check_command_received(AES132_FUNCTION_RETCODE_SUCCESS, AES132_RESPONSE_READY_BIT));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS,
+                          aes132c_check_command_received(AES132_FUNCTION_RETCODE_SUCCESS, AES132_WIP_BIT));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS,
+                          aes132c_check_command_received(AES132_FUNCTION_RETCODE_COMM_FAIL, 0));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_BAD_CRC_TX,
+                          aes132c_check_command_received(AES132_FUNCTION_RETCODE_SUCCESS, AES132_CRC_ERROR_BIT));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_NOT_EXECUTED,
+                          aes132c_check_command_received(AES132_FUNCTION_RETCODE_SUCCESS, 0));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_ADDRESS_READ_NACK,
+                          aes132c_check_command_received(AES132_FUNCTION_RETCODE_ADDRESS_READ_NACK, 0));
+}
+
+/**
+ * @brief Test the monotonic clock behind the time-outs and the wait statistics
+ * Data: a 2 ms delay, statistics after a reset, and an op-code outside the table
+ */
+void test_wait_clock_and_statistics(void) {
+  uint32_t start_us = aes132c_now_us();
+  aes132c_delay_us(2000);
+  TEST_ASSERT_TRUE((uint32_t) (aes132c_now_us() - start_us) >= 2000);
+
+  aes132c_reset_wait_statistics();
+  const struct aes132_wait_statistics *statistics = aes132c_get_execution_statistics(AES132_INFO);
+  TEST_ASSERT_NOT_NULL(statistics);
+  TEST_ASSERT_EQUAL_UINT16(0, statistics->n_waits);
+  TEST_ASSERT_EQUAL_UINT32(0, statistics->max_us);
+  TEST_ASSERT_EQUAL_UINT16(0, aes132c_get_device_ready_statistics()->n_timeouts);
+
+  TEST_ASSERT_NULL(aes132c_get_execution_statistics(AES132_OPCODE_COUNT));
+}
+
+/**
+ * @brief Test the learned execution times of the adaptive poller
+ * Data: Random on two devices, measured at 2000 us, then ready at the first poll
+ */
+void test_latency_estimate(void) {
+  aes132c_reset_latency_estimates();
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+  uint8_t first = aes132c_get_device_index();
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC4));
+  uint8_t second = aes132c_get_device_index();
+  TEST_ASSERT_TRUE(first != second);
+
+  // Nothing learned yet: the table decides.
+  TEST_ASSERT_EQUAL_UINT32(aes132c_get_execution_time(AES132_RANDOM, 0).typical_us,
+                           aes132c_predict_execution_time(AES132_RANDOM, 0));
+
+  for (uint8_t i = 0; i < 32; i++)
+    aes132c_update_latency_estimate(AES132_RANDOM, 0, 2000, 0);
+  const struct aes132_latency_estimate *estimate = aes132c_get_latency_estimate(second, AES132_RANDOM, 0);
+  TEST_ASSERT_UINT32_WITHIN(50, 2000, estimate->mean_us);
+  TEST_ASSERT_EQUAL_UINT32(estimate->mean_us, aes132c_predict_execution_time(AES132_RANDOM, 0));
+  TEST_ASSERT_EQUAL_UINT32(AES132_POLL_INTERVAL_MIN_US, aes132c_get_poll_interval(AES132_RANDOM, 0));
+
+  // A response ready at the first poll moves the estimate down.
+  uint32_t mean_us = estimate->mean_us;
+  aes132c_update_latency_estimate(AES132_RANDOM, 0, mean_us + 100, 1);
+  TEST_ASSERT_TRUE(estimate->mean_us < mean_us);
+
+  // The other device and the other Counter mode learned nothing.
+  TEST_ASSERT_EQUAL_UINT16(0, aes132c_get_latency_estimate(first, AES132_RANDOM, 0)->n_samples);
+  aes132c_update_latency_estimate(AES132_COUNTER, 1, 1000, 0);
+  TEST_ASSERT_EQUAL_UINT16(0, aes132c_get_latency_estimate(second, AES132_COUNTER, 0)->n_samples);
+
+  TEST_ASSERT_EQUAL_UINT32(AES132_POLL_INTERVAL_MAX_US, aes132c_next_poll_interval(AES132_POLL_INTERVAL_MAX_US));
+  TEST_ASSERT_NULL(aes132c_get_latency_estimate(first, 0x12, 0));
+  TEST_ASSERT_NULL(aes132c_get_latency_estimate(AES132_DEVICE_COUNT_MAX, AES132_RANDOM, 0));
+}
+
+//! number of accesses a fake_bus records
+#define FAKE_BUS_ACCESS_COUNT_MAX 128
+
+//! transport around a fake device that records what it is asked to do and injects faults
+struct fake_bus {
+  struct aes132_transport transport;
+  struct aes132h_fake_device fake;
+  uint8_t is_nacking;         // nack every access
+  uint8_t nack_op_code;       // nack writes of commands with this op-code, AES132_OPCODE_UNKNOWN for none
+  uint8_t n_corrupt_reads;    // I/O buffer reads still to arrive with a bit flipped
+  uint16_t n_accesses;
+  char accesses[FAKE_BUS_ACCESS_COUNT_MAX];      // 'S' status read, 'R' I/O read, 'W' command write,
+                                                 // 'M' other write, 'X' resync; lower case if it failed
+  uint8_t op_codes[FAKE_BUS_ACCESS_COUNT_MAX];   // op-code of each command write
+};
+
+static void fake_bus_record(struct fake_bus *bus, char access, uint8_t op_code, uint8_t result) {
+  if (bus->n_accesses < FAKE_BUS_ACCESS_COUNT_MAX) {
+    bus->accesses[bus->n_accesses] = (result == AES132_FUNCTION_RETCODE_SUCCESS) ? access : access | 0x20;
+    bus->op_codes[bus->n_accesses] = op_code;
+  }
+  bus->n_accesses++;
+}
+
+//! returns the index of the first acked write of a command with this op-code, or -1
+static int fake_bus_find_command(const struct fake_bus *bus, uint8_t op_code) {
+  for (uint16_t i = 0; i < bus->n_accesses && i < FAKE_BUS_ACCESS_COUNT_MAX; i++) {
+    if (bus->accesses[i] == 'W' && bus->op_codes[i] == op_code)
+      return i;
+  }
+  return -1;
+}
+
+static void fake_bus_set_interface(void *context) { (void)context; }
+
+static uint8_t fake_bus_select_device(void *context, uint8_t device_id) {
+  struct fake_bus *bus = (struct fake_bus *)context;
+  return bus->fake.transport.select_device(&bus->fake, device_id);
+}
+
+static uint8_t fake_bus_read_memory(void *context, uint8_t size, uint16_t word_address, uint8_t *data) {
+  struct fake_bus *bus = (struct fake_bus *)context;
+  uint8_t result = bus->is_nacking ? AES132_FUNCTION_RETCODE_COMM_FAIL
+                                   : bus->fake.transport.read_memory(&bus->fake, size, word_address, data);
+  if (result == AES132_FUNCTION_RETCODE_SUCCESS && word_address == AES132_IO_ADDR && bus->n_corrupt_reads > 0) {
+    bus->n_corrupt_reads--;
+    data[size - 1] ^= 0x01;
+  }
+  fake_bus_record(bus, (word_address == AES132_STATUS_ADDR) ? 'S' : 'R', 0, result);
+  return result;
+}
+
+static uint8_t fake_bus_write_memory_segments(void *context, uint16_t word_address,
+                                              const struct aes132_segment *segments, uint8_t n_segments) {
+  struct fake_bus *bus = (struct fake_bus *)context;
+  uint8_t op_code = (word_address == AES132_IO_ADDR) ? segments[0].data[AES132_COMMAND_INDEX_OPCODE] : 0;
+  uint8_t result = (bus->is_nacking || (word_address == AES132_IO_ADDR && op_code == bus->nack_op_code))
+                       ? AES132_FUNCTION_RETCODE_COMM_FAIL
+                       : bus->fake.transport.write_memory_segments(&bus->fake, word_address, segments, n_segments);
+  fake_bus_record(bus, (word_address == AES132_IO_ADDR) ? 'W' : 'M', op_code, result);
+  return result;
+}
+
+static uint8_t fake_bus_resync(void *context) {
+  struct fake_bus *bus = (struct fake_bus *)context;
+  uint8_t result = bus->fake.transport.resync(&bus->fake);
+  fake_bus_record(bus, 'X', 0, result);
+  return result;
+}
+
+static uint8_t fake_bus_set_clock(void *context, uint32_t clock_hz) {
+  struct fake_bus *bus = (struct fake_bus *)context;
+  return bus->fake.transport.set_clock(&bus->fake, clock_hz);
+}
+
+static void fake_bus_init(struct fake_bus *bus) {
+  memset(bus, 0, sizeof(*bus));
+  aes132h_fake_device_init(&bus->fake);
+  bus->transport.enable_interface = fake_bus_set_interface;
+  bus->transport.disable_interface = fake_bus_set_interface;
+  bus->transport.select_device = fake_bus_select_device;
+  bus->transport.read_memory = fake_bus_read_memory;
+  bus->transport.write_memory_segments = fake_bus_write_memory_segments;
+  bus->transport.resync = fake_bus_resync;
+  bus->transport.set_clock = fake_bus_set_clock;
+  bus->transport.context = bus;
+  bus->nack_op_code = AES132_OPCODE_UNKNOWN;
+}
+
+//! fake device with its bus, shared by the tests that run commands (too large for the stack)
+static struct fake_bus fake_bus;
+
+//! three commands for aes132m_execute_batch(); the middle one is BlockRead from param1
+static void batch_init(struct aes132_batch_command *commands, uint8_t (*responses)[AES132_RESPONSE_SIZE_MAX],
+                       uint16_t block_read_address) {
+  static const uint8_t op_codes[] = {AES132_INFO, AES132_BLOCK_READ, AES132_RANDOM};
+  for (uint8_t i = 0; i < 3; i++) {
+    memset(&commands[i], 0, sizeof(commands[i]));
+    commands[i].op_code = op_codes[i];
+    commands[i].size = AES132_RESPONSE_SIZE_MAX;
+    commands[i].rx_buffer = responses[i];
+    commands[i].result = 0x5A;
+  }
+  commands[1].param1 = block_read_address;
+  commands[1].param2 = 16;
+}
+
+/**
+ * @brief Test the results of a batch whose middle command fails, and the bus access after it
+ * Data: Info, BlockRead and Random on a fake device; BlockRead beyond the user memory (device error),
+ *       BlockRead nacked (library error), and a device that does not wake up, under both policies
+ */
+void test_execute_batch(void) {
+  struct aes132_batch_command commands[3];
+  uint8_t responses[3][AES132_RESPONSE_SIZE_MAX];
+  uint8_t policy;
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+  const struct aes132_transport *bus = aes132c_get_transport();
+  fake_bus_init(&fake_bus);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device_transport(0xA0, &fake_bus.transport));
+
+  for (policy = AES132_BATCH_ABORT_ON_ERROR; policy <= AES132_BATCH_CONTINUE_ON_ERROR; policy++) {
+    // A device error leaves the device idle. The next command is written without polling first.
+    fake_bus_init(&fake_bus);
+    batch_init(commands, responses, AES132H_FAKE_MEMORY_SIZE - 8);
+    TEST_ASSERT_EQUAL_UINT8(AES132_DEVICE_RETCODE_BAD_ADDR, aes132m_execute_batch(commands, 3, policy));
+    TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, commands[0].result);
+    TEST_ASSERT_EQUAL_UINT8(AES132_DEVICE_RETCODE_BAD_ADDR, commands[1].result);
+    if (policy == AES132_BATCH_ABORT_ON_ERROR) {
+      TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_NOT_EXECUTED, commands[2].result);
+      TEST_ASSERT_EQUAL_INT(-1, fake_bus_find_command(&fake_bus, AES132_RANDOM));
+      TEST_ASSERT_EQUAL_UINT32(2, fake_bus.fake.n_commands);
+    } else {
+      TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, commands[2].result);
+      TEST_ASSERT_EQUAL_UINT8(AES132_RESPONSE_SIZE_MIN + 16, responses[2][AES132_RESPONSE_INDEX_COUNT]);
+      int random = fake_bus_find_command(&fake_bus, AES132_RANDOM);
+      TEST_ASSERT_GREATER_THAN_INT(0, random);
+      TEST_ASSERT_EQUAL_INT('R', fake_bus.accesses[random - 1]);
+      TEST_ASSERT_EQUAL_UINT32(3, fake_bus.fake.n_commands);
+    }
+
+    // After a library error, the device might still be busy. The next command polls it first.
+    fake_bus_init(&fake_bus);
+    fake_bus.nack_op_code = AES132_BLOCK_READ;
+    batch_init(commands, responses, 0);
+    TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_COMM_FAIL, aes132m_execute_batch(commands, 3, policy));
+    TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, commands[0].result);
+    TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_COMM_FAIL, commands[1].result);
+    if (policy == AES132_BATCH_ABORT_ON_ERROR) {
+      TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_NOT_EXECUTED, commands[2].result);
+      TEST_ASSERT_EQUAL_INT(-1, fake_bus_find_command(&fake_bus, AES132_RANDOM));
+    } else {
+      TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, commands[2].result);
+      int random = fake_bus_find_command(&fake_bus, AES132_RANDOM);
+      TEST_ASSERT_GREATER_THAN_INT(0, random);
+      TEST_ASSERT_EQUAL_INT('S', fake_bus.accesses[random - 1]);
+    }
+
+    // No command is sent to a device that does not wake up.
+    fake_bus_init(&fake_bus);
+    fake_bus.is_nacking = 1;
+    batch_init(commands, responses, 0);
+    TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_TIMEOUT, aes132m_execute_batch(commands, 3, policy));
+    for (uint8_t i = 0; i < 3; i++)
+      TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_NOT_EXECUTED, commands[i].result);
+    TEST_ASSERT_EQUAL_UINT32(0, fake_bus.fake.n_writes);
+  }
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device_transport(0xA0, bus));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+}
+
+/**
+ * @brief Test the argument checks of the non-blocking command interface
+ * Data: a handle that is idle, in progress and done, and a response with a bad count and CRC
+ */
+void test_async_command_handle(void) {
+  struct aes132_async_command command = {};
+  uint8_t tx_buffer[AES132_COMMAND_SIZE_MAX] = {AES132_COMMAND_SIZE_MIN, AES132_INFO};
+  uint8_t rx_buffer[AES132_RESPONSE_SIZE_MIN] = {AES132_RESPONSE_SIZE_MIN};
+
+  // An idle handle has nothing to do and the bus is not touched.
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_async_step(&command));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_BAD_PARAM,
+                          aes132c_send_and_receive_async(&command, tx_buffer, sizeof(rx_buffer), NULL, 0, NULL, NULL));
+
+  // A command in progress cannot be replaced.
+  command.state = AES132_ASYNC_STATE_EXECUTE;
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_BAD_PARAM,
+                          aes132c_send_and_receive_async(&command, tx_buffer, sizeof(rx_buffer), rx_buffer, 0, NULL, NULL));
+  command.state = AES132_ASYNC_STATE_DONE;
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_async_step(&command));
+
+  // The response checks shared with aes132c_receive_command_response()
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_COMM_FAIL, aes132c_check_response_count(0, sizeof(rx_buffer)));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SIZE_TOO_SMALL,
+                          aes132c_check_response_count(AES132_RESPONSE_SIZE_MIN + 1, sizeof(rx_buffer)));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_COUNT_INVALID, aes132c_check_response_count(1, sizeof(rx_buffer)));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_BAD_CRC_RX, aes132c_check_response_crc(rx_buffer));
+  aes132c_calculate_crc(AES132_RESPONSE_SIZE_MIN - AES132_CRC_SIZE, rx_buffer,
+                        &rx_buffer[AES132_RESPONSE_SIZE_MIN - AES132_CRC_SIZE]);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_check_response_crc(rx_buffer));
+}
+
+//! states a command of the non-blocking interface has entered, and the calls of its callback
+struct async_trace {
+  uint8_t states[32];
+  uint8_t n_states;
+  uint8_t n_callbacks;
+  uint8_t callback_result;
+};
+
+static void async_trace_callback(struct aes132_async_command *command, void *context) {
+  struct async_trace *trace = (struct async_trace *)context;
+  trace->n_callbacks++;
+  trace->callback_result = command->result;
+}
+
+static void async_trace_record(struct async_trace *trace, uint8_t state) {
+  if (trace->n_states == 0 || trace->states[trace->n_states - 1] != state) {
+    if (trace->n_states < sizeof(trace->states))
+      trace->states[trace->n_states] = state;
+    trace->n_states++;
+  }
+}
+
+//! steps a command until it completes, for at most a second, recording the states it enters
+static void async_run(struct aes132_async_command *command, struct async_trace *trace) {
+  uint32_t start_us = aes132c_now_us();
+  async_trace_record(trace, command->state);
+  while (aes132c_async_step(command) && aes132c_now_us() - start_us < 1000000)
+    async_trace_record(trace, command->state);
+  async_trace_record(trace, command->state);
+}
+
+/**
+ * @brief Test a command of the non-blocking interface stepped to completion on a fake device
+ * Data: Info DevRev on a clean bus, and with one response read that arrives with a bit flipped
+ */
+void test_async_exchange(void) {
+#if AES132_NACK_POLLING
+  // The response is read as soon as the device acks. A bad response CRC is checked against the CRC bit.
+  static const uint8_t clean[] = {AES132_ASYNC_STATE_SEND, AES132_ASYNC_STATE_EXECUTE,
+                                  AES132_ASYNC_STATE_WAIT_RESPONSE_READY, AES132_ASYNC_STATE_CHECK_CRC,
+                                  AES132_ASYNC_STATE_DONE};
+  static const uint8_t rx_crc_error[] = {AES132_ASYNC_STATE_SEND, AES132_ASYNC_STATE_EXECUTE,
+                                         AES132_ASYNC_STATE_WAIT_RESPONSE_READY, AES132_ASYNC_STATE_CHECK_CRC,
+                                         AES132_ASYNC_STATE_CHECK_STATUS, AES132_ASYNC_STATE_RESYNC,
+                                         AES132_ASYNC_STATE_WAIT_RESPONSE_READY, AES132_ASYNC_STATE_CHECK_CRC,
+                                         AES132_ASYNC_STATE_DONE};
+#else
+  static const uint8_t clean[] = {AES132_ASYNC_STATE_SEND, AES132_ASYNC_STATE_CHECK_SEND,
+                                  AES132_ASYNC_STATE_EXECUTE, AES132_ASYNC_STATE_WAIT_RESPONSE_READY,
+                                  AES132_ASYNC_STATE_READ_COUNT, AES132_ASYNC_STATE_CHECK_CRC,
+                                  AES132_ASYNC_STATE_DONE};
+  static const uint8_t rx_crc_error[] = {AES132_ASYNC_STATE_SEND, AES132_ASYNC_STATE_CHECK_SEND,
+                                         AES132_ASYNC_STATE_EXECUTE, AES132_ASYNC_STATE_WAIT_RESPONSE_READY,
+                                         AES132_ASYNC_STATE_READ_COUNT, AES132_ASYNC_STATE_CHECK_CRC,
+                                         AES132_ASYNC_STATE_RESYNC, AES132_ASYNC_STATE_WAIT_RESPONSE_READY,
+                                         AES132_ASYNC_STATE_READ_COUNT, AES132_ASYNC_STATE_CHECK_CRC,
+                                         AES132_ASYNC_STATE_DONE};
+#endif
+  struct aes132_async_command command = {};
+  struct async_trace trace = {};
+  uint8_t tx_buffer[AES132_COMMAND_SIZE_MAX] = {AES132_COMMAND_SIZE_MIN, AES132_INFO};
+  uint8_t rx_buffer[AES132_RESPONSE_SIZE_MAX];
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+  const struct aes132_transport *bus = aes132c_get_transport();
+  fake_bus_init(&fake_bus);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device_transport(0xA0, &fake_bus.transport));
+
+  // The device is idle: the command is written at once, and its response read once it is ready.
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS,
+                          aes132c_send_and_receive_async(&command, tx_buffer, sizeof(rx_buffer), rx_buffer,
+                                                         AES132_OPTION_DEVICE_READY, async_trace_callback, &trace));
+  async_run(&command, &trace);
+  TEST_ASSERT_EQUAL_UINT8(sizeof(clean), trace.n_states);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(clean, trace.states, sizeof(clean));
+  TEST_ASSERT_EQUAL_UINT8(1, trace.n_callbacks);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, trace.callback_result);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, command.result);
+  TEST_ASSERT_EQUAL_UINT8(aes132c_get_response_size(AES132_INFO, 0, 0), rx_buffer[AES132_RESPONSE_INDEX_COUNT]);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_check_response_crc(rx_buffer));
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_async_step(&command));
+  TEST_ASSERT_EQUAL_UINT8(1, trace.n_callbacks);
+
+  // A response with a bad CRC is read again after re-synchronizing. The command is not sent again.
+  fake_bus_init(&fake_bus);
+  fake_bus.n_corrupt_reads = 1;
+  memset(&trace, 0, sizeof(trace));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS,
+                          aes132c_send_and_receive_async(&command, tx_buffer, sizeof(rx_buffer), rx_buffer,
+                                                         AES132_OPTION_DEVICE_READY, async_trace_callback, &trace));
+  async_run(&command, &trace);
+  TEST_ASSERT_EQUAL_UINT8(sizeof(rx_crc_error), trace.n_states);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(rx_crc_error, trace.states, sizeof(rx_crc_error));
+  TEST_ASSERT_EQUAL_UINT8(1, trace.n_callbacks);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, trace.callback_result);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, command.result);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_check_response_crc(rx_buffer));
+  TEST_ASSERT_EQUAL_UINT32(1, fake_bus.fake.n_resyncs);
+  TEST_ASSERT_EQUAL_UINT32(1, fake_bus.fake.n_commands);
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device_transport(0xA0, bus));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+}
+
+/**
+ * @brief Test the decisions of the retry policy
+ * Data: the default policy, and a policy with three retries and a doubling backoff on time-outs
+ */
+void test_retry_policy(void) {
+  static const struct aes132_retry_policy patient = {{
+      {0, 1, 0, 0},          // nack: give up at once
+      {0, 0, 0, 0},          // Rx CRC
+      {0, 0, 0, 0},          // Tx CRC
+      {0, 0, 0, 0},          // count
+      {3, 1, 1, 60000},      // time-out: 60 ms, 120 ms, capped at 100 ms
+  }};
+  struct aes132_retry_state retry;
+  struct aes132_retry_action action;
+  uint8_t device_index = aes132c_get_device_index();
+  const struct aes132_retry_statistics *statistics = aes132c_get_retry_statistics(device_index);
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_ERROR_CLASS_NACK, aes132c_classify_error(AES132_FUNCTION_RETCODE_COMM_FAIL));
+  TEST_ASSERT_EQUAL_UINT8(AES132_ERROR_CLASS_BAD_CRC_RX, aes132c_classify_error(AES132_FUNCTION_RETCODE_BAD_CRC_RX));
+  TEST_ASSERT_EQUAL_UINT8(AES132_ERROR_CLASS_BAD_CRC_TX, aes132c_classify_error(AES132_FUNCTION_RETCODE_BAD_CRC_TX));
+  TEST_ASSERT_EQUAL_UINT8(AES132_ERROR_CLASS_BAD_COUNT, aes132c_classify_error(AES132_FUNCTION_RETCODE_SIZE_TOO_SMALL));
+  TEST_ASSERT_EQUAL_UINT8(AES132_ERROR_CLASS_TIMEOUT, aes132c_classify_error(AES132_FUNCTION_RETCODE_TIMEOUT));
+
+  // The default policy retries once, re-synchronizing after a bad response CRC also when giving up.
+  aes132c_reset_retry_statistics();
+  TEST_ASSERT_EQUAL_PTR(&aes132c_default_retry_policy, aes132c_get_retry_policy());
+  aes132c_begin_retries(&retry);
+  TEST_ASSERT_EQUAL_UINT8(1, aes132c_plan_retry(&retry, AES132_FUNCTION_RETCODE_BAD_CRC_RX, 0, &action));
+  TEST_ASSERT_EQUAL_UINT8(1, action.is_resync);
+  TEST_ASSERT_EQUAL_UINT32(0, action.backoff_us);
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_plan_retry(&retry, AES132_FUNCTION_RETCODE_BAD_CRC_RX, 0, &action));
+  TEST_ASSERT_EQUAL_UINT8(1, action.is_resync);
+  TEST_ASSERT_EQUAL_UINT16(2, statistics->n_errors[AES132_ERROR_CLASS_BAD_CRC_RX]);
+  TEST_ASSERT_EQUAL_UINT16(1, statistics->n_retries[AES132_ERROR_CLASS_BAD_CRC_RX]);
+  TEST_ASSERT_EQUAL_UINT16(2, statistics->n_resyncs);
+  TEST_ASSERT_EQUAL_UINT16(1, statistics->n_exhausted);
+
+  // No second re-synchronization after the caller has done one, and none after a Tx CRC error.
+  aes132c_begin_retries(&retry);
+  TEST_ASSERT_EQUAL_UINT8(1, aes132c_plan_retry(&retry, AES132_FUNCTION_RETCODE_COMM_FAIL, 1, &action));
+  TEST_ASSERT_EQUAL_UINT8(0, action.is_resync);
+  aes132c_begin_retries(&retry);
+  TEST_ASSERT_EQUAL_UINT8(1, aes132c_plan_retry(&retry, AES132_FUNCTION_RETCODE_BAD_CRC_TX, 0, &action));
+  TEST_ASSERT_EQUAL_UINT8(0, action.is_resync);
+
+  // A policy set for a call takes precedence over the policy of the device.
+  aes132c_set_retry_policy(&patient);
+  TEST_ASSERT_EQUAL_PTR(&patient, aes132c_get_retry_policy());
+  TEST_ASSERT_NULL(aes132c_use_retry_policy(&aes132c_default_retry_policy));
+  TEST_ASSERT_EQUAL_PTR(&aes132c_default_retry_policy, aes132c_get_retry_policy());
+  TEST_ASSERT_EQUAL_PTR(&aes132c_default_retry_policy, aes132c_use_retry_policy(NULL));
+  TEST_ASSERT_EQUAL_PTR(&patient, aes132c_get_retry_policy());
+
+  // The backoff doubles per retry up to the longest backoff.
+  aes132c_begin_retries(&retry);
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_plan_retry(&retry, AES132_FUNCTION_RETCODE_COMM_FAIL, 0, &action));
+  TEST_ASSERT_EQUAL_UINT8(1, aes132c_plan_retry(&retry, AES132_FUNCTION_RETCODE_TIMEOUT, 0, &action));
+  TEST_ASSERT_EQUAL_UINT32(60000, action.backoff_us);
+  TEST_ASSERT_EQUAL_UINT8(1, aes132c_plan_retry(&retry, AES132_FUNCTION_RETCODE_TIMEOUT, 0, &action));
+  TEST_ASSERT_EQUAL_UINT32(AES132_RETRY_BACKOFF_MAX_US, action.backoff_us);
+  TEST_ASSERT_EQUAL_UINT8(1, aes132c_plan_retry(&retry, AES132_FUNCTION_RETCODE_TIMEOUT, 0, &action));
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_plan_retry(&retry, AES132_FUNCTION_RETCODE_TIMEOUT, 0, &action));
+  aes132c_set_retry_policy(NULL);
+
+  // A successful attempt is not retried.
+  TEST_ASSERT_EQUAL_UINT8(0, aes132c_retry(&retry, AES132_FUNCTION_RETCODE_SUCCESS, 0));
+  TEST_ASSERT_NULL(aes132c_get_retry_statistics(AES132_DEVICE_COUNT_MAX));
+}
+
+/**
+ * @brief Test when a failed response read is taken for a rejected command
+ * Data: a time-out, and a Rx CRC error without AES132_NACK_POLLING; with it, Info on a fake device
+ *       that nacks twice before acking, and Info with a bad CRC
+ */
+void test_tx_crc_error_detection(void) {
+  uint8_t aes132_lib_return = AES132_FUNCTION_RETCODE_TIMEOUT;
+
+  // A device that nacks until the time-out has not acked a command it rejected.
+  TEST_ASSERT_FALSE(aes132c_find_tx_crc_error(&aes132_lib_return));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_TIMEOUT, aes132_lib_return);
+
+#if !AES132_NACK_POLLING
+  // The device status register has been read after writing. The error stays a Rx error.
+  aes132_lib_return = AES132_FUNCTION_RETCODE_BAD_CRC_RX;
+  TEST_ASSERT_FALSE(aes132c_find_tx_crc_error(&aes132_lib_return));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_BAD_CRC_RX, aes132_lib_return);
+#else
+  uint8_t tx_buffer[AES132_COMMAND_SIZE_MAX] = {AES132_COMMAND_SIZE_MIN, AES132_INFO};
+  uint8_t rx_buffer[AES132_RESPONSE_SIZE_MAX];
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+  const struct aes132_transport *bus = aes132c_get_transport();
+  fake_bus_init(&fake_bus);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device_transport(0xA0, &fake_bus.transport));
+
+  // The response is polled through the nacks and read with the first ack.
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_send_command(tx_buffer, AES132_OPTION_DEFAULT));
+  fake_bus.fake.n_nacks = 2;
+  fake_bus.n_accesses = 0;
+  TEST_ASSERT_EQUAL_UINT8(AES132_DEVICE_RETCODE_SUCCESS,
+                          aes132c_receive_command_response(sizeof(rx_buffer), rx_buffer, AES132_INFO, 0, 0));
+  TEST_ASSERT_EQUAL_UINT16(3, fake_bus.n_accesses);
+  TEST_ASSERT_EQUAL_MEMORY("rrR", fake_bus.accesses, 3);
+  TEST_ASSERT_EQUAL_UINT8(aes132c_get_response_size(AES132_INFO, 0, 0), rx_buffer[AES132_RESPONSE_INDEX_COUNT]);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_check_response_crc(rx_buffer));
+
+  // The device rejects a command with a bad CRC. What is read instead of a response is not
+  // consistent, and the CRC bit tells a Tx error. The response is not read again.
+  fake_bus_init(&fake_bus);
+  tx_buffer[AES132_COMMAND_SIZE_MIN - 1] ^= 0x01;
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS,
+                          aes132c_send_command(tx_buffer, AES132_OPTION_NO_APPEND_CRC));
+  TEST_ASSERT_EQUAL_UINT32(1, fake_bus.fake.n_crc_errors);
+  fake_bus.n_accesses = 0;
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_BAD_CRC_TX,
+                          aes132c_receive_command_response(sizeof(rx_buffer), rx_buffer, AES132_INFO, 0, 0));
+  TEST_ASSERT_EQUAL_UINT16(2, fake_bus.n_accesses);
+  TEST_ASSERT_EQUAL_MEMORY("RS", fake_bus.accesses, 2);
+  TEST_ASSERT_EQUAL_UINT32(0, fake_bus.fake.n_resyncs);
+  TEST_ASSERT_EQUAL_UINT32(0, fake_bus.fake.n_commands);
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device_transport(0xA0, bus));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+#endif
+}
+
+/**
+ * @brief Test the power manager bookkeeping without bus access
+ * Data: waits recorded in Standby and Sleep mode, thresholds that have not passed
+ */
+void test_power_manager(void) {
+  static const struct aes132_power_policy battery = {1000, 2000};
+  uint8_t device_index = aes132c_get_device_index();
+  const struct aes132_power_statistics *statistics = aes132c_get_power_statistics(device_index);
+
+  TEST_ASSERT_EQUAL_PTR(&aes132c_default_power_policy, aes132c_get_power_policy());
+  aes132c_set_power_policy(&battery);
+  TEST_ASSERT_EQUAL_PTR(&battery, aes132c_get_power_policy());
+
+  // A wait counts as the wake cost of the mode the device was in, and makes it active.
+  aes132c_reset_power_statistics();
+  aes132c_record_power_mode(AES132_POWER_MODE_STANDBY);
+  TEST_ASSERT_EQUAL_UINT8(AES132_POWER_MODE_STANDBY, aes132c_get_power_mode());
+  aes132c_record_wakeup(300, AES132_FUNCTION_RETCODE_SUCCESS);
+  TEST_ASSERT_EQUAL_UINT8(AES132_POWER_MODE_ACTIVE, aes132c_get_power_mode());
+  aes132c_record_power_mode(AES132_POWER_MODE_SLEEP);
+  aes132c_record_wakeup(1400, AES132_FUNCTION_RETCODE_SUCCESS);
+  aes132c_record_power_mode(AES132_POWER_MODE_SLEEP);
+  aes132c_record_wakeup(1600, AES132_FUNCTION_RETCODE_SUCCESS);
+  aes132c_record_wakeup(20, AES132_FUNCTION_RETCODE_SUCCESS);
+  TEST_ASSERT_EQUAL_UINT16(1, statistics->n_standbys);
+  TEST_ASSERT_EQUAL_UINT16(2, statistics->n_sleeps);
+  TEST_ASSERT_EQUAL_UINT16(1, statistics->wakeups[AES132_POWER_MODE_STANDBY].n_waits);
+  TEST_ASSERT_EQUAL_UINT32(300, statistics->total_us[AES132_POWER_MODE_STANDBY]);
+  TEST_ASSERT_EQUAL_UINT16(2, statistics->wakeups[AES132_POWER_MODE_SLEEP].n_waits);
+  TEST_ASSERT_EQUAL_UINT32(1600, statistics->wakeups[AES132_POWER_MODE_SLEEP].max_us);
+  TEST_ASSERT_EQUAL_UINT32(3000, statistics->total_us[AES132_POWER_MODE_SLEEP]);
+  TEST_ASSERT_EQUAL_UINT32(20, statistics->total_us[AES132_POWER_MODE_ACTIVE]);
+
+  // A device that fails to wake up keeps its mode.
+  aes132c_record_power_mode(AES132_POWER_MODE_SLEEP);
+  aes132c_record_wakeup(100000, AES132_FUNCTION_RETCODE_TIMEOUT);
+  TEST_ASSERT_EQUAL_UINT8(AES132_POWER_MODE_SLEEP, aes132c_get_power_mode());
+  TEST_ASSERT_EQUAL_UINT16(1, statistics->wakeups[AES132_POWER_MODE_SLEEP].n_timeouts);
+  aes132c_record_wakeup(1500, AES132_FUNCTION_RETCODE_SUCCESS);
+
+  // Before the thresholds have passed, the mode is left alone.
+  aes132c_record_activity();
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_update_power_mode());
+  TEST_ASSERT_EQUAL_UINT8(AES132_POWER_MODE_ACTIVE, aes132c_get_power_mode());
+
+  aes132c_set_power_policy(NULL);
+  aes132c_reset_power_statistics();
+  TEST_ASSERT_NULL(aes132c_get_power_statistics(AES132_DEVICE_COUNT_MAX));
+}
+
+//! transport that counts its calls and does not reach a device
+struct counting_transport {
+  struct aes132_transport transport;
+  uint8_t select_return;
+  uint16_t n_selects;
+  uint16_t n_reads;
+  uint16_t n_clock_changes;
+  uint32_t clock_hz;
+};
+
+static void counting_set_interface(void *context) { (void)context; }
+
+static uint8_t counting_select_device(void *context, uint8_t device_id) {
+  struct counting_transport *counting = (struct counting_transport *)context;
+  (void)device_id;
+  counting->n_selects++;
+  return counting->select_return;
+}
+
+static uint8_t counting_read_memory(void *context, uint8_t size, uint16_t word_address, uint8_t *data) {
+  struct counting_transport *counting = (struct counting_transport *)context;
+  (void)word_address;
+  counting->n_reads++;
+  memset(data, 0x5A, size);
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t counting_write_memory_segments(void *context, uint16_t word_address,
+                                              const struct aes132_segment *segments, uint8_t n_segments) {
+  (void)context;
+  (void)word_address;
+  (void)segments;
+  (void)n_segments;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t counting_resync(void *context) {
+  (void)context;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static uint8_t counting_set_clock(void *context, uint32_t clock_hz) {
+  struct counting_transport *counting = (struct counting_transport *)context;
+  counting->n_clock_changes++;
+  counting->clock_hz = clock_hz;
+  return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+static void counting_init(struct counting_transport *counting, uint8_t select_return) {
+  memset(counting, 0, sizeof(*counting));
+  counting->transport.enable_interface = counting_set_interface;
+  counting->transport.disable_interface = counting_set_interface;
+  counting->transport.select_device = counting_select_device;
+  counting->transport.read_memory = counting_read_memory;
+  counting->transport.write_memory_segments = counting_write_memory_segments;
+  counting->transport.resync = counting_resync;
+  counting->transport.set_clock = counting_set_clock;
+  counting->transport.context = counting;
+  counting->select_return = select_return;
+}
+
+/**
+ * @brief Test that the physical layer calls the transport of the selected device
+ * Data: a counting transport for one device, the default transport for another,
+ *       and a transport that fails to select
+ */
+void test_transport_dispatch(void) {
+  struct counting_transport counting;
+  struct counting_transport failing;
+  uint8_t data = 0;
+
+  counting_init(&counting, AES132_FUNCTION_RETCODE_SUCCESS);
+  counting_init(&failing, AES132_FUNCTION_RETCODE_DEVICE_SELECT_FAIL);
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+  const struct aes132_transport *bus = aes132c_get_transport();
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS,
+                          aes132c_select_device_transport(0xC4, &counting.transport));
+  uint8_t device_index = aes132c_get_device_index();
+  TEST_ASSERT_EQUAL_PTR(&counting.transport, aes132c_get_transport());
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS,
+                          aes132p_read_memory_physical(1, AES132_STATUS_ADDR, &data));
+  TEST_ASSERT_EQUAL_UINT8(0x5A, data);
+  TEST_ASSERT_EQUAL_UINT16(1, counting.n_selects);
+  TEST_ASSERT_EQUAL_UINT16(1, counting.n_reads);
+
+  // Each device keeps its transport when the other one is selected.
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+  TEST_ASSERT_EQUAL_PTR(bus, aes132c_get_transport());
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC4));
+  TEST_ASSERT_EQUAL_PTR(&counting.transport, aes132c_get_transport());
+  TEST_ASSERT_EQUAL_UINT16(2, counting.n_selects);
+
+  // A failed selection keeps the selected device and its transport.
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_DEVICE_SELECT_FAIL,
+                          aes132c_select_device_transport(0xC2, &failing.transport));
+  TEST_ASSERT_EQUAL_UINT16(1, failing.n_selects);
+  TEST_ASSERT_EQUAL_PTR(&counting.transport, aes132c_get_transport());
+  TEST_ASSERT_EQUAL_UINT8(device_index, aes132c_get_device_index());
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+  TEST_ASSERT_EQUAL_PTR(bus, aes132c_get_transport());
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device_transport(0xC4, bus));
+  TEST_ASSERT_EQUAL_PTR(bus, aes132c_get_transport());
+}
+
+/**
+ * @brief Test that the clock manager steps the clock down on errors and probes back up
+ * Data: rates of 1 MHz, 400 kHz and 100 kHz, windows of 4 commands, 1 error tolerated,
+ *       a probe after 2 clean windows, on a counting transport
+ */
+void test_clock_manager(void) {
+  static const uint32_t rates_hz[] = {1000000, 400000, 100000};
+  const struct aes132_clock_policy policy = {rates_hz, 3, 4, 1, 2};
+  const struct aes132_clock_policy slowest = {&rates_hz[2], 1, 4, 1, 2};
+  const struct aes132_clock_policy no_rates = {rates_hz, 0, 4, 1, 2};
+  const struct aes132_clock_policy no_window = {rates_hz, 3, 0, 1, 2};
+  struct counting_transport counting;
+  int i;
+
+  counting_init(&counting, AES132_FUNCTION_RETCODE_SUCCESS);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device(0xC2));
+  const struct aes132_transport *bus = aes132c_get_transport();
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS,
+                          aes132c_select_device_transport(0xC4, &counting.transport));
+  uint8_t device_index = aes132c_get_device_index();
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_BAD_PARAM, aes132c_set_clock_policy(&no_rates));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_BAD_PARAM, aes132c_set_clock_policy(&no_window));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_set_clock_policy(&policy));
+  TEST_ASSERT_EQUAL_PTR(&policy, aes132c_get_clock_policy());
+  const struct aes132_clock_statistics *statistics = aes132c_get_clock_statistics(device_index);
+
+  // A device starts at the fastest rate, set before its first command.
+  TEST_ASSERT_EQUAL_UINT32(1000000, aes132c_get_clock_rate());
+  aes132c_record_clock_command();
+  TEST_ASSERT_EQUAL_UINT32(1000000, counting.clock_hz);
+  TEST_ASSERT_EQUAL_UINT16(1, counting.n_clock_changes);
+
+  // Timeouts do not count; the second error of the window steps the clock down at once.
+  aes132c_record_clock_error(AES132_FUNCTION_RETCODE_TIMEOUT);
+  aes132c_record_clock_error(AES132_FUNCTION_RETCODE_BAD_CRC_RX);
+  TEST_ASSERT_EQUAL_UINT32(1000000, aes132c_get_clock_rate());
+  aes132c_record_clock_error(AES132_FUNCTION_RETCODE_COMM_FAIL);
+  TEST_ASSERT_EQUAL_UINT32(400000, aes132c_get_clock_rate());
+  TEST_ASSERT_EQUAL_UINT32(400000, counting.clock_hz);
+  TEST_ASSERT_EQUAL_UINT32(2, statistics->rates[0].n_errors);
+  TEST_ASSERT_EQUAL_UINT16(1, statistics->n_downshifts);
+
+  // After 2 clean windows of 4 commands, the next command probes the faster rate.
+  for (i = 0; i < 8; i++)
+    aes132c_record_clock_command();
+  TEST_ASSERT_EQUAL_UINT32(400000, aes132c_get_clock_rate());
+  TEST_ASSERT_EQUAL_UINT16(2, counting.n_clock_changes);
+  aes132c_record_clock_command();
+  TEST_ASSERT_EQUAL_UINT32(1000000, counting.clock_hz);
+  TEST_ASSERT_EQUAL_UINT16(1, statistics->n_upshifts);
+
+  // A failed probe doubles the clean windows before the next one.
+  aes132c_record_clock_error(AES132_FUNCTION_RETCODE_BAD_CRC_RX);
+  aes132c_record_clock_error(AES132_FUNCTION_RETCODE_BAD_CRC_RX);
+  TEST_ASSERT_EQUAL_UINT32(400000, counting.clock_hz);
+  for (i = 0; i < 16; i++)
+    aes132c_record_clock_command();
+  TEST_ASSERT_EQUAL_UINT32(400000, aes132c_get_clock_rate());
+  aes132c_record_clock_command();
+  TEST_ASSERT_EQUAL_UINT32(1000000, aes132c_get_clock_rate());
+  TEST_ASSERT_EQUAL_UINT16(2, statistics->n_downshifts);
+  TEST_ASSERT_EQUAL_UINT16(2, statistics->n_upshifts);
+  TEST_ASSERT_EQUAL_UINT32(1000000, statistics->rates[0].clock_hz);
+  TEST_ASSERT_EQUAL_UINT32(3, statistics->rates[0].n_commands);
+  TEST_ASSERT_EQUAL_UINT32(4, statistics->rates[0].n_errors);
+  TEST_ASSERT_EQUAL_UINT32(400000, statistics->rates[1].clock_hz);
+  TEST_ASSERT_EQUAL_UINT32(24, statistics->rates[1].n_commands);
+
+  // Only successful transactions count towards the throughput of the rate.
+  aes132c_record_clock_transfer(16, aes132c_now_us() - 1000, AES132_FUNCTION_RETCODE_SUCCESS);
+  aes132c_record_clock_transfer(16, aes132c_now_us() - 1000, AES132_FUNCTION_RETCODE_COMM_FAIL);
+  TEST_ASSERT_EQUAL_UINT32(16, statistics->rates[0].n_bytes);
+  TEST_ASSERT_UINT32_WITHIN(500, 16000, aes132c_get_clock_throughput(device_index, 0));
+  TEST_ASSERT_EQUAL_UINT32(0, aes132c_get_clock_throughput(device_index, 1));
+  TEST_ASSERT_EQUAL_UINT32(0, aes132c_get_clock_throughput(device_index, AES132_CLOCK_RATE_COUNT_MAX));
+
+  // At the slowest rate, errors only start a new window.
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_set_clock_policy(&slowest));
+  aes132c_record_clock_command();
+  aes132c_record_clock_error(AES132_FUNCTION_RETCODE_COMM_FAIL);
+  aes132c_record_clock_error(AES132_FUNCTION_RETCODE_COMM_FAIL);
+  TEST_ASSERT_EQUAL_UINT32(100000, counting.clock_hz);
+  TEST_ASSERT_EQUAL_UINT16(0, statistics->n_downshifts);
+
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_set_clock_policy(NULL));
+  TEST_ASSERT_EQUAL_PTR(&aes132c_default_clock_policy, aes132c_get_clock_policy());
+  aes132c_reset_clock_statistics();
+  TEST_ASSERT_NULL(aes132c_get_clock_statistics(AES132_DEVICE_COUNT_MAX));
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_SUCCESS, aes132c_select_device_transport(0xC4, bus));
+}
+
+#if AES132_TRACE_LEVEL > AES132_TRACE_LEVEL_OFF
+//! bytes written by aes132c_trace_drain()
+struct trace_capture {
+  uint8_t data[4 + AES132_TRACE_FRAME_EVENTS_MAX * sizeof(struct aes132_trace_event)];
+  uint16_t size;
+  uint8_t n_frames;
+};
+
+static void trace_capture_write(const uint8_t *data, uint16_t size, void *context) {
+  struct trace_capture *capture = (struct trace_capture *)context;
+  if (capture->size + size <= sizeof(capture->data)) {
+    memcpy(&capture->data[capture->size], data, size);
+  }
+  capture->size += size;
+  if (size == 4) {
+    capture->n_frames++;
+  }
+}
+
+/**
+ * @brief Test the trace ring buffer and its frames
+ * Data: events recorded by hand, then more events than the ring buffer holds
+ */
+void test_trace_ring(void) {
+  struct aes132_trace_event events[2];
+  struct trace_capture capture = {};
+  uint32_t start_us = aes132c_now_us();
+
+  aes132c_trace_reset();
+  aes132c_trace_record(AES132_TRACE_BUS_READ, AES132_FUNCTION_RETCODE_SUCCESS, AES132_STATUS_ADDR, 1, start_us);
+  aes132c_trace_record(AES132_TRACE_COMM_EXCHANGE, AES132_FUNCTION_RETCODE_TIMEOUT, AES132_INFO << 8, 6, start_us);
+  aes132c_trace_record(AES132_TRACE_COMM_RESYNC, AES132_FUNCTION_RETCODE_SUCCESS, 0, 0, start_us);
+
+  // Events are read oldest first, as recorded.
+  TEST_ASSERT_EQUAL_UINT16(2, aes132c_trace_read(events, 2));
+  TEST_ASSERT_EQUAL_UINT8(AES132_TRACE_BUS_READ, events[0].event);
+  TEST_ASSERT_EQUAL_UINT16(AES132_STATUS_ADDR, events[0].arg0);
+  TEST_ASSERT_EQUAL_UINT16(1, events[0].arg1);
+  TEST_ASSERT_EQUAL_UINT32(start_us, events[0].time_us);
+  TEST_ASSERT_EQUAL_UINT8(AES132_TRACE_COMM_EXCHANGE, events[1].event);
+  TEST_ASSERT_EQUAL_UINT8(AES132_FUNCTION_RETCODE_TIMEOUT, events[1].result);
+
+  // The rest is drained as one frame.
+  TEST_ASSERT_EQUAL_UINT16(1, aes132c_trace_drain(trace_capture_write, &capture));
+  TEST_ASSERT_EQUAL_UINT16(4 + sizeof(struct aes132_trace_event), capture.size);
+  TEST_ASSERT_EQUAL_UINT8(AES132_TRACE_FRAME_SYNC_0, capture.data[0]);
+  TEST_ASSERT_EQUAL_UINT8(AES132_TRACE_FRAME_SYNC_1, capture.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(1, capture.data[2]);
+  TEST_ASSERT_EQUAL_UINT8(0, capture.data[3]);
+  TEST_ASSERT_EQUAL_UINT8(AES132_TRACE_COMM_RESYNC, capture.data[4 + 6]);
+  TEST_ASSERT_EQUAL_UINT16(0, aes132c_trace_read(events, 2));
+
+  // A full ring buffer drops new events and counts them; the next frame reports them.
+  for (uint16_t i = 0; i < AES132_TRACE_BUFFER_SIZE + 5; i++)
+    aes132c_trace_record(AES132_TRACE_BUS_WRITE, AES132_FUNCTION_RETCODE_SUCCESS, AES132_IO_ADDR, i, start_us);
+  TEST_ASSERT_EQUAL_UINT32(5, aes132c_trace_get_dropped());
+  TEST_ASSERT_EQUAL_UINT16(1, aes132c_trace_read(events, 1));
+  TEST_ASSERT_EQUAL_UINT16(0, events[0].arg1);
+  capture = {};
+  TEST_ASSERT_EQUAL_UINT16(AES132_TRACE_BUFFER_SIZE - 1, aes132c_trace_drain(trace_capture_write, &capture));
+  TEST_ASSERT_EQUAL_UINT8(5, capture.data[3]);
+  TEST_ASSERT_EQUAL_UINT8((AES132_TRACE_BUFFER_SIZE + AES132_TRACE_FRAME_EVENTS_MAX - 1) / AES132_TRACE_FRAME_EVENTS_MAX,
+                          capture.n_frames);
+
+  aes132c_trace_reset();
+}
+#endif
+
 void setup() {
   delay(2000); // Wait for board to boot
 
@@ -53,6 +1206,28 @@ void setup() {
 
   RUN_TEST(test_crc_calculation_sleep_command);
   RUN_TEST(test_crc_calculation_standby_command);
+  RUN_TEST(test_crc_table_variants_match_bitwise);
+  RUN_TEST(test_fixed_command_matches_runtime_crc);
+  RUN_TEST(test_crc_incremental_matches_one_shot);
+  RUN_TEST(test_prepared_command_patch_keeps_crc_valid);
+  RUN_TEST(test_typed_command_sizes);
+  RUN_TEST(test_response_view_fields);
+  RUN_TEST(test_opcode_response_sizes);
+  RUN_TEST(test_opcode_execution_times);
+  RUN_TEST(test_command_classes);
+  RUN_TEST(test_wait_clock_and_statistics);
+  RUN_TEST(test_latency_estimate);
+  RUN_TEST(test_execute_batch);
+  RUN_TEST(test_async_command_handle);
+  RUN_TEST(test_async_exchange);
+  RUN_TEST(test_retry_policy);
+  RUN_TEST(test_tx_crc_error_detection);
+  RUN_TEST(test_power_manager);
+  RUN_TEST(test_transport_dispatch);
+  RUN_TEST(test_clock_manager);
+#if AES132_TRACE_LEVEL > AES132_TRACE_LEVEL_OFF
+  RUN_TEST(test_trace_ring);
+#endif
 
   UNITY_END();
 }
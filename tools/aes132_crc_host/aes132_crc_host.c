@@ -0,0 +1,369 @@
+/** \file
+ *  \brief  Host-side CRC-16 kernels and batch packet validation for AES132 tooling.
+ *
+ * See aes132_crc_host.h for an overview of the kernels.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#   include <immintrin.h>
+#   define AES132H_HAVE_PCLMUL
+#endif
+
+#include "aes132_comm.h"
+#include "aes132_crc.h"
+#include "aes132_crc_host.h"
+
+//! Folding needs this many bytes to fill its four accumulators.
+#define AES132H_PCLMUL_MIN_LENGTH   (64)
+
+/** \brief slicing tables: aes132h_crc_tables[k][b] is the CRC of byte b followed by k zero bytes
+ *
+ * aes132h_crc_tables[0] is the ordinary byte table.
+ */
+static uint16_t aes132h_crc_tables[8][256];
+
+static pthread_once_t aes132h_crc_tables_once = PTHREAD_ONCE_INIT;
+
+//! kernel used by aes132h_crc16(), selected on first use
+static enum aes132h_crc_kernel aes132h_crc_kernel_current = AES132H_CRC_KERNEL_AUTO;
+
+
+/** \brief This function fills the slicing tables. */
+static void aes132h_crc_build_tables(void)
+{
+	uint16_t crc;
+	uint16_t byte;
+	uint8_t bit, k;
+
+	for (byte = 0; byte < 256; byte++) {
+		crc = (uint16_t) (byte << 8);
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ AES132_CRC_POLYNOMIAL) : (uint16_t) (crc << 1);
+		aes132h_crc_tables[0][byte] = crc;
+	}
+
+	// Appending a zero byte shifts the CRC by eight bits.
+	for (k = 1; k < 8; k++)
+		for (byte = 0; byte < 256; byte++) {
+			crc = aes132h_crc_tables[k - 1][byte];
+			aes132h_crc_tables[k][byte] = (uint16_t) (crc << 8) ^ aes132h_crc_tables[0][crc >> 8];
+		}
+}
+
+
+/** \brief This function calculates a CRC with one table lookup per byte.
+ * \param[in] crc CRC of the preceding data, 0 to start
+ * \param[in] data pointer to data
+ * \param[in] length number of bytes in data buffer
+ * \return CRC
+ */
+uint16_t aes132h_crc16_table(uint16_t crc, const uint8_t *data, size_t length)
+{
+	pthread_once(&aes132h_crc_tables_once, aes132h_crc_build_tables);
+
+	while (length-- > 0)
+		crc = (uint16_t) (crc << 8) ^ aes132h_crc_tables[0][(crc >> 8) ^ *data++];
+
+	return crc;
+}
+
+
+/** \brief This function calculates a CRC eight bytes at a time (slicing-by-8).
+ *
+ * The CRC register is XORed into the first two bytes of every eight-byte chunk.
+ * The CRC of the chunk is then the XOR of the contributions of its bytes, each
+ * looked up in the table for its distance to the end of the chunk.
+ * \param[in] crc CRC of the preceding data, 0 to start
+ * \param[in] data pointer to data
+ * \param[in] length number of bytes in data buffer
+ * \return CRC
+ */
+uint16_t aes132h_crc16_slice8(uint16_t crc, const uint8_t *data, size_t length)
+{
+	pthread_once(&aes132h_crc_tables_once, aes132h_crc_build_tables);
+
+	while (length >= 8) {
+		crc = aes132h_crc_tables[7][data[0] ^ (crc >> 8)]
+			^ aes132h_crc_tables[6][data[1] ^ (crc & 0xFF)]
+			^ aes132h_crc_tables[5][data[2]]
+			^ aes132h_crc_tables[4][data[3]]
+			^ aes132h_crc_tables[3][data[4]]
+			^ aes132h_crc_tables[2][data[5]]
+			^ aes132h_crc_tables[1][data[6]]
+			^ aes132h_crc_tables[0][data[7]];
+		data += 8;
+		length -= 8;
+	}
+
+	return aes132h_crc16_table(crc, data, length);
+}
+
+
+#ifdef AES132H_HAVE_PCLMUL
+
+/** \name Folding constants x^n mod P(x), P(x) = x^16 + 0x8005
+ *
+ * A 128-bit remainder H * x^64 + L followed by n bits of data is congruent to
+ * H * (x^(n + 64) mod P) + L * (x^n mod P) followed by the data.
+ * Both products have fewer than 80 bits, so they fit into the next 128-bit block.
+@{ */
+#define AES132H_X128_MOD_P   (0x0106ULL)   //!< x^128 mod P, fold by one block
+#define AES132H_X192_MOD_P   (0x1666ULL)   //!< x^192 mod P, fold by one block
+#define AES132H_X512_MOD_P   (0x8107ULL)   //!< x^512 mod P, fold by four blocks
+#define AES132H_X576_MOD_P   (0x1446ULL)   //!< x^576 mod P, fold by four blocks
+/** @} */
+
+/** \brief This function folds a 128-bit remainder across the given distance.
+ * \param[in] remainder remainder to fold
+ * \param[in] constants x^(n + 64) mod P in the high and x^n mod P in the low quadword
+ * \return folded remainder, to be XORed with the block n bits further
+ */
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i aes132h_fold(__m128i remainder, __m128i constants)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(remainder, constants, 0x11),
+			_mm_clmulepi64_si128(remainder, constants, 0x00));
+}
+
+
+/** \brief This function calculates a CRC by carry-less multiply folding.
+ *
+ * Four 128-bit accumulators are folded 512 bits ahead while the data lasts. They are
+ * then folded into one, remaining whole blocks are folded in one at a time, and the
+ * last remainder and the tail bytes are finished with the byte table.
+ * \param[in] crc CRC of the preceding data, 0 to start
+ * \param[in] data pointer to data
+ * \param[in] length number of bytes in data buffer
+ * \return CRC
+ */
+__attribute__((target("pclmul,ssse3")))
+uint16_t aes132h_crc16_pclmul(uint16_t crc, const uint8_t *data, size_t length)
+{
+	// The CPU loads little-endian. Reversing the bytes turns the first byte into
+	// the most significant one, which is how the CRC treats the data.
+	const __m128i byte_swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i fold_1 = _mm_set_epi64x(AES132H_X192_MOD_P, AES132H_X128_MOD_P);
+	const __m128i fold_4 = _mm_set_epi64x(AES132H_X576_MOD_P, AES132H_X512_MOD_P);
+	__m128i x0, x1, x2, x3;
+	uint8_t remainder[16];
+
+	if (length < AES132H_PCLMUL_MIN_LENGTH)
+		return aes132h_crc16_slice8(crc, data, length);
+
+	x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 0)), byte_swap);
+	x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16)), byte_swap);
+	x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 32)), byte_swap);
+	x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 48)), byte_swap);
+
+	// A CRC of preceding data acts like an XOR into the first two bytes.
+	x0 = _mm_xor_si128(x0, _mm_set_epi64x((long long) ((uint64_t) crc << 48), 0));
+	data += 64;
+	length -= 64;
+
+	while (length >= 64) {
+		x0 = _mm_xor_si128(aes132h_fold(x0, fold_4),
+				_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 0)), byte_swap));
+		x1 = _mm_xor_si128(aes132h_fold(x1, fold_4),
+				_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16)), byte_swap));
+		x2 = _mm_xor_si128(aes132h_fold(x2, fold_4),
+				_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 32)), byte_swap));
+		x3 = _mm_xor_si128(aes132h_fold(x3, fold_4),
+				_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 48)), byte_swap));
+		data += 64;
+		length -= 64;
+	}
+
+	x1 = _mm_xor_si128(aes132h_fold(x0, fold_1), x1);
+	x2 = _mm_xor_si128(aes132h_fold(x1, fold_1), x2);
+	x3 = _mm_xor_si128(aes132h_fold(x2, fold_1), x3);
+
+	while (length >= 16) {
+		x3 = _mm_xor_si128(aes132h_fold(x3, fold_1),
+				_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) data), byte_swap));
+		data += 16;
+		length -= 16;
+	}
+
+	_mm_storeu_si128((__m128i *) remainder, _mm_shuffle_epi8(x3, byte_swap));
+	crc = aes132h_crc16_slice8(0, remainder, sizeof(remainder));
+
+	return aes132h_crc16_slice8(crc, data, length);
+}
+
+#else
+
+/** \brief This function falls back to slicing-by-8 on CPUs without carry-less multiply.
+ * \param[in] crc CRC of the preceding data, 0 to start
+ * \param[in] data pointer to data
+ * \param[in] length number of bytes in data buffer
+ * \return CRC
+ */
+uint16_t aes132h_crc16_pclmul(uint16_t crc, const uint8_t *data, size_t length)
+{
+	return aes132h_crc16_slice8(crc, data, length);
+}
+
+#endif
+
+
+/** \brief This function tells whether the CPU supports a kernel.
+ * \param[in] kernel kernel to check
+ * \return non-zero if supported
+ */
+int aes132h_crc_kernel_supported(enum aes132h_crc_kernel kernel)
+{
+	switch (kernel) {
+	case AES132H_CRC_KERNEL_AUTO:
+	case AES132H_CRC_KERNEL_TABLE:
+	case AES132H_CRC_KERNEL_SLICE8:
+		return 1;
+
+	case AES132H_CRC_KERNEL_PCLMUL:
+#ifdef AES132H_HAVE_PCLMUL
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+#else
+		return 0;
+#endif
+	}
+	return 0;
+}
+
+
+/** \brief This function selects the kernel used by aes132h_crc16().
+ * \param[in] kernel kernel to use, or #AES132H_CRC_KERNEL_AUTO for the fastest supported one
+ * \return selected kernel; falls back to slicing-by-8 if the requested kernel is not supported
+ */
+enum aes132h_crc_kernel aes132h_crc_select_kernel(enum aes132h_crc_kernel kernel)
+{
+	if (kernel == AES132H_CRC_KERNEL_AUTO)
+		kernel = aes132h_crc_kernel_supported(AES132H_CRC_KERNEL_PCLMUL)
+				? AES132H_CRC_KERNEL_PCLMUL : AES132H_CRC_KERNEL_SLICE8;
+	else if (!aes132h_crc_kernel_supported(kernel))
+		kernel = AES132H_CRC_KERNEL_SLICE8;
+
+	aes132h_crc_kernel_current = kernel;
+	return kernel;
+}
+
+
+/** \brief This function returns the name of a kernel for reports.
+ * \param[in] kernel kernel
+ * \return name
+ */
+const char *aes132h_crc_kernel_name(enum aes132h_crc_kernel kernel)
+{
+	switch (kernel) {
+	case AES132H_CRC_KERNEL_AUTO:   return "auto";
+	case AES132H_CRC_KERNEL_TABLE:  return "table";
+	case AES132H_CRC_KERNEL_SLICE8: return "slice8";
+	case AES132H_CRC_KERNEL_PCLMUL: return "pclmul";
+	}
+	return "unknown";
+}
+
+
+/** \brief This function calculates a CRC with the selected kernel.
+ *
+ * The first call selects the fastest supported kernel unless
+ * aes132h_crc_select_kernel() has been called before.
+ * \param[in] crc CRC of the preceding data, 0 to start
+ * \param[in] data pointer to data
+ * \param[in] length number of bytes in data buffer
+ * \return CRC
+ */
+uint16_t aes132h_crc16(uint16_t crc, const uint8_t *data, size_t length)
+{
+	enum aes132h_crc_kernel kernel = aes132h_crc_kernel_current;
+
+	if (kernel == AES132H_CRC_KERNEL_AUTO)
+		kernel = aes132h_crc_select_kernel(AES132H_CRC_KERNEL_AUTO);
+
+	switch (kernel) {
+	case AES132H_CRC_KERNEL_TABLE:
+		return aes132h_crc16_table(crc, data, length);
+	case AES132H_CRC_KERNEL_PCLMUL:
+		return aes132h_crc16_pclmul(crc, data, length);
+	default:
+		return aes132h_crc16_slice8(crc, data, length);
+	}
+}
+
+
+/** \brief This function validates one framed packet (count byte, body, CRC).
+ * \param[in] packet pointer to packet
+ * \param[in] length number of bytes available at packet
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS, #AES132_FUNCTION_RETCODE_COUNT_INVALID if the count
+ *         byte is out of range or does not match length, or #AES132_FUNCTION_RETCODE_BAD_CRC_RX
+ */
+uint8_t aes132h_validate_packet(const uint8_t *packet, size_t length)
+{
+	uint8_t count;
+	uint16_t crc;
+
+	if (length < AES132_RESPONSE_SIZE_MIN)
+		return AES132_FUNCTION_RETCODE_COUNT_INVALID;
+
+	count = packet[AES132_RESPONSE_INDEX_COUNT];
+	if ((count != length) || (count < AES132_RESPONSE_SIZE_MIN) || (count > AES132_COMMAND_SIZE_MAX))
+		return AES132_FUNCTION_RETCODE_COUNT_INVALID;
+
+	crc = aes132h_crc16_slice8(0, packet, count - AES132_CRC_SIZE);
+	if ((packet[count - 2] != (uint8_t) (crc >> 8)) || (packet[count - 1] != (uint8_t) (crc & 0xFF)))
+		return AES132_FUNCTION_RETCODE_BAD_CRC_RX;
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function validates back-to-back framed packets, e.g. from an I2C capture.
+ *
+ * Packets are framed by their count byte. Commands and responses may be mixed, so every
+ * count from #AES132_RESPONSE_SIZE_MIN to #AES132_COMMAND_SIZE_MAX is accepted.
+ * Validation stops
+ * - after max_results packets,
+ * - at a count byte out of range (reported with #AES132_FUNCTION_RETCODE_COUNT_INVALID, since
+ *   the stream cannot be framed beyond it), or
+ * - at a packet that is cut off by the end of the stream (not reported; pass the unconsumed
+ *   bytes again together with the next chunk of the stream).
+ * \param[in] stream pointer to packets
+ * \param[in] length number of bytes in stream
+ * \param[out] results one result per packet
+ * \param[in] max_results number of elements in results
+ * \param[out] consumed number of bytes of complete, reported packets (may be NULL)
+ * \return number of results written
+ */
+size_t aes132h_validate_packets(const uint8_t *stream, size_t length,
+			struct aes132h_packet_result *results, size_t max_results, size_t *consumed)
+{
+	size_t offset = 0;
+	size_t n_results = 0;
+	uint8_t count;
+
+	while ((n_results < max_results) && (offset < length)) {
+		count = stream[offset];
+		if ((count < AES132_RESPONSE_SIZE_MIN) || (count > AES132_COMMAND_SIZE_MAX)) {
+			results[n_results].offset = offset;
+			results[n_results].count = count;
+			results[n_results].status = AES132_FUNCTION_RETCODE_COUNT_INVALID;
+			n_results++;
+			break;
+		}
+		if (count > length - offset)
+			break;
+
+		results[n_results].offset = offset;
+		results[n_results].count = count;
+		results[n_results].status = aes132h_validate_packet(&stream[offset], count);
+		n_results++;
+		offset += count;
+	}
+
+	if (consumed)
+		*consumed = offset;
+	return n_results;
+}
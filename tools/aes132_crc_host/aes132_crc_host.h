@@ -0,0 +1,66 @@
+/** \file
+ *  \brief  Host-side CRC-16 kernels and batch packet validation for AES132 tooling.
+ *
+ * Same CRC as aes132c_calculate_crc() (polynomial 0x8005, initial value 0x0000,
+ * MSB first, no final XOR), but for buffers of any length and with kernels suited
+ * to a PC:
+ *
+ * <table>
+ *   <tr><th>Kernel</th>  <th>Method</th></tr>
+ *   <tr><td>table</td>   <td>one 256-entry table lookup per byte</td></tr>
+ *   <tr><td>slice8</td>  <td>slicing-by-8, eight independent lookups per 8 bytes</td></tr>
+ *   <tr><td>pclmul</td>  <td>carry-less multiply folding of 4 x 128 bits (x86 PCLMULQDQ)</td></tr>
+ * </table>
+ *
+ * aes132h_crc16() dispatches at runtime to the fastest kernel the CPU supports.
+ * Folding needs at least 64 bytes to pay off, so shorter buffers always take the
+ * slice8 kernel. Single packets (at most 63 bytes) therefore never reach the
+ * pclmul kernel; it serves captures and dumps that are checksummed as a whole.
+ *
+ * This module is not part of the firmware. It is built by the native environments
+ * in platformio.ini.
+ */
+
+#ifndef AES132_CRC_HOST_H
+#   define AES132_CRC_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief These enumerations select a CRC kernel. */
+enum aes132h_crc_kernel {
+	AES132H_CRC_KERNEL_AUTO   = 0,   //!< fastest kernel supported by the CPU
+	AES132H_CRC_KERNEL_TABLE  = 1,   //!< byte table
+	AES132H_CRC_KERNEL_SLICE8 = 2,   //!< slicing-by-8
+	AES132H_CRC_KERNEL_PCLMUL = 3    //!< carry-less multiply folding
+};
+
+/** \brief result of validating one framed packet with aes132h_validate_packets() */
+struct aes132h_packet_result {
+	size_t  offset;     //!< offset of the count byte in the stream
+	uint8_t count;      //!< count byte, i.e. packet size
+	uint8_t status;     //!< #AES132_FUNCTION_RETCODE_SUCCESS, _BAD_CRC_RX or _COUNT_INVALID
+};
+
+int      aes132h_crc_kernel_supported(enum aes132h_crc_kernel kernel);
+enum aes132h_crc_kernel aes132h_crc_select_kernel(enum aes132h_crc_kernel kernel);
+const char *aes132h_crc_kernel_name(enum aes132h_crc_kernel kernel);
+
+uint16_t aes132h_crc16(uint16_t crc, const uint8_t *data, size_t length);
+uint16_t aes132h_crc16_table(uint16_t crc, const uint8_t *data, size_t length);
+uint16_t aes132h_crc16_slice8(uint16_t crc, const uint8_t *data, size_t length);
+uint16_t aes132h_crc16_pclmul(uint16_t crc, const uint8_t *data, size_t length);
+
+uint8_t  aes132h_validate_packet(const uint8_t *packet, size_t length);
+size_t   aes132h_validate_packets(const uint8_t *stream, size_t length,
+			struct aes132h_packet_result *results, size_t max_results, size_t *consumed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
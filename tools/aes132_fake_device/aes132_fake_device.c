@@ -0,0 +1,324 @@
+/** \file
+ *  \brief  Fake AES132 device for host builds.
+ *
+ * See aes132_fake_device.h for what is modeled.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "aes132_comm.h"
+#include "aes132_comm_marshaling.h"
+#include "aes132_fake_device.h"
+#include "aes132_opcode.h"
+#include "aes132_power.h"
+#include "aes132_timer.h"
+
+
+/** \brief This function returns whether the device is executing a command or waking up.
+ *
+ * An access to a device in Standby or Sleep mode starts waking it up.
+ * \param[in,out] device fake device
+ * \return non-zero while busy
+ */
+static uint8_t aes132h_fake_is_busy(struct aes132h_fake_device *device)
+{
+	uint32_t now_us = aes132c_now_us();
+
+	if ((device->power_mode != AES132_POWER_MODE_ACTIVE) && !device->is_waking) {
+		device->is_waking = 1;
+		device->ready_us = now_us + ((device->power_mode == AES132_POWER_MODE_STANDBY)
+					? device->standby_wake_us : device->sleep_wake_us);
+	}
+
+	if ((int32_t) (device->ready_us - now_us) > 0)
+		return 1;
+
+	device->power_mode = AES132_POWER_MODE_ACTIVE;
+	device->is_waking = 0;
+	return 0;
+}
+
+
+/** \brief This function decides whether to ack an access.
+ * \param[in,out] device fake device
+ * \param[out] is_busy non-zero if the device is busy
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS, or #AES132_FUNCTION_RETCODE_COMM_FAIL for a nack
+ */
+static uint8_t aes132h_fake_begin_access(struct aes132h_fake_device *device, uint8_t *is_busy)
+{
+	*is_busy = aes132h_fake_is_busy(device);
+
+	if (device->n_nacks > 0) {
+		device->n_nacks--;
+		return AES132_FUNCTION_RETCODE_COMM_FAIL;
+	}
+
+	if (*is_busy && device->is_nack_busy)
+		return AES132_FUNCTION_RETCODE_COMM_FAIL;
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function puts a response with its count and CRC into the response buffer.
+ * \param[in,out] device fake device
+ * \param[in] size response size including count byte and CRC
+ * \param[in] return_code response return code
+ */
+static void aes132h_fake_respond(struct aes132h_fake_device *device, uint8_t size, uint8_t return_code)
+{
+	device->response[AES132_RESPONSE_INDEX_COUNT] = size;
+	device->response[AES132_RESPONSE_INDEX_RETURN_CODE] = return_code;
+	aes132c_calculate_crc(size - AES132_CRC_SIZE, device->response, &device->response[size - AES132_CRC_SIZE]);
+	device->response_index = 0;
+	device->status = AES132_RESPONSE_READY_BIT;
+}
+
+
+/** \brief This function runs a command whose count and CRC are good.
+ * \param[in,out] device fake device
+ * \param[in] command command buffer
+ */
+static void aes132h_fake_run_command(struct aes132h_fake_device *device, const uint8_t *command)
+{
+	uint8_t op_code = command[AES132_COMMAND_INDEX_OPCODE];
+	uint8_t mode = command[AES132_COMMAND_INDEX_MODE];
+	uint16_t param1 = (uint16_t) ((command[AES132_COMMAND_INDEX_PARAM1_MSB] << 8) | command[AES132_COMMAND_INDEX_PARAM1_LSB]);
+	uint16_t param2 = (uint16_t) ((command[AES132_COMMAND_INDEX_PARAM2_MSB] << 8) | command[AES132_COMMAND_INDEX_PARAM2_LSB]);
+	uint8_t size = aes132c_get_response_size(op_code, mode, param2);
+	uint8_t i;
+
+	device->n_commands++;
+
+	if (op_code == AES132_SLEEP) {
+		device->power_mode = (mode == AES132_COMMAND_MODE_STANDBY) ? AES132_POWER_MODE_STANDBY : AES132_POWER_MODE_SLEEP;
+		device->status = 0;
+		return;
+	}
+
+	if (!aes132c_get_opcode_descriptor(op_code) || (size == 0)) {
+		aes132h_fake_respond(device, AES132_RESPONSE_SIZE_MIN, AES132_DEVICE_RETCODE_PARSE_ERROR);
+		return;
+	}
+
+	if (op_code == AES132_BLOCK_READ) {
+		if ((uint32_t) param1 + param2 > AES132H_FAKE_MEMORY_SIZE) {
+			aes132h_fake_respond(device, AES132_RESPONSE_SIZE_MIN, AES132_DEVICE_RETCODE_BAD_ADDR);
+			return;
+		}
+		memcpy(&device->response[AES132_RESPONSE_INDEX_DATA], &device->memory[param1], param2);
+	}
+	else {
+		for (i = AES132_RESPONSE_INDEX_DATA; i < size - AES132_CRC_SIZE; i++)
+			device->response[i] = i;
+	}
+	aes132h_fake_respond(device, size, AES132_DEVICE_RETCODE_SUCCESS);
+
+	device->ready_us = aes132c_now_us() + (device->execution_us
+				? device->execution_us : aes132c_get_execution_time(op_code, mode).typical_us);
+}
+
+
+/** \brief This function writes a command to the I/O buffer.
+ * \param[in,out] device fake device
+ * \param[in] segments buffers to write, in order
+ * \param[in] n_segments number of segments
+ */
+static void aes132h_fake_write_command(struct aes132h_fake_device *device, const struct aes132_segment *segments,
+			uint8_t n_segments)
+{
+	uint8_t command[AES132_COMMAND_SIZE_MAX];
+	uint8_t count = 0;
+	uint8_t crc[AES132_CRC_SIZE] = {0, 0};
+	uint8_t i;
+
+	for (i = 0; i < n_segments; i++) {
+		if (count + segments[i].count > sizeof(command)) {
+			count = 0;
+			break;
+		}
+		memcpy(&command[count], segments[i].data, segments[i].count);
+		count += segments[i].count;
+	}
+
+	if ((count >= AES132_COMMAND_SIZE_MIN) && (command[AES132_COMMAND_INDEX_COUNT] == count))
+		aes132c_calculate_crc(count - AES132_CRC_SIZE, command, crc);
+	else
+		count = 0;
+	if ((count == 0) || memcmp(crc, &command[count - AES132_CRC_SIZE], AES132_CRC_SIZE)) {
+		// The device does not run the command, and flags the error in the device status register.
+		device->n_crc_errors++;
+		device->status = AES132_CRC_ERROR_BIT;
+		return;
+	}
+
+	aes132h_fake_run_command(device, command);
+}
+
+
+/** \brief This function does nothing: the fake device has no interface to enable or disable.
+ * \param[in] context fake device
+ */
+static void aes132h_fake_set_interface(void *context)
+{
+	(void) context;
+}
+
+
+/** \brief This function selects the fake device. Every device id does.
+ * \param[in] context fake device
+ * \param[in] device_id device id
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS
+ */
+static uint8_t aes132h_fake_select_device(void *context, uint8_t device_id)
+{
+	(void) context;
+	(void) device_id;
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function reads from the fake device.
+ * \param[in] context fake device
+ * \param[in] size number of bytes to read
+ * \param[in] word_address word address to read from
+ * \param[out] data pointer to rx buffer
+ * \return status of the operation
+ */
+static uint8_t aes132h_fake_read_memory(void *context, uint8_t size, uint16_t word_address, uint8_t *data)
+{
+	struct aes132h_fake_device *device = (struct aes132h_fake_device *) context;
+	uint8_t is_busy;
+	uint8_t i;
+	uint8_t aes132_lib_return = aes132h_fake_begin_access(device, &is_busy);
+
+	device->n_reads++;
+	if (aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS)
+		return aes132_lib_return;
+
+	if (word_address == AES132_STATUS_ADDR) {
+		*data = is_busy ? AES132_WIP_BIT : device->status;
+		for (i = 1; i < size; i++)
+			data[i] = data[0];
+	}
+	else if (word_address == AES132_IO_ADDR) {
+		for (i = 0; i < size; i++) {
+			data[i] = (!is_busy && (device->response_index < device->response[AES132_RESPONSE_INDEX_COUNT]))
+						? device->response[device->response_index++] : 0xFF;
+		}
+		if ((size > 0) && (device->max_clock_hz > 0) && (device->clock_hz > device->max_clock_hz))
+			// The bus is too fast for this board.
+			data[size - 1] ^= 0x01;
+	}
+	else if ((uint32_t) word_address + size <= AES132H_FAKE_MEMORY_SIZE)
+		memcpy(data, &device->memory[word_address], size);
+	else
+		memset(data, 0, size);
+
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function writes to the fake device.
+ * \param[in] context fake device
+ * \param[in] word_address word address to write to
+ * \param[in] segments buffers to write, in order
+ * \param[in] n_segments number of segments
+ * \return status of the operation
+ */
+static uint8_t aes132h_fake_write_memory_segments(void *context, uint16_t word_address,
+			const struct aes132_segment *segments, uint8_t n_segments)
+{
+	struct aes132h_fake_device *device = (struct aes132h_fake_device *) context;
+	uint8_t is_busy;
+	uint8_t i;
+	uint16_t address = word_address;
+	uint8_t aes132_lib_return = aes132h_fake_begin_access(device, &is_busy);
+
+	device->n_writes++;
+	if ((aes132_lib_return != AES132_FUNCTION_RETCODE_SUCCESS) || is_busy)
+		// A busy device that does not nack ignores the write.
+		return aes132_lib_return;
+
+	if (word_address == AES132_IO_ADDR) {
+		aes132h_fake_write_command(device, segments, n_segments);
+		return aes132_lib_return;
+	}
+
+	if (word_address == AES132_RESET_ADDR) {
+		device->response_index = 0;
+		return aes132_lib_return;
+	}
+
+	if (word_address >= AES132H_FAKE_MEMORY_SIZE)
+		return aes132_lib_return;
+
+	for (i = 0; i < n_segments; i++) {
+		if ((uint32_t) address + segments[i].count > AES132H_FAKE_MEMORY_SIZE) {
+			aes132h_fake_respond(device, AES132_RESPONSE_SIZE_MIN, AES132_DEVICE_RETCODE_BAD_ADDR);
+			return aes132_lib_return;
+		}
+		memcpy(&device->memory[address], segments[i].data, segments[i].count);
+		address += segments[i].count;
+	}
+	aes132h_fake_respond(device, AES132_RESPONSE_SIZE_MIN, AES132_DEVICE_RETCODE_SUCCESS);
+
+	return aes132_lib_return;
+}
+
+
+/** \brief This function re-synchronizes communication with the fake device.
+ * \param[in] context fake device
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS
+ */
+static uint8_t aes132h_fake_resync(void *context)
+{
+	struct aes132h_fake_device *device = (struct aes132h_fake_device *) context;
+
+	device->n_resyncs++;
+	device->response_index = 0;
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function sets the clock the fake device is accessed with.
+ * \param[in] context fake device
+ * \param[in] clock_hz clock in Hz
+ * \return #AES132_FUNCTION_RETCODE_SUCCESS
+ */
+static uint8_t aes132h_fake_set_clock(void *context, uint32_t clock_hz)
+{
+	struct aes132h_fake_device *device = (struct aes132h_fake_device *) context;
+
+	device->n_clock_changes++;
+	device->clock_hz = clock_hz;
+	return AES132_FUNCTION_RETCODE_SUCCESS;
+}
+
+
+/** \brief This function initializes a fake device and its transport.
+ *
+ * The device is active and idle, nacks while busy, runs commands in their typical time,
+ * and wakes up in 0.3 ms from Standby and 1.5 ms from Sleep mode. Its memory is erased (0xFF).
+ * \param[out] device fake device
+ */
+void aes132h_fake_device_init(struct aes132h_fake_device *device)
+{
+	memset(device, 0, sizeof(*device));
+	memset(device->memory, 0xFF, sizeof(device->memory));
+
+	device->transport.enable_interface = aes132h_fake_set_interface;
+	device->transport.disable_interface = aes132h_fake_set_interface;
+	device->transport.select_device = aes132h_fake_select_device;
+	device->transport.read_memory = aes132h_fake_read_memory;
+	device->transport.write_memory_segments = aes132h_fake_write_memory_segments;
+	device->transport.resync = aes132h_fake_resync;
+	device->transport.set_clock = aes132h_fake_set_clock;
+	device->transport.context = device;
+
+	device->is_nack_busy = 1;
+	device->standby_wake_us = 300;
+	device->sleep_wake_us = 1500;
+	device->ready_us = aes132c_now_us();
+}
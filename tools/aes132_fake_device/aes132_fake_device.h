@@ -0,0 +1,83 @@
+/** \file
+ *  \brief  Fake AES132 device for host builds and tests.
+ *
+ * A fake device is reached through its own transport (see aes132_transport.h), so the
+ * real communication layer can run on a PC against it:
+ * \code
+ * static struct aes132h_fake_device fake;
+ * aes132h_fake_device_init(&fake);
+ * ret = aes132c_select_device_transport(0xA0, &fake.transport);
+ * \endcode
+ * It models what the library relies on:
+ *
+ * - the I/O buffer: commands are checked for their count and CRC, and the response is read
+ *   back from the start after a write to #AES132_RESET_ADDR;
+ * - the device status register: WIP while a command executes, RRDY once the response is
+ *   ready, and the CRC bit after a command with a bad CRC, which is then not run;
+ * - execution time: the typical time of the op-code (see aes132c_get_execution_time()), or a
+ *   fixed time, on the clock of aes132c_now_us();
+ * - I2C address nacks while executing and while waking up from Standby or Sleep mode;
+ * - a bus that is not clean above a clock rate: responses read while the clock set through the
+ *   transport is faster than aes132h_fake_device::max_clock_hz arrive with a bit flipped;
+ * - user memory that BlockRead and memory writes access.
+ *
+ * Other commands return a response of the size aes132c_get_response_size() gives, with a
+ * counting pattern as data. Commands with an unknown op-code return a parse error.
+ * Faults are injected by setting aes132h_fake_device::n_nacks.
+ *
+ * This module is not part of the firmware. It is built by the native environments
+ * in platformio.ini, and for the Unity tests in test/.
+ */
+
+#ifndef AES132_FAKE_DEVICE_H
+#   define AES132_FAKE_DEVICE_H
+
+#include <stdint.h>
+
+#include "aes132_comm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! size of the user memory of the fake device
+#define AES132H_FAKE_MEMORY_SIZE        ((uint16_t) 0x1000)
+
+//! state of a fake device; set the configuration after aes132h_fake_device_init()
+struct aes132h_fake_device {
+	struct aes132_transport transport;  //!< transport that reaches this device
+
+	// configuration
+	uint8_t is_nack_busy;               //!< non-zero to nack accesses while busy, like the device on I2C
+	uint32_t execution_us;              //!< execution time of every command, 0 for the typical time of its op-code
+	uint32_t standby_wake_us;           //!< time to wake up from Standby mode
+	uint32_t sleep_wake_us;             //!< time to wake up from Sleep mode
+	uint8_t n_nacks;                    //!< number of accesses to nack from now on, for fault injection
+	uint32_t max_clock_hz;              //!< fastest clock at which responses arrive intact, 0 for any
+
+	// device state
+	uint8_t memory[AES132H_FAKE_MEMORY_SIZE];       //!< user memory
+	uint8_t response[AES132_RESPONSE_SIZE_MAX];     //!< response buffer
+	uint8_t response_index;             //!< index of the next response byte to read
+	uint8_t status;                     //!< device status register, without WIP
+	uint8_t power_mode;                 //!< power mode (#aes132_power_mode)
+	uint8_t is_waking;                  //!< non-zero while waking up
+	uint32_t ready_us;                  //!< time the command or the wakeup completes
+	uint32_t clock_hz;                  //!< clock set through the transport, 0 before it has been
+
+	// counters
+	uint32_t n_reads;                   //!< read transactions
+	uint32_t n_writes;                  //!< write transactions
+	uint32_t n_commands;                //!< commands run
+	uint32_t n_crc_errors;              //!< commands rejected for their CRC
+	uint32_t n_resyncs;                 //!< re-synchronizations
+	uint32_t n_clock_changes;           //!< clock changes through the transport
+};
+
+void aes132h_fake_device_init(struct aes132h_fake_device *device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,198 @@
+/** \file
+ *  \brief  Host stand-in for the ESP-IDF I2C master driver.
+ *
+ * See aes132_i2c_master_host.h.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes132_comm.h"
+#include "aes132_i2c_master_host.h"
+#include "driver/i2c_master.h"
+
+//! number of device handles the stand-in hands out
+#define AES132H_I2C_MASTER_DEVICE_COUNT_MAX   (8)
+
+struct i2c_master_bus_t {
+	uint8_t is_installed;
+};
+
+struct i2c_master_dev_t {
+	uint8_t device_id;          //!< I2C address shifted by one, as the library uses it
+	uint8_t in_use;
+	uint32_t scl_speed_hz;      //!< clock the device has been added with
+};
+
+static struct i2c_master_bus_t aes132h_i2c_master_bus;
+static struct i2c_master_dev_t aes132h_i2c_master_devices[AES132H_I2C_MASTER_DEVICE_COUNT_MAX];
+static struct aes132h_fake_device *aes132h_i2c_master_fake;
+static struct aes132h_i2c_master_statistics aes132h_i2c_master_statistics;
+
+
+/** \brief This function makes the stand-in reach a fake device and resets its counters.
+ *
+ * The fake device answers at every I2C address.
+ * \param[in] device fake device
+ */
+void aes132h_i2c_master_attach(struct aes132h_fake_device *device)
+{
+	aes132h_i2c_master_fake = device;
+	aes132h_i2c_master_statistics = (struct aes132h_i2c_master_statistics) {0, 0, 0};
+}
+
+
+/** \brief This function returns the counters of the stand-in.
+ * \return counters since aes132h_i2c_master_attach()
+ */
+const struct aes132h_i2c_master_statistics *aes132h_i2c_master_get_statistics(void)
+{
+	return &aes132h_i2c_master_statistics;
+}
+
+
+/** \brief This function counts a transaction and translates a return code of the fake device.
+ * \param[in] n_bytes bytes written and read
+ * \param[in] aes132_lib_return return code of the fake device
+ * \return ESP_OK, or ESP_ERR_INVALID_STATE for a nack
+ */
+static esp_err_t aes132h_i2c_master_return(size_t n_bytes, uint8_t aes132_lib_return)
+{
+	aes132h_i2c_master_statistics.n_transactions++;
+	aes132h_i2c_master_statistics.n_bytes += (uint32_t) n_bytes;
+	if (aes132_lib_return == AES132_FUNCTION_RETCODE_SUCCESS)
+		return ESP_OK;
+
+	aes132h_i2c_master_statistics.n_nacks++;
+	return ESP_ERR_INVALID_STATE;
+}
+
+
+/** \brief This function makes the fake device take a transaction of a device handle.
+ * \param[in] fake fake device
+ * \param[in] i2c_dev device handle
+ */
+static void aes132h_i2c_master_address(struct aes132h_fake_device *fake, i2c_master_dev_handle_t i2c_dev)
+{
+	(void) fake->transport.select_device(fake->transport.context, i2c_dev->device_id);
+	if (fake->clock_hz != i2c_dev->scl_speed_hz)
+		(void) fake->transport.set_clock(fake->transport.context, i2c_dev->scl_speed_hz);
+}
+
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle)
+{
+	if (!bus_config || !ret_bus_handle)
+		return ESP_ERR_INVALID_ARG;
+	if (aes132h_i2c_master_bus.is_installed)
+		return ESP_ERR_INVALID_STATE;
+
+	aes132h_i2c_master_bus.is_installed = 1;
+	*ret_bus_handle = &aes132h_i2c_master_bus;
+	return ESP_OK;
+}
+
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle)
+{
+	if (bus_handle != &aes132h_i2c_master_bus)
+		return ESP_ERR_INVALID_ARG;
+
+	bus_handle->is_installed = 0;
+	return ESP_OK;
+}
+
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config,
+			i2c_master_dev_handle_t *ret_handle)
+{
+	uint8_t i;
+
+	if ((bus_handle != &aes132h_i2c_master_bus) || !dev_config || !ret_handle
+				|| (dev_config->dev_addr_length != I2C_ADDR_BIT_LEN_7) || (dev_config->device_address > 0x7F))
+		return ESP_ERR_INVALID_ARG;
+
+	for (i = 0; i < AES132H_I2C_MASTER_DEVICE_COUNT_MAX; i++) {
+		if (!aes132h_i2c_master_devices[i].in_use) {
+			aes132h_i2c_master_devices[i].in_use = 1;
+			aes132h_i2c_master_devices[i].device_id = (uint8_t) (dev_config->device_address << 1);
+			aes132h_i2c_master_devices[i].scl_speed_hz = dev_config->scl_speed_hz;
+			*ret_handle = &aes132h_i2c_master_devices[i];
+			return ESP_OK;
+		}
+	}
+	return ESP_ERR_INVALID_STATE;
+}
+
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle)
+{
+	if (!handle || !handle->in_use)
+		return ESP_ERR_INVALID_ARG;
+
+	handle->in_use = 0;
+	return ESP_OK;
+}
+
+
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus_handle)
+{
+	struct aes132h_fake_device *fake = aes132h_i2c_master_fake;
+
+	if ((bus_handle != &aes132h_i2c_master_bus) || !fake)
+		return ESP_ERR_INVALID_ARG;
+
+	(void) fake->transport.resync(fake->transport.context);
+	return ESP_OK;
+}
+
+
+/** \brief This function writes a word address and reads from it, with a repeated Start in between.
+ *
+ * The fake device is reached by its word address, so the write has to be one.
+ */
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size,
+			uint8_t *read_buffer, size_t read_size, int xfer_timeout_ms)
+{
+	struct aes132h_fake_device *fake = aes132h_i2c_master_fake;
+
+	(void) xfer_timeout_ms;
+	if (!i2c_dev || !i2c_dev->in_use || !fake || (write_size != 2) || (read_size == 0) || (read_size > 0xFF))
+		return ESP_ERR_INVALID_ARG;
+
+	aes132h_i2c_master_address(fake, i2c_dev);
+	return aes132h_i2c_master_return(write_size + read_size, fake->transport.read_memory(fake->transport.context,
+				(uint8_t) read_size, (uint16_t) ((write_buffer[0] << 8) | write_buffer[1]), read_buffer));
+}
+
+
+/** \brief This function writes several buffers in one transaction.
+ *
+ * The first buffer has to be the word address, as aes132_i2c_master.c passes it.
+ */
+esp_err_t i2c_master_multi_buffer_transmit(i2c_master_dev_handle_t i2c_dev,
+			i2c_master_transmit_multi_buffer_info_t *buffer_info_array, size_t array_size, int xfer_timeout_ms)
+{
+	struct aes132h_fake_device *fake = aes132h_i2c_master_fake;
+	struct aes132_segment segments[AES132_SEGMENT_COUNT_MAX];
+	size_t n_bytes = 2;
+	size_t i;
+
+	(void) xfer_timeout_ms;
+	if (!i2c_dev || !i2c_dev->in_use || !fake || !buffer_info_array || (array_size == 0)
+				|| (array_size > 1 + AES132_SEGMENT_COUNT_MAX) || (buffer_info_array[0].buffer_size != 2))
+		return ESP_ERR_INVALID_ARG;
+
+	for (i = 1; i < array_size; i++) {
+		if (buffer_info_array[i].buffer_size > 0xFF)
+			return ESP_ERR_INVALID_ARG;
+		segments[i - 1].data = buffer_info_array[i].write_buffer;
+		segments[i - 1].count = (uint8_t) buffer_info_array[i].buffer_size;
+		n_bytes += buffer_info_array[i].buffer_size;
+	}
+
+	aes132h_i2c_master_address(fake, i2c_dev);
+	return aes132h_i2c_master_return(n_bytes, fake->transport.write_memory_segments(fake->transport.context,
+				(uint16_t) ((buffer_info_array[0].write_buffer[0] << 8) | buffer_info_array[0].write_buffer[1]),
+				segments, (uint8_t) (array_size - 1)));
+}
@@ -0,0 +1,45 @@
+/** \file
+ *  \brief  Host stand-in for the ESP-IDF I2C master driver.
+ *
+ * Host builds with AES132_I2C_MASTER=1 compile lib/aes132/aes132_i2c_master.c against the
+ * driver declared in driver/i2c_master.h of this directory. The stand-in turns every
+ * transaction into a call of the transport of a fake device (tools/aes132_fake_device):
+ * \code
+ * static struct aes132h_fake_device fake;
+ * aes132h_fake_device_init(&fake);
+ * aes132h_i2c_master_attach(&fake);
+ * ret = aes132c_select_device_transport(0xA0, &aes132_i2c_master_transport);
+ * \endcode
+ * A nack of the fake device becomes ESP_ERR_INVALID_STATE, which the driver returns
+ * for a nack. The fake device runs at the clock a device handle has been added with.
+ *
+ * This module is not part of the firmware. It is built by the native environments
+ * in platformio.ini.
+ */
+
+#ifndef AES132_I2C_MASTER_HOST_H
+#   define AES132_I2C_MASTER_HOST_H
+
+#include <stdint.h>
+
+#include "aes132_fake_device.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! counters of the stand-in
+struct aes132h_i2c_master_statistics {
+	uint32_t n_transactions;    //!< transactions run
+	uint32_t n_bytes;           //!< bytes written and read, without I2C addresses
+	uint32_t n_nacks;           //!< transactions the fake device nacked
+};
+
+void    aes132h_i2c_master_attach(struct aes132h_fake_device *device);
+const struct aes132h_i2c_master_statistics *aes132h_i2c_master_get_statistics(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,88 @@
+/** \file
+ *  \brief  Stand-in for the ESP-IDF I2C master driver (driver/i2c_master.h) on a host.
+ *
+ * Declares the part of the driver that aes132_i2c_master.c uses, with the same names and
+ * types, so that the backend compiles on a PC. aes132_i2c_master_host.c implements it on a
+ * fake device (see aes132_i2c_master_host.h).
+ *
+ * This module is not part of the firmware. It is built by the native environments
+ * in platformio.ini.
+ */
+
+#ifndef AES132_I2C_MASTER_HOST_DRIVER_H
+#   define AES132_I2C_MASTER_HOST_DRIVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_TIMEOUT         0x107
+
+typedef int i2c_port_num_t;
+typedef int gpio_num_t;
+
+typedef enum {
+	I2C_CLK_SRC_DEFAULT = 0,
+} i2c_clock_source_t;
+
+typedef enum {
+	I2C_ADDR_BIT_LEN_7 = 0,
+	I2C_ADDR_BIT_LEN_10 = 1,
+} i2c_addr_bit_len_t;
+
+typedef struct {
+	i2c_port_num_t i2c_port;
+	gpio_num_t sda_io_num;
+	gpio_num_t scl_io_num;
+	i2c_clock_source_t clk_source;
+	uint8_t glitch_ignore_cnt;
+	int intr_priority;
+	size_t trans_queue_depth;
+	struct {
+		uint32_t enable_internal_pullup : 1;
+	} flags;
+} i2c_master_bus_config_t;
+
+typedef struct {
+	i2c_addr_bit_len_t dev_addr_length;
+	uint16_t device_address;
+	uint32_t scl_speed_hz;
+	uint32_t scl_wait_us;
+	struct {
+		uint32_t disable_ack_check : 1;
+	} flags;
+} i2c_device_config_t;
+
+typedef struct {
+	uint8_t *write_buffer;
+	size_t buffer_size;
+} i2c_master_transmit_multi_buffer_info_t;
+
+typedef struct i2c_master_bus_t *i2c_master_bus_handle_t;
+typedef struct i2c_master_dev_t *i2c_master_dev_handle_t;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle);
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle);
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config,
+			i2c_master_dev_handle_t *ret_handle);
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle);
+esp_err_t i2c_master_bus_reset(i2c_master_bus_handle_t bus_handle);
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size,
+			uint8_t *read_buffer, size_t read_size, int xfer_timeout_ms);
+esp_err_t i2c_master_multi_buffer_transmit(i2c_master_dev_handle_t i2c_dev,
+			i2c_master_transmit_multi_buffer_info_t *buffer_info_array, size_t array_size, int xfer_timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
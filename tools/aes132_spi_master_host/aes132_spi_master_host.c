@@ -0,0 +1,193 @@
+/** \file
+ *  \brief  Host stand-in for the ESP-IDF SPI master driver, with a fake SPI device.
+ *
+ * See aes132_spi_master_host.h.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "aes132_comm.h"
+#include "aes132_spi_master_host.h"
+#include "driver/spi_master.h"
+
+//! number of SPI hosts
+#define AES132H_SPI_MASTER_HOST_COUNT       (3)
+
+//! number of device handles the stand-in hands out
+#define AES132H_SPI_MASTER_DEVICE_COUNT_MAX (4)
+
+struct spi_device_t {
+	uint8_t in_use;
+	spi_host_device_t host_id;
+	uint32_t clock_speed_hz;    //!< clock the device has been added with
+};
+
+static uint8_t aes132h_spi_master_is_installed[AES132H_SPI_MASTER_HOST_COUNT];
+static struct spi_device_t aes132h_spi_master_devices[AES132H_SPI_MASTER_DEVICE_COUNT_MAX];
+static struct aes132h_fake_device *aes132h_spi_master_fake;
+static uint8_t aes132h_spi_master_is_write_enabled;
+static struct aes132h_spi_master_statistics aes132h_spi_master_statistics;
+
+
+/** \brief This function makes the stand-in reach a fake device and resets its counters.
+ *
+ * The fake device stops nacking while busy, as on SPI, and its write enable latch is cleared.
+ * \param[in] device fake device
+ */
+void aes132h_spi_master_attach(struct aes132h_fake_device *device)
+{
+	device->is_nack_busy = 0;
+	aes132h_spi_master_fake = device;
+	aes132h_spi_master_is_write_enabled = 0;
+	aes132h_spi_master_statistics = (struct aes132h_spi_master_statistics) {0, 0, 0};
+}
+
+
+/** \brief This function returns the counters of the stand-in.
+ * \return counters since aes132h_spi_master_attach()
+ */
+const struct aes132h_spi_master_statistics *aes132h_spi_master_get_statistics(void)
+{
+	return &aes132h_spi_master_statistics;
+}
+
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_dma_chan_t dma_chan)
+{
+	(void) dma_chan;
+	if (((unsigned) host_id >= AES132H_SPI_MASTER_HOST_COUNT) || !bus_config)
+		return ESP_ERR_INVALID_ARG;
+	if (aes132h_spi_master_is_installed[host_id])
+		return ESP_ERR_INVALID_STATE;
+
+	aes132h_spi_master_is_installed[host_id] = 1;
+	return ESP_OK;
+}
+
+
+esp_err_t spi_bus_free(spi_host_device_t host_id)
+{
+	uint8_t i;
+
+	if (((unsigned) host_id >= AES132H_SPI_MASTER_HOST_COUNT) || !aes132h_spi_master_is_installed[host_id])
+		return ESP_ERR_INVALID_STATE;
+
+	// The driver refuses to free a bus with devices on it.
+	for (i = 0; i < AES132H_SPI_MASTER_DEVICE_COUNT_MAX; i++) {
+		if (aes132h_spi_master_devices[i].in_use && (aes132h_spi_master_devices[i].host_id == host_id))
+			return ESP_ERR_INVALID_STATE;
+	}
+
+	aes132h_spi_master_is_installed[host_id] = 0;
+	return ESP_OK;
+}
+
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config,
+			spi_device_handle_t *handle)
+{
+	uint8_t i;
+
+	if (((unsigned) host_id >= AES132H_SPI_MASTER_HOST_COUNT) || !dev_config || !handle
+				|| (dev_config->clock_speed_hz <= 0) || (dev_config->mode > 3))
+		return ESP_ERR_INVALID_ARG;
+	if (!aes132h_spi_master_is_installed[host_id])
+		return ESP_ERR_INVALID_STATE;
+
+	for (i = 0; i < AES132H_SPI_MASTER_DEVICE_COUNT_MAX; i++) {
+		if (!aes132h_spi_master_devices[i].in_use) {
+			aes132h_spi_master_devices[i].in_use = 1;
+			aes132h_spi_master_devices[i].host_id = host_id;
+			aes132h_spi_master_devices[i].clock_speed_hz = (uint32_t) dev_config->clock_speed_hz;
+			*handle = &aes132h_spi_master_devices[i];
+			return ESP_OK;
+		}
+	}
+	return ESP_ERR_INVALID_STATE;
+}
+
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+	if (!handle || !handle->in_use)
+		return ESP_ERR_INVALID_ARG;
+
+	handle->in_use = 0;
+	return ESP_OK;
+}
+
+
+/** \brief This function runs a full-duplex frame on the fake device.
+ *
+ * The first byte of the frame is the instruction. Bytes the device does not drive read as 0xFF.
+ */
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+	struct aes132h_fake_device *fake = aes132h_spi_master_fake;
+	const uint8_t *tx;
+	uint8_t *rx;
+	size_t size;
+	uint16_t word_address;
+	struct aes132_segment segment;
+
+	if (!handle || !handle->in_use || !fake || !trans_desc || !trans_desc->tx_buffer || !trans_desc->rx_buffer
+				|| (trans_desc->length == 0) || (trans_desc->length % 8 != 0)
+				|| ((trans_desc->rxlength != 0) && (trans_desc->rxlength != trans_desc->length)))
+		return ESP_ERR_INVALID_ARG;
+
+	tx = (const uint8_t *) trans_desc->tx_buffer;
+	rx = (uint8_t *) trans_desc->rx_buffer;
+	size = trans_desc->length / 8;
+	if ((tx[0] != AES132_SPI_WREN) && (tx[0] != AES132_SPI_WRDI) && (tx[0] != AES132_SPI_RDSR)
+				&& ((size < AES132_SPI_HEADER_SIZE) || (size > AES132_SPI_HEADER_SIZE + 0xFF)))
+		return ESP_ERR_INVALID_ARG;
+
+	aes132h_spi_master_statistics.n_transactions++;
+	aes132h_spi_master_statistics.n_bytes += (uint32_t) size;
+	memset(rx, 0xFF, size);
+	if (fake->clock_hz != handle->clock_speed_hz)
+		(void) fake->transport.set_clock(fake->transport.context, handle->clock_speed_hz);
+
+	word_address = (size >= AES132_SPI_HEADER_SIZE) ? (uint16_t) ((tx[1] << 8) | tx[2]) : 0;
+	switch (tx[0]) {
+	case AES132_SPI_WREN:
+		aes132h_spi_master_is_write_enabled = 1;
+		break;
+
+	case AES132_SPI_WRDI:
+		aes132h_spi_master_is_write_enabled = 0;
+		break;
+
+	case AES132_SPI_RDSR:
+		if ((size > 1) && (fake->transport.read_memory(fake->transport.context, 1, AES132_STATUS_ADDR, &rx[1])
+					!= AES132_FUNCTION_RETCODE_SUCCESS))
+			rx[1] = 0xFF;
+		break;
+
+	case AES132_SPI_READ:
+		if ((size > AES132_SPI_HEADER_SIZE) && (fake->transport.read_memory(fake->transport.context,
+					(uint8_t) (size - AES132_SPI_HEADER_SIZE), word_address, &rx[AES132_SPI_HEADER_SIZE])
+					!= AES132_FUNCTION_RETCODE_SUCCESS))
+			memset(&rx[AES132_SPI_HEADER_SIZE], 0xFF, size - AES132_SPI_HEADER_SIZE);
+		break;
+
+	case AES132_SPI_WRITE:
+		if (!aes132h_spi_master_is_write_enabled) {
+			aes132h_spi_master_statistics.n_ignored_writes++;
+			break;
+		}
+		aes132h_spi_master_is_write_enabled = 0;
+		segment.data = &tx[AES132_SPI_HEADER_SIZE];
+		segment.count = (uint8_t) (size - AES132_SPI_HEADER_SIZE);
+		(void) fake->transport.write_memory_segments(fake->transport.context, word_address, &segment, 1);
+		break;
+
+	default:
+		// The device ignores other instructions.
+		break;
+	}
+
+	return ESP_OK;
+}
@@ -0,0 +1,52 @@
+/** \file
+ *  \brief  Host stand-in for the ESP-IDF SPI master driver, with a fake SPI device.
+ *
+ * Host builds with AES132_SPI=1 compile lib/aes132/aes132_spi.c against the driver
+ * declared in driver/spi_master.h of this directory. The stand-in decodes every frame
+ * as the device would and turns it into a call of the transport of a fake device
+ * (tools/aes132_fake_device):
+ * \code
+ * static struct aes132h_fake_device fake;
+ * aes132h_fake_device_init(&fake);
+ * aes132h_spi_master_attach(&fake);
+ * ret = aes132c_select_device_transport(0xA0, &aes132_spi_transport);
+ * \endcode
+ * - RDSR reads the device status register, READ and WRITE the word address of the frame.
+ * - WRITE needs the write enable latch, set by WREN and cleared by WRDI and by every WRITE.
+ *   A WRITE without it is ignored and counted.
+ * - There are no nacks on SPI. The fake device is attached with
+ *   aes132h_fake_device::is_nack_busy cleared, so that it ignores accesses while busy, and
+ *   a nack injected with aes132h_fake_device::n_nacks reads as 0xFF.
+ *
+ * The fake device runs at the clock the device handle has been added with.
+ *
+ * This module is not part of the firmware. It is built by the native environments
+ * in platformio.ini.
+ */
+
+#ifndef AES132_SPI_MASTER_HOST_H
+#   define AES132_SPI_MASTER_HOST_H
+
+#include <stdint.h>
+
+#include "aes132_fake_device.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! counters of the stand-in
+struct aes132h_spi_master_statistics {
+	uint32_t n_transactions;    //!< frames run
+	uint32_t n_bytes;           //!< bytes of the frames, with instructions and word addresses
+	uint32_t n_ignored_writes;  //!< WRITE frames without the write enable latch
+};
+
+void    aes132h_spi_master_attach(struct aes132h_fake_device *device);
+const struct aes132h_spi_master_statistics *aes132h_spi_master_get_statistics(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+/** \file
+ *  \brief  Stand-in for the ESP-IDF SPI master driver (driver/spi_master.h) on a host.
+ *
+ * Declares the part of the driver that aes132_spi.c uses, with the same names and
+ * types, so that the backend compiles on a PC. aes132_spi_master_host.c implements it on a
+ * fake device (see aes132_spi_master_host.h).
+ *
+ * This module is not part of the firmware. It is built by the native environments
+ * in platformio.ini.
+ */
+
+#ifndef AES132_SPI_MASTER_HOST_DRIVER_H
+#   define AES132_SPI_MASTER_HOST_DRIVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_TIMEOUT         0x107
+
+typedef enum {
+	SPI1_HOST = 0,
+	SPI2_HOST = 1,
+	SPI3_HOST = 2,
+} spi_host_device_t;
+
+typedef enum {
+	SPI_DMA_DISABLED = 0,
+	SPI_DMA_CH_AUTO = 3,
+} spi_dma_chan_t;
+
+typedef struct {
+	int mosi_io_num;
+	int miso_io_num;
+	int sclk_io_num;
+	int quadwp_io_num;
+	int quadhd_io_num;
+	int max_transfer_sz;
+	uint32_t flags;
+	int intr_flags;
+} spi_bus_config_t;
+
+typedef struct {
+	uint8_t command_bits;
+	uint8_t address_bits;
+	uint8_t dummy_bits;
+	uint8_t mode;
+	uint16_t duty_cycle_pos;
+	uint16_t cs_ena_pretrans;
+	uint8_t cs_ena_posttrans;
+	int clock_speed_hz;
+	int input_delay_ns;
+	int spics_io_num;
+	uint32_t flags;
+	int queue_size;
+} spi_device_interface_config_t;
+
+typedef struct {
+	uint32_t flags;
+	uint16_t cmd;
+	uint64_t addr;
+	size_t length;              //!< bits to send
+	size_t rxlength;            //!< bits to receive, 0 for length
+	void *user;
+	union {
+		const void *tx_buffer;
+		uint8_t tx_data[4];
+	};
+	union {
+		void *rx_buffer;
+		uint8_t rx_data[4];
+	};
+} spi_transaction_t;
+
+typedef struct spi_device_t *spi_device_handle_t;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_dma_chan_t dma_chan);
+esp_err_t spi_bus_free(spi_host_device_t host_id);
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config,
+			spi_device_handle_t *handle);
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle);
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif